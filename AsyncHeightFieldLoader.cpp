@@ -0,0 +1,570 @@
+/** @file *//********************************************************************************************************
+
+                                               AsyncHeightFieldLoader.cpp
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/AsyncHeightFieldLoader.cpp#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#include "PrecompiledHeaders.h"
+
+#include "AsyncHeightFieldLoader.h"
+
+#include "HeightField.h"
+#include "HeightFieldLoader.h"
+
+#include "Misc/Types.h"
+
+using namespace std;
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! A load or prefetch that has not finished
+
+struct AsyncHeightFieldLoader::Job
+{
+	enum State
+	{
+		STATE_READ_QUEUED,		// Waiting for an I/O thread
+		STATE_READING,			// Being read by an I/O thread
+		STATE_READ,				// Read, but not requested yet (prefetch only)
+		STATE_DECODE_QUEUED,	// Waiting for a decode thread
+		STATE_DECODING			// Being decoded
+	};
+
+	Ticket			m_ticket;		// Ticket of the load. Also determines the order of jobs with the same priority.
+	string			m_fileName;		// Name of the file
+	float			m_zScale;		// Scale factor for the heights
+	int				m_priority;		// Priority
+	State			m_state;		// Current state
+	bool			m_cancelled;	// True if the job was cancelled while it was being read
+	Callback		m_callback;		// Called when the load finishes. Empty for a prefetch that has not been claimed.
+	bool			m_read;			// True if the image was read successfully
+	int				m_width;		// Width of the image
+	int				m_height;		// Height of the image
+	vector<uint8>	m_image;		// The image
+};
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	nIoThreads		Number of threads reading files
+//! @param	nDecodeThreads	Number of threads converting images. Each conversion is already done in parallel, so
+//!							more than one thread only helps when loading many small files.
+
+AsyncHeightFieldLoader::AsyncHeightFieldLoader( int nIoThreads /*= 2*/, int nDecodeThreads /*= 1*/ )
+	: m_nextTicket( 1 ),
+	m_stopping( false )
+{
+	assert( nIoThreads > 0 && nDecodeThreads > 0 );
+
+	m_threads.reserve( nIoThreads + nDecodeThreads );
+
+	for ( int k = 0; k < nIoThreads; k++ )
+	{
+		m_threads.push_back( thread( &AsyncHeightFieldLoader::IoThread, this ) );
+	}
+
+	for ( int k = 0; k < nDecodeThreads; k++ )
+	{
+		m_threads.push_back( thread( &AsyncHeightFieldLoader::DecodeThread, this ) );
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! The callbacks of the cancelled loads are called before the destructor returns.
+
+AsyncHeightFieldLoader::~AsyncHeightFieldLoader()
+{
+	CancelAll();
+
+	{
+		lock_guard<mutex>	lock( m_mutex );
+		m_stopping = true;
+	}
+
+	m_ioReady.notify_all();
+	m_decodeReady.notify_all();
+
+	for ( size_t k = 0; k < m_threads.size(); k++ )
+	{
+		m_threads[ k ].join();
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! If the file has been prefetched, its image is used instead of reading the file again.
+//!
+//! @param	sFileName	The name of the TGA file containing the height data.
+//! @param	zScale		Scale factor for height data
+//! @param	callback	Called when the load finishes, fails, or is cancelled. It must not throw.
+//! @param	priority	Loads with higher priorities are started first.
+//!
+//! @return		Ticket identifying the load
+//!
+//! @see	HeightFieldLoader::LoadTga()
+
+AsyncHeightFieldLoader::Ticket AsyncHeightFieldLoader::LoadTga( char const *		sFileName,
+																float				zScale,
+																Callback const &	callback,
+																int					priority /*= PRIORITY_NORMAL*/ )
+{
+	lock_guard<mutex>	lock( m_mutex );
+
+	Ticket const	ticket	= m_nextTicket++;
+	JobPtr			pJob;
+
+	// Claim a prefetch of the file if there is one. It is given the new ticket.
+
+	map< string, JobPtr >::iterator const	pPrefetched	= m_prefetched.find( sFileName );
+
+	if ( pPrefetched != m_prefetched.end() )
+	{
+		pJob = pPrefetched->second;
+		m_prefetched.erase( pPrefetched );
+		m_jobs.erase( pJob->m_ticket );
+	}
+	else
+	{
+		pJob.reset( new Job );
+		pJob->m_fileName	= sFileName;
+		pJob->m_state		= Job::STATE_READ_QUEUED;
+		pJob->m_cancelled	= false;
+		pJob->m_read		= false;
+		pJob->m_width		= 0;
+		pJob->m_height		= 0;
+
+		m_ioQueue.push_back( pJob );
+		m_ioReady.notify_one();
+	}
+
+	pJob->m_ticket		= ticket;
+	pJob->m_zScale		= zScale;
+	pJob->m_priority	= priority;
+	pJob->m_callback	= callback;
+
+	// If the prefetch has already been read, it only needs to be decoded
+
+	if ( pJob->m_state == Job::STATE_READ )
+	{
+		pJob->m_state = Job::STATE_DECODE_QUEUED;
+		m_decodeQueue.push_back( pJob );
+		m_decodeReady.notify_one();
+	}
+
+	m_jobs[ ticket ] = pJob;
+
+	return ticket;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	sFileName	The name of the TGA file containing the height data.
+//! @param	zScale		Scale factor for height data
+//! @param	priority	Loads with higher priorities are started first.
+//! @param	pTicket		If not 0, receives the ticket identifying the load, so that it can be cancelled.
+//!
+//! @return		A future holding the heightfield, or null if the load failed or was cancelled
+
+future< unique_ptr<HeightField> > AsyncHeightFieldLoader::LoadTga( char const *	sFileName,
+																   float		zScale,
+																   int			priority /*= PRIORITY_NORMAL*/,
+																   Ticket *		pTicket /*= 0*/ )
+{
+	shared_ptr< promise< unique_ptr<HeightField> > > const	pPromise( new promise< unique_ptr<HeightField> > );
+	future< unique_ptr<HeightField> >						result	= pPromise->get_future();
+
+	Ticket const	ticket	= LoadTga( sFileName, zScale, [ pPromise ]( Ticket, Status, unique_ptr<HeightField> pHF )
+	{
+		pPromise->set_value( std::move( pHF ) );
+	}, priority );
+
+	if ( pTicket != 0 )
+	{
+		*pTicket = ticket;
+	}
+
+	return result;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! The files are read in the background, several at a time, and their images are kept until they are loaded
+//! with LoadTga() or cancelled. A file that is already being prefetched is not read again.
+//!
+//! @param	files		Names of the TGA files to read
+//! @param	priority	Priority of the reads. Loads are usually more urgent, so the default is lower.
+//!
+//! @return		A ticket for each file, which can be used to cancel the prefetch until the file is loaded
+
+vector<AsyncHeightFieldLoader::Ticket> AsyncHeightFieldLoader::Prefetch( vector<string> const &	files,
+																		 int					priority /*= PRIORITY_PREFETCH*/ )
+{
+	vector<Ticket>	tickets;
+
+	tickets.reserve( files.size() );
+
+	lock_guard<mutex>	lock( m_mutex );
+
+	for ( size_t k = 0; k < files.size(); k++ )
+	{
+		map< string, JobPtr >::iterator const	pPrefetched	= m_prefetched.find( files[ k ] );
+
+		if ( pPrefetched != m_prefetched.end() )
+		{
+			tickets.push_back( pPrefetched->second->m_ticket );
+			continue;
+		}
+
+		JobPtr const	pJob( new Job );
+
+		pJob->m_ticket		= m_nextTicket++;
+		pJob->m_fileName	= files[ k ];
+		pJob->m_zScale		= 1.0f;
+		pJob->m_priority	= priority;
+		pJob->m_state		= Job::STATE_READ_QUEUED;
+		pJob->m_cancelled	= false;
+		pJob->m_read		= false;
+		pJob->m_width		= 0;
+		pJob->m_height		= 0;
+
+		m_ioQueue.push_back( pJob );
+		m_jobs[ pJob->m_ticket ] = pJob;
+		m_prefetched[ files[ k ] ] = pJob;
+		tickets.push_back( pJob->m_ticket );
+	}
+
+	m_ioReady.notify_all();
+
+	return tickets;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	ticket		The load
+//! @param	priority	New priority
+//!
+//! @return		false if the load has already started decoding or has finished
+
+bool AsyncHeightFieldLoader::SetPriority( Ticket ticket, int priority )
+{
+	lock_guard<mutex>	lock( m_mutex );
+
+	JobPtr const	pJob	= Find( ticket );
+
+	if ( !pJob )
+	{
+		return false;
+	}
+
+	pJob->m_priority = priority;
+
+	return true;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! The load's callback is called with @c STATUS_CANCELLED before this function returns.
+//!
+//! @param	ticket	The load or prefetch
+//!
+//! @return		false if the load has already started decoding or has finished
+
+bool AsyncHeightFieldLoader::Cancel( Ticket ticket )
+{
+	Callback	callback;
+
+	{
+		lock_guard<mutex>	lock( m_mutex );
+
+		JobPtr const	pJob	= Find( ticket );
+
+		if ( !pJob )
+		{
+			return false;
+		}
+
+		callback = CancelLocked( pJob );
+	}
+
+	if ( callback )
+	{
+		callback( ticket, STATUS_CANCELLED, unique_ptr<HeightField>() );
+	}
+
+	return true;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! The callbacks of the cancelled loads are called before this function returns.
+
+void AsyncHeightFieldLoader::CancelAll()
+{
+	vector< pair< Ticket, Callback > >	callbacks;
+
+	{
+		lock_guard<mutex>	lock( m_mutex );
+
+		while ( !m_jobs.empty() )
+		{
+			JobPtr const	pJob	= m_jobs.begin()->second;
+			Callback const	callback	= CancelLocked( pJob );
+
+			if ( callback )
+			{
+				callbacks.push_back( make_pair( pJob->m_ticket, callback ) );
+			}
+		}
+	}
+
+	for ( size_t k = 0; k < callbacks.size(); k++ )
+	{
+		callbacks[ k ].second( callbacks[ k ].first, STATUS_CANCELLED, unique_ptr<HeightField>() );
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+void AsyncHeightFieldLoader::IoThread()
+{
+	unique_lock<mutex>	lock( m_mutex );
+
+	while ( true )
+	{
+		m_ioReady.wait( lock, [ this ]() { return m_stopping || !m_ioQueue.empty(); } );
+
+		if ( m_stopping )
+		{
+			return;
+		}
+
+		JobPtr const	pJob	= PopHighest( m_ioQueue );
+
+		pJob->m_state = Job::STATE_READING;
+
+		// Read the file without holding the lock
+
+		lock.unlock();
+
+		int				width	= 0;
+		int				height	= 0;
+		vector<uint8>	image;
+		bool const		read	= HeightFieldLoader::ReadTgaImage( pJob->m_fileName.c_str(), width, height, image );
+
+		lock.lock();
+
+		if ( pJob->m_cancelled )
+		{
+			continue;
+		}
+
+		pJob->m_read	= read;
+		pJob->m_width	= width;
+		pJob->m_height	= height;
+		pJob->m_image.swap( image );
+
+		// An unclaimed prefetch waits until it is loaded
+
+		if ( pJob->m_callback )
+		{
+			pJob->m_state = Job::STATE_DECODE_QUEUED;
+			m_decodeQueue.push_back( pJob );
+			m_decodeReady.notify_one();
+		}
+		else
+		{
+			pJob->m_state = Job::STATE_READ;
+		}
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+void AsyncHeightFieldLoader::DecodeThread()
+{
+	unique_lock<mutex>	lock( m_mutex );
+
+	while ( true )
+	{
+		m_decodeReady.wait( lock, [ this ]() { return m_stopping || !m_decodeQueue.empty(); } );
+
+		if ( m_stopping )
+		{
+			return;
+		}
+
+		// Once decoding starts, the job can no longer be cancelled
+
+		JobPtr const	pJob	= PopHighest( m_decodeQueue );
+
+		pJob->m_state = Job::STATE_DECODING;
+		m_jobs.erase( pJob->m_ticket );
+
+		lock.unlock();
+
+		unique_ptr<HeightField>	pHF;
+		Status					status	= STATUS_FAILED;
+
+		if ( pJob->m_read )
+		{
+			try
+			{
+				pHF.reset( new HeightField( pJob->m_height, pJob->m_width, pJob->m_zScale, &pJob->m_image[0] ) );
+				status = STATUS_LOADED;
+			}
+			catch ( ... )
+			{
+				pHF.reset();
+			}
+		}
+
+		vector<uint8>().swap( pJob->m_image );
+
+		pJob->m_callback( pJob->m_ticket, status, std::move( pHF ) );
+
+		lock.lock();
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+AsyncHeightFieldLoader::JobPtr AsyncHeightFieldLoader::PopHighest( vector<JobPtr> & queue )
+{
+	assert( !queue.empty() );
+
+	size_t	best	= 0;
+
+	for ( size_t k = 1; k < queue.size(); k++ )
+	{
+		Job const &	job		= *queue[ k ];
+		Job const &	other	= *queue[ best ];
+
+		if ( job.m_priority > other.m_priority || ( job.m_priority == other.m_priority && job.m_ticket < other.m_ticket ) )
+		{
+			best = k;
+		}
+	}
+
+	JobPtr const	pJob	= queue[ best ];
+
+	queue.erase( queue.begin() + best );
+
+	return pJob;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+bool AsyncHeightFieldLoader::Remove( vector<JobPtr> & queue, JobPtr const & pJob )
+{
+	vector<JobPtr>::iterator const	p	= find( queue.begin(), queue.end(), pJob );
+
+	if ( p == queue.end() )
+	{
+		return false;
+	}
+
+	queue.erase( p );
+
+	return true;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+AsyncHeightFieldLoader::JobPtr AsyncHeightFieldLoader::Find( Ticket ticket ) const
+{
+	map< Ticket, JobPtr >::const_iterator const	p	= m_jobs.find( ticket );
+
+	return ( p != m_jobs.end() ) ? p->second : JobPtr();
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+AsyncHeightFieldLoader::Callback AsyncHeightFieldLoader::CancelLocked( JobPtr const & pJob )
+{
+	assert( pJob->m_state != Job::STATE_DECODING );
+
+	switch ( pJob->m_state )
+	{
+	case Job::STATE_READ_QUEUED:
+		Remove( m_ioQueue, pJob );
+		break;
+
+	case Job::STATE_READING:		// The I/O thread discards it when it is done
+		pJob->m_cancelled = true;
+		break;
+
+	case Job::STATE_DECODE_QUEUED:
+		Remove( m_decodeQueue, pJob );
+		break;
+
+	default:
+		break;
+	}
+
+	m_jobs.erase( pJob->m_ticket );
+
+	if ( !pJob->m_callback )
+	{
+		m_prefetched.erase( pJob->m_fileName );
+	}
+
+	vector<uint8>().swap( pJob->m_image );
+
+	Callback	callback;
+
+	callback.swap( pJob->m_callback );
+
+	return callback;
+}
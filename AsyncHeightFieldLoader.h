@@ -0,0 +1,132 @@
+/** @file *//********************************************************************************************************
+
+                                                AsyncHeightFieldLoader.h
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/AsyncHeightFieldLoader.h#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class HeightField;
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! Loads HeightFields in the background.
+//!
+//! A load has two stages. An I/O thread reads the image from the file, and then a decode thread converts it to a
+//! HeightField. The stages run on separate pools, so while one file is being converted the next one is being
+//! read. Pending loads are started in order of priority (highest first) and then in the order they were
+//! requested. A load can be cancelled until its decoding starts.
+//!
+//! Files can be prefetched. A prefetched file is read by the I/O pool and its image is kept until it is loaded
+//! or cancelled, so a later load of that file only needs to be decoded.
+//!
+//! @note	Callbacks are called on a decode thread, or on the calling thread if the load is cancelled.
+
+class AsyncHeightFieldLoader
+{
+public:
+
+	//! Identifies a load
+	typedef unsigned long long	Ticket;
+
+	//! How a load finished
+	enum Status
+	{
+		STATUS_LOADED,		//!< The HeightField was loaded
+		STATUS_FAILED,		//!< The file could not be read or converted
+		STATUS_CANCELLED	//!< The load was cancelled
+	};
+
+	//! Called when a load finishes. The HeightField is null unless the status is STATUS_LOADED.
+	typedef std::function< void ( Ticket ticket, Status status, std::unique_ptr< HeightField > pHF ) >	Callback;
+
+	//! Default priority of a load
+	static int const	PRIORITY_NORMAL		= 0;
+
+	//! Default priority of a prefetch
+	static int const	PRIORITY_PREFETCH	= -100;
+
+	//! Constructor
+	explicit AsyncHeightFieldLoader( int nIoThreads = 2, int nDecodeThreads = 1 );
+
+	//! Destructor. Cancels all pending loads and waits for the ones in progress.
+	~AsyncHeightFieldLoader();
+
+	//! Loads a HeightField from a TGA file and calls @a callback when it is done.
+	Ticket LoadTga( char const * sFileName, float zScale, Callback const & callback, int priority = PRIORITY_NORMAL );
+
+	//! Loads a HeightField from a TGA file. The result is null if the load fails or is cancelled.
+	std::future< std::unique_ptr< HeightField > > LoadTga( char const * sFileName,
+														   float zScale,
+														   int priority = PRIORITY_NORMAL,
+														   Ticket * pTicket = 0 );
+
+	//! Starts reading a list of files in the background.
+	std::vector< Ticket > Prefetch( std::vector< std::string > const & files, int priority = PRIORITY_PREFETCH );
+
+	//! Changes the priority of a load that has not started.
+	bool SetPriority( Ticket ticket, int priority );
+
+	//! Cancels a load.
+	bool Cancel( Ticket ticket );
+
+	//! Cancels all loads and prefetches that have not started decoding.
+	void CancelAll();
+
+private:
+
+	struct Job;
+	typedef std::shared_ptr< Job >	JobPtr;
+
+	// Body of an I/O thread
+	void IoThread();
+
+	// Body of a decode thread
+	void DecodeThread();
+
+	// Removes and returns the highest-priority job in a queue
+	static JobPtr PopHighest( std::vector< JobPtr > & queue );
+
+	// Removes a job from a queue. Returns false if it is not there.
+	static bool Remove( std::vector< JobPtr > & queue, JobPtr const & pJob );
+
+	// Returns the job with the given ticket, or null
+	JobPtr Find( Ticket ticket ) const;
+
+	// Cancels a job whose decoding has not started. Returns the callback to call, if any. The lock must be held.
+	Callback CancelLocked( JobPtr const & pJob );
+
+	AsyncHeightFieldLoader( AsyncHeightFieldLoader const & );
+	AsyncHeightFieldLoader & operator =( AsyncHeightFieldLoader const & );
+
+	mutable std::mutex						m_mutex;			//!< Protects everything below
+	std::condition_variable					m_ioReady;			//!< Signalled when there is I/O to do
+	std::condition_variable					m_decodeReady;		//!< Signalled when there is decoding to do
+	std::vector< JobPtr >					m_ioQueue;			//!< Jobs waiting to be read
+	std::vector< JobPtr >					m_decodeQueue;		//!< Jobs waiting to be decoded
+	std::map< Ticket, JobPtr >				m_jobs;				//!< Jobs that have not finished
+	std::map< std::string, JobPtr >			m_prefetched;		//!< Prefetches that have not been claimed
+	Ticket									m_nextTicket;		//!< Ticket of the next job
+	bool									m_stopping;			//!< True when the threads should exit
+	std::vector< std::thread >				m_threads;			//!< I/O and decode threads
+};
@@ -15,10 +15,45 @@
 
 #include "HeightField.h"
 
+#include "HeightFieldStatistics.h"
+#include "HeightFieldView.h"
+#include "Parallel.h"
 
 using namespace std;
 
 
+namespace
+{
+
+// Minimum number of vertexes initialized by a single thread
+int const	FILL_GRAIN	= 64 * 1024;
+
+} // anonymous namespace
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	f	Function called as <tt>f( i0, i1 )</tt> to initialize the rows [ @a i0, @a i1 )
+//!
+//! The storage allocator does not touch the vertex array when it is resized, so the first write here determines
+//! which NUMA node each page is placed on. Filling it in parallel spreads the pages across the nodes of the threads.
+
+template< typename Function >
+void HeightField::Fill( Function const & f )
+{
+	if ( GetAllocatorPolicy().m_parallelFirstTouch )
+	{
+		Parallel::For( 0, m_sizeI, max( FILL_GRAIN / max( m_stride, 1 ), 1 ), f );
+	}
+	else
+	{
+		f( 0, m_sizeI );
+	}
+}
+
+
 /********************************************************************************************************************/
 /*																													*/
 /********************************************************************************************************************/
@@ -29,25 +64,38 @@ using namespace std;
 //! @param	sizeJ	Size of the heightfield along the J axis.
 //! @param	pData	Height data to be copied. If @a pData is 0 or omitted, no data is copied. The data should be in
 //!					this order: <tt>pData[i][j]</tt>.
+//! @param	policy	Allocation policy for the vertex array
 
-HeightField::HeightField( int sizeI /*= 0*/, int sizeJ /*= 0*/, float const * pData /*= 0*/ )
-	: m_sizeI( sizeI ), m_sizeJ( sizeJ )
+HeightField::HeightField( int sizeI /*= 0*/, int sizeJ /*= 0*/, float const * pData /*= 0*/,
+						  HeightFieldAllocatorPolicy const & policy /*= HeightFieldAllocatorPolicy()*/ )
+	: m_sizeI( sizeI ), m_sizeJ( sizeJ ), m_edgeMode( EDGE_CLAMP ), m_apron( 0 ), m_stride( sizeJ ),
+	m_data( Allocator( policy ) ), m_statisticsValid( false )
 {
 	if ( pData )
 	{
-		assert( sizeI > 0 && sizeJ > 0 );
+		Assign( sizeI, sizeJ, pData );
+	}
+}
 
-		int const	n	= sizeI * sizeJ;	// Number of elements
 
-		m_data.resize( n );
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
 
-		// Load the height for each vertex
+//! This constructor creates a heightfield given an array size, scale, and an array of heights.
+//!
+//! @param	sizeI	Size of the heightfield along the I axis.
+//! @param	sizeJ	Size of the heightfield along the J axis.
+//! @param	data	Height data. The data should be in this order: <tt>qData[i][j]</tt>. The HeightField takes
+//!					ownership of the data without copying it.
 
-		for ( int k = 0; k < n; k++ )
-		{
-			m_data[k].m_Z = *pData++;
-		}
-	}
+HeightField::HeightField( int sizeI, int sizeJ, Storage && data )
+	: m_sizeI( sizeI ), m_sizeJ( sizeJ ), m_edgeMode( EDGE_CLAMP ), m_apron( 0 ), m_stride( sizeJ ),
+	m_data( std::move( data ) ), m_statisticsValid( false )
+
+{
+	assert( sizeI > 0 && sizeJ > 0 );
+	assert( size_t(sizeI * sizeJ) == m_data.size() );
 }
 
 
@@ -59,17 +107,23 @@ HeightField::HeightField( int sizeI /*= 0*/, int sizeJ /*= 0*/, float const * pD
 //!
 //! @param	sizeI	Size of the heightfield along the I axis.
 //! @param	sizeJ	Size of the heightfield along the J axis.
-//! @param	data	Height data. The data should be in this order: <tt>qData[i][j]</tt>. The HeightField takes
-//!					ownership of the data.
+//! @param	data	Height data. The data should be in this order: <tt>qData[i][j]</tt>. Since @a data does not
+//!					use the storage allocator, the data is copied into storage allocated according to @a policy and
+//!					@a data is freed.
+//! @param	policy	Allocation policy for the vertex array
 
-HeightField::HeightField( int sizeI, int sizeJ, std::vector<Vertex> & data )
-	: m_sizeI( sizeI ), m_sizeJ( sizeJ )
+HeightField::HeightField( int sizeI, int sizeJ, std::vector<Vertex> && data,
+						  HeightFieldAllocatorPolicy const & policy /*= HeightFieldAllocatorPolicy()*/ )
+	: m_sizeI( sizeI ), m_sizeJ( sizeJ ), m_edgeMode( EDGE_CLAMP ), m_apron( 0 ), m_stride( sizeJ ),
+	m_data( Allocator( policy ) ), m_statisticsValid( false )
 
 {
 	assert( sizeI > 0 && sizeJ > 0 );
 	assert( size_t(sizeI * sizeJ) == data.size() );
 
-	m_data.swap( data );
+	Assign( sizeI, sizeJ, &data[0].m_Z );
+
+	std::vector<Vertex>().swap( data );
 }
 
 
@@ -84,29 +138,229 @@ HeightField::HeightField( int sizeI, int sizeJ, std::vector<Vertex> & data )
 //! @param	sizeJ	Size of the heightfield along the J axis.
 //! @param	zScale	Scale factor for height data
 //! @param	pData	Height data to be copied. The data should be in this order: <tt>pData[i][j]</tt>.
+//! @param	policy	Allocation policy for the vertex array
 //!
 //! @exception	bad_alloc	Unable to allocate an array of vertexes.
 //!
 //! @note	As a result of scaling, the stored heights will be in the range of 0 - @a zScale, inclusive.
 
-HeightField::HeightField( int sizeI, int sizeJ, float zScale, unsigned __int8 const * pData )
-	: m_sizeI( sizeI ), m_sizeJ( sizeJ )
+HeightField::HeightField( int sizeI, int sizeJ, float zScale, unsigned __int8 const * pData,
+						  HeightFieldAllocatorPolicy const & policy /*= HeightFieldAllocatorPolicy()*/ )
+	: m_sizeI( sizeI ), m_sizeJ( sizeJ ), m_edgeMode( EDGE_CLAMP ), m_apron( 0 ), m_stride( sizeJ ),
+	m_data( Allocator( policy ) ), m_statisticsValid( false )
+{
+	Assign( sizeI, sizeJ, zScale, pData );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	other	Heightfield to copy
+
+HeightField::HeightField( HeightField const & other )
+	: m_sizeI( other.m_sizeI ),
+	m_sizeJ( other.m_sizeJ ),
+	m_edgeMode( other.m_edgeMode ),
+	m_apron( other.m_apron ),
+	m_stride( other.m_stride ),
+	m_data( other.m_data ),
+	m_statisticsValid( other.m_statisticsValid.load( memory_order_acquire ) ),
+	m_pStatistics( atomic_load( &other.m_pStatistics ) )
+{
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	other	Heightfield to move. It is left empty.
+
+HeightField::HeightField( HeightField && other ) noexcept
+	: m_sizeI( other.m_sizeI ),
+	m_sizeJ( other.m_sizeJ ),
+	m_edgeMode( other.m_edgeMode ),
+	m_apron( other.m_apron ),
+	m_stride( other.m_stride ),
+	m_data( std::move( other.m_data ) ),
+	m_statisticsValid( other.m_statisticsValid.load( memory_order_relaxed ) ),
+	m_pStatistics( std::move( other.m_pStatistics ) )
+{
+	other.m_sizeI = 0;
+	other.m_sizeJ = 0;
+	other.m_stride = 2 * other.m_apron;
+	other.m_data.clear();
+	other.m_statisticsValid.store( false, memory_order_relaxed );
+	other.m_pStatistics.reset();
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	rhs		Heightfield to copy
+//!
+//! @return		This heightfield
+
+HeightField & HeightField::operator =( HeightField const & rhs )
+{
+	if ( this != &rhs )
+	{
+		m_sizeI			= rhs.m_sizeI;
+		m_sizeJ			= rhs.m_sizeJ;
+		m_edgeMode		= rhs.m_edgeMode;
+		m_apron			= rhs.m_apron;
+		m_stride		= rhs.m_stride;
+		m_data			= rhs.m_data;
+		m_statisticsValid.store( rhs.m_statisticsValid.load( memory_order_acquire ), memory_order_relaxed );
+		m_pStatistics	= atomic_load( &rhs.m_pStatistics );
+	}
+
+	return *this;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	rhs		Heightfield to move. It is left empty.
+//!
+//! @return		This heightfield
+
+HeightField & HeightField::operator =( HeightField && rhs ) noexcept
+{
+	if ( this != &rhs )
+	{
+		m_sizeI			= rhs.m_sizeI;
+		m_sizeJ			= rhs.m_sizeJ;
+		m_edgeMode		= rhs.m_edgeMode;
+		m_apron			= rhs.m_apron;
+		m_stride		= rhs.m_stride;
+		m_data			= std::move( rhs.m_data );
+		m_statisticsValid.store( rhs.m_statisticsValid.load( memory_order_relaxed ), memory_order_relaxed );
+		m_pStatistics	= std::move( rhs.m_pStatistics );
+
+		rhs.m_sizeI = 0;
+		rhs.m_sizeJ = 0;
+		rhs.m_stride = 2 * rhs.m_apron;
+		rhs.m_data.clear();
+		rhs.m_statisticsValid.store( false, memory_order_relaxed );
+		rhs.m_pStatistics.reset();
+	}
+
+	return *this;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	sizeI	New size of the heightfield along the I axis.
+//! @param	sizeJ	New size of the heightfield along the J axis.
+//!
+//! @exception	bad_alloc	Unable to allocate an array of vertexes.
+//!
+//! The existing storage is reused if it is large enough, so resizing repeatedly to the same size or smaller
+//! does not allocate. The storage is not initialized, and neither is the apron.
+
+void HeightField::Resize( int sizeI, int sizeJ )
+{
+	assert( sizeI >= 0 && sizeJ >= 0 );
+
+	m_data.resize( ( sizeI > 0 && sizeJ > 0 ) ? size_t( sizeI + 2 * m_apron ) * ( sizeJ + 2 * m_apron ) : 0 );
+	m_sizeI = sizeI;
+	m_sizeJ = sizeJ;
+	m_stride = sizeJ + 2 * m_apron;
+
+	InvalidateStatistics();
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	sizeI	Size of the heightfield along the I axis.
+//! @param	sizeJ	Size of the heightfield along the J axis.
+//! @param	pData	Height data to be copied. The data should be in this order: <tt>pData[i][j]</tt>.
+//!
+//! @exception	bad_alloc	Unable to allocate an array of vertexes.
+//!
+//! The existing storage is reused if it is large enough.
+
+void HeightField::Assign( int sizeI, int sizeJ, float const * pData )
 {
 	assert( sizeI > 0 && sizeJ > 0 );
 	assert( pData != 0 );
 
-	int const	n	= sizeI * sizeJ;	// Number of elements
+	Resize( sizeI, sizeJ );
 
-	m_data.resize( n );
+	// Load the height for each vertex
+
+	Fill( [ this, pData ]( int i0, int i1 )
+	{
+		for ( int i = i0; i < i1; i++ )
+		{
+			Vertex * const			pRow	= &m_data[ GetOffset( 0, i ) ];
+			float const * const		pZ		= pData + size_t( i ) * m_sizeJ;
+
+			for ( int j = 0; j < m_sizeJ; j++ )
+			{
+				pRow[j].m_Z = pZ[j];
+			}
+		}
+	} );
+
+	UpdateApron();
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! The values in the height data are multiplied by @a zScale / 255 to get the actual heights.
+//!
+//! @param	sizeI	Size of the heightfield along the I axis.
+//! @param	sizeJ	Size of the heightfield along the J axis.
+//! @param	zScale	Scale factor for height data
+//! @param	pData	Height data to be copied. The data should be in this order: <tt>pData[i][j]</tt>.
+//!
+//! @exception	bad_alloc	Unable to allocate an array of vertexes.
+//!
+//! The existing storage is reused if it is large enough.
+
+void HeightField::Assign( int sizeI, int sizeJ, float zScale, unsigned __int8 const * pData )
+{
+	assert( sizeI > 0 && sizeJ > 0 );
+	assert( pData != 0 );
+
+	Resize( sizeI, sizeJ );
 
 	// Compute the height for each vertex
 
 	float const	heightFactor	= zScale / 255.f;
 
-	for ( int k = 0; k < n; k++ )
+	Fill( [ this, pData, heightFactor ]( int i0, int i1 )
 	{
-		m_data[k].m_Z = float( *pData++ ) * heightFactor;
-	}
+		for ( int i = i0; i < i1; i++ )
+		{
+			Vertex * const					pRow	= &m_data[ GetOffset( 0, i ) ];
+			unsigned __int8 const * const	pZ		= pData + size_t( i ) * m_sizeJ;
+
+			for ( int j = 0; j < m_sizeJ; j++ )
+			{
+				pRow[j].m_Z = float( pZ[j] ) * heightFactor;
+			}
+		}
+	} );
+
+	UpdateApron();
 }
 
 
@@ -114,8 +368,32 @@ HeightField::HeightField( int sizeI, int sizeJ, float zScale, unsigned __int8 co
 /*																													*/
 /********************************************************************************************************************/
 
-HeightField::~HeightField()
+//! @param	sizeI	Size of the heightfield along the I axis.
+//! @param	sizeJ	Size of the heightfield along the J axis.
+//! @param	data	Height data. The data should be in this order: <tt>qData[i][j]</tt>. The HeightField takes
+//!					ownership of the data without copying it, unless it has an apron. In that case, the data is
+//!					copied and @a data is freed.
+
+void HeightField::Assign( int sizeI, int sizeJ, Storage && data )
 {
+	assert( sizeI > 0 && sizeJ > 0 );
+	assert( size_t(sizeI * sizeJ) == data.size() );
+
+	if ( m_apron == 0 )
+	{
+		m_data		= std::move( data );
+		m_sizeI		= sizeI;
+		m_sizeJ		= sizeJ;
+		m_stride	= sizeJ;
+
+		InvalidateStatistics();
+	}
+	else
+	{
+		Assign( sizeI, sizeJ, &data[0].m_Z );
+
+		Storage( data.get_allocator() ).swap( data );
+	}
 }
 
 
@@ -123,30 +401,107 @@ HeightField::~HeightField()
 /*																													*/
 /********************************************************************************************************************/
 
-//! @param	j	J index
-//! @param	i	I index
-//! @param	sj	width of the area along the J axis
-//! @param	si	width of the area along the I axis
+//! @param	mode	How the vertexes beyond the edges are addressed
+//! @param	apron	Number of rows and columns to store beyond each edge
 //!
-//! @return		Lowest Z value
+//! @exception	bad_alloc	Unable to allocate an array of vertexes.
+//!
+//! The apron holds the heights addressed by the edge mode beyond the edges, so GetZ() and the views can read
+//! locations up to @a apron vertexes beyond the edges directly. The heights are moved to a new vertex array if
+//! the width of the apron changes. The default is EDGE_CLAMP with no apron.
 
-float HeightField::GetMinZ( int j, int i, int sj, int si ) const
+void HeightField::SetEdgeMode( EdgeMode mode, int apron /*= 1*/ )
 {
-	float minZ	=	numeric_limits< float >::max();
+	assert( apron >= 0 );
+
+	m_edgeMode = mode;
 
-	for ( int y = i; y < i + si; y++ )
+	if ( apron != m_apron )
 	{
-		for ( int x = j; x < j + sj; x++ )
+		// Move the heights into a vertex array with the new apron
+
+		Storage		old( std::move( m_data ) );
+		int const	oldApron	= m_apron;
+		int const	oldStride	= m_stride;
+
+		m_data		= Storage( old.get_allocator() );
+		m_apron		= apron;
+		m_stride	= m_sizeJ + 2 * apron;
+
+		if ( !old.empty() )
 		{
-			float const		z	= GetZ( x, y );
-			if ( z < minZ )
+			m_data.resize( size_t( m_sizeI + 2 * apron ) * m_stride );
+
+			Fill( [ this, &old, oldApron, oldStride ]( int i0, int i1 )
 			{
-				minZ = z;
-			}
+				for ( int i = i0; i < i1; i++ )
+				{
+					Vertex const * const	pOld	= &old[ size_t( i + oldApron ) * oldStride + oldApron ];
+
+					copy( pOld, pOld + m_sizeJ, &m_data[ GetOffset( 0, i ) ] );
+				}
+			} );
 		}
 	}
 
-	return minZ;
+	UpdateApron();
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! This must be called after the heights are modified through a pointer or a view, if the heightfield has an
+//! apron. Every library function that writes the heights of a HeightField calls it when it is done, but functions
+//! that write through a view (such as HeightFieldLoader::ReadRows()) cannot.
+
+void HeightField::UpdateApron()
+{
+	if ( m_apron == 0 || m_data.empty() )
+	{
+		return;
+	}
+
+	// Each vertex in the apron is copied from the vertex it addresses. Those are never in the apron, so the rows
+	// are independent.
+
+	Parallel::For( -m_apron, m_sizeI + m_apron, max( FILL_GRAIN / m_stride, 1 ), [ this ]( int first, int last )
+	{
+		for ( int i = first; i < last; i++ )
+		{
+			Vertex * const			pRow	= &m_data[ GetOffset( 0, i ) ];
+			Vertex const * const	pSource	= &m_data[ GetOffset( 0, GetEdgeIndex( m_edgeMode, i, m_sizeI ) ) ];
+
+			if ( i < 0 || i >= m_sizeI )
+			{
+				copy( pSource, pSource + m_sizeJ, pRow );
+			}
+
+			for ( int k = 1; k <= m_apron; k++ )
+			{
+				pRow[ -k ]				= pSource[ GetEdgeIndex( m_edgeMode, -k, m_sizeJ ) ];
+				pRow[ m_sizeJ - 1 + k ]	= pSource[ GetEdgeIndex( m_edgeMode, m_sizeJ - 1 + k, m_sizeJ ) ];
+			}
+		}
+	} );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	j	J index
+//! @param	i	I index
+//! @param	sj	width of the area along the J axis
+//! @param	si	width of the area along the I axis
+//!
+//! @return		Lowest Z value
+
+float HeightField::GetMinZ( int j, int i, int sj, int si ) const
+{
+	return GetView().GetMinZ( j, i, sj, si );
 }
 
 
@@ -163,21 +518,29 @@ float HeightField::GetMinZ( int j, int i, int sj, int si ) const
 
 float HeightField::GetMaxZ( int j, int i, int sj, int si ) const
 {
-	float maxZ	=	-numeric_limits< float >::max();
+	return GetView().GetMaxZ( j, i, sj, si );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//!
+//! @return		Lowest Z value
+//!
+//! If the statistics are cached, the value is taken from them. Otherwise, the heights are scanned without caching
+//! anything. Like GetStatistics(), the cached value is stale if the heights were modified through a pointer or view
+//! obtained before the statistics were computed and InvalidateStatistics() was not called.
 
-	for ( int y = i; y < i + si; y++ )
+float HeightField::GetMinZ() const
+{
+	if ( m_statisticsValid.load( memory_order_acquire ) )
 	{
-		for ( int x = j; x < j + sj; x++ )
-		{
-			float const		z	= GetZ( x, y );
-			if ( z > maxZ )
-			{
-				maxZ = z;
-			}
-		}
+		return GetStatistics()->GetMinZ();
 	}
 
-	return maxZ;
+	return GetView().GetMinZ();
 }
 
 
@@ -185,8 +548,32 @@ float HeightField::GetMaxZ( int j, int i, int sj, int si ) const
 /*																													*/
 /********************************************************************************************************************/
 
-//! @param	j		j index (can be a non-integer, but must be less than the width of the heightmap)
-//! @param	i		i index (can be a non-integer, but must be less than the height of the heightmap)
+//!
+//! @return		Highest Z value
+//!
+//! If the statistics are cached, the value is taken from them. Otherwise, the heights are scanned without caching
+//! anything. Like GetStatistics(), the cached value is stale if the heights were modified through a pointer or view
+//! obtained before the statistics were computed and InvalidateStatistics() was not called.
+
+float HeightField::GetMaxZ() const
+{
+	if ( m_statisticsValid.load( memory_order_acquire ) )
+	{
+		return GetStatistics()->GetMaxZ();
+	}
+
+	return GetView().GetMaxZ();
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	j		j index (can be a non-integer, but must be less than the width of the heightmap unless the
+//!					edge mode is EDGE_WRAP)
+//! @param	i		i index (can be a non-integer, but must be less than the height of the heightmap unless the
+//!					edge mode is EDGE_WRAP)
 //! @param	step	width and height of the quad to interpolate
 //!
 //! The function assumes that every quad in the grid is triangulated like this:
@@ -208,42 +595,104 @@ float HeightField::GetMaxZ( int j, int i, int sj, int si ) const
 
 float HeightField::GetInterpolatedZ( float j, float i, int step/* = 1*/ ) const
 {
+	return GetView().GetInterpolatedZ( j, i, step );
+}
 
-	assert( i >= 0.0f && i <= m_sizeI-1 );
-	assert( j >= 0.0f && j <= m_sizeJ-1 );
 
-	float		fj0;
-	float		fi0;
-	float const	dj0	= modff( j / step, &fj0 );
-	float const	di0	= modff( i / step, &fi0 );
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
 
-	int const 	j0	= (int)fj0 * step;
-	int const 	i0	= (int)fi0 * step;
+//!
+//! @return		A view of the whole heightfield. It is valid until the heightfield is resized or destroyed.
 
-	float	z	= GetZ( j0, i0 );
+HeightFieldView HeightField::GetView() const
+{
+	return HeightFieldView( m_sizeI, m_sizeJ, m_data.empty() ? 0 : &m_data[ GetOffset( 0, 0 ) ], m_stride,
+							m_edgeMode, m_apron );
+}
 
-	if ( dj0 > di0 )
-	{
-		if ( j0+step < m_sizeJ )
-		{
-			z += ( GetZ( j0+step, i0 ) - GetZ( j0, i0 ) ) * dj0;
-			if ( i0+step < m_sizeI )
-			{
-				z += ( GetZ( j0+step, i0+step ) - GetZ( j0+step, i0 ) ) * di0;
-			}
-		}
-	}
-	else
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//!
+//! @return		A modifiable view of the whole heightfield. It is valid until the heightfield is resized or destroyed.
+//!
+//! @note	The cached statistics are discarded, since the data may be modified through the view.
+
+HeightFieldMutableView HeightField::GetView()
+{
+	InvalidateStatistics();
+	return HeightFieldMutableView( m_sizeI, m_sizeJ, m_data.empty() ? 0 : &m_data[ GetOffset( 0, 0 ) ], m_stride,
+								   m_edgeMode, m_apron );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	j	J index of the first vertex in the rectangle
+//! @param	i	I index of the first vertex in the rectangle
+//! @param	sj	width of the rectangle along the J axis
+//! @param	si	width of the rectangle along the I axis
+//!
+//! @return		A view of the rectangle, sharing the heightfield's data
+
+HeightFieldView HeightField::GetView( int j, int i, int sj, int si ) const
+{
+	return GetView().GetSubView( j, i, sj, si );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	j	J index of the first vertex in the rectangle
+//! @param	i	I index of the first vertex in the rectangle
+//! @param	sj	width of the rectangle along the J axis
+//! @param	si	width of the rectangle along the I axis
+//!
+//! @return		A modifiable view of the rectangle, sharing the heightfield's data
+
+HeightFieldMutableView HeightField::GetView( int j, int i, int sj, int si )
+{
+	return GetView().GetSubView( j, i, sj, si );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! The statistics are computed by a single parallel pass over the data the first time they are needed, and then
+//! cached until a non-const member function that can modify the data is called, or InvalidateStatistics() is
+//! called. Heights written through a pointer or view that was obtained before the statistics were computed do not
+//! invalidate them, so the cached statistics are stale until InvalidateStatistics() is called. This function may
+//! be called by several threads at the same time.
+//!
+//! @return		Statistics of the heights. They remain valid even if the heightfield changes.
+//!
+//! @exception	bad_alloc	Unable to allocate the statistics.
+
+shared_ptr< HeightFieldStatistics const > HeightField::GetStatistics() const
+{
+	if ( m_statisticsValid.load( memory_order_acquire ) )
 	{
-		if ( i0+step < m_sizeI )
+		shared_ptr< HeightFieldStatistics const >	pStatistics	= atomic_load( &m_pStatistics );
+		if ( pStatistics )
 		{
-			z += ( GetZ( j0, i0+step ) - GetZ( j0, i0 ) ) * di0;
-			if ( j0+step < m_sizeJ )
-			{
-				z += ( GetZ( j0+step, i0+step ) - GetZ( j0, i0+step ) ) * dj0;
-			}
+			return pStatistics;
 		}
 	}
 
-	return z;
+	shared_ptr< HeightFieldStatistics const >	pStatistics( make_shared< HeightFieldStatistics const >( GetView() ) );
+
+	atomic_store( &m_pStatistics, pStatistics );
+	m_statisticsValid.store( true, memory_order_release );
+
+	return pStatistics;
 }
@@ -13,16 +13,29 @@
 
 #pragma once
 
+#include "HeightFieldAllocator.h"
+
 #include <Misc/Assert.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
 #include <vector>
 #include <iosfwd>
 
+class HeightFieldView;
+class HeightFieldMutableView;
+class HeightFieldStatistics;
 
 /********************************************************************************************************************/
 /*																													*/
 /********************************************************************************************************************/
 
 //! A height field stored as an array of height values.
+//!
+//! The heights beyond the edges are defined by an edge mode: clamped to the nearest edge, wrapped around for
+//! heightfields that tile, or mirrored across the edges. Optionally, an apron of rows and columns holding those
+//! heights is stored around the heightfield, so stencils can read the neighbors of the edge vertexes with GetZ()
+//! without testing for the edges.
 
 class HeightField
 {
@@ -32,17 +45,58 @@ public:
 
 	class Vertex;
 
+	//! Allocator used for the vertex array
+	typedef HeightFieldAllocator<Vertex>	Allocator;
+
+	//! Vertex array
+	typedef std::vector<Vertex, Allocator>	Storage;
+
+	//! Addressing of the vertexes beyond the edges
+	enum EdgeMode
+	{
+		EDGE_CLAMP,		//!< The nearest edge vertex
+		EDGE_WRAP,		//!< The vertex on the opposite side, for heightfields that tile
+		EDGE_MIRROR		//!< The vertex reflected across the edge. The edge vertexes are not repeated.
+	};
+
+	//! Constructor
+	explicit HeightField( int SizeI = 0, int SizeJ = 0, float const * pData = 0,
+						  HeightFieldAllocatorPolicy const & policy = HeightFieldAllocatorPolicy() );
+
 	//! Constructor
-	explicit HeightField( int SizeI = 0, int SizeJ = 0, float const * pData = 0 );
+	HeightField( int SizeI, int SizeJ, Storage && data );
 
 	//! Constructor
-	HeightField( int SizeI, int SizeJ, std::vector<Vertex> & data );
+	HeightField( int SizeI, int SizeJ, std::vector<Vertex> && data,
+				 HeightFieldAllocatorPolicy const & policy = HeightFieldAllocatorPolicy() );
 
 	//! Constructor
-	HeightField( int SizeI, int SizeJ, float zScale, unsigned __int8 const * pData );
+	HeightField( int SizeI, int SizeJ, float zScale, unsigned __int8 const * pData,
+				 HeightFieldAllocatorPolicy const & policy = HeightFieldAllocatorPolicy() );
+
+	//! Copy constructor
+	HeightField( HeightField const & other );
+
+	//! Move constructor
+	HeightField( HeightField && other ) noexcept;
+
+	//! Copy assignment
+	HeightField & operator =( HeightField const & rhs );
+
+	//! Move assignment
+	HeightField & operator =( HeightField && rhs ) noexcept;
+
+	//! Changes the size of the heightfield. The heights are undefined afterwards.
+	void Resize( int sizeI, int sizeJ );
+
+	//! Replaces the contents with a copy of an array of heights
+	void Assign( int sizeI, int sizeJ, float const * pData );
 
-	// Destructor
-	virtual ~HeightField();
+	//! Replaces the contents with a copy of an array of scaled 8-bit heights
+	void Assign( int sizeI, int sizeJ, float zScale, unsigned __int8 const * pData );
+
+	//! Replaces the contents with an array of vertexes
+	void Assign( int sizeI, int sizeJ, Storage && data );
 
 	//! Returns the size of the heightfield along the I axis.
 	int GetSizeI() const;
@@ -50,6 +104,21 @@ public:
 	//! Returns the size of the heightfield along the J axis.
 	int GetSizeJ() const;
 
+	//! Sets the edge mode and the width of the apron stored around the heightfield.
+	void SetEdgeMode( EdgeMode mode, int apron = 1 );
+
+	//! Returns the edge mode.
+	EdgeMode GetEdgeMode() const;
+
+	//! Returns the number of rows and columns stored beyond each edge.
+	int GetApron() const;
+
+	//! Returns the number of vertexes between the starts of consecutive rows.
+	int GetStride() const;
+
+	//! Recomputes the heights in the apron from the heights in the heightfield.
+	void UpdateApron();
+
 	//! Returns a pointer to a particular element
 	Vertex const * GetData( int j = 0, int i = 0 ) const;
 
@@ -59,6 +128,12 @@ public:
 	//! Returns an element 
 	float GetZ( int j, int i ) const;
 
+	//! Returns an element, applying the edge mode to locations beyond the edges
+	float GetEdgeZ( int j, int i ) const;
+
+	//! Returns the index of the vertex addressed by a location along an axis
+	static int GetEdgeIndex( EdgeMode mode, int k, int size );
+
 	//! Returns the lowest Z in the specified range
 	float GetMinZ( int j, int i, int sj, int si ) const;
 
@@ -74,11 +149,45 @@ public:
 	//! Returns the interpolated Z at [ @a j, @a i ]
 	float GetInterpolatedZ( float j, float i, int step = 1 ) const;
 
+	//! Returns a view of the whole heightfield
+	HeightFieldView GetView() const;
+
+	//! Returns a modifiable view of the whole heightfield
+	HeightFieldMutableView GetView();
+
+	//! Returns a view of a rectangle within the heightfield
+	HeightFieldView GetView( int j, int i, int sj, int si ) const;
+
+	//! Returns a modifiable view of a rectangle within the heightfield
+	HeightFieldMutableView GetView( int j, int i, int sj, int si );
+
+	//! Returns the allocation policy of the vertex array.
+	HeightFieldAllocatorPolicy GetAllocatorPolicy() const;
+
+	//! Returns statistics of the heights, computing them if they are not cached.
+	std::shared_ptr< HeightFieldStatistics const > GetStatistics() const;
+
+	//! Discards the cached statistics.
+	void InvalidateStatistics();
+
 private:
 
+	// Calls f( i0, i1 ) to initialize ranges of rows, in parallel if the policy allows it
+	template< typename Function >
+	void Fill( Function const & f );
+
+	// Returns the location of an element in the vertex array
+	size_t GetOffset( int j, int i ) const;
+
 	int					m_sizeI;	//!< Size of the vertex array in the I direction
 	int					m_sizeJ;	//!< Size of the vertex array in the J direction
-	std::vector<Vertex>	m_data;		//!< Vertex array
+	EdgeMode			m_edgeMode;	//!< Addressing of the vertexes beyond the edges
+	int					m_apron;	//!< Number of rows and columns stored beyond each edge
+	int					m_stride;	//!< Number of vertexes between the starts of consecutive rows
+	Storage				m_data;		//!< Vertex array, including the apron
+
+	mutable std::atomic< bool >								m_statisticsValid;	//!< True if the statistics are current
+	mutable std::shared_ptr< HeightFieldStatistics const >	m_pStatistics;		//!< Last statistics, or null
 };
 
 
@@ -128,12 +237,12 @@ inline int HeightField::GetSizeJ() const
 //! @param	i	I index
 //!
 //! @return		Pointer to const element at ( @a j, @a i )
+//!
+//! The location may be in the apron.
 
 inline HeightField::Vertex const * HeightField::GetData( int j/*= 0*/, int i/*= 0*/ ) const
 {
-	assert_limits( 0, j, m_sizeJ-1 );
-	assert_limits( 0, i, m_sizeI-1 );
-	return &m_data[ i * m_sizeJ + j ];
+	return &m_data[ GetOffset( j, i ) ];
 }
 
 
@@ -145,12 +254,15 @@ inline HeightField::Vertex const * HeightField::GetData( int j/*= 0*/, int i/*=
 //! @param	i	I index
 //!
 //! @return		Pointer to element at ( @a j, @a i )
+//!
+//! The location may be in the apron.
+//!
+//! @note	The cached statistics are discarded, since the data may be modified through the pointer.
 
 inline HeightField::Vertex * HeightField::GetData( int j/*= 0*/, int i/*= 0*/ )
 {
-	assert_limits( 0, j, m_sizeJ-1 );
-	assert_limits( 0, i, m_sizeI-1 );
-	return &m_data[ i * m_sizeJ + j ];
+	InvalidateStatistics();
+	return &m_data[ GetOffset( j, i ) ];
 }
 
 
@@ -173,9 +285,14 @@ inline float HeightField::GetZ( int j, int i ) const
 /*																													*/
 /********************************************************************************************************************/
 
-inline float HeightField::GetMinZ() const
+//! @param	j	J index. It can be any value.
+//! @param	i	I index. It can be any value.
+//!
+//! @return		Z value of the vertex addressed by ( @a j, @a i ) according to the edge mode
+
+inline float HeightField::GetEdgeZ( int j, int i ) const
 {
-	return GetMinZ( 0, 0, m_sizeJ, m_sizeI );
+	return GetData( GetEdgeIndex( m_edgeMode, j, m_sizeJ ), GetEdgeIndex( m_edgeMode, i, m_sizeI ) )->m_Z;
 }
 
 
@@ -183,7 +300,120 @@ inline float HeightField::GetMinZ() const
 /*																													*/
 /********************************************************************************************************************/
 
-inline float HeightField::GetMaxZ() const
+//! @param	mode	Edge mode
+//! @param	k		Location along the axis. It can be any value.
+//! @param	size	Size of the heightfield along the axis
+//!
+//! @return		Index of the vertex in [ 0, @a size ) addressed by @a k
+//!
+//! The mode selects the computation, but the computation itself does not branch on @a k.
+
+inline int HeightField::GetEdgeIndex( EdgeMode mode, int k, int size )
+{
+	assert( size > 0 );
+
+	switch ( mode )
+	{
+	case EDGE_WRAP:
+	{
+		int const	r	= k % size;
+		return ( r < 0 ) ? r + size : r;
+	}
+
+	case EDGE_MIRROR:
+	{
+		int const	period	= std::max( 2 * size - 2, 1 );
+		int			r		= k % period;
+		r = ( r < 0 ) ? r + period : r;
+		return std::min( r, period - r );
+	}
+
+	default:
+		return std::min( std::max( k, 0 ), size - 1 );
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//!
+//! @return		The edge mode
+
+inline HeightField::EdgeMode HeightField::GetEdgeMode() const
+{
+	return m_edgeMode;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//!
+//! @return		Number of rows and columns stored beyond each edge
+
+inline int HeightField::GetApron() const
+{
+	return m_apron;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//!
+//! @return		Number of vertexes between the starts of consecutive rows
+
+inline int HeightField::GetStride() const
+{
+	return m_stride;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	j	J index
+//! @param	i	I index
+//!
+//! @return		Index of the element at ( @a j, @a i ) in the vertex array
+
+inline size_t HeightField::GetOffset( int j, int i ) const
+{
+	assert_limits( -m_apron, j, m_sizeJ-1+m_apron );
+	assert_limits( -m_apron, i, m_sizeI-1+m_apron );
+	return size_t( i + m_apron ) * m_stride + ( j + m_apron );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+inline HeightFieldAllocatorPolicy HeightField::GetAllocatorPolicy() const
+{
+	return m_data.get_allocator().GetPolicy();
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! This must be called if the data is modified through a pointer or view that was obtained before the statistics
+//! were last computed. Every non-const member function that can modify the data calls it. Like GetStatistics(),
+//! it may be called by several threads at the same time.
+//!
+//! @note	Only a flag is cleared, and only if it is set, so this is cheap enough to call on every access.
+
+inline void HeightField::InvalidateStatistics()
 {
-	return GetMaxZ( 0, 0, m_sizeJ, m_sizeI );
+	if ( m_statisticsValid.load( std::memory_order_relaxed ) )
+	{
+		m_statisticsValid.store( false, std::memory_order_relaxed );
+	}
 }
@@ -0,0 +1,196 @@
+/** @file *//********************************************************************************************************
+
+                                                HeightFieldAllocator.cpp
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/HeightFieldAllocator.cpp#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#include "PrecompiledHeaders.h"
+
+#include "HeightFieldAllocator.h"
+
+#if defined( _WIN32 )
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <malloc.h>
+#else
+#include <cstdlib>
+#include <sys/mman.h>
+#endif
+
+using namespace std;
+
+
+namespace
+{
+
+// Size of a huge page (2 MB on x86)
+size_t const	HUGE_PAGE_SIZE	= 2 * 1024 * 1024;
+
+// Rounds n up to a multiple of a power of 2
+size_t RoundUp( size_t n, size_t alignment )
+{
+	return ( n + alignment - 1 ) & ~( alignment - 1 );
+}
+
+} // anonymous namespace
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	alignment			Alignment of the storage in bytes. Must be a power of 2. The default (64) is the size of
+//!								a cache line and allows aligned loads of any SIMD width.
+//! @param	pages				Type of pages to use
+//! @param	parallelFirstTouch	If true, HeightField initializes its storage in parallel.
+
+HeightFieldAllocatorPolicy::HeightFieldAllocatorPolicy( size_t alignment /*= 64*/,
+														Pages pages /*= PAGES_DEFAULT*/,
+														bool parallelFirstTouch /*= true*/ )
+	: m_alignment( alignment ),
+	m_pages( pages ),
+	m_parallelFirstTouch( parallelFirstTouch )
+{
+	assert( alignment > 0 && ( alignment & ( alignment - 1 ) ) == 0 );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	size	Number of bytes to allocate
+//!
+//! @return		Address of the block
+//!
+//! @exception	bad_alloc	Unable to allocate the block.
+//!
+//! Explicit huge pages are allocated from the OS directly, and normal pages are used if none are available. For
+//! transparent huge pages, blocks of at least one huge page are aligned to a huge page and the OS is advised to
+//! back them with huge pages.
+
+void * HeightFieldAllocatorPolicy::Allocate( size_t size ) const
+{
+	size = max( size, size_t( 1 ) );
+
+	void *	p	= 0;
+
+#if defined( _WIN32 )
+
+	if ( m_pages == PAGES_EXPLICIT_HUGE )
+	{
+		size_t const	largePage	= GetLargePageMinimum();
+
+		if ( largePage > 0 )
+		{
+			p = VirtualAlloc( 0, RoundUp( size, largePage ), MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE );
+		}
+		if ( !p )
+		{
+			p = VirtualAlloc( 0, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE );
+		}
+	}
+	else
+	{
+		p = _aligned_malloc( size, m_alignment );
+	}
+
+#else // defined( _WIN32 )
+
+	if ( m_pages == PAGES_EXPLICIT_HUGE )
+	{
+		size_t const	rounded	= RoundUp( size, HUGE_PAGE_SIZE );
+
+#if defined( MAP_HUGETLB )
+		p = mmap( 0, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0 );
+		if ( p == MAP_FAILED )
+#endif // defined( MAP_HUGETLB )
+		{
+			p = mmap( 0, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+		}
+		if ( p == MAP_FAILED )
+		{
+			p = 0;
+		}
+	}
+	else
+	{
+		bool const		huge		= ( m_pages == PAGES_TRANSPARENT_HUGE && size >= HUGE_PAGE_SIZE );
+		size_t const	alignment	= huge ? max( m_alignment, HUGE_PAGE_SIZE ) : max( m_alignment, sizeof( void * ) );
+
+		// The block is rounded up to whole huge pages so that the advice covers only memory that it owns.
+
+		size_t const	allocated	= huge ? RoundUp( size, HUGE_PAGE_SIZE ) : size;
+
+		if ( posix_memalign( &p, alignment, allocated ) != 0 )
+		{
+			p = 0;
+		}
+
+#if defined( MADV_HUGEPAGE )
+		if ( p && huge )
+		{
+			madvise( p, allocated, MADV_HUGEPAGE );
+		}
+#endif // defined( MADV_HUGEPAGE )
+	}
+
+#endif // defined( _WIN32 )
+
+	if ( !p )
+	{
+		throw bad_alloc();
+	}
+
+	return p;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	p		Address of the block
+//! @param	size	Size of the block passed to Allocate()
+
+void HeightFieldAllocatorPolicy::Deallocate( void * p, size_t size ) const
+{
+	if ( !p )
+	{
+		return;
+	}
+
+#if defined( _WIN32 )
+
+	(void)size;
+
+	if ( m_pages == PAGES_EXPLICIT_HUGE )
+	{
+		VirtualFree( p, 0, MEM_RELEASE );
+	}
+	else
+	{
+		_aligned_free( p );
+	}
+
+#else // defined( _WIN32 )
+
+	if ( m_pages == PAGES_EXPLICIT_HUGE )
+	{
+		munmap( p, RoundUp( max( size, size_t( 1 ) ), HUGE_PAGE_SIZE ) );
+	}
+	else
+	{
+		free( p );
+	}
+
+#endif // defined( _WIN32 )
+}
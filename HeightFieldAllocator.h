@@ -0,0 +1,144 @@
+/** @file *//********************************************************************************************************
+
+                                                 HeightFieldAllocator.h
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/HeightFieldAllocator.h#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! Determines how the storage of a HeightField is allocated and initialized.
+
+class HeightFieldAllocatorPolicy
+{
+public:
+
+	//! Page types
+	enum Pages
+	{
+		PAGES_DEFAULT,				//!< Normal pages
+		PAGES_TRANSPARENT_HUGE,		//!< Normal allocation aligned and advised for transparent huge pages
+		PAGES_EXPLICIT_HUGE			//!< Explicit huge (large) pages, falling back to normal pages if unavailable
+	};
+
+	//! Constructor
+	explicit HeightFieldAllocatorPolicy( size_t alignment = 64, Pages pages = PAGES_DEFAULT, bool parallelFirstTouch = true );
+
+	//! Allocates a block of memory
+	void * Allocate( size_t size ) const;
+
+	//! Frees a block of memory allocated by Allocate()
+	void Deallocate( void * p, size_t size ) const;
+
+	//! Returns true if the two policies allocate compatibly.
+	bool operator ==( HeightFieldAllocatorPolicy const & rhs ) const
+	{
+		return m_alignment == rhs.m_alignment && m_pages == rhs.m_pages;
+	}
+
+	size_t	m_alignment;			//!< Alignment of the storage. Must be a power of 2.
+	Pages	m_pages;				//!< Type of pages to use
+	bool	m_parallelFirstTouch;	//!< If true, storage is initialized in parallel so that pages are spread across
+									//!< NUMA nodes.
+};
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! A standard allocator that allocates according to a HeightFieldAllocatorPolicy.
+//!
+//! Elements that are value-initialized by the container (e.g. by @c resize()) are default-initialized instead,
+//! so growing the storage does not touch the memory. This leaves the first touch to the code that fills it.
+
+template< typename T >
+class HeightFieldAllocator
+{
+public:
+
+	typedef T				value_type;
+	typedef std::true_type	propagate_on_container_copy_assignment;
+	typedef std::true_type	propagate_on_container_move_assignment;
+	typedef std::true_type	propagate_on_container_swap;
+
+	template< typename U >
+	struct rebind
+	{
+		typedef HeightFieldAllocator< U >	other;
+	};
+
+	//! Constructor
+	HeightFieldAllocator( HeightFieldAllocatorPolicy const & policy = HeightFieldAllocatorPolicy() )
+		: m_policy( policy )
+	{
+	}
+
+	//! Converting constructor
+	template< typename U >
+	HeightFieldAllocator( HeightFieldAllocator< U > const & other )
+		: m_policy( other.GetPolicy() )
+	{
+	}
+
+	//! Returns the allocation policy.
+	HeightFieldAllocatorPolicy const & GetPolicy() const	{ return m_policy; }
+
+	//! Allocates storage for @a n elements
+	T * allocate( size_t n )
+	{
+		return static_cast< T * >( m_policy.Allocate( n * sizeof( T ) ) );
+	}
+
+	//! Frees storage allocated by allocate()
+	void deallocate( T * p, size_t n )
+	{
+		m_policy.Deallocate( p, n * sizeof( T ) );
+	}
+
+	//! Default-initializes an element instead of value-initializing it
+	template< typename U >
+	void construct( U * p )
+	{
+		::new( static_cast< void * >( p ) ) U;
+	}
+
+	//! Constructs an element
+	template< typename U, typename... Args >
+	void construct( U * p, Args &&... args )
+	{
+		::new( static_cast< void * >( p ) ) U( std::forward< Args >( args )... );
+	}
+
+private:
+
+	HeightFieldAllocatorPolicy	m_policy;	//!< Allocation policy
+};
+
+template< typename T, typename U >
+bool operator ==( HeightFieldAllocator< T > const & a, HeightFieldAllocator< U > const & b )
+{
+	return a.GetPolicy() == b.GetPolicy();
+}
+
+template< typename T, typename U >
+bool operator !=( HeightFieldAllocator< T > const & a, HeightFieldAllocator< U > const & b )
+{
+	return !( a == b );
+}
@@ -0,0 +1,382 @@
+/** @file *//********************************************************************************************************
+
+                                                HeightFieldContours.cpp
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/HeightFieldContours.cpp#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#include "PrecompiledHeaders.h"
+
+#include "HeightFieldContours.h"
+
+#include "HeightField.h"
+#include "Parallel.h"
+
+#include <unordered_map>
+
+using namespace std;
+
+
+namespace
+{
+
+// Number of cells along each side of a tile
+int const	TILE_SIZE	= 64;
+
+// An edge of the grid is identified by the index of its first vertex and its direction. Since adjacent cells (and
+// tiles) share edges, segments that meet at an edge have the same key there.
+typedef unsigned long long	EdgeKey;
+
+// A contour segment crossing a cell, from one edge to another
+struct Segment
+{
+	EdgeKey	m_A;
+	EdgeKey	m_B;
+};
+
+// Edges of a cell: 0 = bottom, 1 = right, 2 = top, 3 = left
+//
+//	v3 --2-- v2
+//	|        |
+//	3        1
+//	|        |
+//	v0 --0-- v1
+
+// Edge pairs crossed by the contour for each combination of corners at or above the level. -1 terminates the
+// list. Cases 5 and 10 are saddles and are resolved separately.
+int const	SEGMENT_TABLE[ 16 ][ 4 ] =
+{
+	{ -1, -1, -1, -1 },	//  0: none
+	{  3,  0, -1, -1 },	//  1: v0
+	{  0,  1, -1, -1 },	//  2: v1
+	{  3,  1, -1, -1 },	//  3: v0 v1
+	{  1,  2, -1, -1 },	//  4: v2
+	{ -1, -1, -1, -1 },	//  5: v0 v2 (saddle)
+	{  0,  2, -1, -1 },	//  6: v1 v2
+	{  3,  2, -1, -1 },	//  7: v0 v1 v2
+	{  2,  3, -1, -1 },	//  8: v3
+	{  0,  2, -1, -1 },	//  9: v0 v3
+	{ -1, -1, -1, -1 },	// 10: v1 v3 (saddle)
+	{  1,  2, -1, -1 },	// 11: v0 v1 v3
+	{  1,  3, -1, -1 },	// 12: v2 v3
+	{  0,  1, -1, -1 },	// 13: v0 v2 v3
+	{  3,  0, -1, -1 },	// 14: v1 v2 v3
+	{ -1, -1, -1, -1 },	// 15: all
+};
+
+// Saddle segments, indexed by whether the center of the cell is at or above the level
+int const	SADDLE_5_TABLE[ 2 ][ 4 ]	= { { 3, 0, 1, 2 }, { 0, 1, 2, 3 } };
+int const	SADDLE_10_TABLE[ 2 ][ 4 ]	= { { 0, 1, 2, 3 }, { 3, 0, 1, 2 } };
+
+// Returns the key of an edge of the cell whose first vertex is at ( j, i )
+EdgeKey GetEdgeKey( int j, int i, int sizeJ, int edge )
+{
+	static int const	dj[ 4 ]		= { 0, 1, 0, 0 };
+	static int const	di[ 4 ]		= { 0, 0, 1, 0 };
+	static int const	dir[ 4 ]	= { 0, 1, 0, 1 };	// 0 = along J, 1 = along I
+
+	return ( EdgeKey( i + di[ edge ] ) * sizeJ + ( j + dj[ edge ] ) ) * 2 + dir[ edge ];
+}
+
+// Returns the point where the contour crosses an edge
+HeightFieldContours::Point GetCrossing( HeightField const & hf, EdgeKey key, float level )
+{
+	int const	sizeJ	= hf.GetSizeJ();
+	int const	dir		= int( key & 1 );
+	int const	j		= int( ( key >> 1 ) % sizeJ );
+	int const	i		= int( ( key >> 1 ) / sizeJ );
+	int const	j1		= ( dir == 0 ) ? j + 1 : j;
+	int const	i1		= ( dir == 0 ) ? i : i + 1;
+	float const	z0		= hf.GetZ( j, i );
+	float const	z1		= hf.GetZ( j1, i1 );
+	float const	t		= ( level - z0 ) / ( z1 - z0 );
+
+	HeightFieldContours::Point	p;
+	p.m_J = float( j ) + float( j1 - j ) * t;
+	p.m_I = float( i ) + float( i1 - i ) * t;
+	return p;
+}
+
+// Generates the segments for all the cells in a tile at each of the given levels
+void MarchTile( HeightField const &			hf,
+				int							j0,
+				int							i0,
+				int							sj,
+				int							si,
+				float const *				pLevels,
+				int							nLevels,
+				vector< Segment > * const	apSegments )
+{
+	int const	sizeJ	= hf.GetSizeJ();
+
+	for ( int i = i0; i < i0 + si; i++ )
+	{
+		HeightField::Vertex const * const	pRow0	= hf.GetData( 0, i );
+		HeightField::Vertex const * const	pRow1	= hf.GetData( 0, i + 1 );
+
+		for ( int j = j0; j < j0 + sj; j++ )
+		{
+			float const	z0		= pRow0[ j ].m_Z;
+			float const	z1		= pRow0[ j + 1 ].m_Z;
+			float const	z2		= pRow1[ j + 1 ].m_Z;
+			float const	z3		= pRow1[ j ].m_Z;
+			float const	cellMin	= min( min( z0, z1 ), min( z2, z3 ) );
+			float const	cellMax	= max( max( z0, z1 ), max( z2, z3 ) );
+
+			// Only the levels in ( cellMin, cellMax ] cross the cell
+
+			int const	first	= int( upper_bound( pLevels, pLevels + nLevels, cellMin ) - pLevels );
+			int const	last	= int( upper_bound( pLevels, pLevels + nLevels, cellMax ) - pLevels );
+
+			for ( int k = first; k < last; k++ )
+			{
+				float const	level	= pLevels[ k ];
+				int const	index	= ( z0 >= level ? 1 : 0 ) |
+									  ( z1 >= level ? 2 : 0 ) |
+									  ( z2 >= level ? 4 : 0 ) |
+									  ( z3 >= level ? 8 : 0 );
+
+				int const *	pEdges	= SEGMENT_TABLE[ index ];
+				int			nEdges	= 2;
+
+				if ( index == 5 || index == 10 )
+				{
+					int const	center	= ( ( z0 + z1 + z2 + z3 ) * 0.25f >= level ) ? 1 : 0;
+
+					pEdges = ( index == 5 ) ? SADDLE_5_TABLE[ center ] : SADDLE_10_TABLE[ center ];
+					nEdges = 4;
+				}
+
+				for ( int e = 0; e < nEdges; e += 2 )
+				{
+					Segment	s;
+					s.m_A = GetEdgeKey( j, i, sizeJ, pEdges[ e ] );
+					s.m_B = GetEdgeKey( j, i, sizeJ, pEdges[ e + 1 ] );
+					apSegments[ k ].push_back( s );
+				}
+			}
+		}
+	}
+}
+
+// Joins the segments of a single level into polylines
+void Stitch( HeightField const &					hf,
+			 float									level,
+			 vector< Segment > const &				segments,
+			 vector< HeightFieldContours::Polyline > &	polylines )
+{
+	int const	n	= int( segments.size() );
+
+	// Find the (at most two) segments touching each edge
+
+	unordered_map< EdgeKey, pair< int, int > >	links;
+
+	links.reserve( n * 2 );
+
+	for ( int s = 0; s < n; s++ )
+	{
+		EdgeKey const	keys[ 2 ]	= { segments[ s ].m_A, segments[ s ].m_B };
+
+		for ( int e = 0; e < 2; e++ )
+		{
+			pair< int, int > &	link	= links.insert( make_pair( keys[ e ], make_pair( -1, -1 ) ) ).first->second;
+
+			if ( link.first < 0 )
+			{
+				link.first = s;
+			}
+			else
+			{
+				link.second = s;
+			}
+		}
+	}
+
+	vector< bool >	used( n, false );
+
+	// Follows the segments starting with segment s at edge key
+
+	auto Walk = [ & ]( int s, EdgeKey key, bool closed )
+	{
+		HeightFieldContours::Polyline	polyline;
+
+		polyline.m_Level	= level;
+		polyline.m_Closed	= closed;
+		polyline.m_Points.push_back( GetCrossing( hf, key, level ) );
+
+		while ( s >= 0 )
+		{
+			used[ s ] = true;
+			key = ( segments[ s ].m_A == key ) ? segments[ s ].m_B : segments[ s ].m_A;
+			polyline.m_Points.push_back( GetCrossing( hf, key, level ) );
+
+			pair< int, int > const &	link	= links[ key ];
+			int const					next	= ( link.first == s ) ? link.second : link.first;
+
+			s = ( next >= 0 && !used[ next ] ) ? next : -1;
+		}
+
+		polylines.push_back( polyline );
+	};
+
+	// Open contours start and end at edges touched by only one segment (on the border of the height field)
+
+	for ( int s = 0; s < n; s++ )
+	{
+		if ( !used[ s ] )
+		{
+			if ( links[ segments[ s ].m_A ].second < 0 )
+			{
+				Walk( s, segments[ s ].m_A, false );
+			}
+			else if ( links[ segments[ s ].m_B ].second < 0 )
+			{
+				Walk( s, segments[ s ].m_B, false );
+			}
+		}
+	}
+
+	// Everything left over is a closed contour
+
+	for ( int s = 0; s < n; s++ )
+	{
+		if ( !used[ s ] )
+		{
+			Walk( s, segments[ s ].m_A, true );
+		}
+	}
+}
+
+} // anonymous namespace
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	hf		Height field
+//! @param	levels	Heights of the contours to extract. They do not need to be sorted.
+//!
+//! @return		The contours, sorted by level
+//!
+//! The cells are processed in square tiles in parallel, and a tile is skipped entirely if its range of heights
+//! does not contain any of the levels. Contour segments are then joined across cells and tiles into polylines,
+//! one level per task. A vertex exactly at a level is considered to be above it, and saddle cells are resolved using
+//! the average of the four corners. The results are deterministic.
+
+vector< HeightFieldContours::Polyline > HeightFieldContours::Extract( HeightField const &		hf,
+																		vector< float > const &	levels )
+{
+	vector< Polyline >	contours;
+
+	int const	cellsI	= hf.GetSizeI() - 1;
+	int const	cellsJ	= hf.GetSizeJ() - 1;
+
+	if ( cellsI <= 0 || cellsJ <= 0 || levels.empty() )
+	{
+		return contours;
+	}
+
+	vector< float >	sortedLevels( levels );
+
+	sort( sortedLevels.begin(), sortedLevels.end() );
+	sortedLevels.erase( unique( sortedLevels.begin(), sortedLevels.end() ), sortedLevels.end() );
+
+	int const			nLevels		= int( sortedLevels.size() );
+	float const * const	pLevels		= &sortedLevels[ 0 ];
+	int const			tilesI		= ( cellsI + TILE_SIZE - 1 ) / TILE_SIZE;
+	int const			tilesJ		= ( cellsJ + TILE_SIZE - 1 ) / TILE_SIZE;
+	int const			nTiles		= tilesI * tilesJ;
+
+	// Generate the segments for each tile and level
+
+	vector< vector< Segment > >	tileSegments( size_t( nTiles ) * nLevels );
+
+	Parallel::For( 0, nTiles, 1, [ & ]( int first, int last )
+	{
+		for ( int t = first; t < last; t++ )
+		{
+			int const	j0	= ( t % tilesJ ) * TILE_SIZE;
+			int const	i0	= ( t / tilesJ ) * TILE_SIZE;
+			int const	sj	= min( TILE_SIZE, cellsJ - j0 );
+			int const	si	= min( TILE_SIZE, cellsI - i0 );
+
+			// Skip the tile if none of the levels are in its range ( minZ, maxZ ]
+
+			float const	minZ	= hf.GetMinZ( j0, i0, sj + 1, si + 1 );
+			float const	maxZ	= hf.GetMaxZ( j0, i0, sj + 1, si + 1 );
+
+			if ( upper_bound( pLevels, pLevels + nLevels, minZ ) == upper_bound( pLevels, pLevels + nLevels, maxZ ) )
+			{
+				continue;
+			}
+
+			MarchTile( hf, j0, i0, sj, si, pLevels, nLevels, &tileSegments[ size_t( t ) * nLevels ] );
+		}
+	} );
+
+	// Stitch the segments of each level into polylines
+
+	vector< vector< Polyline > >	levelContours( nLevels );
+
+	Parallel::For( 0, nLevels, 1, [ & ]( int first, int last )
+	{
+		for ( int k = first; k < last; k++ )
+		{
+			vector< Segment >	segments;
+
+			for ( int t = 0; t < nTiles; t++ )
+			{
+				vector< Segment > const &	s	= tileSegments[ size_t( t ) * nLevels + k ];
+				segments.insert( segments.end(), s.begin(), s.end() );
+			}
+
+			Stitch( hf, pLevels[ k ], segments, levelContours[ k ] );
+		}
+	} );
+
+	for ( int k = 0; k < nLevels; k++ )
+	{
+		contours.insert( contours.end(), levelContours[ k ].begin(), levelContours[ k ].end() );
+	}
+
+	return contours;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	hf			Height field
+//! @param	base		A height that is a contour level
+//! @param	interval	Distance between contour levels
+//!
+//! @return		The contours at <tt>base + n * interval</tt> for every integer n that is within the range of heights
+//!				in the height field, sorted by level
+
+vector< HeightFieldContours::Polyline > HeightFieldContours::Extract( HeightField const & hf, float base, float interval )
+{
+	assert( interval > 0.0f );
+
+	vector< float >	levels;
+
+	if ( hf.GetSizeI() > 0 && hf.GetSizeJ() > 0 )
+	{
+		float const	minZ	= hf.GetMinZ();
+		float const	maxZ	= hf.GetMaxZ();
+
+		for ( float n = ceilf( ( minZ - base ) / interval ); base + n * interval <= maxZ; n += 1.0f )
+		{
+			levels.push_back( base + n * interval );
+		}
+	}
+
+	return Extract( hf, levels );
+}
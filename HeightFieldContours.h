@@ -0,0 +1,51 @@
+/** @file *//********************************************************************************************************
+
+                                                 HeightFieldContours.h
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/HeightFieldContours.h#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#pragma once
+
+#include <vector>
+
+class HeightField;
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! Extracts contour lines (isolines) from a HeightField using marching squares.
+
+class HeightFieldContours
+{
+public:
+
+	//! A point on a contour, in grid coordinates
+	struct Point
+	{
+		float	m_J;	//!< Position along the J axis
+		float	m_I;	//!< Position along the I axis
+	};
+
+	//! A connected contour line
+	struct Polyline
+	{
+		float				m_Level;	//!< Height of the contour
+		bool				m_Closed;	//!< True if the last point is the same as the first point
+		std::vector<Point>	m_Points;	//!< Points along the contour
+	};
+
+	//! Extracts the contours at the specified heights
+	static std::vector<Polyline> Extract( HeightField const & hf, std::vector<float> const & levels );
+
+	//! Extracts the contours at regular intervals
+	static std::vector<Polyline> Extract( HeightField const & hf, float base, float interval );
+};
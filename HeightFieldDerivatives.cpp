@@ -0,0 +1,395 @@
+/** @file *//********************************************************************************************************
+
+                                              HeightFieldDerivatives.cpp
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/HeightFieldDerivatives.cpp#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#include "PrecompiledHeaders.h"
+
+#include "HeightFieldDerivatives.h"
+
+#include "HeightField.h"
+#include "Parallel.h"
+#include "Simd.h"
+
+using namespace std;
+
+
+namespace
+{
+
+// Number of rows processed by a task
+int const	ROW_BLOCK_SIZE	= 32;
+
+// Partial derivatives of a row of vertexes
+struct Coefficients
+{
+	vector<float>	p;	// dz/dj
+	vector<float>	q;	// dz/di
+	vector<float>	r;	// d2z/dj2
+	vector<float>	t;	// d2z/di2
+	vector<float>	s;	// d2z/didj
+
+	explicit Coefficients( int n ) : p( n ), q( n ), r( n ), t( n ), s( n ) {}
+};
+
+// Copies row i of the height field into a row with one extra element replicated at each end
+void LoadPaddedRow( HeightField const & hf, int i, float * pRow )
+{
+	int const	sizeJ	= hf.GetSizeJ();
+
+	i = min( max( i, 0 ), hf.GetSizeI() - 1 );
+
+	HeightField::Vertex const * const	pV	= hf.GetData( 0, i );
+
+	for ( int j = 0; j < sizeJ; j++ )
+	{
+		pRow[ j + 1 ] = pV[ j ].m_Z;
+	}
+
+	pRow[ 0 ]			= pRow[ 1 ];
+	pRow[ sizeJ + 1 ]	= pRow[ sizeJ ];
+}
+
+// Computes the partial derivatives of the center row given three padded rows
+void ComputeCoefficients( float const * a, float const * b, float const * c, int n, float spacing, Coefficients & out )
+{
+	float const	k1	= 1.0f / ( 8.0f * spacing );
+	float const	k2	= 1.0f / ( spacing * spacing );
+	float const	k3	= 1.0f / ( 4.0f * spacing * spacing );
+
+	int	j	= 0;
+
+#if defined( HEIGHTFIELD_USE_SSE )
+
+	__m128 const	vk1	= _mm_set1_ps( k1 );
+	__m128 const	vk2	= _mm_set1_ps( k2 );
+	__m128 const	vk3	= _mm_set1_ps( k3 );
+
+	for ( ; j + 4 <= n; j += 4 )
+	{
+		__m128 const	z1	= _mm_loadu_ps( a + j );
+		__m128 const	z2	= _mm_loadu_ps( a + j + 1 );
+		__m128 const	z3	= _mm_loadu_ps( a + j + 2 );
+		__m128 const	z4	= _mm_loadu_ps( b + j );
+		__m128 const	z5	= _mm_loadu_ps( b + j + 1 );
+		__m128 const	z6	= _mm_loadu_ps( b + j + 2 );
+		__m128 const	z7	= _mm_loadu_ps( c + j );
+		__m128 const	z8	= _mm_loadu_ps( c + j + 1 );
+		__m128 const	z9	= _mm_loadu_ps( c + j + 2 );
+
+		__m128 const	z5x2	= _mm_add_ps( z5, z5 );
+
+		__m128 const	p	= _mm_mul_ps( _mm_sub_ps( _mm_add_ps( _mm_add_ps( z3, z9 ), _mm_add_ps( z6, z6 ) ),
+												  _mm_add_ps( _mm_add_ps( z1, z7 ), _mm_add_ps( z4, z4 ) ) ), vk1 );
+		__m128 const	q	= _mm_mul_ps( _mm_sub_ps( _mm_add_ps( _mm_add_ps( z7, z9 ), _mm_add_ps( z8, z8 ) ),
+												  _mm_add_ps( _mm_add_ps( z1, z3 ), _mm_add_ps( z2, z2 ) ) ), vk1 );
+		__m128 const	r	= _mm_mul_ps( _mm_sub_ps( _mm_add_ps( z4, z6 ), z5x2 ), vk2 );
+		__m128 const	t	= _mm_mul_ps( _mm_sub_ps( _mm_add_ps( z2, z8 ), z5x2 ), vk2 );
+		__m128 const	s	= _mm_mul_ps( _mm_sub_ps( _mm_add_ps( z9, z1 ), _mm_add_ps( z7, z3 ) ), vk3 );
+
+		_mm_storeu_ps( &out.p[ j ], p );
+		_mm_storeu_ps( &out.q[ j ], q );
+		_mm_storeu_ps( &out.r[ j ], r );
+		_mm_storeu_ps( &out.t[ j ], t );
+		_mm_storeu_ps( &out.s[ j ], s );
+	}
+
+#endif // defined( HEIGHTFIELD_USE_SSE )
+
+	for ( ; j < n; j++ )
+	{
+		float const	z1	= a[ j ];
+		float const	z2	= a[ j + 1 ];
+		float const	z3	= a[ j + 2 ];
+		float const	z4	= b[ j ];
+		float const	z5	= b[ j + 1 ];
+		float const	z6	= b[ j + 2 ];
+		float const	z7	= c[ j ];
+		float const	z8	= c[ j + 1 ];
+		float const	z9	= c[ j + 2 ];
+
+		out.p[ j ] = ( ( z3 + 2.0f * z6 + z9 ) - ( z1 + 2.0f * z4 + z7 ) ) * k1;
+		out.q[ j ] = ( ( z7 + 2.0f * z8 + z9 ) - ( z1 + 2.0f * z2 + z3 ) ) * k1;
+		out.r[ j ] = ( z4 - 2.0f * z5 + z6 ) * k2;
+		out.t[ j ] = ( z2 - 2.0f * z5 + z8 ) * k2;
+		out.s[ j ] = ( z9 - z7 - z3 + z1 ) * k3;
+	}
+}
+
+// Gradients smaller than this are considered flat
+float const	FLAT_GRADIENT_SQUARED	= 1.0e-12f;
+
+} // anonymous namespace
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	hf					Height field
+//! @param	spacing				Distance between adjacent vertexes, in the same units as Z
+//! @param	pSlope				If not 0, receives the slope angle in radians, [0, pi/2]
+//! @param	pAspect				If not 0, receives the direction of steepest descent in radians, [-pi, pi], measured
+//!								from the J axis towards the I axis. Flat vertexes have an aspect of 0.
+//! @param	pPlanCurvature		If not 0, receives the curvature of the contour line through each vertex
+//! @param	pProfileCurvature	If not 0, receives the curvature along the direction of steepest descent
+//!
+//! Each raster is resized to the size of the height field and keeps its format and quantization range. Rows are
+//! processed in blocks in parallel, and each block keeps a rolling window of three rows so that every height is
+//! read from the height field only once per block.
+//!
+//! @note	The curvatures use the Evans-Young formulation. Both are 0 where the surface is flat.
+
+void HeightFieldDerivatives::Compute( HeightField const &	hf,
+									  float					spacing,
+									  Raster *				pSlope,
+									  Raster *				pAspect,
+									  Raster *				pPlanCurvature,
+									  Raster *				pProfileCurvature )
+{
+	assert( spacing > 0.0f );
+
+	int const	sizeI	= hf.GetSizeI();
+	int const	sizeJ	= hf.GetSizeJ();
+
+	if ( sizeI <= 0 || sizeJ <= 0 )
+	{
+		return;
+	}
+
+	Raster * const	apRasters[]	= { pSlope, pAspect, pPlanCurvature, pProfileCurvature };
+
+	for ( int k = 0; k < 4; k++ )
+	{
+		if ( apRasters[ k ] )
+		{
+			apRasters[ k ]->Resize( sizeI, sizeJ );
+		}
+	}
+
+	Parallel::For( 0, sizeI, ROW_BLOCK_SIZE, [ & ]( int first, int last )
+	{
+		int const		paddedSize	= sizeJ + 2;
+		vector<float>	window( paddedSize * 3 );
+		float *			a			= &window[ 0 ];
+		float *			b			= &window[ paddedSize ];
+		float *			c			= &window[ paddedSize * 2 ];
+		Coefficients	k( sizeJ );
+		vector<float>	values( sizeJ );
+
+		LoadPaddedRow( hf, first - 1, a );
+		LoadPaddedRow( hf, first, b );
+
+		for ( int i = first; i < last; i++ )
+		{
+			LoadPaddedRow( hf, i + 1, c );
+
+			ComputeCoefficients( a, b, c, sizeJ, spacing, k );
+
+			if ( pSlope )
+			{
+				for ( int j = 0; j < sizeJ; j++ )
+				{
+					values[ j ] = atanf( sqrtf( k.p[ j ] * k.p[ j ] + k.q[ j ] * k.q[ j ] ) );
+				}
+				pSlope->SetRow( i, &values[ 0 ] );
+			}
+
+			if ( pAspect )
+			{
+				for ( int j = 0; j < sizeJ; j++ )
+				{
+					float const	g	= k.p[ j ] * k.p[ j ] + k.q[ j ] * k.q[ j ];
+					values[ j ] = ( g > FLAT_GRADIENT_SQUARED ) ? atan2f( -k.q[ j ], -k.p[ j ] ) : 0.0f;
+				}
+				pAspect->SetRow( i, &values[ 0 ] );
+			}
+
+			if ( pPlanCurvature )
+			{
+				for ( int j = 0; j < sizeJ; j++ )
+				{
+					float const	p	= k.p[ j ];
+					float const	q	= k.q[ j ];
+					float const	g	= max( p * p + q * q, FLAT_GRADIENT_SQUARED );
+					float const	curvature	= -( q * q * k.r[ j ] - 2.0f * p * q * k.s[ j ] + p * p * k.t[ j ] ) / ( g * sqrtf( g ) );
+					values[ j ] = ( g > FLAT_GRADIENT_SQUARED ) ? curvature : 0.0f;
+				}
+				pPlanCurvature->SetRow( i, &values[ 0 ] );
+			}
+
+			if ( pProfileCurvature )
+			{
+				for ( int j = 0; j < sizeJ; j++ )
+				{
+					float const	p	= k.p[ j ];
+					float const	q	= k.q[ j ];
+					float const	g	= max( p * p + q * q, FLAT_GRADIENT_SQUARED );
+					float const	curvature	= -( p * p * k.r[ j ] + 2.0f * p * q * k.s[ j ] + q * q * k.t[ j ] ) /
+										  ( g * ( 1.0f + g ) * sqrtf( 1.0f + g ) );
+					values[ j ] = ( g > FLAT_GRADIENT_SQUARED ) ? curvature : 0.0f;
+				}
+				pProfileCurvature->SetRow( i, &values[ 0 ] );
+			}
+
+			// Roll the window down one row
+
+			float * const	pOldest	= a;
+			a = b;
+			b = c;
+			c = pOldest;
+		}
+	} );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	format		Storage format
+//! @param	minValue	Value represented by the lowest quantized value (ignored by @c FORMAT_FLOAT)
+//! @param	maxValue	Value represented by the highest quantized value (ignored by @c FORMAT_FLOAT)
+
+HeightFieldDerivatives::Raster::Raster( Format format /*= FORMAT_FLOAT*/,
+										float minValue /*= 0.0f*/, float maxValue /*= 1.0f*/ )
+	: m_format( format ),
+	m_minValue( minValue ),
+	m_maxValue( maxValue ),
+	m_sizeI( 0 ),
+	m_sizeJ( 0 )
+{
+	assert( format == FORMAT_FLOAT || maxValue > minValue );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	sizeI	Size of the raster along the I axis.
+//! @param	sizeJ	Size of the raster along the J axis.
+//!
+//! @exception	bad_alloc	Unable to allocate the storage.
+
+void HeightFieldDerivatives::Raster::Resize( int sizeI, int sizeJ )
+{
+	size_t const	n	= size_t( sizeI ) * sizeJ;
+
+	m_sizeI = sizeI;
+	m_sizeJ = sizeJ;
+
+	// Only the vector for the format is used.
+
+	switch ( m_format )
+	{
+	case FORMAT_UINT8:	m_bytes.resize( n );	break;
+	case FORMAT_UINT16:	m_words.resize( n );	break;
+	default:			m_floats.resize( n );	break;
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//!
+//! @return		The storage, or 0 if the raster is empty. The type of the elements depends on the format.
+
+void const * HeightFieldDerivatives::Raster::GetData() const
+{
+	switch ( m_format )
+	{
+	case FORMAT_UINT8:	return m_bytes.empty() ? 0 : &m_bytes[ 0 ];
+	case FORMAT_UINT16:	return m_words.empty() ? 0 : &m_words[ 0 ];
+	default:			return m_floats.empty() ? 0 : &m_floats[ 0 ];
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	j	J index
+//! @param	i	I index
+//!
+//! @return		Value at ( @a j, @a i )
+
+float HeightFieldDerivatives::Raster::GetValue( int j, int i ) const
+{
+	assert_limits( 0, j, m_sizeJ-1 );
+	assert_limits( 0, i, m_sizeI-1 );
+
+	size_t const	k	= size_t( i ) * m_sizeJ + j;
+
+	switch ( m_format )
+	{
+	case FORMAT_UINT8:
+		return m_minValue + m_bytes[ k ] * ( m_maxValue - m_minValue ) / 255.0f;
+
+	case FORMAT_UINT16:
+		return m_minValue + m_words[ k ] * ( m_maxValue - m_minValue ) / 65535.0f;
+
+	default:
+		return m_floats[ k ];
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	i			I index of the row
+//! @param	pValues		Values to store (GetSizeJ() of them). Quantized values are clamped to [min, max].
+
+void HeightFieldDerivatives::Raster::SetRow( int i, float const * pValues )
+{
+	assert_limits( 0, i, m_sizeI-1 );
+
+	size_t const	offset	= size_t( i ) * m_sizeJ;
+
+	if ( m_format == FORMAT_FLOAT )
+	{
+		float * const	pRow	= &m_floats[ offset ];
+
+		for ( int j = 0; j < m_sizeJ; j++ )
+		{
+			pRow[ j ] = pValues[ j ];
+		}
+	}
+	else
+	{
+		float const	maxCode	= ( m_format == FORMAT_UINT8 ) ? 255.0f : 65535.0f;
+		float const	scale	= maxCode / ( m_maxValue - m_minValue );
+
+		if ( m_format == FORMAT_UINT8 )
+		{
+			unsigned char * const	pRow	= &m_bytes[ offset ];
+
+			for ( int j = 0; j < m_sizeJ; j++ )
+			{
+				pRow[ j ] = (unsigned char)( min( max( ( pValues[ j ] - m_minValue ) * scale, 0.0f ), maxCode ) + 0.5f );
+			}
+		}
+		else
+		{
+			unsigned short * const	pRow	= &m_words[ offset ];
+
+			for ( int j = 0; j < m_sizeJ; j++ )
+			{
+				pRow[ j ] = (unsigned short)( min( max( ( pValues[ j ] - m_minValue ) * scale, 0.0f ), maxCode ) + 0.5f );
+			}
+		}
+	}
+}
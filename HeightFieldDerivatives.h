@@ -0,0 +1,105 @@
+/** @file *//********************************************************************************************************
+
+                                               HeightFieldDerivatives.h
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/HeightFieldDerivatives.h#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#pragma once
+
+#include <Misc/Assert.h>
+#include <vector>
+
+class HeightField;
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! Computes slope, aspect and curvature rasters from a HeightField.
+//!
+//! All products are computed from a 3x3 stencil around each vertex. Vertexes on the edges use the nearest
+//! vertex in place of the missing neighbors. Any combination of products can be computed in a single pass.
+
+class HeightFieldDerivatives
+{
+public:
+
+	class Raster;
+
+	//! Computes the requested derivative rasters
+	static void Compute( HeightField const &	hf,
+						 float					spacing,
+						 Raster *				pSlope,
+						 Raster *				pAspect				= 0,
+						 Raster *				pPlanCurvature		= 0,
+						 Raster *				pProfileCurvature	= 0 );
+};
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! A 2D array of derivative values stored as floats or quantized integers.
+
+class HeightFieldDerivatives::Raster
+{
+public:
+
+	//! Storage format of the values
+	enum Format
+	{
+		FORMAT_FLOAT,		//!< 32-bit floats
+		FORMAT_UINT8,		//!< 8-bit values quantized over [min, max]
+		FORMAT_UINT16		//!< 16-bit values quantized over [min, max]
+	};
+
+	//! Constructor
+	explicit Raster( Format format = FORMAT_FLOAT, float minValue = 0.0f, float maxValue = 1.0f );
+
+	//! Resizes the raster. The contents are undefined afterwards.
+	void Resize( int sizeI, int sizeJ );
+
+	//! Returns the size of the raster along the I axis.
+	int GetSizeI() const				{ return m_sizeI; }
+
+	//! Returns the size of the raster along the J axis.
+	int GetSizeJ() const				{ return m_sizeJ; }
+
+	//! Returns the storage format.
+	Format GetFormat() const			{ return m_format; }
+
+	//! Returns the value represented by the lowest quantized value.
+	float GetMinValue() const			{ return m_minValue; }
+
+	//! Returns the value represented by the highest quantized value.
+	float GetMaxValue() const			{ return m_maxValue; }
+
+	//! Returns the raw storage. The elements are stored in this order: <tt>[i][j]</tt>.
+	void const * GetData() const;
+
+	//! Returns the (dequantized) value at ( @a j, @a i ).
+	float GetValue( int j, int i ) const;
+
+	//! Stores a row of values, quantizing them if necessary
+	void SetRow( int i, float const * pValues );
+
+private:
+
+	Format						m_format;		//!< Storage format
+	float						m_minValue;		//!< Value of the lowest quantized value
+	float						m_maxValue;		//!< Value of the highest quantized value
+	int							m_sizeI;		//!< Size of the raster in the I direction
+	int							m_sizeJ;		//!< Size of the raster in the J direction
+	std::vector<float>			m_floats;		//!< Storage if the format is FORMAT_FLOAT
+	std::vector<unsigned char>	m_bytes;		//!< Storage if the format is FORMAT_UINT8
+	std::vector<unsigned short>	m_words;		//!< Storage if the format is FORMAT_UINT16
+};
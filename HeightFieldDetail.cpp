@@ -0,0 +1,272 @@
+/** @file *//********************************************************************************************************
+
+                                                  HeightFieldDetail.cpp
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/HeightFieldDetail.cpp#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#include "PrecompiledHeaders.h"
+
+#include "HeightFieldDetail.h"
+
+#include "HeightField.h"
+#include "HeightFieldGenerator.h"
+
+using namespace std;
+
+
+namespace
+{
+
+// Returns the magnitude of the gradient of the heightfield at a vertex, from central differences (one-sided on the
+// edges). Vertexes outside the heightfield are clamped to the edges.
+float GetSlope( HeightFieldView const & view, int j, int i )
+{
+	j = min( max( j, 0 ), view.GetSizeJ() - 1 );
+	i = min( max( i, 0 ), view.GetSizeI() - 1 );
+
+	int const	j0	= max( j - 1, 0 );
+	int const	j1	= min( j + 1, view.GetSizeJ() - 1 );
+	int const	i0	= max( i - 1, 0 );
+	int const	i1	= min( i + 1, view.GetSizeI() - 1 );
+
+	float const	dzdj	= ( j1 > j0 ) ? ( view.GetZ( j1, i ) - view.GetZ( j0, i ) ) / float( j1 - j0 ) : 0.0f;
+	float const	dzdi	= ( i1 > i0 ) ? ( view.GetZ( j, i1 ) - view.GetZ( j, i0 ) ) / float( i1 - i0 ) : 0.0f;
+
+	return sqrtf( dzdj * dzdj + dzdi * dzdi );
+}
+
+} // anonymous namespace
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+HeightFieldDetail::Parameters::Parameters()
+	: m_Seed( 0 ),
+	m_Resolution( 16 ),
+	m_TileCells( 8 ),
+	m_Amplitude( 0.0f ),
+	m_SlopeAmplitude( 0.1f ),
+	m_Roughness( 0.5f ),
+	m_CacheSize( 64 )
+{
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	view		Base heightfield. The data must outlive this object.
+//! @param	parameters	Parameters of the detail
+
+HeightFieldDetail::HeightFieldDetail( HeightFieldView const & view, Parameters const & parameters /*= Parameters()*/ )
+	: m_view( view ),
+	m_parameters( parameters ),
+	m_tilesJ( max( ( view.GetSizeJ() - 1 + parameters.m_TileCells - 1 ) / parameters.m_TileCells, 1 ) ),
+	m_tilesI( max( ( view.GetSizeI() - 1 + parameters.m_TileCells - 1 ) / parameters.m_TileCells, 1 ) )
+{
+	assert( parameters.m_Resolution >= 1 );
+	assert( parameters.m_TileCells >= 1 );
+	assert( parameters.m_CacheSize >= 1 );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	j,i		Position, in grid coordinates. It must be within the heightfield.
+//!
+//! @return		The height of the base surface (as for HeightFieldView::GetInterpolatedZ()) plus the detail
+//!
+//! @exception	bad_alloc	Unable to allocate a tile.
+
+float HeightFieldDetail::GetZ( float j, float i ) const
+{
+	return m_view.GetInterpolatedZ( j, i ) + GetDetail( j, i );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! The detail is interpolated between the detail samples the same way as the heights are interpolated between
+//! vertexes.
+//!
+//! @param	j,i		Position, in grid coordinates. It must be within the heightfield.
+//!
+//! @return		The detail offset
+//!
+//! @exception	bad_alloc	Unable to allocate a tile.
+
+float HeightFieldDetail::GetDetail( float j, float i ) const
+{
+	int const	cells		= m_parameters.m_TileCells;
+	int const	resolution	= m_parameters.m_Resolution;
+
+	int const	x		= min( int( j ) / cells, m_tilesJ - 1 );
+	int const	y		= min( int( i ) / cells, m_tilesI - 1 );
+	float const	last	= float( cells * resolution );
+
+	TilePtr const	pTile	= GetTile( x, y );
+
+	return pTile->GetInterpolatedZ( min( ( j - float( x * cells ) ) * resolution, last ),
+									min( ( i - float( y * cells ) ) * resolution, last ) );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+void HeightFieldDetail::Clear()
+{
+	lock_guard< mutex >	lock( m_mutex );
+
+	m_tiles.clear();
+	m_index.clear();
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+int HeightFieldDetail::GetCachedTileCount() const
+{
+	lock_guard< mutex >	lock( m_mutex );
+
+	return int( m_tiles.size() );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+HeightFieldDetail::TilePtr HeightFieldDetail::GetTile( int x, int y ) const
+{
+	int const	key	= y * m_tilesJ + x;
+
+	{
+		lock_guard< mutex >	lock( m_mutex );
+
+		TileIndex::iterator const	pEntry	= m_index.find( key );
+
+		if ( pEntry != m_index.end() )
+		{
+			m_tiles.splice( m_tiles.begin(), m_tiles, pEntry->second );
+			return pEntry->second->second;
+		}
+	}
+
+	// The tile is synthesized without holding the lock, so other threads can use the cache in the meantime. If
+	// another thread synthesizes the same tile first, its tile is used instead (they are the same).
+
+	TilePtr const	pTile	= Synthesize( x, y );
+
+	lock_guard< mutex >	lock( m_mutex );
+
+	TileIndex::iterator const	pEntry	= m_index.find( key );
+
+	if ( pEntry != m_index.end() )
+	{
+		m_tiles.splice( m_tiles.begin(), m_tiles, pEntry->second );
+		return pEntry->second->second;
+	}
+
+	m_tiles.push_front( make_pair( key, pTile ) );
+	m_index[ key ] = m_tiles.begin();
+
+	while ( int( m_tiles.size() ) > m_parameters.m_CacheSize )
+	{
+		m_index.erase( m_tiles.back().first );
+		m_tiles.pop_back();
+	}
+
+	return pTile;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+HeightFieldDetail::TilePtr HeightFieldDetail::Synthesize( int x, int y ) const
+{
+	int const	cells		= m_parameters.m_TileCells;
+	int const	resolution	= m_parameters.m_Resolution;
+	int const	n			= cells * resolution + 1;
+
+	// The noise has one octave per halving of the feature size, from one cycle per cell down to two samples per cycle
+
+	HeightFieldGenerator::Parameters	noise;
+
+	noise.m_Seed		= m_parameters.m_Seed;
+	noise.m_Octaves		= 1;
+	noise.m_Frequency	= 1.0f / float( resolution );
+	noise.m_Lacunarity	= 2.0f;
+	noise.m_Gain		= m_parameters.m_Roughness;
+	noise.m_Amplitude	= 1.0f;
+	noise.m_OffsetJ		= x * cells * resolution;
+	noise.m_OffsetI		= y * cells * resolution;
+
+	while ( ( 2 << noise.m_Octaves ) <= resolution )
+	{
+		++noise.m_Octaves;
+	}
+
+	shared_ptr< HeightField >	pTile( new HeightField( n, n ) );
+
+	pTile->Resize( n, n );
+	HeightFieldGenerator::GenerateFbm( *pTile, noise );
+
+	// Scale the noise by the amplitude, which depends on the slope. The slope is interpolated bilinearly between the
+	// slopes at the vertexes, so the amplitude is continuous across cells and tiles.
+
+	vector< float >	slopes( ( cells + 1 ) * ( cells + 1 ) );
+
+	for ( int v = 0; v <= cells; v++ )
+	{
+		for ( int u = 0; u <= cells; u++ )
+		{
+			slopes[ v * ( cells + 1 ) + u ] = GetSlope( m_view, x * cells + u, y * cells + v );
+		}
+	}
+
+	HeightFieldMutableView const	view	= pTile->GetView();
+	float const						scale	= 1.0f / float( resolution );
+
+	for ( int si = 0; si < n; si++ )
+	{
+		int const	v	= min( si / resolution, cells - 1 );
+		float const	fv	= float( si - v * resolution ) * scale;
+
+		HeightField::Vertex * const	pRow	= view.GetData( 0, si );
+
+		for ( int sj = 0; sj < n; sj++ )
+		{
+			int const		u		= min( sj / resolution, cells - 1 );
+			float const		fu		= float( sj - u * resolution ) * scale;
+			float const *	pSlope	= &slopes[ v * ( cells + 1 ) + u ];
+
+			float const	s0		= pSlope[ 0 ] + ( pSlope[ 1 ] - pSlope[ 0 ] ) * fu;
+			float const	s1		= pSlope[ cells + 1 ] + ( pSlope[ cells + 2 ] - pSlope[ cells + 1 ] ) * fu;
+			float const	slope	= s0 + ( s1 - s0 ) * fv;
+
+			pRow[ sj ].m_Z *= m_parameters.m_Amplitude + m_parameters.m_SlopeAmplitude * slope;
+		}
+	}
+
+	return pTile;
+}
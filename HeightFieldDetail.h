@@ -0,0 +1,97 @@
+/** @file *//********************************************************************************************************
+
+                                                   HeightFieldDetail.h
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/HeightFieldDetail.h#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#pragma once
+
+#include "HeightFieldView.h"
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+class HeightField;
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! Adds procedural detail below the resolution of a heightfield.
+//!
+//! Heights are the interpolated height of the base heightfield plus a detail offset. The detail is fBm noise from
+//! HeightFieldGenerator with features from the size of a cell down to the size of a detail sample, scaled by an
+//! amplitude that increases with the slope of the base surface, so steep ground is rougher than flat ground.
+//!
+//! The detail is synthesized when it is first needed, in square tiles of cells, and the most recently used tiles
+//! are kept in a small cache. The detail depends only on the seed and the position, so a tile that is evicted and
+//! synthesized again is the same, and adjacent tiles join exactly.
+//!
+//! @note	The functions may be called by several threads at the same time. If the base heightfield changes,
+//!			Clear() must be called.
+
+class HeightFieldDetail
+{
+public:
+
+	//! Parameters of the detail
+	struct Parameters
+	{
+		//! Constructor
+		Parameters();
+
+		unsigned	m_Seed;				//!< Seed of the random values
+		int			m_Resolution;		//!< Number of detail samples per cell along each axis
+		int			m_TileCells;		//!< Number of cells in a tile along each axis
+		float		m_Amplitude;		//!< Amplitude of the detail on flat ground
+		float		m_SlopeAmplitude;	//!< Increase in the amplitude per unit of slope (height per grid unit)
+		float		m_Roughness;		//!< Ratio of the amplitudes of consecutive octaves of the detail
+		int			m_CacheSize;		//!< Maximum number of tiles in the cache
+	};
+
+	//! Constructor
+	explicit HeightFieldDetail( HeightFieldView const & view, Parameters const & parameters = Parameters() );
+
+	//! Returns the height at [ @a j, @a i ], including the detail.
+	float GetZ( float j, float i ) const;
+
+	//! Returns the detail offset at [ @a j, @a i ].
+	float GetDetail( float j, float i ) const;
+
+	//! Discards the cached detail.
+	void Clear();
+
+	//! Returns the number of tiles in the cache.
+	int GetCachedTileCount() const;
+
+private:
+
+	typedef std::shared_ptr< HeightField const >				TilePtr;
+	typedef std::list< std::pair< int, TilePtr > >				TileList;
+	typedef std::unordered_map< int, TileList::iterator >		TileIndex;
+
+	// Returns a tile, synthesizing it if it is not in the cache
+	TilePtr GetTile( int x, int y ) const;
+
+	// Synthesizes the detail of a tile
+	TilePtr Synthesize( int x, int y ) const;
+
+	HeightFieldView			m_view;			//!< Base heightfield
+	Parameters				m_parameters;	//!< Parameters of the detail
+	int						m_tilesJ;		//!< Number of tiles along the J axis
+	int						m_tilesI;		//!< Number of tiles along the I axis
+	mutable std::mutex		m_mutex;		//!< Protects the cache
+	mutable TileList		m_tiles;		//!< Cached tiles, most recently used first
+	mutable TileIndex		m_index;		//!< Cached tiles by number
+};
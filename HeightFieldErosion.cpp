@@ -0,0 +1,840 @@
+/** @file *//********************************************************************************************************
+
+                                                 HeightFieldErosion.cpp
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/HeightFieldErosion.cpp#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#include "PrecompiledHeaders.h"
+
+#include "HeightFieldErosion.h"
+
+#include "HeightField.h"
+#include "HeightFieldView.h"
+#include "Parallel.h"
+#include "Simd.h"
+
+using namespace std;
+
+
+namespace
+{
+
+// Number of rows updated by each parallel task
+int const	ROW_GRAIN	= 16;
+
+// Smallest divisor, to avoid dividing by 0
+float const	TINY		= 1.0e-20f;
+
+// Constants used by the flux kernel
+struct FluxConstants
+{
+	float	m_Acceleration;		// Change in flux per unit of difference in water level in an iteration
+	float	m_Rain;				// Depth of the rain falling in an iteration
+	float	m_TimeStep;			// Duration of an iteration
+};
+
+// Constants used by the thermal kernels
+struct ThermalConstants
+{
+	float	m_Talus;			// Largest stable difference in height between adjacent vertexes
+	float	m_DiagonalTalus;	// Largest stable difference in height between diagonal vertexes
+	float	m_Rate;				// Fraction of the largest excess moved in an iteration
+};
+
+// Returns the pointer to the heights in a row
+inline float * GetRow( HeightFieldMutableView const & view, int i )
+{
+	return &view.GetData( 0, i )->m_Z;
+}
+
+// Updates the outflow of a cell given the levels of the water surface of the cell and its neighbors. The outflow
+// through each pipe is accelerated by the difference in levels, and then all of them are scaled so that no more
+// water flows out than the cell contains.
+inline void UpdateFlux( float h, float hJ0, float hJ1, float hI0, float hI1, float water, FluxConstants const & c,
+						float & fJ0, float & fJ1, float & fI0, float & fI1 )
+{
+	float const	f0		= max( 0.0f, fJ0 + c.m_Acceleration * ( h - hJ0 ) );
+	float const	f1		= max( 0.0f, fJ1 + c.m_Acceleration * ( h - hJ1 ) );
+	float const	f2		= max( 0.0f, fI0 + c.m_Acceleration * ( h - hI0 ) );
+	float const	f3		= max( 0.0f, fI1 + c.m_Acceleration * ( h - hI1 ) );
+	float const	sum		= ( ( f0 + f1 ) + f2 ) + f3;
+	float const	scale	= min( 1.0f, ( water + c.m_Rain ) / max( sum * c.m_TimeStep, TINY ) );
+
+	fJ0 = f0 * scale;
+	fJ1 = f1 * scale;
+	fI0 = f2 * scale;
+	fI1 = f3 * scale;
+}
+
+// Updates the outflow of the cells in a row. b and d are the heights and the water in the previous, current and
+// next rows. A missing row or column is replaced by the cell itself, so nothing flows out of the heightfield.
+void UpdateFluxRow( float const * const b[ 3 ], float const * const d[ 3 ], float * const f[ 4 ], int sizeJ,
+					FluxConstants const & c )
+{
+	int const	last	= sizeJ - 1;
+
+	auto const	cell	= [ & ]( int j, int jm, int jp )
+	{
+		UpdateFlux( b[ 1 ][ j ] + d[ 1 ][ j ],
+					b[ 1 ][ jm ] + d[ 1 ][ jm ], b[ 1 ][ jp ] + d[ 1 ][ jp ],
+					b[ 0 ][ j ] + d[ 0 ][ j ], b[ 2 ][ j ] + d[ 2 ][ j ],
+					d[ 1 ][ j ], c,
+					f[ 0 ][ j ], f[ 1 ][ j ], f[ 2 ][ j ], f[ 3 ][ j ] );
+	};
+
+	cell( 0, 0, min( 1, last ) );
+
+	int	j	= 1;
+
+#if defined( HEIGHTFIELD_USE_AVX2 )
+
+	__m256 const	vAcceleration	= _mm256_set1_ps( c.m_Acceleration );
+	__m256 const	vRain			= _mm256_set1_ps( c.m_Rain );
+	__m256 const	vTimeStep		= _mm256_set1_ps( c.m_TimeStep );
+	__m256 const	vTiny			= _mm256_set1_ps( TINY );
+	__m256 const	vZero			= _mm256_setzero_ps();
+	__m256 const	vOne			= _mm256_set1_ps( 1.0f );
+
+	for ( ; j + 8 <= last; j += 8 )
+	{
+		__m256 const	h		= _mm256_add_ps( _mm256_loadu_ps( b[ 1 ] + j ), _mm256_loadu_ps( d[ 1 ] + j ) );
+		__m256 const	hJ0		= _mm256_add_ps( _mm256_loadu_ps( b[ 1 ] + j - 1 ), _mm256_loadu_ps( d[ 1 ] + j - 1 ) );
+		__m256 const	hJ1		= _mm256_add_ps( _mm256_loadu_ps( b[ 1 ] + j + 1 ), _mm256_loadu_ps( d[ 1 ] + j + 1 ) );
+		__m256 const	hI0		= _mm256_add_ps( _mm256_loadu_ps( b[ 0 ] + j ), _mm256_loadu_ps( d[ 0 ] + j ) );
+		__m256 const	hI1		= _mm256_add_ps( _mm256_loadu_ps( b[ 2 ] + j ), _mm256_loadu_ps( d[ 2 ] + j ) );
+		__m256 const	f0		= _mm256_max_ps( _mm256_add_ps( _mm256_loadu_ps( f[ 0 ] + j ), _mm256_mul_ps( vAcceleration, _mm256_sub_ps( h, hJ0 ) ) ), vZero );
+		__m256 const	f1		= _mm256_max_ps( _mm256_add_ps( _mm256_loadu_ps( f[ 1 ] + j ), _mm256_mul_ps( vAcceleration, _mm256_sub_ps( h, hJ1 ) ) ), vZero );
+		__m256 const	f2		= _mm256_max_ps( _mm256_add_ps( _mm256_loadu_ps( f[ 2 ] + j ), _mm256_mul_ps( vAcceleration, _mm256_sub_ps( h, hI0 ) ) ), vZero );
+		__m256 const	f3		= _mm256_max_ps( _mm256_add_ps( _mm256_loadu_ps( f[ 3 ] + j ), _mm256_mul_ps( vAcceleration, _mm256_sub_ps( h, hI1 ) ) ), vZero );
+		__m256 const	sum		= _mm256_add_ps( _mm256_add_ps( _mm256_add_ps( f0, f1 ), f2 ), f3 );
+		__m256 const	water	= _mm256_add_ps( _mm256_loadu_ps( d[ 1 ] + j ), vRain );
+		__m256 const	scale	= _mm256_min_ps( _mm256_div_ps( water, _mm256_max_ps( _mm256_mul_ps( sum, vTimeStep ), vTiny ) ), vOne );
+
+		_mm256_storeu_ps( f[ 0 ] + j, _mm256_mul_ps( f0, scale ) );
+		_mm256_storeu_ps( f[ 1 ] + j, _mm256_mul_ps( f1, scale ) );
+		_mm256_storeu_ps( f[ 2 ] + j, _mm256_mul_ps( f2, scale ) );
+		_mm256_storeu_ps( f[ 3 ] + j, _mm256_mul_ps( f3, scale ) );
+	}
+
+#elif defined( HEIGHTFIELD_USE_SSE )
+
+	__m128 const	vAcceleration	= _mm_set1_ps( c.m_Acceleration );
+	__m128 const	vRain			= _mm_set1_ps( c.m_Rain );
+	__m128 const	vTimeStep		= _mm_set1_ps( c.m_TimeStep );
+	__m128 const	vTiny			= _mm_set1_ps( TINY );
+	__m128 const	vZero			= _mm_setzero_ps();
+	__m128 const	vOne			= _mm_set1_ps( 1.0f );
+
+	for ( ; j + 4 <= last; j += 4 )
+	{
+		__m128 const	h		= _mm_add_ps( _mm_loadu_ps( b[ 1 ] + j ), _mm_loadu_ps( d[ 1 ] + j ) );
+		__m128 const	hJ0		= _mm_add_ps( _mm_loadu_ps( b[ 1 ] + j - 1 ), _mm_loadu_ps( d[ 1 ] + j - 1 ) );
+		__m128 const	hJ1		= _mm_add_ps( _mm_loadu_ps( b[ 1 ] + j + 1 ), _mm_loadu_ps( d[ 1 ] + j + 1 ) );
+		__m128 const	hI0		= _mm_add_ps( _mm_loadu_ps( b[ 0 ] + j ), _mm_loadu_ps( d[ 0 ] + j ) );
+		__m128 const	hI1		= _mm_add_ps( _mm_loadu_ps( b[ 2 ] + j ), _mm_loadu_ps( d[ 2 ] + j ) );
+		__m128 const	f0		= _mm_max_ps( _mm_add_ps( _mm_loadu_ps( f[ 0 ] + j ), _mm_mul_ps( vAcceleration, _mm_sub_ps( h, hJ0 ) ) ), vZero );
+		__m128 const	f1		= _mm_max_ps( _mm_add_ps( _mm_loadu_ps( f[ 1 ] + j ), _mm_mul_ps( vAcceleration, _mm_sub_ps( h, hJ1 ) ) ), vZero );
+		__m128 const	f2		= _mm_max_ps( _mm_add_ps( _mm_loadu_ps( f[ 2 ] + j ), _mm_mul_ps( vAcceleration, _mm_sub_ps( h, hI0 ) ) ), vZero );
+		__m128 const	f3		= _mm_max_ps( _mm_add_ps( _mm_loadu_ps( f[ 3 ] + j ), _mm_mul_ps( vAcceleration, _mm_sub_ps( h, hI1 ) ) ), vZero );
+		__m128 const	sum		= _mm_add_ps( _mm_add_ps( _mm_add_ps( f0, f1 ), f2 ), f3 );
+		__m128 const	water	= _mm_add_ps( _mm_loadu_ps( d[ 1 ] + j ), vRain );
+		__m128 const	scale	= _mm_min_ps( _mm_div_ps( water, _mm_max_ps( _mm_mul_ps( sum, vTimeStep ), vTiny ) ), vOne );
+
+		_mm_storeu_ps( f[ 0 ] + j, _mm_mul_ps( f0, scale ) );
+		_mm_storeu_ps( f[ 1 ] + j, _mm_mul_ps( f1, scale ) );
+		_mm_storeu_ps( f[ 2 ] + j, _mm_mul_ps( f2, scale ) );
+		_mm_storeu_ps( f[ 3 ] + j, _mm_mul_ps( f3, scale ) );
+	}
+
+#endif
+
+	for ( ; j < last; j++ )
+	{
+		cell( j, j - 1, j + 1 );
+	}
+
+	if ( last > 0 )
+	{
+		cell( last, last - 1, last );
+	}
+}
+
+
+// Returns the excess of a difference in height over the talus
+inline float Excess( float h, float neighbor, float talus )
+{
+	return max( 0.0f, ( h - neighbor ) - talus );
+}
+
+// Returns the amount of material moved out of a cell per unit of excess. The neighbors are ordered -J, +J, -I, +I,
+// and then the diagonals. The largest excess is reduced by half at the full rate, so that a cell never drops below
+// a neighbor it moves material to.
+inline float ComputeTalus( float h, float const n[ 8 ], ThermalConstants const & c )
+{
+	float const	e0		= Excess( h, n[ 0 ], c.m_Talus );
+	float const	e1		= Excess( h, n[ 1 ], c.m_Talus );
+	float const	e2		= Excess( h, n[ 2 ], c.m_Talus );
+	float const	e3		= Excess( h, n[ 3 ], c.m_Talus );
+	float const	e4		= Excess( h, n[ 4 ], c.m_DiagonalTalus );
+	float const	e5		= Excess( h, n[ 5 ], c.m_DiagonalTalus );
+	float const	e6		= Excess( h, n[ 6 ], c.m_DiagonalTalus );
+	float const	e7		= Excess( h, n[ 7 ], c.m_DiagonalTalus );
+	float const	most	= max( max( max( e0, e1 ), max( e2, e3 ) ), max( max( e4, e5 ), max( e6, e7 ) ) );
+	float const	sum		= ( ( e0 + e1 ) + ( e2 + e3 ) ) + ( ( e4 + e5 ) + ( e6 + e7 ) );
+
+	return ( c.m_Rate * most ) / max( sum, TINY );
+}
+
+// Returns the new height of a cell given the neighbors' heights and weights. The cell loses its weight times each
+// of its excesses, and gains each neighbor's weight times the neighbor's excess over the cell, which is the same
+// value that the neighbor loses, so the material is conserved.
+inline float ApplyTalus( float h, float weight, float const n[ 8 ], float const w[ 8 ], ThermalConstants const & c )
+{
+	float const	a0	= w[ 0 ] * Excess( n[ 0 ], h, c.m_Talus )			- weight * Excess( h, n[ 0 ], c.m_Talus );
+	float const	a1	= w[ 1 ] * Excess( n[ 1 ], h, c.m_Talus )			- weight * Excess( h, n[ 1 ], c.m_Talus );
+	float const	a2	= w[ 2 ] * Excess( n[ 2 ], h, c.m_Talus )			- weight * Excess( h, n[ 2 ], c.m_Talus );
+	float const	a3	= w[ 3 ] * Excess( n[ 3 ], h, c.m_Talus )			- weight * Excess( h, n[ 3 ], c.m_Talus );
+	float const	a4	= w[ 4 ] * Excess( n[ 4 ], h, c.m_DiagonalTalus )	- weight * Excess( h, n[ 4 ], c.m_DiagonalTalus );
+	float const	a5	= w[ 5 ] * Excess( n[ 5 ], h, c.m_DiagonalTalus )	- weight * Excess( h, n[ 5 ], c.m_DiagonalTalus );
+	float const	a6	= w[ 6 ] * Excess( n[ 6 ], h, c.m_DiagonalTalus )	- weight * Excess( h, n[ 6 ], c.m_DiagonalTalus );
+	float const	a7	= w[ 7 ] * Excess( n[ 7 ], h, c.m_DiagonalTalus )	- weight * Excess( h, n[ 7 ], c.m_DiagonalTalus );
+
+	return h + ( ( ( a0 + a1 ) + ( a2 + a3 ) ) + ( ( a4 + a5 ) + ( a6 + a7 ) ) );
+}
+
+// Offsets of the neighbors, in the order used by ComputeTalus() and ApplyTalus()
+int const	NEIGHBOR_J[ 8 ]	= { -1,  1,  0,  0, -1,  1, -1,  1 };
+int const	NEIGHBOR_I[ 8 ]	= {  0,  0, -1,  1, -1, -1,  1,  1 };
+
+// Gathers the values of the neighbors of a cell from a grid of rows. A missing neighbor is replaced by the cell
+// itself, which has no excess over the cell.
+inline void GetNeighbors( float const * const * rows, int sizeJ, int sizeI, int j, int i, float n[ 8 ] )
+{
+	for ( int k = 0; k < 8; k++ )
+	{
+		int const	nj	= j + NEIGHBOR_J[ k ];
+		int const	ni	= i + NEIGHBOR_I[ k ];
+
+		n[ k ] = ( nj >= 0 && nj < sizeJ && ni >= 0 && ni < sizeI ) ? rows[ ni ][ nj ] : rows[ i ][ j ];
+	}
+}
+
+// Gathers the values of the neighbors of an interior cell. r points to the previous, current and next rows.
+inline void GetNeighbors( float const * const r[ 3 ], int j, float n[ 8 ] )
+{
+	n[ 0 ] = r[ 1 ][ j - 1 ];
+	n[ 1 ] = r[ 1 ][ j + 1 ];
+	n[ 2 ] = r[ 0 ][ j ];
+	n[ 3 ] = r[ 2 ][ j ];
+	n[ 4 ] = r[ 0 ][ j - 1 ];
+	n[ 5 ] = r[ 0 ][ j + 1 ];
+	n[ 6 ] = r[ 2 ][ j - 1 ];
+	n[ 7 ] = r[ 2 ][ j + 1 ];
+}
+
+#if defined( HEIGHTFIELD_USE_AVX2 )
+
+// Returns the excess of differences in height over the talus
+inline __m256 Excess( __m256 h, __m256 neighbor, __m256 talus )
+{
+	return _mm256_max_ps( _mm256_sub_ps( _mm256_sub_ps( h, neighbor ), talus ), _mm256_setzero_ps() );
+}
+
+// Loads the values of the 8 neighbors of 8 consecutive interior cells. r points to the previous, current and next
+// rows.
+inline void LoadNeighbors( float const * const r[ 3 ], int j, __m256 n[ 8 ] )
+{
+	n[ 0 ] = _mm256_loadu_ps( r[ 1 ] + j - 1 );
+	n[ 1 ] = _mm256_loadu_ps( r[ 1 ] + j + 1 );
+	n[ 2 ] = _mm256_loadu_ps( r[ 0 ] + j );
+	n[ 3 ] = _mm256_loadu_ps( r[ 2 ] + j );
+	n[ 4 ] = _mm256_loadu_ps( r[ 0 ] + j - 1 );
+	n[ 5 ] = _mm256_loadu_ps( r[ 0 ] + j + 1 );
+	n[ 6 ] = _mm256_loadu_ps( r[ 2 ] + j - 1 );
+	n[ 7 ] = _mm256_loadu_ps( r[ 2 ] + j + 1 );
+}
+
+#elif defined( HEIGHTFIELD_USE_SSE )
+
+// Returns the excess of differences in height over the talus
+inline __m128 Excess( __m128 h, __m128 neighbor, __m128 talus )
+{
+	return _mm_max_ps( _mm_sub_ps( _mm_sub_ps( h, neighbor ), talus ), _mm_setzero_ps() );
+}
+
+// Loads the values of the 8 neighbors of 4 consecutive interior cells. r points to the previous, current and next
+// rows.
+inline void LoadNeighbors( float const * const r[ 3 ], int j, __m128 n[ 8 ] )
+{
+	n[ 0 ] = _mm_loadu_ps( r[ 1 ] + j - 1 );
+	n[ 1 ] = _mm_loadu_ps( r[ 1 ] + j + 1 );
+	n[ 2 ] = _mm_loadu_ps( r[ 0 ] + j );
+	n[ 3 ] = _mm_loadu_ps( r[ 2 ] + j );
+	n[ 4 ] = _mm_loadu_ps( r[ 0 ] + j - 1 );
+	n[ 5 ] = _mm_loadu_ps( r[ 0 ] + j + 1 );
+	n[ 6 ] = _mm_loadu_ps( r[ 2 ] + j - 1 );
+	n[ 7 ] = _mm_loadu_ps( r[ 2 ] + j + 1 );
+}
+
+#endif
+
+// Computes the weights of the interior cells of an interior row. h points to the previous, current and next rows.
+void ComputeTalusRow( float const * const h[ 3 ], float * weight, int sizeJ, ThermalConstants const & c )
+{
+	int	j	= 1;
+
+#if defined( HEIGHTFIELD_USE_AVX2 )
+
+	__m256 const	vTalus			= _mm256_set1_ps( c.m_Talus );
+	__m256 const	vDiagonalTalus	= _mm256_set1_ps( c.m_DiagonalTalus );
+	__m256 const	vRate			= _mm256_set1_ps( c.m_Rate );
+	__m256 const	vTiny			= _mm256_set1_ps( TINY );
+
+	for ( ; j + 8 <= sizeJ - 1; j += 8 )
+	{
+		__m256	n[ 8 ];
+
+		LoadNeighbors( h, j, n );
+
+		__m256 const	z		= _mm256_loadu_ps( h[ 1 ] + j );
+		__m256 const	e0		= Excess( z, n[ 0 ], vTalus );
+		__m256 const	e1		= Excess( z, n[ 1 ], vTalus );
+		__m256 const	e2		= Excess( z, n[ 2 ], vTalus );
+		__m256 const	e3		= Excess( z, n[ 3 ], vTalus );
+		__m256 const	e4		= Excess( z, n[ 4 ], vDiagonalTalus );
+		__m256 const	e5		= Excess( z, n[ 5 ], vDiagonalTalus );
+		__m256 const	e6		= Excess( z, n[ 6 ], vDiagonalTalus );
+		__m256 const	e7		= Excess( z, n[ 7 ], vDiagonalTalus );
+		__m256 const	most	= _mm256_max_ps( _mm256_max_ps( _mm256_max_ps( e0, e1 ), _mm256_max_ps( e2, e3 ) ),
+												 _mm256_max_ps( _mm256_max_ps( e4, e5 ), _mm256_max_ps( e6, e7 ) ) );
+		__m256 const	sum		= _mm256_add_ps( _mm256_add_ps( _mm256_add_ps( e0, e1 ), _mm256_add_ps( e2, e3 ) ),
+												 _mm256_add_ps( _mm256_add_ps( e4, e5 ), _mm256_add_ps( e6, e7 ) ) );
+
+		_mm256_storeu_ps( weight + j, _mm256_div_ps( _mm256_mul_ps( vRate, most ), _mm256_max_ps( sum, vTiny ) ) );
+	}
+
+#elif defined( HEIGHTFIELD_USE_SSE )
+
+	__m128 const	vTalus			= _mm_set1_ps( c.m_Talus );
+	__m128 const	vDiagonalTalus	= _mm_set1_ps( c.m_DiagonalTalus );
+	__m128 const	vRate			= _mm_set1_ps( c.m_Rate );
+	__m128 const	vTiny			= _mm_set1_ps( TINY );
+
+	for ( ; j + 4 <= sizeJ - 1; j += 4 )
+	{
+		__m128	n[ 8 ];
+
+		LoadNeighbors( h, j, n );
+
+		__m128 const	z		= _mm_loadu_ps( h[ 1 ] + j );
+		__m128 const	e0		= Excess( z, n[ 0 ], vTalus );
+		__m128 const	e1		= Excess( z, n[ 1 ], vTalus );
+		__m128 const	e2		= Excess( z, n[ 2 ], vTalus );
+		__m128 const	e3		= Excess( z, n[ 3 ], vTalus );
+		__m128 const	e4		= Excess( z, n[ 4 ], vDiagonalTalus );
+		__m128 const	e5		= Excess( z, n[ 5 ], vDiagonalTalus );
+		__m128 const	e6		= Excess( z, n[ 6 ], vDiagonalTalus );
+		__m128 const	e7		= Excess( z, n[ 7 ], vDiagonalTalus );
+		__m128 const	most	= _mm_max_ps( _mm_max_ps( _mm_max_ps( e0, e1 ), _mm_max_ps( e2, e3 ) ),
+											  _mm_max_ps( _mm_max_ps( e4, e5 ), _mm_max_ps( e6, e7 ) ) );
+		__m128 const	sum		= _mm_add_ps( _mm_add_ps( _mm_add_ps( e0, e1 ), _mm_add_ps( e2, e3 ) ),
+											  _mm_add_ps( _mm_add_ps( e4, e5 ), _mm_add_ps( e6, e7 ) ) );
+
+		_mm_storeu_ps( weight + j, _mm_div_ps( _mm_mul_ps( vRate, most ), _mm_max_ps( sum, vTiny ) ) );
+	}
+
+#endif
+
+	for ( ; j < sizeJ - 1; j++ )
+	{
+		float	n[ 8 ];
+
+		GetNeighbors( h, j, n );
+		weight[ j ] = ComputeTalus( h[ 1 ][ j ], n, c );
+	}
+}
+
+// Computes the new heights of the interior cells of an interior row. h and w point to the previous, current and next
+// rows of the old heights and the weights.
+void ApplyTalusRow( float const * const h[ 3 ], float const * const w[ 3 ], float * z, int sizeJ,
+					ThermalConstants const & c )
+{
+	int	j	= 1;
+
+#if defined( HEIGHTFIELD_USE_AVX2 )
+
+	__m256 const	t[ 8 ]	=
+	{
+		_mm256_set1_ps( c.m_Talus ), _mm256_set1_ps( c.m_Talus ), _mm256_set1_ps( c.m_Talus ), _mm256_set1_ps( c.m_Talus ),
+		_mm256_set1_ps( c.m_DiagonalTalus ), _mm256_set1_ps( c.m_DiagonalTalus ),
+		_mm256_set1_ps( c.m_DiagonalTalus ), _mm256_set1_ps( c.m_DiagonalTalus )
+	};
+
+	for ( ; j + 8 <= sizeJ - 1; j += 8 )
+	{
+		__m256	n[ 8 ];
+		__m256	m[ 8 ];
+		__m256	a[ 8 ];
+
+		LoadNeighbors( h, j, n );
+		LoadNeighbors( w, j, m );
+
+		__m256 const	x		= _mm256_loadu_ps( h[ 1 ] + j );
+		__m256 const	weight	= _mm256_loadu_ps( w[ 1 ] + j );
+
+		for ( int k = 0; k < 8; k++ )
+		{
+			a[ k ] = _mm256_sub_ps( _mm256_mul_ps( m[ k ], Excess( n[ k ], x, t[ k ] ) ), _mm256_mul_ps( weight, Excess( x, n[ k ], t[ k ] ) ) );
+		}
+
+		__m256 const	change	= _mm256_add_ps( _mm256_add_ps( _mm256_add_ps( a[ 0 ], a[ 1 ] ), _mm256_add_ps( a[ 2 ], a[ 3 ] ) ),
+												 _mm256_add_ps( _mm256_add_ps( a[ 4 ], a[ 5 ] ), _mm256_add_ps( a[ 6 ], a[ 7 ] ) ) );
+
+		_mm256_storeu_ps( z + j, _mm256_add_ps( x, change ) );
+	}
+
+#elif defined( HEIGHTFIELD_USE_SSE )
+
+	__m128 const	t[ 8 ]	=
+	{
+		_mm_set1_ps( c.m_Talus ), _mm_set1_ps( c.m_Talus ), _mm_set1_ps( c.m_Talus ), _mm_set1_ps( c.m_Talus ),
+		_mm_set1_ps( c.m_DiagonalTalus ), _mm_set1_ps( c.m_DiagonalTalus ),
+		_mm_set1_ps( c.m_DiagonalTalus ), _mm_set1_ps( c.m_DiagonalTalus )
+	};
+
+	for ( ; j + 4 <= sizeJ - 1; j += 4 )
+	{
+		__m128	n[ 8 ];
+		__m128	m[ 8 ];
+		__m128	a[ 8 ];
+
+		LoadNeighbors( h, j, n );
+		LoadNeighbors( w, j, m );
+
+		__m128 const	x		= _mm_loadu_ps( h[ 1 ] + j );
+		__m128 const	weight	= _mm_loadu_ps( w[ 1 ] + j );
+
+		for ( int k = 0; k < 8; k++ )
+		{
+			a[ k ] = _mm_sub_ps( _mm_mul_ps( m[ k ], Excess( n[ k ], x, t[ k ] ) ), _mm_mul_ps( weight, Excess( x, n[ k ], t[ k ] ) ) );
+		}
+
+		__m128 const	change	= _mm_add_ps( _mm_add_ps( _mm_add_ps( a[ 0 ], a[ 1 ] ), _mm_add_ps( a[ 2 ], a[ 3 ] ) ),
+											  _mm_add_ps( _mm_add_ps( a[ 4 ], a[ 5 ] ), _mm_add_ps( a[ 6 ], a[ 7 ] ) ) );
+
+		_mm_storeu_ps( z + j, _mm_add_ps( x, change ) );
+	}
+
+#endif
+
+	for ( ; j < sizeJ - 1; j++ )
+	{
+		float	n[ 8 ];
+		float	m[ 8 ];
+
+		GetNeighbors( h, j, n );
+		GetNeighbors( w, j, m );
+		z[ j ] = ApplyTalus( h[ 1 ][ j ], w[ 1 ][ j ], n, m, c );
+	}
+}
+
+} // anonymous namespace
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+HeightFieldErosion::HydraulicParameters::HydraulicParameters()
+	: m_TimeStep( 0.02f ),
+	m_Rain( 0.01f ),
+	m_Gravity( 9.81f ),
+	m_Capacity( 1.0f ),
+	m_Dissolving( 0.5f ),
+	m_Deposition( 1.0f ),
+	m_Evaporation( 0.015f ),
+	m_MinSlope( 0.05f )
+{
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+HeightFieldErosion::ThermalParameters::ThermalParameters()
+	: m_Talus( 0.8f ),
+	m_Rate( 0.5f )
+{
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	hf	Heightfield to be eroded. It must outlive this object.
+//!
+//! @exception	bad_alloc	Unable to allocate the state of the simulation.
+
+HeightFieldErosion::HeightFieldErosion( HeightField & hf )
+	: m_hf( hf ),
+	m_sizeI( hf.GetSizeI() ),
+	m_sizeJ( hf.GetSizeJ() )
+{
+	size_t const	size	= size_t( m_sizeI ) * size_t( m_sizeJ );
+
+	m_water.resize( size, 0.0f );
+	m_sediment.resize( size, 0.0f );
+
+	for ( int k = 0; k < 4; k++ )
+	{
+		m_flux[ k ].resize( size, 0.0f );
+	}
+
+	m_temp[ 0 ].resize( size );
+	m_temp[ 1 ].resize( size );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	iterations	Number of iterations
+//! @param	parameters	Parameters of the simulation. The time step times the gravity should not be more than 0.25,
+//!						or the flow becomes unstable.
+
+void HeightFieldErosion::Hydraulic( int iterations, HydraulicParameters const & parameters /*= HydraulicParameters()*/ )
+{
+	assert( m_hf.GetSizeI() == m_sizeI && m_hf.GetSizeJ() == m_sizeJ );
+
+	for ( int k = 0; k < iterations; k++ )
+	{
+		HydraulicStep( parameters );
+	}
+
+	m_hf.UpdateApron();
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	iterations	Number of iterations
+//! @param	parameters	Parameters of the simulation
+
+void HeightFieldErosion::Thermal( int iterations, ThermalParameters const & parameters /*= ThermalParameters()*/ )
+{
+	assert( m_hf.GetSizeI() == m_sizeI && m_hf.GetSizeJ() == m_sizeJ );
+
+	for ( int k = 0; k < iterations; k++ )
+	{
+		ThermalStep( parameters );
+	}
+
+	m_hf.UpdateApron();
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+void HeightFieldErosion::Dry()
+{
+	assert( m_hf.GetSizeI() == m_sizeI && m_hf.GetSizeJ() == m_sizeJ );
+
+	HeightFieldMutableView const	view	= m_hf.GetView();
+
+	Parallel::For( 0, m_sizeI, ROW_GRAIN, [ & ]( int first, int end )
+	{
+		for ( int i = first; i < end; i++ )
+		{
+			float const * const	s	= &m_sediment[ size_t( i ) * m_sizeJ ];
+			float * const		z	= GetRow( view, i );
+
+			for ( int j = 0; j < m_sizeJ; j++ )
+			{
+				z[ j ] += s[ j ];
+			}
+		}
+	} );
+
+	fill( m_water.begin(), m_water.end(), 0.0f );
+	fill( m_sediment.begin(), m_sediment.end(), 0.0f );
+
+	for ( int k = 0; k < 4; k++ )
+	{
+		fill( m_flux[ k ].begin(), m_flux[ k ].end(), 0.0f );
+	}
+
+	m_hf.UpdateApron();
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+void HeightFieldErosion::HydraulicStep( HydraulicParameters const & parameters )
+{
+	int const		sizeI		= m_sizeI;
+	int const		sizeJ		= m_sizeJ;
+	float const		dt			= parameters.m_TimeStep;
+	float const		rain		= parameters.m_Rain * dt;
+	float const		evaporation	= max( 0.0f, 1.0f - parameters.m_Evaporation * dt );
+	float * const	capacity	= &m_temp[ 0 ][ 0 ];
+	float * const	transport	= &m_temp[ 1 ][ 0 ];
+
+	// The rows are accessed through a view, since getting a pointer from the heightfield discards its statistics
+
+	HeightFieldMutableView const	view	= m_hf.GetView();
+	FluxConstants					fluxConstants;
+
+	fluxConstants.m_Acceleration	= parameters.m_Gravity * dt;
+	fluxConstants.m_Rain			= rain;
+	fluxConstants.m_TimeStep		= dt;
+
+	// Each pass reads only values that no other cell writes during the pass, so the rows can be updated in any order.
+	// The rain is uniform, so it does not change the differences in water levels and is simply added to the water in
+	// the flux and water passes.
+
+	// Flux: the outflow of each cell depends only on its old outflow and the old water levels.
+
+	Parallel::For( 0, sizeI, ROW_GRAIN, [ & ]( int first, int end )
+	{
+		for ( int i = first; i < end; i++ )
+		{
+			int const			i0		= max( i - 1, 0 );
+			int const			i1		= min( i + 1, sizeI - 1 );
+			size_t const		row		= size_t( i ) * sizeJ;
+			float const * const	b[ 3 ]	= { GetRow( view, i0 ), GetRow( view, i ), GetRow( view, i1 ) };
+			float const * const	d[ 3 ]	= { &m_water[ size_t( i0 ) * sizeJ ], &m_water[ row ], &m_water[ size_t( i1 ) * sizeJ ] };
+			float * const		f[ 4 ]	= { &m_flux[ 0 ][ row ], &m_flux[ 1 ][ row ], &m_flux[ 2 ][ row ], &m_flux[ 3 ][ row ] };
+
+			UpdateFluxRow( b, d, f, sizeJ, fluxConstants );
+		}
+	} );
+
+	// Water: each cell's depth changes by its inflow minus its outflow. The sediment capacity is proportional to the
+	// flow through the cell and the slope of the terrain, so a thin film of water does not carve the terrain. The
+	// fraction of the water (and so of the sediment) that leaves through a pipe is the pipe's outflow times the
+	// transport factor.
+
+	Parallel::For( 0, sizeI, ROW_GRAIN, [ & ]( int first, int end )
+	{
+		for ( int i = first; i < end; i++ )
+		{
+			size_t const		row		= size_t( i ) * sizeJ;
+			float const * const	zI0		= GetRow( view, max( i - 1, 0 ) );
+			float const * const	z		= GetRow( view, i );
+			float const * const	zI1		= GetRow( view, min( i + 1, sizeI - 1 ) );
+			float const * const	fJ0		= &m_flux[ 0 ][ row ];
+			float const * const	fJ1		= &m_flux[ 1 ][ row ];
+			float const * const	fI0		= &m_flux[ 2 ][ row ];
+			float const * const	fI1		= &m_flux[ 3 ][ row ];
+			float const * const	fromI0	= ( i > 0 ) ? &m_flux[ 3 ][ row - sizeJ ] : 0;
+			float const * const	fromI1	= ( i < sizeI - 1 ) ? &m_flux[ 2 ][ row + sizeJ ] : 0;
+			float const			scaleI	= ( i > 0 && i < sizeI - 1 ) ? 0.5f : 1.0f;
+
+			for ( int j = 0; j < sizeJ; j++ )
+			{
+				float const	inJ0	= ( j > 0 ) ? fJ1[ j - 1 ] : 0.0f;
+				float const	inJ1	= ( j < sizeJ - 1 ) ? fJ0[ j + 1 ] : 0.0f;
+				float const	inI0	= fromI0 ? fromI0[ j ] : 0.0f;
+				float const	inI1	= fromI1 ? fromI1[ j ] : 0.0f;
+				float const	in		= ( inJ0 + inJ1 ) + ( inI0 + inI1 );
+				float const	out		= ( fJ0[ j ] + fJ1[ j ] ) + ( fI0[ j ] + fI1[ j ] );
+				float const	before	= m_water[ row + j ] + rain;
+				float const	flowJ	= ( ( inJ0 - fJ0[ j ] ) + ( fJ1[ j ] - inJ1 ) ) * 0.5f;
+				float const	flowI	= ( ( inI0 - fI0[ j ] ) + ( fI1[ j ] - inI1 ) ) * 0.5f;
+				float const	scaleJ	= ( j > 0 && j < sizeJ - 1 ) ? 0.5f : 1.0f;
+				float const	gJ		= ( z[ min( j + 1, sizeJ - 1 ) ] - z[ max( j - 1, 0 ) ] ) * scaleJ;
+				float const	gI		= ( zI1[ j ] - zI0[ j ] ) * scaleI;
+				float const	g2		= gJ * gJ + gI * gI;
+				float const	slope	= sqrt( g2 / ( 1.0f + g2 ) );
+
+				m_water[ row + j ] = max( 0.0f, before + dt * ( in - out ) );
+				capacity[ row + j ] = parameters.m_Capacity * max( slope, parameters.m_MinSlope ) * sqrt( flowJ * flowJ + flowI * flowI );
+				transport[ row + j ] = dt / max( before, TINY );
+			}
+		}
+	} );
+
+	// Erosion and deposition: each cell dissolves part of its unused capacity, but no more than its depth of water,
+	// or deposits part of its excess sediment.
+
+	Parallel::For( 0, sizeI, ROW_GRAIN, [ & ]( int first, int end )
+	{
+		for ( int i = first; i < end; i++ )
+		{
+			size_t const		row		= size_t( i ) * sizeJ;
+			float * const		z		= GetRow( view, i );
+			float * const		s		= &m_sediment[ row ];
+			float const * const	c		= &capacity[ row ];
+			float const * const	d		= &m_water[ row ];
+
+			for ( int j = 0; j < sizeJ; j++ )
+			{
+				float const	amount	= ( c[ j ] > s[ j ] ) ? min( parameters.m_Dissolving * ( c[ j ] - s[ j ] ), d[ j ] )
+													  : -parameters.m_Deposition * ( s[ j ] - c[ j ] );
+
+				z[ j ] -= amount;
+				s[ j ] += amount;
+			}
+		}
+	} );
+
+	// Transport and evaporation: the sediment moves through the pipes in proportion to the water, into the capacity
+	// buffer, which then becomes the sediment.
+
+	Parallel::For( 0, sizeI, ROW_GRAIN, [ & ]( int first, int end )
+	{
+		for ( int i = first; i < end; i++ )
+		{
+			size_t const		row		= size_t( i ) * sizeJ;
+			float const * const	s		= &m_sediment[ row ];
+			float const * const	t		= &transport[ row ];
+			float const * const	fJ0		= &m_flux[ 0 ][ row ];
+			float const * const	fJ1		= &m_flux[ 1 ][ row ];
+			float const * const	fI0		= &m_flux[ 2 ][ row ];
+			float const * const	fI1		= &m_flux[ 3 ][ row ];
+			size_t const		above	= ( i > 0 ) ? row - sizeJ : row;
+			size_t const		below	= ( i < sizeI - 1 ) ? row + sizeJ : row;
+			float const			hasI0	= ( i > 0 ) ? 1.0f : 0.0f;
+			float const			hasI1	= ( i < sizeI - 1 ) ? 1.0f : 0.0f;
+
+			for ( int j = 0; j < sizeJ; j++ )
+			{
+				float const	inJ0	= ( j > 0 ) ? s[ j - 1 ] * t[ j - 1 ] * fJ1[ j - 1 ] : 0.0f;
+				float const	inJ1	= ( j < sizeJ - 1 ) ? s[ j + 1 ] * t[ j + 1 ] * fJ0[ j + 1 ] : 0.0f;
+				float const	inI0	= hasI0 * m_sediment[ above + j ] * transport[ above + j ] * m_flux[ 3 ][ above + j ];
+				float const	inI1	= hasI1 * m_sediment[ below + j ] * transport[ below + j ] * m_flux[ 2 ][ below + j ];
+				float const	out		= ( fJ0[ j ] + fJ1[ j ] ) + ( fI0[ j ] + fI1[ j ] );
+				float const	left	= s[ j ] * max( 0.0f, 1.0f - out * t[ j ] );
+
+				capacity[ row + j ] = left + ( ( inJ0 + inJ1 ) + ( inI0 + inI1 ) );
+				m_water[ row + j ] *= evaporation;
+			}
+		}
+	} );
+
+	m_sediment.swap( m_temp[ 0 ] );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+void HeightFieldErosion::ThermalStep( ThermalParameters const & parameters )
+{
+	int const			sizeI		= m_sizeI;
+	int const			sizeJ		= m_sizeJ;
+	float * const		old			= &m_temp[ 0 ][ 0 ];
+	float * const		weight		= &m_temp[ 1 ][ 0 ];
+
+	HeightFieldMutableView const	view	= m_hf.GetView();
+	ThermalConstants				c;
+
+	c.m_Talus			= parameters.m_Talus;
+	c.m_DiagonalTalus	= parameters.m_Talus * sqrt( 2.0f );
+	c.m_Rate			= parameters.m_Rate * 0.5f;
+
+	vector< float const * >	rows( sizeI );
+	vector< float const * >	weights( sizeI );
+
+	for ( int i = 0; i < sizeI; i++ )
+	{
+		rows[ i ] = old + size_t( i ) * sizeJ;
+		weights[ i ] = weight + size_t( i ) * sizeJ;
+	}
+
+	// The heights are copied so that the second pass can read the old heights of the neighbors while it writes the
+	// new ones.
+
+	Parallel::For( 0, sizeI, ROW_GRAIN, [ & ]( int first, int end )
+	{
+		for ( int i = first; i < end; i++ )
+		{
+			float const * const	z	= GetRow( view, i );
+
+			copy( z, z + sizeJ, old + size_t( i ) * sizeJ );
+		}
+	} );
+
+	// Each cell computes how much material it moves out per unit of excess.
+
+	Parallel::For( 0, sizeI, ROW_GRAIN, [ & ]( int first, int end )
+	{
+		for ( int i = first; i < end; i++ )
+		{
+			float * const	w	= weight + size_t( i ) * sizeJ;
+
+			auto const	cell	= [ & ]( int j )
+			{
+				float	n[ 8 ];
+
+				GetNeighbors( &rows[ 0 ], sizeJ, sizeI, j, i, n );
+				w[ j ] = ComputeTalus( rows[ i ][ j ], n, c );
+			};
+
+			if ( i > 0 && i < sizeI - 1 && sizeJ > 2 )
+			{
+				cell( 0 );
+				ComputeTalusRow( &rows[ i - 1 ], w, sizeJ, c );
+				cell( sizeJ - 1 );
+			}
+			else
+			{
+				for ( int j = 0; j < sizeJ; j++ )
+				{
+					cell( j );
+				}
+			}
+		}
+	} );
+
+	// Each cell loses its weight times its excesses and gains its share of the neighbors' outflows.
+
+	Parallel::For( 0, sizeI, ROW_GRAIN, [ & ]( int first, int end )
+	{
+		for ( int i = first; i < end; i++ )
+		{
+			float * const	z	= GetRow( view, i );
+
+			auto const	cell	= [ & ]( int j )
+			{
+				float	n[ 8 ];
+				float	w[ 8 ];
+
+				GetNeighbors( &rows[ 0 ], sizeJ, sizeI, j, i, n );
+				GetNeighbors( &weights[ 0 ], sizeJ, sizeI, j, i, w );
+				z[ j ] = ApplyTalus( rows[ i ][ j ], weights[ i ][ j ], n, w, c );
+			};
+
+			if ( i > 0 && i < sizeI - 1 && sizeJ > 2 )
+			{
+				cell( 0 );
+				ApplyTalusRow( &rows[ i - 1 ], &weights[ i - 1 ], z, sizeJ, c );
+				cell( sizeJ - 1 );
+			}
+			else
+			{
+				for ( int j = 0; j < sizeJ; j++ )
+				{
+					cell( j );
+				}
+			}
+		}
+	} );
+}
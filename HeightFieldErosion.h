@@ -0,0 +1,104 @@
+/** @file *//********************************************************************************************************
+
+                                                  HeightFieldErosion.h
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/HeightFieldErosion.h#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#pragma once
+
+#include <vector>
+
+class HeightField;
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! Simulates hydraulic and thermal erosion of a HeightField, in place.
+//!
+//! The hydraulic model is the "virtual pipes" model: each cell holds water and suspended sediment, and water flows
+//! to the 4 adjacent cells through pipes whose flux is accelerated by the difference in the water levels. Flowing
+//! water dissolves the terrain up to a capacity that depends on the flow and the slope, deposits the sediment
+//! above the capacity, and carries the suspended sediment through the pipes along with it, so the terrain plus the
+//! sediment is conserved. The thermal model moves material down to the 8 adjacent cells wherever the slope is
+//! steeper than the talus slope.
+//!
+//! Every pass reads the state left by the previous pass and writes each cell independently of the others, so the
+//! rows are updated in parallel and the results do not depend on the number of threads. The flux and thermal
+//! kernels are vectorized. The distance between adjacent vertexes is 1. The water and sediment persist between
+//! calls, so a simulation can be run a few iterations at a time.
+//!
+//! @note	The heightfield must not be resized while this object exists.
+
+class HeightFieldErosion
+{
+public:
+
+	//! Parameters of the hydraulic erosion
+	struct HydraulicParameters
+	{
+		//! Constructor
+		HydraulicParameters();
+
+		float	m_TimeStep;		//!< Duration of an iteration
+		float	m_Rain;			//!< Depth of water added to every cell per unit of time
+		float	m_Gravity;		//!< Acceleration of the flux per unit of difference in water level
+		float	m_Capacity;		//!< Sediment capacity per unit of flow and slope
+		float	m_Dissolving;	//!< Fraction of the unused capacity that is dissolved in an iteration
+		float	m_Deposition;	//!< Fraction of the excess sediment that is deposited in an iteration
+		float	m_Evaporation;	//!< Fraction of the water that evaporates per unit of time
+		float	m_MinSlope;		//!< Slope (sine of the tilt) used for the capacity of water on flat ground
+	};
+
+	//! Parameters of the thermal erosion
+	struct ThermalParameters
+	{
+		//! Constructor
+		ThermalParameters();
+
+		float	m_Talus;		//!< Steepest stable slope (height per unit of distance)
+		float	m_Rate;			//!< Fraction of the excess moved in an iteration, in (0, 1]
+	};
+
+	//! Constructor
+	explicit HeightFieldErosion( HeightField & hf );
+
+	//! Runs iterations of hydraulic erosion.
+	void Hydraulic( int iterations, HydraulicParameters const & parameters = HydraulicParameters() );
+
+	//! Runs iterations of thermal erosion.
+	void Thermal( int iterations, ThermalParameters const & parameters = ThermalParameters() );
+
+	//! Deposits the suspended sediment and removes the water.
+	void Dry();
+
+	//! Returns the depth of the water in each cell, in this order: <tt>[i][j]</tt>.
+	std::vector< float > const & GetWater() const		{ return m_water; }
+
+	//! Returns the amount of suspended sediment in each cell, in this order: <tt>[i][j]</tt>.
+	std::vector< float > const & GetSediment() const	{ return m_sediment; }
+
+private:
+
+	// Does one iteration of hydraulic erosion
+	void HydraulicStep( HydraulicParameters const & parameters );
+
+	// Does one iteration of thermal erosion
+	void ThermalStep( ThermalParameters const & parameters );
+
+	HeightField &			m_hf;				//!< Heightfield being eroded
+	int						m_sizeI;			//!< Size of the heightfield along the I axis
+	int						m_sizeJ;			//!< Size of the heightfield along the J axis
+	std::vector< float >	m_water;			//!< Depth of the water
+	std::vector< float >	m_sediment;			//!< Suspended sediment
+	std::vector< float >	m_flux[ 4 ];		//!< Outflow toward -J, +J, -I and +I
+	std::vector< float >	m_temp[ 2 ];		//!< Scratch values
+};
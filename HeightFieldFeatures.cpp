@@ -0,0 +1,734 @@
+/** @file *//********************************************************************************************************
+
+                                                HeightFieldFeatures.cpp
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/HeightFieldFeatures.cpp#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#include "PrecompiledHeaders.h"
+
+#include "HeightFieldFeatures.h"
+
+#include "HeightField.h"
+#include "HeightFieldHydrology.h"
+#include "Parallel.h"
+
+#include <cstring>
+
+using namespace std;
+
+
+namespace
+{
+
+float const	SQRT2		= 1.41421356f;
+
+// Size of the tiles that are scanned and whose join trees are built in parallel
+int const	TILE_SIZE	= 256;
+
+// Number of saddles traced by each task
+int const	TRACE_GRAIN	= 16;
+
+// Index of a node that does not exist
+unsigned const	NONE	= 0xffffffff;
+
+// Orders the vertexes of a heightfield by height, breaking ties by index. Each vertex has a unique 64-bit key: the
+// high 32 bits are the height's bits, flipped so that they compare as unsigned integers, and the low 32 bits are the
+// complement of the index, so that the lower index is higher. Upside down, the heights are reversed.
+class Ordering
+{
+public:
+
+	Ordering( HeightField const & hf, bool upsideDown )
+		: m_hf( hf ),
+		m_sizeJ( hf.GetSizeJ() ),
+		m_sizeI( hf.GetSizeI() ),
+		m_upsideDown( upsideDown )
+	{
+	}
+
+	// Returns the bits of the height of a vertex, flipped so that they are ordered as unsigned integers
+	unsigned GetBits( int j, int i ) const
+	{
+		float const	z	= m_hf.GetZ( j, i );
+		unsigned	bits;
+
+		memcpy( &bits, &z, sizeof( bits ) );
+		bits = ( bits & 0x80000000 ) ? ~bits : ( bits | 0x80000000 );
+
+		return m_upsideDown ? ~bits : bits;
+	}
+
+	// Returns the key of a vertex
+	unsigned long long GetKey( int j, int i ) const
+	{
+		unsigned long long const	high	= GetBits( j, i );
+
+		return ( high << 32 ) | ~GetIndex( j, i );
+	}
+
+	// Returns the height of a vertex, negated if upside down
+	float GetHeight( int j, int i ) const
+	{
+		return m_upsideDown ? -m_hf.GetZ( j, i ) : m_hf.GetZ( j, i );
+	}
+
+	// Returns the index of a vertex
+	unsigned GetIndex( int j, int i ) const		{ return unsigned( i ) * unsigned( m_sizeJ ) + unsigned( j ); }
+
+	// Returns true if the location is in the heightfield
+	bool IsInside( int j, int i ) const			{ return j >= 0 && j < m_sizeJ && i >= 0 && i < m_sizeI; }
+
+	int GetSizeJ() const						{ return m_sizeJ; }
+	int GetSizeI() const						{ return m_sizeI; }
+
+private:
+
+	HeightField const &	m_hf;
+	int					m_sizeJ;
+	int					m_sizeI;
+	bool				m_upsideDown;
+};
+
+// Returns the index of the vertex with a key
+inline unsigned GetIndex( unsigned long long key )
+{
+	return ~unsigned( key );
+}
+
+// Returns the bounds of a tile
+inline void GetTile( int t, int sizeJ, int sizeI, int & j0, int & i0, int & j1, int & i1 )
+{
+	int const	tilesJ	= ( sizeJ + TILE_SIZE - 1 ) / TILE_SIZE;
+
+	j0 = ( t % tilesJ ) * TILE_SIZE;
+	i0 = ( t / tilesJ ) * TILE_SIZE;
+	j1 = min( j0 + TILE_SIZE, sizeJ );
+	i1 = min( i0 + TILE_SIZE, sizeI );
+}
+
+// Returns the number of tiles
+inline int GetTileCount( int sizeJ, int sizeI )
+{
+	return ( ( sizeJ + TILE_SIZE - 1 ) / TILE_SIZE ) * ( ( sizeI + TILE_SIZE - 1 ) / TILE_SIZE );
+}
+
+// Returns the root of a node in a union-find forest, halving the path along the way
+template< typename Index >
+Index Find( vector< Index > & parent, Index x )
+{
+	while ( parent[ x ] != x )
+	{
+		parent[ x ] = parent[ parent[ x ] ];
+		x = parent[ x ];
+	}
+
+	return x;
+}
+
+// The join tree of a tile, reduced to the vertexes on the tile's edges, the tile's peaks, and the vertexes where
+// they join. The nodes are identified by the indexes of their vertexes, in increasing order. The edges include the
+// connections to the neighboring tiles.
+struct ReducedTree
+{
+	vector< unsigned >						m_nodes;	// Vertexes in the tree
+	vector< pair< unsigned, unsigned > >	m_edges;	// Connected vertexes
+};
+
+// Builds the reduced join tree of a tile by adding its vertexes from highest to lowest and merging the regions
+// they connect. Within a tile, the vertexes are ordered the same way by their offsets in the tile as by their
+// indexes, so the keys are made with the offsets.
+void BuildReducedTree( Ordering const & ordering, int j0, int i0, int j1, int i1, ReducedTree & tree )
+{
+	int const						w		= j1 - j0;
+	int const						h		= i1 - i0;
+	vector< unsigned long long >	order;
+	vector< int >					parent( size_t( w ) * h, -1 );
+	vector< unsigned >				node( size_t( w ) * h );		// Lowest node of each region, at its root
+	int								offsets[ 8 ];
+
+	for ( int d = 0; d < 8; d++ )
+	{
+		offsets[ d ] = HeightFieldHydrology::OFFSET_I[ d ] * w + HeightFieldHydrology::OFFSET_J[ d ];
+	}
+
+	order.reserve( size_t( w ) * h );
+
+	for ( int i = i0; i < i1; i++ )
+	{
+		for ( int j = j0; j < j1; j++ )
+		{
+			unsigned long long const	high	= ordering.GetBits( j, i );
+
+			order.push_back( ( high << 32 ) | ~unsigned( order.size() ) );
+		}
+	}
+
+	sort( order.begin(), order.end(), greater< unsigned long long >() );
+
+	for ( size_t k = 0; k < order.size(); k++ )
+	{
+		int const		l		= int( GetIndex( order[ k ] ) );
+		int const		j		= j0 + l % w;
+		int const		i		= i0 + l / w;
+		unsigned const	index	= ordering.GetIndex( j, i );
+		bool const		edge	= ( j == j0 || j == j1 - 1 || i == i0 || i == i1 - 1 );
+		int				roots[ 8 ];
+		int				nRoots	= 0;
+
+		for ( int d = 0; d < 8; d++ )
+		{
+			int const	nj	= j + HeightFieldHydrology::OFFSET_J[ d ];
+			int const	ni	= i + HeightFieldHydrology::OFFSET_I[ d ];
+
+			if ( !edge || ( nj >= j0 && nj < j1 && ni >= i0 && ni < i1 ) )
+			{
+				int const	nl	= l + offsets[ d ];
+
+				if ( parent[ nl ] >= 0 )
+				{
+					int const	r	= Find( parent, nl );
+
+					if ( find( roots, roots + nRoots, r ) == roots + nRoots )
+					{
+						roots[ nRoots++ ] = r;
+					}
+				}
+			}
+			else if ( ordering.IsInside( nj, ni ) && ordering.GetIndex( nj, ni ) > index )
+			{
+				// Connection to a neighboring tile, recorded once
+
+				tree.m_edges.push_back( make_pair( index, ordering.GetIndex( nj, ni ) ) );
+			}
+		}
+
+		if ( edge || nRoots != 1 )
+		{
+			tree.m_nodes.push_back( index );
+
+			for ( int r = 0; r < nRoots; r++ )
+			{
+				tree.m_edges.push_back( make_pair( node[ roots[ r ] ], index ) );
+				parent[ roots[ r ] ] = l;
+			}
+
+			parent[ l ] = l;
+			node[ l ] = index;
+		}
+		else
+		{
+			parent[ l ] = roots[ 0 ];
+		}
+	}
+
+	sort( tree.m_nodes.begin(), tree.m_nodes.end() );
+}
+
+// Computes the prominences and key saddles of the peaks (or the depths of the pits, upside down). The reduced join
+// trees of the tiles are built in parallel, and then the vertexes in all of the trees are added from highest to
+// lowest. When a vertex joins regions, the peaks of all but the region with the highest peak end there.
+void ComputeProminence( HeightField const & hf, bool upsideDown, vector< HeightFieldFeatures::CriticalPoint > & points )
+{
+	Ordering const			ordering( hf, upsideDown );
+	int const				sizeJ	= hf.GetSizeJ();
+	int const				sizeI	= hf.GetSizeI();
+	int const				nTiles	= GetTileCount( sizeJ, sizeI );
+	vector< ReducedTree >	trees( nTiles );
+
+	Parallel::For( 0, nTiles, 1, [ & ]( int first, int last )
+	{
+		for ( int t = first; t < last; t++ )
+		{
+			int	j0, i0, j1, i1;
+
+			GetTile( t, sizeJ, sizeI, j0, i0, j1, i1 );
+			BuildReducedTree( ordering, j0, i0, j1, i1, trees[ t ] );
+		}
+	} );
+
+	// Number the nodes tile by tile, in order of their vertexes, and connect them
+
+	vector< unsigned >	base( nTiles + 1, 0 );
+
+	for ( int t = 0; t < nTiles; t++ )
+	{
+		base[ t + 1 ] = base[ t ] + unsigned( trees[ t ].m_nodes.size() );
+	}
+
+	int const	tilesJ	= ( sizeJ + TILE_SIZE - 1 ) / TILE_SIZE;
+
+	auto const	getNode	= [ & ]( unsigned index )
+	{
+		int const					t		= int( index / unsigned( sizeJ ) ) / TILE_SIZE * tilesJ + int( index % unsigned( sizeJ ) ) / TILE_SIZE;
+		vector< unsigned > const &	tile	= trees[ t ].m_nodes;
+
+		return base[ t ] + unsigned( lower_bound( tile.begin(), tile.end(), index ) - tile.begin() );
+	};
+
+	unsigned const		nNodes	= base[ nTiles ];
+	vector< unsigned >	first( nNodes + 1, 0 );
+	vector< unsigned >	adjacent;
+
+	for ( int t = 0; t < nTiles; t++ )
+	{
+		for ( auto const & e : trees[ t ].m_edges )
+		{
+			++first[ getNode( e.first ) + 1 ];
+			++first[ getNode( e.second ) + 1 ];
+		}
+	}
+
+	for ( unsigned n = 0; n < nNodes; n++ )
+	{
+		first[ n + 1 ] += first[ n ];
+	}
+
+	{
+		vector< unsigned >	next( first.begin(), first.end() - 1 );
+
+		adjacent.resize( first[ nNodes ] );
+
+		for ( int t = 0; t < nTiles; t++ )
+		{
+			for ( auto const & e : trees[ t ].m_edges )
+			{
+				unsigned const	a	= getNode( e.first );
+				unsigned const	b	= getNode( e.second );
+
+				adjacent[ next[ a ]++ ] = b;
+				adjacent[ next[ b ]++ ] = a;
+			}
+
+			vector< pair< unsigned, unsigned > >().swap( trees[ t ].m_edges );
+		}
+	}
+
+	vector< unsigned >	nodes;
+
+	nodes.reserve( nNodes );
+
+	for ( int t = 0; t < nTiles; t++ )
+	{
+		nodes.insert( nodes.end(), trees[ t ].m_nodes.begin(), trees[ t ].m_nodes.end() );
+		vector< unsigned >().swap( trees[ t ].m_nodes );
+	}
+
+	// Add the nodes from highest to lowest
+
+	vector< unsigned long long >	keys( nNodes );
+	vector< unsigned >				order( nNodes );
+
+	for ( unsigned n = 0; n < nNodes; n++ )
+	{
+		keys[ n ] = ordering.GetKey( int( nodes[ n ] % unsigned( sizeJ ) ), int( nodes[ n ] / unsigned( sizeJ ) ) );
+		order[ n ] = n;
+	}
+
+	sort( order.begin(), order.end(), [ & ]( unsigned a, unsigned b ) { return keys[ a ] > keys[ b ]; } );
+
+	vector< unsigned >						parent( nNodes, NONE );
+	vector< unsigned >						top( nNodes, NONE );	// Highest node of each region, at its root
+	vector< pair< unsigned, unsigned > >	saddles;				// Key saddle of each peak, by vertex
+
+	for ( unsigned k = 0; k < nNodes; k++ )
+	{
+		unsigned const	n		= order[ k ];
+		unsigned		main	= NONE;
+
+		for ( unsigned a = first[ n ]; a < first[ n + 1 ]; a++ )
+		{
+			if ( parent[ adjacent[ a ] ] != NONE )
+			{
+				unsigned	r	= Find( parent, adjacent[ a ] );
+
+				if ( main == NONE )
+				{
+					main = r;
+				}
+				else if ( r != main )
+				{
+					// The region with the lower peak ends here
+
+					if ( keys[ top[ r ] ] > keys[ top[ main ] ] )
+					{
+						swap( r, main );
+					}
+
+					saddles.push_back( make_pair( nodes[ top[ r ] ], nodes[ n ] ) );
+					parent[ r ] = main;
+				}
+			}
+		}
+
+		if ( main == NONE )
+		{
+			parent[ n ] = n;
+			top[ n ] = n;
+		}
+		else
+		{
+			parent[ n ] = main;
+		}
+	}
+
+	if ( nNodes > 0 )
+	{
+		saddles.push_back( make_pair( nodes[ top[ Find( parent, order[ 0 ] ) ] ], NONE ) );
+	}
+
+	sort( saddles.begin(), saddles.end() );
+
+	// Look up the key saddle of each point
+
+	float const	extreme	= upsideDown ? hf.GetMaxZ() : hf.GetMinZ();
+
+	for ( auto & p : points )
+	{
+		unsigned const	index	= ordering.GetIndex( p.m_J, p.m_I );
+		auto const		s		= lower_bound( saddles.begin(), saddles.end(), make_pair( index, 0u ) );
+
+		assert( s != saddles.end() && s->first == index );
+
+		if ( s->second != NONE )
+		{
+			p.m_SaddleJ = int( s->second % unsigned( sizeJ ) );
+			p.m_SaddleI = int( s->second / unsigned( sizeJ ) );
+			p.m_Prominence = fabs( p.m_Z - hf.GetZ( p.m_SaddleJ, p.m_SaddleI ) );
+		}
+		else
+		{
+			p.m_Prominence = fabs( p.m_Z - extreme );
+		}
+	}
+}
+
+// Returns a critical point at a vertex
+inline HeightFieldFeatures::CriticalPoint MakeCriticalPoint( int j, int i, float z )
+{
+	HeightFieldFeatures::CriticalPoint	p;
+
+	p.m_J = j;
+	p.m_I = i;
+	p.m_Z = z;
+	p.m_Prominence = 0.0f;
+	p.m_SaddleJ = -1;
+	p.m_SaddleI = -1;
+
+	return p;
+}
+
+// Returns true if a point is more prominent than another. Ties are broken by location.
+inline bool IsMoreProminent( HeightFieldFeatures::CriticalPoint const & a, HeightFieldFeatures::CriticalPoint const & b )
+{
+	if ( a.m_Prominence != b.m_Prominence )
+	{
+		return a.m_Prominence > b.m_Prominence;
+	}
+
+	return ( a.m_I != b.m_I ) ? a.m_I < b.m_I : a.m_J < b.m_J;
+}
+
+// Traces the lines from saddles to peaks by steepest ascent (or to pits by steepest descent, upside down). A line
+// starts in each run of higher neighbors around the saddle, at the highest neighbor in the run.
+void Trace( HeightField const &										hf,
+			bool													upsideDown,
+			vector< HeightFieldFeatures::CriticalPoint > const &	saddles,
+			vector< HeightFieldFeatures::Polyline > &				lines )
+{
+	typedef HeightFieldFeatures::Polyline	Polyline;
+
+	Ordering const				ordering( hf, upsideDown );
+	int const					nSaddles	= int( saddles.size() );
+	vector< vector< Polyline > >	traced( nSaddles );
+
+	Parallel::For( 0, nSaddles, TRACE_GRAIN, [ & ]( int first, int last )
+	{
+		for ( int s = first; s < last; s++ )
+		{
+			int const					sj		= saddles[ s ].m_J;
+			int const					si		= saddles[ s ].m_I;
+			unsigned long long const	key		= ordering.GetKey( sj, si );
+			bool						higher[ 8 ];
+			int							nHigher	= 0;
+
+			for ( int d = 0; d < 8; d++ )
+			{
+				int const	nj	= sj + HeightFieldHydrology::OFFSET_J[ d ];
+				int const	ni	= si + HeightFieldHydrology::OFFSET_I[ d ];
+
+				higher[ d ] = ordering.IsInside( nj, ni ) && ordering.GetKey( nj, ni ) > key;
+				if ( higher[ d ] )
+				{
+					++nHigher;
+				}
+			}
+
+			if ( nHigher == 0 )
+			{
+				continue;
+			}
+
+			// Find the start of a run, so that no run wraps around the end of the ring
+
+			int	start	= 0;
+
+			while ( nHigher < 8 && !( higher[ start ] && !higher[ ( start + 7 ) % 8 ] ) )
+			{
+				++start;
+			}
+
+			for ( int k = 0; k < 8; )
+			{
+				int const	d	= ( start + k ) % 8;
+
+				if ( !higher[ d ] )
+				{
+					++k;
+					continue;
+				}
+
+				// Start at the highest neighbor in the run
+
+				int					best	= d;
+				unsigned long long	bestKey	= 0;
+
+				for ( ; k < 8 && higher[ ( start + k ) % 8 ]; k++ )
+				{
+					int const					e	= ( start + k ) % 8;
+					unsigned long long const	nk	= ordering.GetKey( sj + HeightFieldHydrology::OFFSET_J[ e ], si + HeightFieldHydrology::OFFSET_I[ e ] );
+
+					if ( nk > bestKey )
+					{
+						best = e;
+						bestKey = nk;
+					}
+				}
+
+				Polyline	line;
+				int			j	= sj + HeightFieldHydrology::OFFSET_J[ best ];
+				int			i	= si + HeightFieldHydrology::OFFSET_I[ best ];
+
+				HeightFieldFeatures::Point	p	= { sj, si };
+				line.m_Points.push_back( p );
+
+				// Follow the steepest ascent until there is nothing higher
+
+				for ( ;; )
+				{
+					p.m_J = j;
+					p.m_I = i;
+					line.m_Points.push_back( p );
+
+					unsigned long long const	here	= ordering.GetKey( j, i );
+					float const					z		= ordering.GetHeight( j, i );
+					int							next	= -1;
+					float						steepest	= 0.0f;
+
+					for ( int e = 0; e < 8; e++ )
+					{
+						int const	nj	= j + HeightFieldHydrology::OFFSET_J[ e ];
+						int const	ni	= i + HeightFieldHydrology::OFFSET_I[ e ];
+
+						if ( ordering.IsInside( nj, ni ) && ordering.GetKey( nj, ni ) > here )
+						{
+							float const	slope	= ( ordering.GetHeight( nj, ni ) - z ) / ( ( e % 2 == 0 ) ? 1.0f : SQRT2 );
+
+							if ( next < 0 || slope > steepest )
+							{
+								next = e;
+								steepest = slope;
+							}
+						}
+					}
+
+					if ( next < 0 )
+					{
+						break;
+					}
+
+					j += HeightFieldHydrology::OFFSET_J[ next ];
+					i += HeightFieldHydrology::OFFSET_I[ next ];
+				}
+
+				traced[ s ].push_back( line );
+			}
+		}
+	} );
+
+	lines.clear();
+
+	for ( int s = 0; s < nSaddles; s++ )
+	{
+		lines.insert( lines.end(), traced[ s ].begin(), traced[ s ].end() );
+	}
+}
+
+} // anonymous namespace
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	hf			Heightfield
+//! @param	peaks		Peaks, in order of decreasing prominence (output)
+//! @param	pits		Pits, in order of decreasing depth (output)
+//! @param	saddles		Saddles, in order of their locations (output)
+//!
+//! @exception	bad_alloc	Unable to allocate memory for the analysis
+
+void HeightFieldFeatures::FindCriticalPoints( HeightField const &			hf,
+											  vector< CriticalPoint > &		peaks,
+											  vector< CriticalPoint > &		pits,
+											  vector< CriticalPoint > &		saddles )
+{
+	assert( double( hf.GetSizeI() ) * double( hf.GetSizeJ() ) < 4294967296.0 );
+
+	Ordering const	ordering( hf, false );
+	int const		sizeJ	= hf.GetSizeJ();
+	int const		sizeI	= hf.GetSizeI();
+	int const		nTiles	= GetTileCount( sizeJ, sizeI );
+	bool			before[ 8 ];	// True if the neighbor in the direction has a lower index
+
+	for ( int d = 0; d < 8; d++ )
+	{
+		before[ d ] = HeightFieldHydrology::OFFSET_I[ d ] < 0 ||
+					  ( HeightFieldHydrology::OFFSET_I[ d ] == 0 && HeightFieldHydrology::OFFSET_J[ d ] < 0 );
+	}
+
+	// The points in each tile are found in parallel and then concatenated in order
+
+	vector< vector< CriticalPoint > >	found( size_t( nTiles ) * 3 );
+
+	Parallel::For( 0, nTiles, 1, [ & ]( int first, int last )
+	{
+		for ( int t = first; t < last; t++ )
+		{
+			int	j0, i0, j1, i1;
+
+			GetTile( t, sizeJ, sizeI, j0, i0, j1, i1 );
+
+			for ( int i = i0; i < i1; i++ )
+			{
+				for ( int j = j0; j < j1; j++ )
+				{
+					unsigned const	bits	= ordering.GetBits( j, i );
+					bool			peak	= true;
+					bool			pit		= true;
+					bool			higher[ 8 ];
+
+					for ( int d = 0; d < 8; d++ )
+					{
+						int const	nj	= j + HeightFieldHydrology::OFFSET_J[ d ];
+						int const	ni	= i + HeightFieldHydrology::OFFSET_I[ d ];
+
+						higher[ d ] = false;
+						if ( ordering.IsInside( nj, ni ) )
+						{
+							// At the same height, the neighbor with the lower index is higher, and also lower
+							// when upside down
+
+							unsigned const	other	= ordering.GetBits( nj, ni );
+
+							higher[ d ] = other > bits || ( other == bits && before[ d ] );
+							peak = peak && !higher[ d ];
+							pit = pit && !( other < bits || ( other == bits && before[ d ] ) );
+						}
+					}
+
+					float const	z	= hf.GetZ( j, i );
+
+					if ( peak )
+					{
+						found[ t * 3 + 0 ].push_back( MakeCriticalPoint( j, i, z ) );
+					}
+
+					if ( pit )
+					{
+						found[ t * 3 + 1 ].push_back( MakeCriticalPoint( j, i, z ) );
+					}
+
+					if ( j > 0 && j < sizeJ - 1 && i > 0 && i < sizeI - 1 )
+					{
+						int	changes	= 0;
+
+						for ( int d = 0; d < 8; d++ )
+						{
+							if ( higher[ d ] != higher[ ( d + 1 ) % 8 ] )
+							{
+								++changes;
+							}
+						}
+
+						if ( changes >= 4 )
+						{
+							found[ t * 3 + 2 ].push_back( MakeCriticalPoint( j, i, z ) );
+						}
+					}
+				}
+			}
+		}
+	} );
+
+	peaks.clear();
+	pits.clear();
+	saddles.clear();
+
+	for ( int t = 0; t < nTiles; t++ )
+	{
+		peaks.insert( peaks.end(), found[ t * 3 + 0 ].begin(), found[ t * 3 + 0 ].end() );
+		pits.insert( pits.end(), found[ t * 3 + 1 ].begin(), found[ t * 3 + 1 ].end() );
+		saddles.insert( saddles.end(), found[ t * 3 + 2 ].begin(), found[ t * 3 + 2 ].end() );
+	}
+
+	vector< vector< CriticalPoint > >().swap( found );
+
+	ComputeProminence( hf, false, peaks );
+	ComputeProminence( hf, true, pits );
+
+	sort( peaks.begin(), peaks.end(), IsMoreProminent );
+	sort( pits.begin(), pits.end(), IsMoreProminent );
+	sort( saddles.begin(), saddles.end(), []( CriticalPoint const & a, CriticalPoint const & b )
+	{
+		return ( a.m_I != b.m_I ) ? a.m_I < b.m_I : a.m_J < b.m_J;
+	} );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	hf			Heightfield
+//! @param	saddles		Saddles to trace from, such as the key saddles of the most prominent peaks
+//! @param	ridges		Ridge lines, each from a saddle to a peak, in the order of the saddles (output)
+//!
+//! A line is traced by steepest ascent from each run of higher neighbors around a saddle.
+
+void HeightFieldFeatures::TraceRidges( HeightField const & hf, vector< CriticalPoint > const & saddles, vector< Polyline > & ridges )
+{
+	Trace( hf, false, saddles, ridges );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	hf			Heightfield
+//! @param	saddles		Saddles to trace from, such as the key saddles of the deepest pits
+//! @param	valleys		Valley lines, each from a saddle to a pit, in the order of the saddles (output)
+//!
+//! A line is traced by steepest descent from each run of lower neighbors around a saddle.
+
+void HeightFieldFeatures::TraceValleys( HeightField const & hf, vector< CriticalPoint > const & saddles, vector< Polyline > & valleys )
+{
+	Trace( hf, true, saddles, valleys );
+}
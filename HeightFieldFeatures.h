@@ -0,0 +1,83 @@
+/** @file *//********************************************************************************************************
+
+                                                 HeightFieldFeatures.h
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/HeightFieldFeatures.h#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#pragma once
+
+#include <vector>
+
+class HeightField;
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! Extracts the topographic features of a HeightField: peaks, pits, saddles, and ridge and valley lines.
+//!
+//! Vertexes are compared by height, and ties are broken by index (i * sizeJ + j): at the same height, the vertex
+//! with the lower index is considered higher when looking for peaks and lower when looking for pits, so a flat area
+//! has a single peak or pit. A peak is a vertex that is higher than
+//! its 8 neighbors, a pit is a vertex that is lower than its 8 neighbors, and a saddle is an interior vertex whose
+//! ring of neighbors alternates between higher and lower at least 4 times.
+//!
+//! The prominence of a peak is its height above its key saddle, which is the highest point at which it connects to
+//! a higher peak. The depth of a pit is the same with the heightfield upside down. The highest peak's prominence is
+//! its height above the lowest vertex, and the deepest pit's depth is its depth below the highest vertex.
+//!
+//! The critical points are found one tile at a time, in parallel. The prominences are computed by building the
+//! join tree of each tile in parallel, reduced to the vertexes on the tile's edges and the points where they join,
+//! and then connecting the trees with a single union-find pass, so only a few tiles are in memory at once and the
+//! extraction scales to very large heightfields. The results do not depend on the number of threads.
+//!
+//! @note	The heightfield must have fewer than 2^32 vertexes.
+
+class HeightFieldFeatures
+{
+public:
+
+	//! A peak, pit or saddle
+	struct CriticalPoint
+	{
+		int		m_J;			//!< Location along the J axis
+		int		m_I;			//!< Location along the I axis
+		float	m_Z;			//!< Height
+		float	m_Prominence;	//!< Prominence of a peak, or depth of a pit. 0 for a saddle.
+		int		m_SaddleJ;		//!< Location of the key saddle along the J axis, or -1 if there is none
+		int		m_SaddleI;		//!< Location of the key saddle along the I axis, or -1 if there is none
+	};
+
+	//! A location in the heightfield
+	struct Point
+	{
+		int		m_J;			//!< Location along the J axis
+		int		m_I;			//!< Location along the I axis
+	};
+
+	//! A line through adjacent vertexes
+	struct Polyline
+	{
+		std::vector< Point >	m_Points;	//!< Vertexes along the line
+	};
+
+	//! Finds the peaks, pits and saddles, and computes the prominences of the peaks and the depths of the pits.
+	static void FindCriticalPoints( HeightField const &				hf,
+									std::vector< CriticalPoint > &	peaks,
+									std::vector< CriticalPoint > &	pits,
+									std::vector< CriticalPoint > &	saddles );
+
+	//! Traces the ridge lines from saddles up to peaks.
+	static void TraceRidges( HeightField const & hf, std::vector< CriticalPoint > const & saddles, std::vector< Polyline > & ridges );
+
+	//! Traces the valley lines from saddles down to pits.
+	static void TraceValleys( HeightField const & hf, std::vector< CriticalPoint > const & saddles, std::vector< Polyline > & valleys );
+};
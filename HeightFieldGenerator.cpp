@@ -0,0 +1,649 @@
+/** @file *//********************************************************************************************************
+
+                                                HeightFieldGenerator.cpp
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/HeightFieldGenerator.cpp#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#include "PrecompiledHeaders.h"
+
+#include "HeightFieldGenerator.h"
+
+#include "HeightField.h"
+#include "HeightFieldView.h"
+#include "Parallel.h"
+#include "Simd.h"
+
+using namespace std;
+
+
+namespace
+{
+
+// Size of the tiles that are generated in parallel
+int const	GENERATE_TILE_SIZE	= 128;
+
+// The noise along a row is evaluated in blocks of this many vertexes that are aligned in world coordinates, so
+// that the value at a vertex does not depend on where the heightfield or the tile containing it starts.
+int const	BLOCK_SIZE			= 64;
+
+// Lattice period that is never reached, used when the noise does not wrap
+int const	NO_PERIOD			= numeric_limits< int >::max();
+
+// Added to the seed for each successive octave
+unsigned const	OCTAVE_SEED_INCREMENT	= 0x9e3779b9;
+
+// Hashes a 32-bit value. The hash uses only shifts, adds and xors so that the SSE2 kernel can compute it exactly.
+inline unsigned Hash( unsigned k )
+{
+	k = ~k + ( k << 15 );
+	k ^= k >> 12;
+	k += k << 2;
+	k ^= k >> 4;
+	k = k + ( k << 3 ) + ( k << 11 );
+	k ^= k >> 16;
+	return k;
+}
+
+// Returns the dot product of the gradient selected by a hash and the offset ( x, y ) from its lattice point
+inline float Grad( unsigned h, float x, float y )
+{
+	float const	u	= ( h & 1 ) ? y : x;
+	float const	w	= ( h & 1 ) ? x : y;
+	float const	r	= ( h & 2 ) ? -u : u;
+	float const	s	= ( h & 4 ) ? ( ( h & 8 ) ? -w : w ) : 0.0f;
+
+	return r + s;
+}
+
+// Returns the quintic fade curve of t
+inline float Fade( float t )
+{
+	return t * t * t * ( t * ( t * 6.0f - 15.0f ) + 10.0f );
+}
+
+// Wraps a lattice coordinate in [ 0, 2 * period ) into [ 0, period )
+inline int Wrap( int x, int period )
+{
+	return ( x >= period ) ? x - period : x;
+}
+
+// Returns a random value in [ -1, 1 ) for a vertex
+inline float Random( unsigned seed, int j, int i )
+{
+	return float( Hash( Hash( unsigned( j ) + seed ) + unsigned( i ) ) >> 8 ) * ( 1.0f / 8388608.0f ) - 1.0f;
+}
+
+// Properties of the lattice that are shared by a row of samples in one octave
+struct NoiseRow
+{
+	float		m_Dx;		// Distance between samples, in lattice units
+	int			m_Period;	// Lattice period along the row
+	unsigned	m_Hy0;		// Hash of the lattice row before the samples
+	unsigned	m_Hy1;		// Hash of the lattice row after the samples
+	float		m_Fy;		// Offset of the samples from the lattice row before them
+	float		m_V;		// Fade of m_Fy
+};
+
+// Computes samples [ first, first + n ) of a block of gradient noise. Sample k is at x0 + k * dx, relative to
+// lattice column ixBase. Every kernel computes exactly the same values as this one.
+void NoiseScalar( NoiseRow const & row, float x0, int ixBase, int first, int n, float * pOut )
+{
+	float const	fy1	= row.m_Fy - 1.0f;
+
+	for ( int k = first; k < first + n; k++ )
+	{
+		float const		x	= x0 + float( k ) * row.m_Dx;
+		int const		xi	= int( x );
+		float const		fx	= x - float( xi );
+		int const		ix	= Wrap( ixBase + xi, row.m_Period );
+		int const		ix1	= Wrap( ix + 1, row.m_Period );
+		float const		u	= Fade( fx );
+
+		float const	g00	= Grad( Hash( unsigned( ix ) + row.m_Hy0 ), fx, row.m_Fy );
+		float const	g10	= Grad( Hash( unsigned( ix1 ) + row.m_Hy0 ), fx - 1.0f, row.m_Fy );
+		float const	g01	= Grad( Hash( unsigned( ix ) + row.m_Hy1 ), fx, fy1 );
+		float const	g11	= Grad( Hash( unsigned( ix1 ) + row.m_Hy1 ), fx - 1.0f, fy1 );
+		float const	a	= g00 + u * ( g10 - g00 );
+		float const	b	= g01 + u * ( g11 - g01 );
+
+		*pOut++ = a + row.m_V * ( b - a );
+	}
+}
+
+#if defined( HEIGHTFIELD_USE_AVX2 )
+
+inline __m256i Hash( __m256i k )
+{
+	k = _mm256_add_epi32( _mm256_xor_si256( k, _mm256_set1_epi32( -1 ) ), _mm256_slli_epi32( k, 15 ) );
+	k = _mm256_xor_si256( k, _mm256_srli_epi32( k, 12 ) );
+	k = _mm256_add_epi32( k, _mm256_slli_epi32( k, 2 ) );
+	k = _mm256_xor_si256( k, _mm256_srli_epi32( k, 4 ) );
+	k = _mm256_add_epi32( _mm256_add_epi32( k, _mm256_slli_epi32( k, 3 ) ), _mm256_slli_epi32( k, 11 ) );
+	k = _mm256_xor_si256( k, _mm256_srli_epi32( k, 16 ) );
+	return k;
+}
+
+inline __m256 Grad( __m256i h, __m256 x, __m256 y )
+{
+	__m256 const	swap	= _mm256_castsi256_ps( _mm256_cmpeq_epi32( _mm256_and_si256( h, _mm256_set1_epi32( 1 ) ), _mm256_set1_epi32( 1 ) ) );
+	__m256 const	use		= _mm256_castsi256_ps( _mm256_cmpeq_epi32( _mm256_and_si256( h, _mm256_set1_epi32( 4 ) ), _mm256_set1_epi32( 4 ) ) );
+	__m256 const	u		= _mm256_blendv_ps( x, y, swap );
+	__m256 const	w		= _mm256_blendv_ps( y, x, swap );
+	__m256 const	r		= _mm256_xor_ps( u, _mm256_castsi256_ps( _mm256_slli_epi32( _mm256_and_si256( h, _mm256_set1_epi32( 2 ) ), 30 ) ) );
+	__m256 const	s		= _mm256_xor_ps( w, _mm256_castsi256_ps( _mm256_slli_epi32( _mm256_and_si256( h, _mm256_set1_epi32( 8 ) ), 28 ) ) );
+
+	return _mm256_add_ps( r, _mm256_and_ps( s, use ) );
+}
+
+inline __m256 Fade( __m256 t )
+{
+	__m256 const	t3	= _mm256_mul_ps( _mm256_mul_ps( t, t ), t );
+	__m256 const	p	= _mm256_sub_ps( _mm256_mul_ps( t, _mm256_set1_ps( 6.0f ) ), _mm256_set1_ps( 15.0f ) );
+
+	return _mm256_mul_ps( t3, _mm256_add_ps( _mm256_mul_ps( t, p ), _mm256_set1_ps( 10.0f ) ) );
+}
+
+inline __m256i Wrap( __m256i x, __m256i period )
+{
+	__m256i const	over	= _mm256_cmpgt_epi32( x, _mm256_sub_epi32( period, _mm256_set1_epi32( 1 ) ) );
+
+	return _mm256_sub_epi32( x, _mm256_and_si256( over, period ) );
+}
+
+void Noise( NoiseRow const & row, float x0, int ixBase, int first, int n, float * pOut )
+{
+	__m256 const	vX0		= _mm256_set1_ps( x0 );
+	__m256 const	vDx		= _mm256_set1_ps( row.m_Dx );
+	__m256i const	vBase	= _mm256_set1_epi32( ixBase );
+	__m256i const	vPeriod	= _mm256_set1_epi32( row.m_Period );
+	__m256i const	vHy0	= _mm256_set1_epi32( int( row.m_Hy0 ) );
+	__m256i const	vHy1	= _mm256_set1_epi32( int( row.m_Hy1 ) );
+	__m256 const	vFy		= _mm256_set1_ps( row.m_Fy );
+	__m256 const	vFy1	= _mm256_set1_ps( row.m_Fy - 1.0f );
+	__m256 const	vV		= _mm256_set1_ps( row.m_V );
+	__m256 const	vOne	= _mm256_set1_ps( 1.0f );
+	__m256i			vK		= _mm256_add_epi32( _mm256_set1_epi32( first ), _mm256_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7 ) );
+	int				k		= 0;
+
+	for ( ; k + 8 <= n; k += 8 )
+	{
+		__m256 const	x	= _mm256_add_ps( vX0, _mm256_mul_ps( _mm256_cvtepi32_ps( vK ), vDx ) );
+		__m256i const	xi	= _mm256_cvttps_epi32( x );
+		__m256 const	fx	= _mm256_sub_ps( x, _mm256_cvtepi32_ps( xi ) );
+		__m256 const	fx1	= _mm256_sub_ps( fx, vOne );
+		__m256i const	ix	= Wrap( _mm256_add_epi32( vBase, xi ), vPeriod );
+		__m256i const	ix1	= Wrap( _mm256_add_epi32( ix, _mm256_set1_epi32( 1 ) ), vPeriod );
+		__m256 const	u	= Fade( fx );
+
+		__m256 const	g00	= Grad( Hash( _mm256_add_epi32( ix, vHy0 ) ), fx, vFy );
+		__m256 const	g10	= Grad( Hash( _mm256_add_epi32( ix1, vHy0 ) ), fx1, vFy );
+		__m256 const	g01	= Grad( Hash( _mm256_add_epi32( ix, vHy1 ) ), fx, vFy1 );
+		__m256 const	g11	= Grad( Hash( _mm256_add_epi32( ix1, vHy1 ) ), fx1, vFy1 );
+		__m256 const	a	= _mm256_add_ps( g00, _mm256_mul_ps( u, _mm256_sub_ps( g10, g00 ) ) );
+		__m256 const	b	= _mm256_add_ps( g01, _mm256_mul_ps( u, _mm256_sub_ps( g11, g01 ) ) );
+
+		_mm256_storeu_ps( pOut + k, _mm256_add_ps( a, _mm256_mul_ps( vV, _mm256_sub_ps( b, a ) ) ) );
+
+		vK = _mm256_add_epi32( vK, _mm256_set1_epi32( 8 ) );
+	}
+
+	NoiseScalar( row, x0, ixBase, first + k, n - k, pOut + k );
+}
+
+#elif defined( HEIGHTFIELD_USE_SSE )
+
+inline __m128i Hash( __m128i k )
+{
+	k = _mm_add_epi32( _mm_xor_si128( k, _mm_set1_epi32( -1 ) ), _mm_slli_epi32( k, 15 ) );
+	k = _mm_xor_si128( k, _mm_srli_epi32( k, 12 ) );
+	k = _mm_add_epi32( k, _mm_slli_epi32( k, 2 ) );
+	k = _mm_xor_si128( k, _mm_srli_epi32( k, 4 ) );
+	k = _mm_add_epi32( _mm_add_epi32( k, _mm_slli_epi32( k, 3 ) ), _mm_slli_epi32( k, 11 ) );
+	k = _mm_xor_si128( k, _mm_srli_epi32( k, 16 ) );
+	return k;
+}
+
+inline __m128 Grad( __m128i h, __m128 x, __m128 y )
+{
+	__m128 const	swap	= _mm_castsi128_ps( _mm_cmpeq_epi32( _mm_and_si128( h, _mm_set1_epi32( 1 ) ), _mm_set1_epi32( 1 ) ) );
+	__m128 const	use		= _mm_castsi128_ps( _mm_cmpeq_epi32( _mm_and_si128( h, _mm_set1_epi32( 4 ) ), _mm_set1_epi32( 4 ) ) );
+	__m128 const	u		= _mm_or_ps( _mm_and_ps( swap, y ), _mm_andnot_ps( swap, x ) );
+	__m128 const	w		= _mm_or_ps( _mm_and_ps( swap, x ), _mm_andnot_ps( swap, y ) );
+	__m128 const	r		= _mm_xor_ps( u, _mm_castsi128_ps( _mm_slli_epi32( _mm_and_si128( h, _mm_set1_epi32( 2 ) ), 30 ) ) );
+	__m128 const	s		= _mm_xor_ps( w, _mm_castsi128_ps( _mm_slli_epi32( _mm_and_si128( h, _mm_set1_epi32( 8 ) ), 28 ) ) );
+
+	return _mm_add_ps( r, _mm_and_ps( s, use ) );
+}
+
+inline __m128 Fade( __m128 t )
+{
+	__m128 const	t3	= _mm_mul_ps( _mm_mul_ps( t, t ), t );
+	__m128 const	p	= _mm_sub_ps( _mm_mul_ps( t, _mm_set1_ps( 6.0f ) ), _mm_set1_ps( 15.0f ) );
+
+	return _mm_mul_ps( t3, _mm_add_ps( _mm_mul_ps( t, p ), _mm_set1_ps( 10.0f ) ) );
+}
+
+inline __m128i Wrap( __m128i x, __m128i period )
+{
+	__m128i const	over	= _mm_cmpgt_epi32( x, _mm_sub_epi32( period, _mm_set1_epi32( 1 ) ) );
+
+	return _mm_sub_epi32( x, _mm_and_si128( over, period ) );
+}
+
+void Noise( NoiseRow const & row, float x0, int ixBase, int first, int n, float * pOut )
+{
+	__m128 const	vX0		= _mm_set1_ps( x0 );
+	__m128 const	vDx		= _mm_set1_ps( row.m_Dx );
+	__m128i const	vBase	= _mm_set1_epi32( ixBase );
+	__m128i const	vPeriod	= _mm_set1_epi32( row.m_Period );
+	__m128i const	vHy0	= _mm_set1_epi32( int( row.m_Hy0 ) );
+	__m128i const	vHy1	= _mm_set1_epi32( int( row.m_Hy1 ) );
+	__m128 const	vFy		= _mm_set1_ps( row.m_Fy );
+	__m128 const	vFy1	= _mm_set1_ps( row.m_Fy - 1.0f );
+	__m128 const	vV		= _mm_set1_ps( row.m_V );
+	__m128 const	vOne	= _mm_set1_ps( 1.0f );
+	__m128i			vK		= _mm_add_epi32( _mm_set1_epi32( first ), _mm_setr_epi32( 0, 1, 2, 3 ) );
+	int				k		= 0;
+
+	for ( ; k + 4 <= n; k += 4 )
+	{
+		__m128 const	x	= _mm_add_ps( vX0, _mm_mul_ps( _mm_cvtepi32_ps( vK ), vDx ) );
+		__m128i const	xi	= _mm_cvttps_epi32( x );
+		__m128 const	fx	= _mm_sub_ps( x, _mm_cvtepi32_ps( xi ) );
+		__m128 const	fx1	= _mm_sub_ps( fx, vOne );
+		__m128i const	ix	= Wrap( _mm_add_epi32( vBase, xi ), vPeriod );
+		__m128i const	ix1	= Wrap( _mm_add_epi32( ix, _mm_set1_epi32( 1 ) ), vPeriod );
+		__m128 const	u	= Fade( fx );
+
+		__m128 const	g00	= Grad( Hash( _mm_add_epi32( ix, vHy0 ) ), fx, vFy );
+		__m128 const	g10	= Grad( Hash( _mm_add_epi32( ix1, vHy0 ) ), fx1, vFy );
+		__m128 const	g01	= Grad( Hash( _mm_add_epi32( ix, vHy1 ) ), fx, vFy1 );
+		__m128 const	g11	= Grad( Hash( _mm_add_epi32( ix1, vHy1 ) ), fx1, vFy1 );
+		__m128 const	a	= _mm_add_ps( g00, _mm_mul_ps( u, _mm_sub_ps( g10, g00 ) ) );
+		__m128 const	b	= _mm_add_ps( g01, _mm_mul_ps( u, _mm_sub_ps( g11, g01 ) ) );
+
+		_mm_storeu_ps( pOut + k, _mm_add_ps( a, _mm_mul_ps( vV, _mm_sub_ps( b, a ) ) ) );
+
+		vK = _mm_add_epi32( vK, _mm_set1_epi32( 4 ) );
+	}
+
+	NoiseScalar( row, x0, ixBase, first + k, n - k, pOut + k );
+}
+
+#else
+
+void Noise( NoiseRow const & row, float x0, int ixBase, int first, int n, float * pOut )
+{
+	NoiseScalar( row, x0, ixBase, first, n, pOut );
+}
+
+#endif
+
+// One octave of noise
+struct Octave
+{
+	unsigned	m_Seed;			// Seed
+	double		m_Dx;			// Distance between vertexes along the J axis, in lattice units
+	double		m_Dy;			// Distance between vertexes along the I axis, in lattice units
+	int			m_PeriodJ;		// Lattice period along the J axis
+	int			m_PeriodI;		// Lattice period along the I axis
+	float		m_Amplitude;	// Amplitude
+};
+
+// Computes the octaves described by the parameters, and returns the sum of their amplitudes
+float GetOctaves( HeightField const & hf, HeightFieldGenerator::Parameters const & parameters, vector< Octave > & octaves )
+{
+	double	frequency	= parameters.m_Frequency;
+	float	amplitude	= 1.0f;
+	float	total		= 0.0f;
+
+	octaves.resize( max( parameters.m_Octaves, 0 ) );
+
+	for ( size_t k = 0; k < octaves.size(); k++ )
+	{
+		Octave &	octave	= octaves[ k ];
+
+		octave.m_Seed		= parameters.m_Seed + unsigned( k ) * OCTAVE_SEED_INCREMENT;
+		octave.m_Amplitude	= amplitude;
+
+		if ( parameters.m_Seamless )
+		{
+			// The frequency is rounded so that a whole number of lattice cells spans the heightfield
+
+			int const	cellsJ	= max( int( frequency * ( hf.GetSizeJ() - 1 ) + 0.5 ), 1 );
+			int const	cellsI	= max( int( frequency * ( hf.GetSizeI() - 1 ) + 0.5 ), 1 );
+
+			octave.m_Dx			= double( cellsJ ) / max( hf.GetSizeJ() - 1, 1 );
+			octave.m_Dy			= double( cellsI ) / max( hf.GetSizeI() - 1, 1 );
+			octave.m_PeriodJ	= cellsJ;
+			octave.m_PeriodI	= cellsI;
+		}
+		else
+		{
+			octave.m_Dx			= frequency;
+			octave.m_Dy			= frequency;
+			octave.m_PeriodJ	= NO_PERIOD;
+			octave.m_PeriodI	= NO_PERIOD;
+		}
+
+		total		+= amplitude;
+		frequency	*= parameters.m_Lacunarity;
+		amplitude	*= parameters.m_Gain;
+	}
+
+	return total;
+}
+
+// Computes one octave of noise at world positions [ wj0, wj1 ) in row wi
+void ComputeNoise( Octave const & octave, int wj0, int wj1, int wi, float * pOut )
+{
+	double const	y	= double( wi ) * octave.m_Dy;
+	double const	iy	= floor( y );
+	NoiseRow		row;
+
+	row.m_Dx		= float( octave.m_Dx );
+	row.m_Period	= octave.m_PeriodJ;
+	row.m_Fy		= float( y - iy );
+	row.m_V			= Fade( row.m_Fy );
+	row.m_Hy0		= Hash( unsigned( Wrap( int( iy ), octave.m_PeriodI ) ) + octave.m_Seed );
+	row.m_Hy1		= Hash( unsigned( Wrap( int( iy ) + 1, octave.m_PeriodI ) ) + octave.m_Seed );
+
+	int	wj	= wj0;
+
+	while ( wj < wj1 )
+	{
+		int const		base	= int( floor( double( wj ) / BLOCK_SIZE ) ) * BLOCK_SIZE;
+		int const		end		= min( base + BLOCK_SIZE, wj1 );
+		double const	x		= double( base ) * octave.m_Dx;
+		double const	ix		= floor( x );
+
+		Noise( row, float( x - ix ), Wrap( int( ix ), octave.m_PeriodJ ), wj - base, end - wj, pOut + ( wj - wj0 ) );
+
+		wj = end;
+	}
+}
+
+// Fills a heightfield with fBm or ridged noise
+void Generate( HeightField & hf, HeightFieldGenerator::Parameters const & parameters, bool ridged )
+{
+	int const	sizeI	= hf.GetSizeI();
+	int const	sizeJ	= hf.GetSizeJ();
+
+	if ( sizeI <= 0 || sizeJ <= 0 )
+	{
+		return;
+	}
+
+	vector< Octave >	octaves;
+	float const			total	= GetOctaves( hf, parameters, octaves );
+	float const			scale	= ( total > 0.0f ) ? parameters.m_Amplitude / total : 0.0f;
+	int const			offsetJ	= parameters.m_Seamless ? 0 : parameters.m_OffsetJ;
+	int const			offsetI	= parameters.m_Seamless ? 0 : parameters.m_OffsetI;
+
+	HeightFieldMutableView const	view	= hf.GetView();
+
+	Parallel::ForTiles( sizeJ, sizeI, GENERATE_TILE_SIZE, GENERATE_TILE_SIZE, [ & ]( int j0, int i0, int j1, int i1 )
+	{
+		int const		w		= j1 - j0;
+		vector< float >	noise( w );
+		vector< float >	sum( w );
+		vector< float >	weight( w );
+
+		for ( int i = i0; i < i1; i++ )
+		{
+			fill( sum.begin(), sum.end(), 0.0f );
+			fill( weight.begin(), weight.end(), 1.0f );
+
+			for ( size_t k = 0; k < octaves.size(); k++ )
+			{
+				float const	amplitude	= octaves[ k ].m_Amplitude;
+
+				ComputeNoise( octaves[ k ], offsetJ + j0, offsetJ + j1, offsetI + i, &noise[ 0 ] );
+
+				if ( ridged )
+				{
+					// Musgrave's ridged multifractal: sharp crests where the noise crosses 0, and each octave is
+					// weighted by the previous one so that the valleys stay smooth
+
+					for ( int x = 0; x < w; x++ )
+					{
+						float	signal	= 1.0f - fabsf( noise[ x ] );
+
+						signal		= signal * signal * weight[ x ];
+						weight[ x ]	= min( signal * 2.0f, 1.0f );
+						sum[ x ]	+= signal * amplitude;
+					}
+				}
+				else
+				{
+					for ( int x = 0; x < w; x++ )
+					{
+						sum[ x ] += noise[ x ] * amplitude;
+					}
+				}
+			}
+
+			HeightField::Vertex * const	pRow	= view.GetData( j0, i );
+
+			for ( int x = 0; x < w; x++ )
+			{
+				pRow[ x ].m_Z = sum[ x ] * scale;
+			}
+		}
+	} );
+
+	// The last row and column are the same as the first in theory. Copy them so that they are exactly the same.
+
+	if ( parameters.m_Seamless )
+	{
+		for ( int i = 0; i < sizeI; i++ )
+		{
+			view.GetData( sizeJ - 1, i )->m_Z = view.GetData( 0, i )->m_Z;
+		}
+
+		copy( view.GetData( 0, 0 ), view.GetData( 0, 0 ) + sizeJ, view.GetData( 0, sizeI - 1 ) );
+	}
+
+	hf.UpdateApron();
+}
+
+} // anonymous namespace
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+HeightFieldGenerator::Parameters::Parameters()
+	: m_Seed( 0 ),
+	m_Octaves( 8 ),
+	m_Frequency( 1.0f / 256.0f ),
+	m_Lacunarity( 2.0f ),
+	m_Gain( 0.5f ),
+	m_Amplitude( 1.0f ),
+	m_OffsetJ( 0 ),
+	m_OffsetI( 0 ),
+	m_Seamless( false )
+{
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! The octaves are summed and the sum is divided by the sum of their amplitudes, so the heights are roughly in
+//! [ -amplitude, amplitude ].
+//!
+//! If @a parameters.m_Seamless is true, the frequency of each octave is rounded so that a whole number of cycles
+//! spans the heightfield, and the heightfield wraps around (the last row and column are the same as the first).
+//!
+//! @param	hf			Heightfield. Its contents are replaced and its size is not changed.
+//! @param	parameters	Parameters of the noise
+
+void HeightFieldGenerator::GenerateFbm( HeightField & hf, Parameters const & parameters )
+{
+	Generate( hf, parameters, false );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! Each octave is transformed to ( 1 - |n| )^2, which has sharp ridges, and is weighted by the previous octave. The
+//! heights are in [ 0, amplitude ].
+//!
+//! If @a parameters.m_Seamless is true, the frequency of each octave is rounded so that a whole number of cycles
+//! spans the heightfield, and the heightfield wraps around (the last row and column are the same as the first).
+//!
+//! @param	hf			Heightfield. Its contents are replaced and its size is not changed.
+//! @param	parameters	Parameters of the noise
+
+void HeightFieldGenerator::GenerateRidged( HeightField & hf, Parameters const & parameters )
+{
+	Generate( hf, parameters, true );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! At each level, the center of each square is set to the average of its corners plus a random offset, and then the
+//! center of each diamond is set the same way. The offsets are scaled by @a roughness at each level. Each level is
+//! computed in parallel, and the random offsets are hashes of the seed and the position, so the results do not
+//! depend on the number of threads.
+//!
+//! If @a seamless is true, the diamonds on the edges wrap around to the opposite edge, and the last row and column
+//! are the same as the first.
+//!
+//! @param	hf			Heightfield. It must be square and its size must be a power of 2 plus 1. Its contents are
+//!						replaced.
+//! @param	seed		Seed of the random values
+//! @param	amplitude	Range of the random values of the corners. The heights are roughly in
+//!						[ -amplitude, amplitude ].
+//! @param	roughness	Ratio of the random offsets of consecutive levels
+//! @param	seamless	If true, the result wraps around
+
+void HeightFieldGenerator::GenerateDiamondSquare( HeightField &	hf,
+												  unsigned		seed,
+												  float			amplitude,
+												  float			roughness /*= 0.5f*/,
+												  bool			seamless /*= false*/ )
+{
+	int const	size	= hf.GetSizeJ();
+
+	assert( hf.GetSizeI() == size );
+	assert( size >= 2 && ( ( size - 1 ) & ( size - 2 ) ) == 0 );
+
+	HeightFieldMutableView const	view	= hf.GetView();
+	int const						last	= size - 1;
+
+	// Set the corners
+
+	if ( seamless )
+	{
+		float const	z	= Random( seed, 0, 0 ) * amplitude;
+
+		view.GetData( 0, 0 )->m_Z		= z;
+		view.GetData( last, 0 )->m_Z	= z;
+		view.GetData( 0, last )->m_Z	= z;
+		view.GetData( last, last )->m_Z	= z;
+	}
+	else
+	{
+		view.GetData( 0, 0 )->m_Z		= Random( seed, 0, 0 ) * amplitude;
+		view.GetData( last, 0 )->m_Z	= Random( seed, last, 0 ) * amplitude;
+		view.GetData( 0, last )->m_Z	= Random( seed, 0, last ) * amplitude;
+		view.GetData( last, last )->m_Z	= Random( seed, last, last ) * amplitude;
+	}
+
+	float	scale	= amplitude * roughness;
+
+	for ( int step = last; step > 1; step /= 2 )
+	{
+		int const	half	= step / 2;
+
+		// Square step: the centers of the squares
+
+		Parallel::For( 0, last / step, 1, [ & ]( int first, int end )
+		{
+			for ( int y = first; y < end; y++ )
+			{
+				int const	i	= y * step + half;
+
+				for ( int j = half; j < last; j += step )
+				{
+					float const	average	= ( view.GetZ( j - half, i - half ) + view.GetZ( j + half, i - half ) +
+											view.GetZ( j - half, i + half ) + view.GetZ( j + half, i + half ) ) * 0.25f;
+
+					view.GetData( j, i )->m_Z = average + Random( seed, j, i ) * scale;
+				}
+			}
+		} );
+
+		// Diamond step: the centers of the diamonds, which are the midpoints of the edges of the squares. In seamless
+		// mode, the last row and column are copied from the first.
+
+		Parallel::For( 0, last / half + 1, 1, [ & ]( int first, int end )
+		{
+			for ( int y = first; y < end; y++ )
+			{
+				int const	i	= y * half;
+
+				if ( seamless && i == last )
+				{
+					continue;
+				}
+
+				for ( int j = ( y % 2 == 0 ) ? half : 0; j <= last; j += step )
+				{
+					float	sum		= 0.0f;
+					int		count	= 0;
+
+					if ( seamless )
+					{
+						if ( j == last )
+						{
+							continue;
+						}
+
+						sum = view.GetZ( ( j + last - half ) % last, i ) + view.GetZ( ( j + half ) % last, i ) +
+							  view.GetZ( j, ( i + last - half ) % last ) + view.GetZ( j, ( i + half ) % last );
+						count = 4;
+					}
+					else
+					{
+						if ( j >= half )	{ sum += view.GetZ( j - half, i ); ++count; }
+						if ( j + half <= last )	{ sum += view.GetZ( j + half, i ); ++count; }
+						if ( i >= half )	{ sum += view.GetZ( j, i - half ); ++count; }
+						if ( i + half <= last )	{ sum += view.GetZ( j, i + half ); ++count; }
+					}
+
+					view.GetData( j, i )->m_Z = sum / float( count ) + Random( seed, j, i ) * scale;
+				}
+			}
+		} );
+
+		if ( seamless )
+		{
+			for ( int k = 0; k < last; k += half )
+			{
+				view.GetData( last, k )->m_Z = view.GetZ( 0, k );
+				view.GetData( k, last )->m_Z = view.GetZ( k, 0 );
+			}
+		}
+
+		scale *= roughness;
+	}
+
+	hf.UpdateApron();
+}
@@ -0,0 +1,61 @@
+/** @file *//********************************************************************************************************
+
+                                                 HeightFieldGenerator.h
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/HeightFieldGenerator.h#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#pragma once
+
+class HeightField;
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! Generates procedural terrain directly into a HeightField.
+//!
+//! The noise generators sum octaves of 2D gradient noise. The noise is computed by vectorized kernels, in tiles,
+//! in parallel. Every random value is a hash of the seed and the position, so the results do not depend on the
+//! number of threads, the tiling, or which kernels are compiled in. Because the noise at a vertex depends only on
+//! its position in the world (the offset plus its index), heightfields generated at adjacent offsets join
+//! exactly, which allows infinite terrain to be generated a tile at a time.
+
+class HeightFieldGenerator
+{
+public:
+
+	//! Parameters of the noise generators
+	struct Parameters
+	{
+		//! Constructor
+		Parameters();
+
+		unsigned	m_Seed;			//!< Seed of the random values
+		int			m_Octaves;		//!< Number of octaves of noise
+		float		m_Frequency;	//!< Frequency of the first octave, in cycles per vertex
+		float		m_Lacunarity;	//!< Ratio of the frequencies of consecutive octaves
+		float		m_Gain;			//!< Ratio of the amplitudes of consecutive octaves
+		float		m_Amplitude;	//!< Scale of the result
+		int			m_OffsetJ;		//!< Position of vertex ( 0, 0 ) along the J axis in the world
+		int			m_OffsetI;		//!< Position of vertex ( 0, 0 ) along the I axis in the world
+		bool		m_Seamless;		//!< If true, the result wraps around, and the offsets are ignored
+	};
+
+	//! Fills a heightfield with fractional Brownian motion (fBm).
+	static void GenerateFbm( HeightField & hf, Parameters const & parameters );
+
+	//! Fills a heightfield with ridged multifractal noise.
+	static void GenerateRidged( HeightField & hf, Parameters const & parameters );
+
+	//! Fills a heightfield using the diamond-square algorithm.
+	static void GenerateDiamondSquare( HeightField & hf, unsigned seed, float amplitude, float roughness = 0.5f,
+									   bool seamless = false );
+};
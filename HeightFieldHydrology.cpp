@@ -0,0 +1,1222 @@
+/** @file *//********************************************************************************************************
+
+                                                HeightFieldHydrology.cpp
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/HeightFieldHydrology.cpp#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#include "PrecompiledHeaders.h"
+
+#include "HeightFieldHydrology.h"
+
+#include "HeightField.h"
+#include "HeightFieldView.h"
+#include "Parallel.h"
+
+#include <functional>
+#include <map>
+#include <queue>
+
+using namespace std;
+
+
+namespace
+{
+
+float const	SQRT2		= 1.41421356f;
+float const	PI			= 3.14159265f;
+
+// Size of the tiles used for filling depressions. The tiles are large because the graph connecting them grows
+// with the number of vertexes on their edges.
+int const	FILL_TILE_SIZE	= 512;
+
+// Size of the tiles used for flow accumulation and watersheds
+int const	FLOW_TILE_SIZE	= 256;
+
+// Number of rows computed by each task when computing directions
+int const	ROW_BLOCK_SIZE	= 16;
+
+// Label of the vertexes in a tile that drain to the edge of the heightfield
+int const	OCEAN		= 1;
+
+// An entry in a priority queue of vertexes. Ties are broken by index, so the order is deterministic.
+typedef pair< float, int >	QueueEntry;
+typedef priority_queue< QueueEntry, vector< QueueEntry >, greater< QueueEntry > >	PriorityQueue;
+
+// The lowest point on the boundary between two watersheds
+struct SpillEdge
+{
+	int		m_a;
+	int		m_b;
+	float	m_z;
+};
+
+// Divides a heightfield into square tiles and numbers the vertexes on the edges of the tiles. The vertexes on
+// the edge of a tile are numbered along the first row, then the last row, then the first column, then the last
+// column.
+class Tiling
+{
+public:
+
+	Tiling( int sizeJ, int sizeI, int tileSize )
+		: m_sizeJ( sizeJ ),
+		m_sizeI( sizeI ),
+		m_tileSize( tileSize ),
+		m_tilesJ( ( sizeJ + tileSize - 1 ) / tileSize ),
+		m_tilesI( ( sizeI + tileSize - 1 ) / tileSize ),
+		m_perimeterBase( m_tilesJ * m_tilesI + 1, 0 )
+	{
+		for ( int t = 0; t < GetTileCount(); t++ )
+		{
+			int	j0, i0, j1, i1;
+
+			GetTile( t, j0, i0, j1, i1 );
+			m_perimeterBase[ t + 1 ] = m_perimeterBase[ t ] + GetPerimeterCount( j1 - j0, i1 - i0 );
+		}
+	}
+
+	int GetTileCount() const				{ return m_tilesJ * m_tilesI; }
+	int GetPerimeterCount() const			{ return m_perimeterBase.back(); }
+	int GetPerimeterBase( int t ) const		{ return m_perimeterBase[ t ]; }
+
+	int GetTileIndex( int j, int i ) const	{ return ( i / m_tileSize ) * m_tilesJ + ( j / m_tileSize ); }
+
+	void GetTile( int t, int & j0, int & i0, int & j1, int & i1 ) const
+	{
+		j0 = ( t % m_tilesJ ) * m_tileSize;
+		i0 = ( t / m_tilesJ ) * m_tileSize;
+		j1 = min( j0 + m_tileSize, m_sizeJ );
+		i1 = min( i0 + m_tileSize, m_sizeI );
+	}
+
+	// Returns the number of a vertex on the edge of its tile
+	int GetPerimeterNode( int j, int i ) const
+	{
+		int	j0, i0, j1, i1;
+		int const	t	= GetTileIndex( j, i );
+
+		GetTile( t, j0, i0, j1, i1 );
+		return m_perimeterBase[ t ] + GetPerimeterIndex( j - j0, i - i0, j1 - j0, i1 - i0 );
+	}
+
+	// Returns the number of vertexes on the edge of a w x h tile
+	static int GetPerimeterCount( int w, int h )
+	{
+		return ( h == 1 ) ? w : ( ( w == 1 ) ? h : 2 * w + 2 * ( h - 2 ) );
+	}
+
+	// Returns the number of a vertex on the edge of a w x h tile, or -1 if it is not on the edge
+	static int GetPerimeterIndex( int x, int y, int w, int h )
+	{
+		if ( y == 0 )
+		{
+			return x;
+		}
+		else if ( y == h - 1 )
+		{
+			return w + x;
+		}
+		else if ( x == 0 )
+		{
+			return 2 * w + y - 1;
+		}
+		else if ( x == w - 1 )
+		{
+			return 2 * w + h - 2 + y - 1;
+		}
+		else
+		{
+			return -1;
+		}
+	}
+
+	// Returns the location of a numbered vertex on the edge of a w x h tile
+	static void GetPerimeterVertex( int k, int w, int h, int & x, int & y )
+	{
+		if ( k < w )
+		{
+			x = k;
+			y = 0;
+		}
+		else if ( k < 2 * w )
+		{
+			x = k - w;
+			y = h - 1;
+		}
+		else if ( k < 2 * w + h - 2 )
+		{
+			x = 0;
+			y = k - 2 * w + 1;
+		}
+		else
+		{
+			x = w - 1;
+			y = k - ( 2 * w + h - 2 ) + 1;
+		}
+	}
+
+private:
+
+	int				m_sizeJ;
+	int				m_sizeI;
+	int				m_tileSize;
+	int				m_tilesJ;
+	int				m_tilesI;
+	vector< int >	m_perimeterBase;	// Number of the first vertex on the edge of each tile
+};
+
+// Floods a tile with a priority-flood from the vertexes on its edge, raising the heights in the tile's
+// depressions and labeling each vertex with the watershed it is in. Vertexes draining to the edge of the
+// heightfield are labeled OCEAN, and the other watersheds are numbered from 2. If pEdges is not 0, the lowest
+// points between adjacent watersheds are added to it. The results are deterministic. Returns the number of labels.
+int FloodTile( HeightField const & hf, int j0, int i0, int j1, int i1,
+			   vector< float > & z, vector< int > & labels, vector< SpillEdge > * pEdges )
+{
+	int const	w	= j1 - j0;
+	int const	h	= i1 - i0;
+
+	z.resize( size_t( w ) * h );
+	labels.assign( size_t( w ) * h, 0 );
+
+	for ( int y = 0; y < h; y++ )
+	{
+		for ( int x = 0; x < w; x++ )
+		{
+			z[ y * w + x ] = hf.GetZ( j0 + x, i0 + y );
+		}
+	}
+
+	// All of the vertexes on the edge of the tile are seeds. Those on the edge of the heightfield drain to it.
+
+	PriorityQueue	queue;
+	int const		nPerimeter	= Tiling::GetPerimeterCount( w, h );
+
+	for ( int k = 0; k < nPerimeter; k++ )
+	{
+		int	x, y;
+
+		Tiling::GetPerimeterVertex( k, w, h, x, y );
+
+		int const	j	= j0 + x;
+		int const	i	= i0 + y;
+		int const	c	= y * w + x;
+
+		if ( j == 0 || i == 0 || j == hf.GetSizeJ() - 1 || i == hf.GetSizeI() - 1 )
+		{
+			labels[ c ] = OCEAN;
+		}
+
+		queue.push( QueueEntry( z[ c ], c ) );
+	}
+
+	map< pair< int, int >, float >	spills;
+	int								nextLabel	= OCEAN + 1;
+
+	while ( !queue.empty() )
+	{
+		int const	c	= queue.top().second;
+
+		queue.pop();
+
+		// A seed that has not been reached from another watershed starts a new one
+
+		if ( labels[ c ] == 0 )
+		{
+			labels[ c ] = nextLabel++;
+		}
+
+		int const	x	= c % w;
+		int const	y	= c / w;
+
+		for ( int d = 0; d < 8; d++ )
+		{
+			int const	nx	= x + HeightFieldHydrology::OFFSET_J[ d ];
+			int const	ny	= y + HeightFieldHydrology::OFFSET_I[ d ];
+
+			if ( nx < 0 || nx >= w || ny < 0 || ny >= h )
+			{
+				continue;
+			}
+
+			int const	n	= ny * w + nx;
+
+			if ( labels[ n ] != 0 )
+			{
+				if ( pEdges != 0 && labels[ n ] != labels[ c ] )
+				{
+					pair< int, int > const	key( min( labels[ c ], labels[ n ] ), max( labels[ c ], labels[ n ] ) );
+					float const				spill	= max( z[ c ], z[ n ] );
+					auto const				p		= spills.insert( make_pair( key, spill ) );
+
+					if ( !p.second && spill < p.first->second )
+					{
+						p.first->second = spill;
+					}
+				}
+				continue;
+			}
+
+			labels[ n ] = labels[ c ];
+
+			// Vertexes on the edge of the tile are already queued, and are not lower than this one.
+
+			if ( Tiling::GetPerimeterIndex( nx, ny, w, h ) < 0 )
+			{
+				z[ n ] = max( z[ n ], z[ c ] );
+				queue.push( QueueEntry( z[ n ], n ) );
+			}
+		}
+	}
+
+	if ( pEdges != 0 )
+	{
+		for ( auto const & spill : spills )
+		{
+			SpillEdge const	e	= { spill.first.first, spill.first.second, spill.second };
+			pEdges->push_back( e );
+		}
+	}
+
+	return nextLabel - ( OCEAN + 1 );
+}
+
+// Returns the D8 direction of steepest descent from a vertex, or NO_FLOW if none of its neighbors are lower
+unsigned char FindSteepestDescent( HeightField const & hf, int j, int i )
+{
+	float const		z		= hf.GetZ( j, i );
+	float			best	= 0.0f;
+	unsigned char	dir		= HeightFieldHydrology::NO_FLOW;
+
+	for ( int d = 0; d < 8; d++ )
+	{
+		int const	nj	= j + HeightFieldHydrology::OFFSET_J[ d ];
+		int const	ni	= i + HeightFieldHydrology::OFFSET_I[ d ];
+
+		if ( nj < 0 || nj >= hf.GetSizeJ() || ni < 0 || ni >= hf.GetSizeI() )
+		{
+			continue;
+		}
+
+		float const	drop	= z - hf.GetZ( nj, ni );
+		float const	slope	= ( d & 1 ) ? drop * ( 1.0f / SQRT2 ) : drop;
+
+		if ( slope > best )
+		{
+			best	= slope;
+			dir		= (unsigned char)d;
+		}
+	}
+
+	return dir;
+}
+
+// Returns true if the vertex is on the edge of the heightfield
+bool IsOnEdge( int j, int i, int sizeJ, int sizeI )
+{
+	return j == 0 || i == 0 || j == sizeJ - 1 || i == sizeI - 1;
+}
+
+// Sorts the vertexes of a tile so that each one comes before the vertex it flows to, if that vertex is in the
+// tile. The vertexes are given as indexes into the tile.
+void SortTile( int sizeJ, int j0, int i0, int j1, int i1, vector< unsigned char > const & directions,
+			   vector< int > & order )
+{
+	int const	w	= j1 - j0;
+	int const	h	= i1 - i0;
+
+	vector< unsigned char >	donors( size_t( w ) * h, 0 );
+
+	for ( int y = 0; y < h; y++ )
+	{
+		unsigned char const * const	pRow	= &directions[ size_t( i0 + y ) * sizeJ + j0 ];
+
+		for ( int x = 0; x < w; x++ )
+		{
+			if ( pRow[ x ] != HeightFieldHydrology::NO_FLOW )
+			{
+				int const	rx	= x + HeightFieldHydrology::OFFSET_J[ pRow[ x ] ];
+				int const	ry	= y + HeightFieldHydrology::OFFSET_I[ pRow[ x ] ];
+
+				if ( rx >= 0 && rx < w && ry >= 0 && ry < h )
+				{
+					++donors[ ry * w + rx ];
+				}
+			}
+		}
+	}
+
+	order.clear();
+	order.reserve( size_t( w ) * h );
+
+	for ( int c = 0; c < w * h; c++ )
+	{
+		if ( donors[ c ] == 0 )
+		{
+			order.push_back( c );
+		}
+	}
+
+	for ( size_t k = 0; k < order.size(); k++ )
+	{
+		int const			c	= order[ k ];
+		unsigned char const	d	= directions[ size_t( i0 + c / w ) * sizeJ + j0 + c % w ];
+
+		if ( d != HeightFieldHydrology::NO_FLOW )
+		{
+			int const	rx	= c % w + HeightFieldHydrology::OFFSET_J[ d ];
+			int const	ry	= c / w + HeightFieldHydrology::OFFSET_I[ d ];
+
+			if ( rx >= 0 && rx < w && ry >= 0 && ry < h && --donors[ ry * w + rx ] == 0 )
+			{
+				order.push_back( ry * w + rx );
+			}
+		}
+	}
+}
+
+// Accumulates the flow within a tile. Flow entering the tile from its neighbors is given by pInflow (indexed by
+// the number of the vertex on the edge of the tile), if it is not 0. If pExits is not 0, it receives the number
+// of the vertex on the edge of the tile through which the flow from each vertex on the edge leaves the tile, or
+// -1 if the flow ends within the tile.
+void AccumulateTile( int sizeJ, int j0, int i0, int j1, int i1,
+					 vector< unsigned char > const &	directions,
+					 vector< float > const *			pWeights,
+					 double const *						pInflow,
+					 vector< float > &					accumulation,
+					 int *								pExits )
+{
+	int const	w	= j1 - j0;
+	int const	h	= i1 - i0;
+
+	vector< int >	order;
+
+	SortTile( sizeJ, j0, i0, j1, i1, directions, order );
+
+	for ( int y = 0; y < h; y++ )
+	{
+		size_t const	row	= size_t( i0 + y ) * sizeJ + j0;
+
+		for ( int x = 0; x < w; x++ )
+		{
+			accumulation[ row + x ] = ( pWeights != 0 ) ? ( *pWeights )[ row + x ] : 1.0f;
+		}
+	}
+
+	if ( pInflow != 0 )
+	{
+		for ( int k = 0; k < Tiling::GetPerimeterCount( w, h ); k++ )
+		{
+			int	x, y;
+
+			Tiling::GetPerimeterVertex( k, w, h, x, y );
+			accumulation[ size_t( i0 + y ) * sizeJ + j0 + x ] += float( pInflow[ k ] );
+		}
+	}
+
+	for ( size_t k = 0; k < order.size(); k++ )
+	{
+		int const			c	= order[ k ];
+		size_t const		g	= size_t( i0 + c / w ) * sizeJ + j0 + c % w;
+		unsigned char const	d	= directions[ g ];
+
+		if ( d != HeightFieldHydrology::NO_FLOW )
+		{
+			int const	rx	= c % w + HeightFieldHydrology::OFFSET_J[ d ];
+			int const	ry	= c / w + HeightFieldHydrology::OFFSET_I[ d ];
+
+			if ( rx >= 0 && rx < w && ry >= 0 && ry < h )
+			{
+				accumulation[ size_t( i0 + ry ) * sizeJ + j0 + rx ] += accumulation[ g ];
+			}
+		}
+	}
+
+	if ( pExits != 0 )
+	{
+		// Find where the flow from each vertex leaves the tile by following the order backwards
+
+		vector< int >	exits( size_t( w ) * h, -1 );
+
+		for ( size_t k = order.size(); k-- > 0; )
+		{
+			int const			c	= order[ k ];
+			unsigned char const	d	= directions[ size_t( i0 + c / w ) * sizeJ + j0 + c % w ];
+
+			if ( d != HeightFieldHydrology::NO_FLOW )
+			{
+				int const	rx	= c % w + HeightFieldHydrology::OFFSET_J[ d ];
+				int const	ry	= c / w + HeightFieldHydrology::OFFSET_I[ d ];
+
+				exits[ c ] = ( rx >= 0 && rx < w && ry >= 0 && ry < h ) ? exits[ ry * w + rx ] : c;
+			}
+		}
+
+		for ( int k = 0; k < Tiling::GetPerimeterCount( w, h ); k++ )
+		{
+			int	x, y;
+
+			Tiling::GetPerimeterVertex( k, w, h, x, y );
+
+			int const	e	= exits[ y * w + x ];
+
+			pExits[ k ] = ( e >= 0 ) ? Tiling::GetPerimeterIndex( e % w, e / w, w, h ) : -1;
+		}
+	}
+}
+
+} // anonymous namespace
+
+
+int const	HeightFieldHydrology::OFFSET_J[ 8 ]	= { 1, 1, 0, -1, -1, -1, 0, 1 };
+int const	HeightFieldHydrology::OFFSET_I[ 8 ]	= { 0, 1, 1, 1, 0, -1, -1, -1 };
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! Depressions are filled to the level at which they spill, leaving flat areas. The algorithm is a parallel
+//! priority-flood: each tile is flooded from its edges independently, the lowest spill points between the
+//! watersheds found in the tiles are joined into a graph which is flooded from the edge of the heightfield, and
+//! then each tile is flooded again and raised to the level at which its watersheds spill.
+//!
+//! @param	hf	Heightfield to fill
+//!
+//! @exception	bad_alloc	Unable to allocate the graph of watersheds.
+
+void HeightFieldHydrology::FillDepressions( HeightField & hf )
+{
+	int const	sizeJ	= hf.GetSizeJ();
+	int const	sizeI	= hf.GetSizeI();
+
+	if ( sizeJ <= 0 || sizeI <= 0 )
+	{
+		return;
+	}
+
+	Tiling const	tiling( sizeJ, sizeI, FILL_TILE_SIZE );
+	int const		nTiles	= tiling.GetTileCount();
+
+	// Flood each tile, recording the labels of the vertexes on its edge and the spill points between its
+	// watersheds.
+
+	vector< int >					perimeterLabels( tiling.GetPerimeterCount() );
+	vector< int >					labelCounts( nTiles );
+	vector< vector< SpillEdge > >	tileEdges( nTiles );
+
+	Parallel::For( 0, nTiles, 1, [ & ]( int first, int last )
+	{
+		vector< float >	z;
+		vector< int >	labels;
+
+		for ( int t = first; t < last; t++ )
+		{
+			int	j0, i0, j1, i1;
+
+			tiling.GetTile( t, j0, i0, j1, i1 );
+			labelCounts[ t ] = FloodTile( hf, j0, i0, j1, i1, z, labels, &tileEdges[ t ] );
+
+			int const	w	= j1 - j0;
+			int const	h	= i1 - i0;
+			int * const	pLabels	= &perimeterLabels[ tiling.GetPerimeterBase( t ) ];
+
+			for ( int k = 0; k < Tiling::GetPerimeterCount( w, h ); k++ )
+			{
+				int	x, y;
+
+				Tiling::GetPerimeterVertex( k, w, h, x, y );
+				pLabels[ k ] = labels[ y * w + x ];
+			}
+		}
+	} );
+
+	// Number the watersheds of all the tiles. Watershed 0 is the edge of the heightfield.
+
+	vector< int >	labelBase( nTiles + 1, 1 );
+
+	for ( int t = 0; t < nTiles; t++ )
+	{
+		labelBase[ t + 1 ] = labelBase[ t ] + labelCounts[ t ];
+	}
+
+	auto const	getNode	= [ & ]( int t, int label ) { return ( label == OCEAN ) ? 0 : labelBase[ t ] + label - ( OCEAN + 1 ); };
+
+	// Connect the watersheds within each tile, and the ones on each side of the edges of the tiles. The vertexes
+	// on the edges of a tile are never raised by flooding it, so their heights are the original heights.
+
+	Parallel::For( 0, nTiles, 1, [ & ]( int first, int last )
+	{
+		for ( int t = first; t < last; t++ )
+		{
+			vector< SpillEdge > &	edges	= tileEdges[ t ];
+
+			for ( size_t k = 0; k < edges.size(); k++ )
+			{
+				edges[ k ].m_a = getNode( t, edges[ k ].m_a );
+				edges[ k ].m_b = getNode( t, edges[ k ].m_b );
+			}
+
+			int	j0, i0, j1, i1;
+
+			tiling.GetTile( t, j0, i0, j1, i1 );
+
+			int const	w	= j1 - j0;
+			int const	h	= i1 - i0;
+
+			for ( int k = 0; k < Tiling::GetPerimeterCount( w, h ); k++ )
+			{
+				int	x, y;
+
+				Tiling::GetPerimeterVertex( k, w, h, x, y );
+
+				int const	j	= j0 + x;
+				int const	i	= i0 + y;
+				int const	a	= getNode( t, perimeterLabels[ tiling.GetPerimeterBase( t ) + k ] );
+
+				for ( int d = 0; d < 8; d++ )
+				{
+					int const	nj	= j + OFFSET_J[ d ];
+					int const	ni	= i + OFFSET_I[ d ];
+
+					if ( nj < 0 || nj >= sizeJ || ni < 0 || ni >= sizeI || tiling.GetTileIndex( nj, ni ) <= t )
+					{
+						continue;
+					}
+
+					int const	nt	= tiling.GetTileIndex( nj, ni );
+					int const	b	= getNode( nt, perimeterLabels[ tiling.GetPerimeterNode( nj, ni ) ] );
+
+					if ( a != b )
+					{
+						SpillEdge const	e	= { a, b, max( hf.GetZ( j, i ), hf.GetZ( nj, ni ) ) };
+						edges.push_back( e );
+					}
+				}
+			}
+		}
+	} );
+
+	// Flood the graph of watersheds from the edge of the heightfield to find the level at which each one spills
+
+	int const		nNodes	= labelBase[ nTiles ];
+	vector< int >	adjacencyBase( nNodes + 1, 0 );
+
+	for ( int t = 0; t < nTiles; t++ )
+	{
+		for ( size_t k = 0; k < tileEdges[ t ].size(); k++ )
+		{
+			++adjacencyBase[ tileEdges[ t ][ k ].m_a + 1 ];
+			++adjacencyBase[ tileEdges[ t ][ k ].m_b + 1 ];
+		}
+	}
+
+	for ( int n = 0; n < nNodes; n++ )
+	{
+		adjacencyBase[ n + 1 ] += adjacencyBase[ n ];
+	}
+
+	vector< pair< int, float > >	adjacency( adjacencyBase[ nNodes ] );
+	vector< int >					cursor( adjacencyBase.begin(), adjacencyBase.end() - 1 );
+
+	for ( int t = 0; t < nTiles; t++ )
+	{
+		for ( size_t k = 0; k < tileEdges[ t ].size(); k++ )
+		{
+			SpillEdge const &	e	= tileEdges[ t ][ k ];
+
+			adjacency[ cursor[ e.m_a ]++ ] = make_pair( e.m_b, e.m_z );
+			adjacency[ cursor[ e.m_b ]++ ] = make_pair( e.m_a, e.m_z );
+		}
+
+		vector< SpillEdge >().swap( tileEdges[ t ] );
+	}
+
+	vector< float >	spill( nNodes, numeric_limits< float >::max() );
+	PriorityQueue	queue;
+
+	spill[ 0 ] = -numeric_limits< float >::max();
+	queue.push( QueueEntry( spill[ 0 ], 0 ) );
+
+	while ( !queue.empty() )
+	{
+		QueueEntry const	entry	= queue.top();
+
+		queue.pop();
+
+		if ( entry.first > spill[ entry.second ] )
+		{
+			continue;
+		}
+
+		for ( int k = adjacencyBase[ entry.second ]; k < adjacencyBase[ entry.second + 1 ]; k++ )
+		{
+			int const	n		= adjacency[ k ].first;
+			float const	level	= max( entry.first, adjacency[ k ].second );
+
+			if ( level < spill[ n ] )
+			{
+				spill[ n ] = level;
+				queue.push( QueueEntry( level, n ) );
+			}
+		}
+	}
+
+	// Flood each tile again (with the same results) and raise each watershed to its spill level
+
+	HeightFieldMutableView const	view	= hf.GetView();
+
+	Parallel::For( 0, nTiles, 1, [ & ]( int first, int last )
+	{
+		vector< float >	z;
+		vector< int >	labels;
+
+		for ( int t = first; t < last; t++ )
+		{
+			int	j0, i0, j1, i1;
+
+			tiling.GetTile( t, j0, i0, j1, i1 );
+			FloodTile( hf, j0, i0, j1, i1, z, labels, 0 );
+
+			int const	w	= j1 - j0;
+
+			for ( int y = 0; y < i1 - i0; y++ )
+			{
+				HeightField::Vertex * const	pRow	= view.GetData( j0, i0 + y );
+
+				for ( int x = 0; x < w; x++ )
+				{
+					pRow[ x ].m_Z = max( z[ y * w + x ], spill[ getNode( t, labels[ y * w + x ] ) ] );
+				}
+			}
+		}
+	} );
+
+	hf.UpdateApron();
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! Each vertex flows to the neighbor in the direction of steepest descent. Vertexes in flat areas flow towards
+//! the nearest vertex at the same height that drains (so the flat areas left by FillDepressions() drain), and the
+//! other vertexes with no lower neighbors have no direction. The directions never lead off the heightfield.
+//!
+//! @param	hf			Heightfield
+//! @param	directions	Receives the directions. The elements are stored in this order: <tt>[i][j]</tt>.
+//!
+//! @exception	bad_alloc	Unable to allocate the directions.
+
+void HeightFieldHydrology::ComputeD8( HeightField const & hf, vector< unsigned char > & directions )
+{
+	int const	sizeJ	= hf.GetSizeJ();
+	int const	sizeI	= hf.GetSizeI();
+
+	directions.resize( size_t( sizeJ ) * sizeI );
+
+	if ( directions.empty() )
+	{
+		return;
+	}
+
+	Parallel::For( 0, sizeI, ROW_BLOCK_SIZE, [ & ]( int first, int last )
+	{
+		for ( int i = first; i < last; i++ )
+		{
+			unsigned char * const	pRow	= &directions[ size_t( i ) * sizeJ ];
+
+			for ( int j = 0; j < sizeJ; j++ )
+			{
+				pRow[ j ] = FindSteepestDescent( hf, j, i );
+			}
+		}
+	} );
+
+	// Find the draining vertexes next to flat areas. Outlets on the edge drain off the heightfield.
+
+	int const					nBlocks	= ( sizeI + ROW_BLOCK_SIZE - 1 ) / ROW_BLOCK_SIZE;
+	vector< vector< size_t > >	seeds( nBlocks );
+
+	auto const	isFlat	= [ & ]( int j, int i )
+	{
+		return directions[ size_t( i ) * sizeJ + j ] == NO_FLOW && !IsOnEdge( j, i, sizeJ, sizeI );
+	};
+
+	Parallel::For( 0, nBlocks, 1, [ & ]( int first, int last )
+	{
+		for ( int b = first; b < last; b++ )
+		{
+			for ( int i = b * ROW_BLOCK_SIZE; i < min( ( b + 1 ) * ROW_BLOCK_SIZE, sizeI ); i++ )
+			{
+				for ( int j = 0; j < sizeJ; j++ )
+				{
+					if ( isFlat( j, i ) )
+					{
+						continue;
+					}
+
+					float const	z	= hf.GetZ( j, i );
+
+					for ( int d = 0; d < 8; d++ )
+					{
+						int const	nj	= j + OFFSET_J[ d ];
+						int const	ni	= i + OFFSET_I[ d ];
+
+						if ( nj >= 0 && nj < sizeJ && ni >= 0 && ni < sizeI && isFlat( nj, ni ) && hf.GetZ( nj, ni ) == z )
+						{
+							seeds[ b ].push_back( size_t( i ) * sizeJ + j );
+							break;
+						}
+					}
+				}
+			}
+		}
+	} );
+
+	// Drain the flat areas with a breadth-first search from the draining vertexes
+
+	vector< size_t >	queue;
+
+	for ( int b = 0; b < nBlocks; b++ )
+	{
+		queue.insert( queue.end(), seeds[ b ].begin(), seeds[ b ].end() );
+		vector< size_t >().swap( seeds[ b ] );
+	}
+
+	for ( size_t k = 0; k < queue.size(); k++ )
+	{
+		int const	j	= int( queue[ k ] % sizeJ );
+		int const	i	= int( queue[ k ] / sizeJ );
+		float const	z	= hf.GetZ( j, i );
+
+		for ( int d = 0; d < 8; d++ )
+		{
+			int const	nj	= j + OFFSET_J[ d ];
+			int const	ni	= i + OFFSET_I[ d ];
+
+			if ( nj >= 0 && nj < sizeJ && ni >= 0 && ni < sizeI && isFlat( nj, ni ) && hf.GetZ( nj, ni ) == z )
+			{
+				directions[ size_t( ni ) * sizeJ + nj ] = (unsigned char)( ( d + 4 ) % 8 );
+				queue.push_back( size_t( ni ) * sizeJ + nj );
+			}
+		}
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! The D-infinity method (Tarboton, 1997) lets flow go in any direction. The direction of a vertex is the
+//! direction of steepest descent over the 8 triangular facets formed with its neighbors. An angle is measured in
+//! radians from the J axis towards the I axis and is in [0, 2*pi). Vertexes in flat areas use the D8 direction
+//! found by ComputeD8(). Vertexes that do not flow anywhere have an angle of -1.
+//!
+//! @param	hf		Heightfield
+//! @param	angles	Receives the angles. The elements are stored in this order: <tt>[i][j]</tt>.
+//!
+//! @exception	bad_alloc	Unable to allocate the angles.
+
+void HeightFieldHydrology::ComputeDInfinity( HeightField const & hf, vector< float > & angles )
+{
+	// Each facet is formed by a cardinal neighbor (e1) and a diagonal neighbor (e2). The angle of the flow in the
+	// facet is ac * pi/2 + af * r, where r is the angle from e1 towards e2.
+
+	static int const	E1[ 8 ]	= { 0, 2, 2, 4, 4, 6, 6, 0 };
+	static int const	E2[ 8 ]	= { 1, 1, 3, 3, 5, 5, 7, 7 };
+	static int const	AC[ 8 ]	= { 0, 1, 1, 2, 2, 3, 3, 4 };
+	static int const	AF[ 8 ]	= { 1, -1, 1, -1, 1, -1, 1, -1 };
+
+	int const	sizeJ	= hf.GetSizeJ();
+	int const	sizeI	= hf.GetSizeI();
+
+	vector< unsigned char >	directions;
+
+	ComputeD8( hf, directions );
+	angles.resize( directions.size() );
+
+	Parallel::For( 0, sizeI, ROW_BLOCK_SIZE, [ & ]( int first, int last )
+	{
+		for ( int i = first; i < last; i++ )
+		{
+			for ( int j = 0; j < sizeJ; j++ )
+			{
+				float const	z		= hf.GetZ( j, i );
+				float		best	= 0.0f;
+				float		angle	= -1.0f;
+
+				for ( int f = 0; f < 8; f++ )
+				{
+					int const	j1	= j + OFFSET_J[ E1[ f ] ];
+					int const	i1	= i + OFFSET_I[ E1[ f ] ];
+					int const	j2	= j + OFFSET_J[ E2[ f ] ];
+					int const	i2	= i + OFFSET_I[ E2[ f ] ];
+
+					if ( j1 < 0 || j1 >= sizeJ || i1 < 0 || i1 >= sizeI || j2 < 0 || j2 >= sizeJ || i2 < 0 || i2 >= sizeI )
+					{
+						continue;
+					}
+
+					float const	z1	= hf.GetZ( j1, i1 );
+					float const	z2	= hf.GetZ( j2, i2 );
+					float const	s1	= z - z1;
+					float const	s2	= z1 - z2;
+					float		r	= atan2f( s2, s1 );
+					float		s;
+
+					if ( r < 0.0f )
+					{
+						r = 0.0f;
+						s = s1;
+					}
+					else if ( r > PI / 4.0f )
+					{
+						r = PI / 4.0f;
+						s = ( z - z2 ) * ( 1.0f / SQRT2 );
+					}
+					else
+					{
+						s = sqrtf( s1 * s1 + s2 * s2 );
+					}
+
+					if ( s > best )
+					{
+						best	= s;
+						angle	= float( AC[ f ] ) * ( PI / 2.0f ) + float( AF[ f ] ) * r;
+					}
+				}
+
+				size_t const	k	= size_t( i ) * sizeJ + j;
+
+				if ( angle < 0.0f && directions[ k ] != NO_FLOW )
+				{
+					angle = float( directions[ k ] ) * ( PI / 4.0f );
+				}
+				else if ( angle >= 2.0f * PI )
+				{
+					angle = 0.0f;
+				}
+
+				angles[ k ] = angle;
+			}
+		}
+	} );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! The flow accumulated at a vertex is the sum of the weights of the vertexes that flow through it, including
+//! itself. Each tile is processed in topological order in parallel. The flow leaving each tile is then passed
+//! between the tiles through the vertexes on their edges, and the tiles are processed again with the flow entering
+//! them.
+//!
+//! @param	sizeI			Size of the rasters along the I axis
+//! @param	sizeJ			Size of the rasters along the J axis
+//! @param	directions		D8 directions, such as those computed by ComputeD8(). They must not form cycles.
+//! @param	accumulation	Receives the accumulated flow. The elements are stored in this order: <tt>[i][j]</tt>.
+//! @param	pWeights		Weight of each vertex (such as rainfall), or 0 if each vertex has a weight of 1
+//!
+//! @exception	bad_alloc	Unable to allocate the accumulation.
+
+void HeightFieldHydrology::ComputeAccumulation( int							sizeI,
+												int							sizeJ,
+												vector< unsigned char > const &	directions,
+												vector< float > &			accumulation,
+												vector< float > const *		pWeights /*= 0*/ )
+{
+	assert( directions.size() == size_t( sizeI ) * sizeJ );
+	assert( pWeights == 0 || pWeights->size() == directions.size() );
+
+	accumulation.resize( directions.size() );
+
+	if ( accumulation.empty() )
+	{
+		return;
+	}
+
+	Tiling const	tiling( sizeJ, sizeI, FLOW_TILE_SIZE );
+	int const		nTiles		= tiling.GetTileCount();
+	int const		nPerimeter	= tiling.GetPerimeterCount();
+
+	// Accumulate within each tile and find where the flow from the edges of each tile leaves it
+
+	vector< int >	exits( nPerimeter );
+
+	Parallel::For( 0, nTiles, 1, [ & ]( int first, int last )
+	{
+		for ( int t = first; t < last; t++ )
+		{
+			int	j0, i0, j1, i1;
+
+			tiling.GetTile( t, j0, i0, j1, i1 );
+			AccumulateTile( sizeJ, j0, i0, j1, i1, directions, pWeights, 0, accumulation,
+							&exits[ tiling.GetPerimeterBase( t ) ] );
+		}
+	} );
+
+	// Build a graph of the vertexes on the edges of the tiles. A vertex where flow leaves its tile is connected to
+	// the vertex it flows to in the next tile. Any other vertex is connected to the vertex where its flow leaves
+	// its tile.
+
+	vector< int >		next( nPerimeter, -1 );
+	vector< char >		isExit( nPerimeter, 0 );
+	vector< float >		localFlow( nPerimeter, 0.0f );
+	vector< int >		inDegree( nPerimeter, 0 );
+
+	for ( int t = 0; t < nTiles; t++ )
+	{
+		int	j0, i0, j1, i1;
+
+		tiling.GetTile( t, j0, i0, j1, i1 );
+
+		int const	w		= j1 - j0;
+		int const	h		= i1 - i0;
+		int const	base	= tiling.GetPerimeterBase( t );
+
+		for ( int k = 0; k < Tiling::GetPerimeterCount( w, h ); k++ )
+		{
+			if ( exits[ base + k ] == k )
+			{
+				int	x, y;
+
+				Tiling::GetPerimeterVertex( k, w, h, x, y );
+
+				size_t const	g	= size_t( i0 + y ) * sizeJ + j0 + x;
+				int const		rj	= j0 + x + OFFSET_J[ directions[ g ] ];
+				int const		ri	= i0 + y + OFFSET_I[ directions[ g ] ];
+
+				assert( rj >= 0 && rj < sizeJ && ri >= 0 && ri < sizeI );
+
+				isExit[ base + k ]		= 1;
+				next[ base + k ]		= tiling.GetPerimeterNode( rj, ri );
+				localFlow[ base + k ]	= accumulation[ g ];
+			}
+			else if ( exits[ base + k ] >= 0 )
+			{
+				next[ base + k ] = base + exits[ base + k ];
+			}
+		}
+	}
+
+	vector< int >().swap( exits );
+
+	for ( int n = 0; n < nPerimeter; n++ )
+	{
+		if ( next[ n ] >= 0 )
+		{
+			++inDegree[ next[ n ] ];
+		}
+	}
+
+	// Pass the flow through the graph in topological order. The inflow of a vertex is the flow entering its tile
+	// there, and the flow passing through a vertex where flow leaves a tile also includes the inflow of the vertexes
+	// that drain through it.
+
+	vector< double >	inflow( nPerimeter, 0.0 );
+	vector< double >	passing( nPerimeter, 0.0 );
+	vector< int >		queue;
+
+	queue.reserve( nPerimeter );
+
+	for ( int n = 0; n < nPerimeter; n++ )
+	{
+		if ( inDegree[ n ] == 0 )
+		{
+			queue.push_back( n );
+		}
+	}
+
+	for ( size_t k = 0; k < queue.size(); k++ )
+	{
+		int const	n	= queue[ k ];
+
+		if ( next[ n ] < 0 )
+		{
+			continue;
+		}
+
+		if ( isExit[ n ] )
+		{
+			inflow[ next[ n ] ] += double( localFlow[ n ] ) + passing[ n ] + inflow[ n ];
+		}
+		else
+		{
+			passing[ next[ n ] ] += inflow[ n ];
+		}
+
+		if ( --inDegree[ next[ n ] ] == 0 )
+		{
+			queue.push_back( next[ n ] );
+		}
+	}
+
+	// Accumulate within each tile again, including the flow entering it
+
+	Parallel::For( 0, nTiles, 1, [ & ]( int first, int last )
+	{
+		for ( int t = first; t < last; t++ )
+		{
+			int	j0, i0, j1, i1;
+
+			tiling.GetTile( t, j0, i0, j1, i1 );
+			AccumulateTile( sizeJ, j0, i0, j1, i1, directions, pWeights, &inflow[ tiling.GetPerimeterBase( t ) ],
+							accumulation, 0 );
+		}
+	} );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! Every vertex drains to exactly one outlet, which is a vertex with no flow direction. The vertexes that drain
+//! to the same outlet form a watershed. Each tile finds the outlets within it in parallel, the outlets of the
+//! vertexes draining out of the tiles are found by following the flow between the tiles, and then the tiles are
+//! updated in parallel.
+//!
+//! @param	sizeI		Size of the rasters along the I axis
+//! @param	sizeJ		Size of the rasters along the J axis
+//! @param	directions	D8 directions, such as those computed by ComputeD8(). They must not form cycles.
+//! @param	outlets		Receives the index ( i * sizeJ + j ) of the outlet of each vertex. The elements are stored in
+//!						this order: <tt>[i][j]</tt>.
+//!
+//! @exception	bad_alloc	Unable to allocate the outlets.
+
+void HeightFieldHydrology::ComputeWatersheds( int								sizeI,
+											  int								sizeJ,
+											  vector< unsigned char > const &	directions,
+											  vector< unsigned > &				outlets )
+{
+	assert( directions.size() == size_t( sizeI ) * sizeJ );
+	assert( directions.size() <= size_t( numeric_limits< unsigned >::max() ) );
+
+	outlets.resize( directions.size() );
+
+	if ( outlets.empty() )
+	{
+		return;
+	}
+
+	Tiling const	tiling( sizeJ, sizeI, FLOW_TILE_SIZE );
+	int const		nTiles	= tiling.GetTileCount();
+
+	// Find where each vertex's flow ends within its tile: either at an outlet or where it leaves the tile
+
+	Parallel::For( 0, nTiles, 1, [ & ]( int first, int last )
+	{
+		vector< int >	order;
+
+		for ( int t = first; t < last; t++ )
+		{
+			int	j0, i0, j1, i1;
+
+			tiling.GetTile( t, j0, i0, j1, i1 );
+			SortTile( sizeJ, j0, i0, j1, i1, directions, order );
+
+			int const	w	= j1 - j0;
+			int const	h	= i1 - i0;
+
+			for ( size_t k = order.size(); k-- > 0; )
+			{
+				int const			x	= order[ k ] % w;
+				int const			y	= order[ k ] / w;
+				size_t const		g	= size_t( i0 + y ) * sizeJ + j0 + x;
+				unsigned char const	d	= directions[ g ];
+
+				outlets[ g ] = unsigned( g );
+
+				if ( d != NO_FLOW )
+				{
+					int const	rx	= x + OFFSET_J[ d ];
+					int const	ry	= y + OFFSET_I[ d ];
+
+					if ( rx >= 0 && rx < w && ry >= 0 && ry < h )
+					{
+						outlets[ g ] = outlets[ size_t( i0 + ry ) * sizeJ + j0 + rx ];
+					}
+				}
+			}
+		}
+	} );
+
+	// Follow the flow from each vertex where it leaves a tile to its outlet. The vertexes along the way are given
+	// the outlet so they are not followed again.
+
+	vector< size_t >	path;
+
+	for ( int t = 0; t < nTiles; t++ )
+	{
+		int	j0, i0, j1, i1;
+
+		tiling.GetTile( t, j0, i0, j1, i1 );
+
+		int const	w	= j1 - j0;
+		int const	h	= i1 - i0;
+
+		for ( int k = 0; k < Tiling::GetPerimeterCount( w, h ); k++ )
+		{
+			int	x, y;
+
+			Tiling::GetPerimeterVertex( k, w, h, x, y );
+
+			size_t	g	= size_t( i0 + y ) * sizeJ + j0 + x;
+
+			path.clear();
+
+			while ( directions[ g ] != NO_FLOW )
+			{
+				if ( outlets[ g ] != g )
+				{
+					g = outlets[ g ];
+				}
+				else
+				{
+					path.push_back( g );
+					g = outlets[ size_t( g / sizeJ + OFFSET_I[ directions[ g ] ] ) * sizeJ + g % sizeJ + OFFSET_J[ directions[ g ] ] ];
+				}
+			}
+
+			for ( size_t n = 0; n < path.size(); n++ )
+			{
+				outlets[ path[ n ] ] = unsigned( g );
+			}
+		}
+	}
+
+	// Give each vertex draining out of its tile the outlet of the vertex where it leaves
+
+	Parallel::For( 0, nTiles, 1, [ & ]( int first, int last )
+	{
+		for ( int t = first; t < last; t++ )
+		{
+			int	j0, i0, j1, i1;
+
+			tiling.GetTile( t, j0, i0, j1, i1 );
+
+			for ( int i = i0; i < i1; i++ )
+			{
+				for ( int j = j0; j < j1; j++ )
+				{
+					size_t const	g	= size_t( i ) * sizeJ + j;
+
+					if ( directions[ outlets[ g ] ] != NO_FLOW )
+					{
+						outlets[ g ] = outlets[ outlets[ g ] ];
+					}
+				}
+			}
+		}
+	} );
+}
@@ -0,0 +1,70 @@
+/** @file *//********************************************************************************************************
+
+                                                 HeightFieldHydrology.h
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/HeightFieldHydrology.h#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#pragma once
+
+#include <vector>
+
+class HeightField;
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! Flow analysis of a HeightField: depression filling, flow directions, flow accumulation and watersheds.
+//!
+//! Water flows from each vertex to one or more of its 8 neighbors and leaves the heightfield at its edges. A D8
+//! direction is a value in [0, 8) that selects the neighbor at ( OFFSET_J[ d ], OFFSET_I[ d ] ), which is at an
+//! azimuth of d * pi / 4 radians from the J axis towards the I axis. Rasters are stored in this order:
+//! <tt>[i][j]</tt>.
+//!
+//! Each analysis is done one tile at a time, in parallel, with a small sequential pass over the tiles' edges to
+//! connect them. Only a few tiles are in memory besides the inputs and outputs, so the analyses scale to very
+//! large heightfields.
+
+class HeightFieldHydrology
+{
+public:
+
+	//! D8 direction of a vertex that does not flow anywhere (a pit, or an outlet on the edge)
+	static unsigned char const	NO_FLOW	= 255;
+
+	//! Offset along the J axis of the neighbor in each D8 direction
+	static int const	OFFSET_J[ 8 ];
+
+	//! Offset along the I axis of the neighbor in each D8 direction
+	static int const	OFFSET_I[ 8 ];
+
+	//! Raises the heights in depressions so that every vertex drains to the edge.
+	static void FillDepressions( HeightField & hf );
+
+	//! Computes the D8 flow direction of each vertex.
+	static void ComputeD8( HeightField const & hf, std::vector< unsigned char > & directions );
+
+	//! Computes the D-infinity flow angle of each vertex.
+	static void ComputeDInfinity( HeightField const & hf, std::vector< float > & angles );
+
+	//! Computes the flow accumulated at each vertex from D8 flow directions.
+	static void ComputeAccumulation( int									sizeI,
+									 int									sizeJ,
+									 std::vector< unsigned char > const &	directions,
+									 std::vector< float > &					accumulation,
+									 std::vector< float > const *			pWeights	= 0 );
+
+	//! Determines the outlet that each vertex drains to from D8 flow directions.
+	static void ComputeWatersheds( int									sizeI,
+								   int									sizeJ,
+								   std::vector< unsigned char > const &	directions,
+								   std::vector< unsigned > &			outlets );
+};
@@ -0,0 +1,372 @@
+/** @file *//********************************************************************************************************
+
+                                                    HeightFieldJob.cpp
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/HeightFieldJob.cpp#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#include "PrecompiledHeaders.h"
+
+#include "HeightFieldJob.h"
+
+#include "HeightField.h"
+#include "Parallel.h"
+
+#include <chrono>
+
+using namespace std;
+
+
+namespace
+{
+
+typedef chrono::steady_clock	Clock;
+
+// Weight of the latest measurement in the estimated time per unit
+double const	MEASUREMENT_WEIGHT	= 0.5;
+
+// Returns the number of seconds between two times
+double GetSeconds( Clock::time_point start, Clock::time_point end )
+{
+	return chrono::duration< double >( end - start ).count();
+}
+
+} // anonymous namespace
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	seconds		Maximum time to spend
+//! @param	maxUnits	Maximum number of units to do
+
+HeightFieldJob::Budget::Budget( double seconds, int maxUnits /*= std::numeric_limits< int >::max()*/ )
+	: m_Seconds( seconds ),
+	m_MaxUnits( maxUnits )
+{
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	unitCount	Number of units of work
+//! @param	priority	Priority of the job
+
+HeightFieldJob::HeightFieldJob( int unitCount, int priority )
+	: m_unitCount( unitCount ),
+	m_completed( 0 ),
+	m_priority( priority ),
+	m_finished( false ),
+	m_secondsPerUnit( 0.0 ),
+	m_lastSliceUnits( 0 ),
+	m_cancelled( false )
+{
+	assert( unitCount >= 0 );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! The work is done in chunks. The size of each chunk is the number of units expected to fit in the remaining
+//! time, based on the time measured for previous chunks, but it at most doubles from one chunk to the next so that
+//! a poor estimate does not overrun the budget by much.
+//!
+//! @param	budget	Limits on the work done by this call
+//!
+//! @return		true if the job is done or cancelled
+
+bool HeightFieldJob::Run( Budget const & budget )
+{
+	Clock::time_point const	start	= Clock::now();
+	int						done	= 0;
+
+	while ( m_completed < m_unitCount && !m_cancelled )
+	{
+		double const	remaining	= budget.m_Seconds - GetSeconds( start, Clock::now() );
+		int				chunk		= 1;
+
+		if ( m_secondsPerUnit > 0.0 && remaining > m_secondsPerUnit )
+		{
+			chunk = int( min( remaining / m_secondsPerUnit, double( m_unitCount ) ) );
+		}
+
+		chunk = max( min( chunk, 2 * max( m_lastSliceUnits, 1 ) ), 1 );
+		chunk = min( chunk, m_unitCount - m_completed );
+		chunk = min( chunk, max( budget.m_MaxUnits - done, 1 ) );
+
+		Clock::time_point const	chunkStart	= Clock::now();
+
+		DoWork( m_completed, m_completed + chunk );
+
+		double const	seconds	= GetSeconds( chunkStart, Clock::now() ) / chunk;
+
+		m_secondsPerUnit	= ( m_secondsPerUnit > 0.0 ) ? m_secondsPerUnit + ( seconds - m_secondsPerUnit ) * MEASUREMENT_WEIGHT : seconds;
+		m_lastSliceUnits	= chunk;
+		m_completed			+= chunk;
+		done				+= chunk;
+
+		if ( done >= budget.m_MaxUnits || GetSeconds( start, Clock::now() ) >= budget.m_Seconds )
+		{
+			break;
+		}
+	}
+
+	if ( m_completed == m_unitCount && !m_finished && !m_cancelled )
+	{
+		Finish();
+		m_finished = true;
+	}
+
+	return GetState() != STATE_PENDING;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//!
+//! @return		The state of the job. A job that is cancelled after it is done remains done.
+
+HeightFieldJob::State HeightFieldJob::GetState() const
+{
+	if ( m_finished )
+	{
+		return STATE_DONE;
+	}
+	else if ( m_cancelled )
+	{
+		return STATE_CANCELLED;
+	}
+	else
+	{
+		return STATE_PENDING;
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//!
+//! @return		The fraction of the units that have been done, in [0, 1]
+
+float HeightFieldJob::GetProgress() const
+{
+	return ( m_unitCount > 0 ) ? float( m_completed ) / float( m_unitCount ) : 1.0f;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	pJob	Job to add. The queue keeps a reference until the job is no longer pending.
+
+void HeightFieldJobQueue::Add( shared_ptr< HeightFieldJob > const & pJob )
+{
+	m_jobs.push_back( pJob );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! The pending job with the highest priority is run with whatever remains of the budget. Jobs with the same
+//! priority are run in the order they were added. Jobs that are no longer pending are removed.
+//!
+//! @param	budget	Limits on the work done by this call
+//!
+//! @return		The number of jobs that are still pending
+
+int HeightFieldJobQueue::Run( HeightFieldJob::Budget const & budget )
+{
+	Clock::time_point const	start	= Clock::now();
+	int						done	= 0;
+
+	while ( true )
+	{
+		// Remove the jobs that are done or cancelled, and find the one with the highest priority
+
+		int	best	= -1;
+
+		for ( int k = 0; k < int( m_jobs.size() ); k++ )
+		{
+			if ( m_jobs[ k ]->GetState() != HeightFieldJob::STATE_PENDING )
+			{
+				m_jobs.erase( m_jobs.begin() + k );
+				--k;
+			}
+			else if ( best < 0 || m_jobs[ k ]->GetPriority() > m_jobs[ best ]->GetPriority() )
+			{
+				best = k;
+			}
+		}
+
+		double const	remaining	= budget.m_Seconds - GetSeconds( start, Clock::now() );
+
+		if ( best < 0 || remaining <= 0.0 || done >= budget.m_MaxUnits )
+		{
+			break;
+		}
+
+		HeightFieldJob &	job		= *m_jobs[ best ];
+		int const			before	= job.GetCompletedUnits();
+
+		job.Run( HeightFieldJob::Budget( remaining, budget.m_MaxUnits - done ) );
+
+		done += job.GetCompletedUnits() - before;
+	}
+
+	return int( m_jobs.size() );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+void HeightFieldJobQueue::CancelAll()
+{
+	for ( size_t k = 0; k < m_jobs.size(); k++ )
+	{
+		m_jobs[ k ]->Cancel();
+	}
+
+	m_jobs.clear();
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	hf			Heightfield. It must not change or be destroyed while the job is pending.
+//! @param	spacing		Horizontal distance between adjacent vertexes
+//! @param	priority	Priority of the job
+//!
+//! @exception	bad_alloc	Unable to allocate the normals.
+
+HeightFieldNormalsJob::HeightFieldNormalsJob( HeightField const & hf, float spacing, int priority /*= 0*/ )
+	: HeightFieldJob( hf.GetSizeI(), priority ),
+	m_hf( hf ),
+	m_spacing( spacing ),
+	m_normals( size_t( hf.GetSizeI() ) * hf.GetSizeJ() * 3 )
+{
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+void HeightFieldNormalsJob::DoWork( int first, int last )
+{
+	int const	sizeI	= m_hf.GetSizeI();
+	int const	sizeJ	= m_hf.GetSizeJ();
+
+	Parallel::For( first, last, 1, [ & ]( int firstRow, int lastRow )
+	{
+		for ( int i = firstRow; i < lastRow; i++ )
+		{
+			int const		i0		= max( i - 1, 0 );
+			int const		i1		= min( i + 1, sizeI - 1 );
+			float * const	pNormal	= &m_normals[ size_t( i ) * sizeJ * 3 ];
+
+			for ( int j = 0; j < sizeJ; j++ )
+			{
+				int const	j0	= max( j - 1, 0 );
+				int const	j1	= min( j + 1, sizeJ - 1 );
+
+				float const	dzdj	= ( j1 > j0 ) ? ( m_hf.GetZ( j1, i ) - m_hf.GetZ( j0, i ) ) / ( float( j1 - j0 ) * m_spacing ) : 0.0f;
+				float const	dzdi	= ( i1 > i0 ) ? ( m_hf.GetZ( j, i1 ) - m_hf.GetZ( j, i0 ) ) / ( float( i1 - i0 ) * m_spacing ) : 0.0f;
+				float const	scale	= 1.0f / sqrtf( dzdj * dzdj + dzdi * dzdi + 1.0f );
+
+				pNormal[ j * 3 + 0 ] = -dzdj * scale;
+				pNormal[ j * 3 + 1 ] = -dzdi * scale;
+				pNormal[ j * 3 + 2 ] = scale;
+			}
+		}
+	} );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	hf			Heightfield. It must not change or be destroyed while the job is pending.
+//! @param	blockSize	Number of cells in a block along each axis
+//! @param	priority	Priority of the job
+//!
+//! @exception	bad_alloc	Unable to allocate the bounds.
+
+HeightFieldBoundsJob::HeightFieldBoundsJob( HeightField const & hf, int blockSize, int priority /*= 0*/ )
+	: HeightFieldJob( max( ( hf.GetSizeI() - 1 + blockSize - 1 ) / blockSize, ( hf.GetSizeI() > 0 ) ? 1 : 0 ), priority ),
+	m_hf( hf ),
+	m_blockSize( blockSize ),
+	m_blocksJ( max( ( hf.GetSizeJ() - 1 + blockSize - 1 ) / blockSize, ( hf.GetSizeJ() > 0 ) ? 1 : 0 ) ),
+	m_minZ( size_t( GetUnitCount() ) * m_blocksJ ),
+	m_maxZ( size_t( GetUnitCount() ) * m_blocksJ )
+{
+	assert( blockSize > 0 );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+void HeightFieldBoundsJob::DoWork( int first, int last )
+{
+	int const	n	= ( last - first ) * m_blocksJ;
+
+	Parallel::For( 0, n, 1, [ & ]( int firstBlock, int lastBlock )
+	{
+		for ( int k = firstBlock; k < lastBlock; k++ )
+		{
+			int const	y	= first + k / m_blocksJ;
+			int const	x	= k % m_blocksJ;
+			int const	j	= x * m_blockSize;
+			int const	i	= y * m_blockSize;
+			int const	sj	= min( m_blockSize + 1, m_hf.GetSizeJ() - j );
+			int const	si	= min( m_blockSize + 1, m_hf.GetSizeI() - i );
+
+			m_minZ[ size_t( y ) * m_blocksJ + x ] = m_hf.GetMinZ( j, i, sj, si );
+			m_maxZ[ size_t( y ) * m_blocksJ + x ] = m_hf.GetMaxZ( j, i, sj, si );
+		}
+	} );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	unitCount	Number of units of work
+//! @param	work		Called to do each chunk of units, in order
+//! @param	finish		Called after the last unit, if not empty
+//! @param	priority	Priority of the job
+
+HeightFieldFunctionJob::HeightFieldFunctionJob( int						unitCount,
+												WorkFunction const &	work,
+												FinishFunction const &	finish /*= FinishFunction()*/,
+												int						priority /*= 0*/ )
+	: HeightFieldJob( unitCount, priority ),
+	m_work( work ),
+	m_finish( finish )
+{
+}
@@ -0,0 +1,258 @@
+/** @file *//********************************************************************************************************
+
+                                                     HeightFieldJob.h
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/HeightFieldJob.h#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <vector>
+
+class HeightField;
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! A bulk operation that is done a slice at a time, so that it can be spread over several frames.
+//!
+//! The work is divided into a fixed number of units (usually rows). Each call to Run() does as many units as fit
+//! in its budget and then returns, and the next call continues where it left off. The number of units done in a
+//! slice is chosen from the measured time per unit. Each slice does at least one unit, so a job always finishes
+//! eventually. The units are done in order, so the results of the units that have been done can be used before the
+//! job finishes.
+//!
+//! @note	Cancel() may be called by any thread. The other functions must not be called at the same time as Run().
+
+class HeightFieldJob
+{
+public:
+
+	//! The amount of work that a slice may do
+	struct Budget
+	{
+		//! Constructor
+		explicit Budget( double seconds, int maxUnits = std::numeric_limits< int >::max() );
+
+		double	m_Seconds;		//!< Maximum time to spend
+		int		m_MaxUnits;		//!< Maximum number of units to do
+	};
+
+	//! State of a job
+	enum State
+	{
+		STATE_PENDING,		//!< Not finished
+		STATE_DONE,			//!< All of the work has been done
+		STATE_CANCELLED		//!< Cancelled before all of the work was done
+	};
+
+	//! Destructor
+	virtual ~HeightFieldJob() {}
+
+	//! Does a slice of the work. Returns true if the job is no longer pending.
+	bool Run( Budget const & budget );
+
+	//! Stops the job at the end of the current slice.
+	void Cancel()								{ m_cancelled = true; }
+
+	//! Returns the state of the job.
+	State GetState() const;
+
+	//! Returns the priority of the job. Jobs with higher priorities are run first by a HeightFieldJobQueue.
+	int GetPriority() const						{ return m_priority; }
+
+	//! Sets the priority of the job.
+	void SetPriority( int priority )			{ m_priority = priority; }
+
+	//! Returns the number of units of work.
+	int GetUnitCount() const					{ return m_unitCount; }
+
+	//! Returns the number of units that have been done.
+	int GetCompletedUnits() const				{ return m_completed; }
+
+	//! Returns the fraction of the work that has been done.
+	float GetProgress() const;
+
+protected:
+
+	//! Constructor
+	HeightFieldJob( int unitCount, int priority );
+
+	//! Does units [ @a first, @a last ) of the work.
+	virtual void DoWork( int first, int last ) = 0;
+
+	//! Called after the last unit has been done.
+	virtual void Finish() {}
+
+private:
+
+	int					m_unitCount;		//!< Number of units of work
+	int					m_completed;		//!< Number of units done so far
+	int					m_priority;			//!< Priority
+	bool				m_finished;			//!< True if Finish() has been called
+	double				m_secondsPerUnit;	//!< Measured time per unit, or 0 if not measured yet
+	int					m_lastSliceUnits;	//!< Number of units done in the last slice
+	std::atomic< bool >	m_cancelled;		//!< True if the job has been cancelled
+};
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! Runs the highest-priority jobs in a set within a budget.
+//!
+//! A typical use is to call Run() once per frame with the time that can be spared in that frame.
+
+class HeightFieldJobQueue
+{
+public:
+
+	//! Adds a job to the queue.
+	void Add( std::shared_ptr< HeightFieldJob > const & pJob );
+
+	//! Runs jobs until the budget is used up or there are no pending jobs. Returns the number of pending jobs.
+	int Run( HeightFieldJob::Budget const & budget );
+
+	//! Cancels all of the jobs and removes them from the queue.
+	void CancelAll();
+
+	//! Returns the number of jobs in the queue.
+	int GetJobCount() const		{ return int( m_jobs.size() ); }
+
+private:
+
+	std::vector< std::shared_ptr< HeightFieldJob > >	m_jobs;		//!< Jobs that have not finished, in the order added
+};
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! Computes the unit normal of each vertex of a HeightField, a row at a time.
+//!
+//! The normals are computed from central differences (one-sided on the edges). The X axis is along J, Y is along
+//! I, and Z is up. The rows before GetCompletedRows() can be used while the job is pending.
+//!
+//! @note	The heightfield must not change or be destroyed while the job is pending.
+
+class HeightFieldNormalsJob : public HeightFieldJob
+{
+public:
+
+	//! Constructor
+	HeightFieldNormalsJob( HeightField const & hf, float spacing, int priority = 0 );
+
+	//! Returns the normals. Each normal is 3 floats (x, y, z), and they are stored in this order: <tt>[i][j]</tt>.
+	std::vector< float > const & GetNormals() const		{ return m_normals; }
+
+	//! Returns the number of rows whose normals have been computed.
+	int GetCompletedRows() const						{ return GetCompletedUnits(); }
+
+protected:
+
+	// Computes the normals of rows [ first, last )
+	virtual void DoWork( int first, int last );
+
+private:
+
+	HeightField const &		m_hf;		//!< Heightfield
+	float					m_spacing;	//!< Horizontal distance between adjacent vertexes
+	std::vector< float >	m_normals;	//!< Normals
+};
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! Computes the bounds of the heights in square blocks of a HeightField, a row of blocks at a time.
+//!
+//! Block ( x, y ) covers the cells from ( x * blockSize, y * blockSize ) to ( ( x + 1 ) * blockSize,
+//! ( y + 1 ) * blockSize ), including the vertexes on all of its edges, so adjacent blocks share their edges. These
+//! are the bounds needed for culling terrain chunks. The rows of blocks before GetCompletedRows() can be used while
+//! the job is pending.
+//!
+//! @note	The heightfield must not change or be destroyed while the job is pending.
+
+class HeightFieldBoundsJob : public HeightFieldJob
+{
+public:
+
+	//! Constructor
+	HeightFieldBoundsJob( HeightField const & hf, int blockSize, int priority = 0 );
+
+	//! Returns the number of blocks along the I axis.
+	int GetBlocksI() const						{ return GetUnitCount(); }
+
+	//! Returns the number of blocks along the J axis.
+	int GetBlocksJ() const						{ return m_blocksJ; }
+
+	//! Returns the lowest height in each block. They are stored in this order: <tt>[y][x]</tt>.
+	std::vector< float > const & GetMinZ() const	{ return m_minZ; }
+
+	//! Returns the highest height in each block. They are stored in this order: <tt>[y][x]</tt>.
+	std::vector< float > const & GetMaxZ() const	{ return m_maxZ; }
+
+	//! Returns the number of rows of blocks whose bounds have been computed.
+	int GetCompletedRows() const				{ return GetCompletedUnits(); }
+
+protected:
+
+	// Computes the bounds of rows of blocks [ first, last )
+	virtual void DoWork( int first, int last );
+
+private:
+
+	HeightField const &		m_hf;			//!< Heightfield
+	int						m_blockSize;	//!< Number of cells in a block along each axis
+	int						m_blocksJ;		//!< Number of blocks along the J axis
+	std::vector< float >	m_minZ;			//!< Lowest height in each block
+	std::vector< float >	m_maxZ;			//!< Highest height in each block
+};
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! A job that calls a function to do its work, for spreading any bulk operation (such as building a mesh) over
+//! several frames.
+
+class HeightFieldFunctionJob : public HeightFieldJob
+{
+public:
+
+	//! Does units [ first, last ) of the work
+	typedef std::function< void ( int first, int last ) >	WorkFunction;
+
+	//! Called after the last unit
+	typedef std::function< void () >						FinishFunction;
+
+	//! Constructor
+	HeightFieldFunctionJob( int unitCount, WorkFunction const & work, FinishFunction const & finish = FinishFunction(),
+							int priority = 0 );
+
+protected:
+
+	virtual void DoWork( int first, int last )		{ m_work( first, last ); }
+	virtual void Finish()							{ if ( m_finish ) m_finish(); }
+
+private:
+
+	WorkFunction	m_work;		//!< Does the work
+	FinishFunction	m_finish;	//!< Called after the last unit, or empty
+};
@@ -0,0 +1,536 @@
+/** @file *//********************************************************************************************************
+
+                                                 HeightFieldJournal.cpp
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/HeightFieldJournal.cpp#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#include "PrecompiledHeaders.h"
+
+#include "HeightFieldJournal.h"
+
+#include "HeightField.h"
+#include "HeightFieldView.h"
+
+#include <cstring>
+#include <ostream>
+
+using namespace std;
+
+
+namespace
+{
+
+// Number of heights in a block of a delta. 32 heights of any width fill a whole number of bytes.
+int const	DELTA_BLOCK_SIZE	= 32;
+
+// Returns the bits of a float
+inline unsigned GetBits( float z )
+{
+	unsigned	bits;
+
+	memcpy( &bits, &z, sizeof( bits ) );
+	return bits;
+}
+
+// Returns the float with the given bits
+inline float GetFloat( unsigned bits )
+{
+	float	z;
+
+	memcpy( &z, &bits, sizeof( z ) );
+	return z;
+}
+
+// Returns the number of bits needed to hold a value
+inline int GetWidth( unsigned x )
+{
+	int	width	= 0;
+
+	while ( x != 0 )
+	{
+		x >>= 1;
+		++width;
+	}
+
+	return width;
+}
+
+// Bit-packs the XORs of a delta. Each block is a byte containing the width of the values, followed by the values,
+// least significant bit first.
+void Pack( vector< unsigned > const & xors, vector< unsigned char > & delta )
+{
+	delta.clear();
+
+	for ( size_t b = 0; b < xors.size(); b += DELTA_BLOCK_SIZE )
+	{
+		size_t const	end		= min( b + DELTA_BLOCK_SIZE, xors.size() );
+		unsigned		all		= 0;
+
+		for ( size_t k = b; k < end; k++ )
+		{
+			all |= xors[ k ];
+		}
+
+		int const	width	= GetWidth( all );
+
+		delta.push_back( (unsigned char)width );
+
+		unsigned long long	buffer	= 0;
+		int					nBits	= 0;
+
+		for ( size_t k = b; k < b + DELTA_BLOCK_SIZE; k++ )
+		{
+			buffer	|= (unsigned long long)( ( k < end ) ? xors[ k ] : 0 ) << nBits;
+			nBits	+= width;
+
+			while ( nBits >= 8 )
+			{
+				delta.push_back( (unsigned char)buffer );
+				buffer	>>= 8;
+				nBits	-= 8;
+			}
+		}
+	}
+}
+
+// Unpacks the XORs of a delta. Returns false if the delta is malformed.
+bool Unpack( vector< unsigned char > const & delta, size_t n, vector< unsigned > & xors )
+{
+	xors.resize( n );
+
+	size_t	p	= 0;
+
+	for ( size_t b = 0; b < n; b += DELTA_BLOCK_SIZE )
+	{
+		if ( p >= delta.size() || delta[ p ] > 32 || delta.size() - p - 1 < size_t( delta[ p ] ) * DELTA_BLOCK_SIZE / 8 )
+		{
+			return false;
+		}
+
+		int const			width	= delta[ p++ ];
+		unsigned long long	buffer	= 0;
+		int					nBits	= 0;
+
+		for ( size_t k = b; k < b + DELTA_BLOCK_SIZE; k++ )
+		{
+			while ( nBits < width )
+			{
+				buffer	|= (unsigned long long)delta[ p++ ] << nBits;
+				nBits	+= 8;
+			}
+
+			unsigned const	x	= unsigned( buffer & ( ( 1ull << width ) - 1 ) );
+
+			buffer	>>= width;
+			nBits	-= width;
+
+			if ( k < n )
+			{
+				xors[ k ] = x;
+			}
+		}
+	}
+
+	return p == delta.size();
+}
+
+// Writes an integer in little-endian order
+void WriteInteger( ostream & stream, unsigned long long x, int nBytes )
+{
+	char	bytes[ 8 ];
+
+	for ( int k = 0; k < nBytes; k++ )
+	{
+		bytes[ k ] = char( x >> ( k * 8 ) );
+	}
+
+	stream.write( bytes, nBytes );
+}
+
+// Reads an integer in little-endian order
+unsigned long long ReadInteger( istream & stream, int nBytes )
+{
+	unsigned char		bytes[ 8 ];
+	unsigned long long	x	= 0;
+
+	stream.read( reinterpret_cast< char * >( bytes ), nBytes );
+
+	for ( int k = 0; k < nBytes && stream; k++ )
+	{
+		x |= (unsigned long long)bytes[ k ] << ( k * 8 );
+	}
+
+	return x;
+}
+
+} // anonymous namespace
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	hf	Heightfield to be edited. It must outlive the journal.
+
+HeightFieldJournal::HeightFieldJournal( HeightField & hf )
+	: m_hf( hf ),
+	m_firstSequence( 0 ),
+	m_editing( false ),
+	m_j( 0 ),
+	m_i( 0 ),
+	m_sizeJ( 0 ),
+	m_sizeI( 0 )
+{
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	j,i		Location of the rectangle
+//! @param	sj,si	Size of the rectangle. The rectangle must be within the heightfield.
+//!
+//! @exception	bad_alloc	Unable to allocate a copy of the rectangle.
+
+void HeightFieldJournal::Begin( int j, int i, int sj, int si )
+{
+	assert( !m_editing );
+	assert( j >= 0 && i >= 0 && sj >= 0 && si >= 0 );
+	assert( j + sj <= m_hf.GetSizeJ() && i + si <= m_hf.GetSizeI() );
+
+	m_j			= j;
+	m_i			= i;
+	m_sizeJ		= sj;
+	m_sizeI		= si;
+	m_editing	= true;
+
+	m_before.resize( size_t( sj ) * si );
+
+	for ( int y = 0; y < si; y++ )
+	{
+		for ( int x = 0; x < sj; x++ )
+		{
+			m_before[ size_t( y ) * sj + x ] = m_hf.GetZ( j + x, i + y );
+		}
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! The edit can be undone, and anything that was undone can no longer be redone.
+//!
+//! @exception	bad_alloc	Unable to allocate the entry.
+
+void HeightFieldJournal::Commit()
+{
+	assert( m_editing );
+
+	vector< unsigned >	xors( m_before.size() );
+
+	for ( int y = 0; y < m_sizeI; y++ )
+	{
+		for ( int x = 0; x < m_sizeJ; x++ )
+		{
+			size_t const	k	= size_t( y ) * m_sizeJ + x;
+
+			xors[ k ] = GetBits( m_before[ k ] ) ^ GetBits( m_hf.GetZ( m_j + x, m_i + y ) );
+		}
+	}
+
+	Entry	entry;
+
+	entry.m_sequence	= GetNextSequence();
+	entry.m_j			= m_j;
+	entry.m_i			= m_i;
+	entry.m_sizeJ		= m_sizeJ;
+	entry.m_sizeI		= m_sizeI;
+	Pack( xors, entry.m_delta );
+
+	m_entries.push_back( entry );
+	m_undo.push_back( m_entries.size() - 1 );
+	m_redo.clear();
+	m_editing = false;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+void HeightFieldJournal::Rollback()
+{
+	assert( m_editing );
+
+	HeightFieldMutableView const	view	= m_hf.GetView();
+
+	for ( int y = 0; y < m_sizeI; y++ )
+	{
+		for ( int x = 0; x < m_sizeJ; x++ )
+		{
+			view.GetData( m_j + x, m_i + y )->m_Z = m_before[ size_t( y ) * m_sizeJ + x ];
+		}
+	}
+
+	m_hf.UpdateApron();
+	m_editing = false;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! The changes made by the undo are appended to the journal as a new entry.
+//!
+//! @return		false, if there is nothing to undo
+//!
+//! @exception	bad_alloc	Unable to allocate the entry.
+
+bool HeightFieldJournal::Undo()
+{
+	assert( !m_editing );
+
+	if ( m_undo.empty() )
+	{
+		return false;
+	}
+
+	size_t const	k	= m_undo.back();
+
+	Replay( k );
+	m_undo.pop_back();
+	m_redo.push_back( k );
+
+	return true;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! The changes made by the redo are appended to the journal as a new entry.
+//!
+//! @return		false, if there is nothing to redo
+//!
+//! @exception	bad_alloc	Unable to allocate the entry.
+
+bool HeightFieldJournal::Redo()
+{
+	assert( !m_editing );
+
+	if ( m_redo.empty() )
+	{
+		return false;
+	}
+
+	size_t const	k	= m_redo.back();
+
+	Replay( k );
+	m_redo.pop_back();
+	m_undo.push_back( k );
+
+	return true;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! Each entry is written as its sequence number (8 bytes), the location and size of its rectangle (4 bytes each),
+//! the size of its delta (4 bytes), and the delta. Integers are little-endian. Writing the new entries after each
+//! edit to the end of a file or a connection keeps the other end up to date.
+//!
+//! @param	stream	Stream to write to
+//! @param	first	Sequence number of the first entry to write. Entries that have been discarded are not written.
+
+void HeightFieldJournal::Write( ostream & stream, unsigned long long first ) const
+{
+	size_t const	start	= ( first > m_firstSequence ) ? size_t( first - m_firstSequence ) : 0;
+
+	for ( size_t k = start; k < m_entries.size(); k++ )
+	{
+		Entry const &	entry	= m_entries[ k ];
+
+		WriteInteger( stream, entry.m_sequence, 8 );
+		WriteInteger( stream, unsigned( entry.m_j ), 4 );
+		WriteInteger( stream, unsigned( entry.m_i ), 4 );
+		WriteInteger( stream, unsigned( entry.m_sizeJ ), 4 );
+		WriteInteger( stream, unsigned( entry.m_sizeI ), 4 );
+		WriteInteger( stream, entry.m_delta.size(), 4 );
+
+		if ( !entry.m_delta.empty() )
+		{
+			stream.write( reinterpret_cast< char const * >( &entry.m_delta[ 0 ] ), entry.m_delta.size() );
+		}
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! Sequence numbers continue from the last entry.
+
+void HeightFieldJournal::Clear()
+{
+	assert( !m_editing );
+
+	m_firstSequence = GetNextSequence();
+	m_entries.clear();
+	m_undo.clear();
+	m_redo.clear();
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! The entries are read until the end of the stream. Entries before @a next have already been applied and are
+//! skipped, so a stream can be applied again after more entries have been appended to it. The heightfield must be
+//! in the state it was in when entry @a next was recorded.
+//!
+//! @param	stream	Stream written by Write()
+//! @param	hf		Heightfield to apply the entries to
+//! @param	next	Sequence number of the next entry to apply. On return, it is the sequence number after the last
+//!					entry applied.
+//!
+//! @return		false, if an entry is malformed, does not fit the heightfield, or is missing (its sequence number is
+//!				skipped). The stream's @c failbit is set, and the entries before it have been applied.
+//!
+//! @exception	bad_alloc	Unable to allocate an entry.
+
+bool HeightFieldJournal::Apply( istream & stream, HeightField & hf, unsigned long long & next )
+{
+	HeightFieldMutableView const	view	= hf.GetView();
+
+	if ( !stream )
+	{
+		return false;
+	}
+
+	while ( stream.peek() != istream::traits_type::eof() )
+	{
+		Entry	entry;
+
+		entry.m_sequence	= ReadInteger( stream, 8 );
+		entry.m_j			= int( ReadInteger( stream, 4 ) );
+		entry.m_i			= int( ReadInteger( stream, 4 ) );
+		entry.m_sizeJ		= int( ReadInteger( stream, 4 ) );
+		entry.m_sizeI		= int( ReadInteger( stream, 4 ) );
+
+		size_t const	size	= size_t( ReadInteger( stream, 4 ) );
+		size_t const	n		= size_t( max( entry.m_sizeJ, 0 ) ) * size_t( max( entry.m_sizeI, 0 ) );
+		size_t const	maxSize	= ( n + DELTA_BLOCK_SIZE - 1 ) / DELTA_BLOCK_SIZE * ( 1 + DELTA_BLOCK_SIZE * 4 );
+
+		if ( !stream ||
+			 entry.m_j < 0 || entry.m_i < 0 || entry.m_sizeJ < 0 || entry.m_sizeI < 0 ||
+			 entry.m_j > view.GetSizeJ() - entry.m_sizeJ || entry.m_i > view.GetSizeI() - entry.m_sizeI ||
+			 size > maxSize || entry.m_sequence > next )
+		{
+			stream.setstate( ios::failbit );
+			hf.UpdateApron();
+			return false;
+		}
+
+		entry.m_delta.resize( size );
+
+		if ( size > 0 )
+		{
+			stream.read( reinterpret_cast< char * >( &entry.m_delta[ 0 ] ), size );
+		}
+
+		if ( !stream )
+		{
+			hf.UpdateApron();
+			return false;
+		}
+
+		if ( entry.m_sequence < next )
+		{
+			continue;
+		}
+
+		if ( !ApplyDelta( entry, view ) )
+		{
+			stream.setstate( ios::failbit );
+			hf.UpdateApron();
+			return false;
+		}
+
+		++next;
+	}
+
+	hf.UpdateApron();
+
+	return true;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+bool HeightFieldJournal::ApplyDelta( Entry const & entry, HeightFieldMutableView const & view )
+{
+	size_t const		n	= size_t( entry.m_sizeJ ) * entry.m_sizeI;
+	vector< unsigned >	xors;
+
+	if ( !Unpack( entry.m_delta, n, xors ) )
+	{
+		return false;
+	}
+
+	if ( n == 0 )
+	{
+		return true;
+	}
+
+	for ( int y = 0; y < entry.m_sizeI; y++ )
+	{
+		HeightField::Vertex * const	pRow	= view.GetData( entry.m_j, entry.m_i + y );
+		unsigned const *			pXor	= &xors[ size_t( y ) * entry.m_sizeJ ];
+
+		for ( int x = 0; x < entry.m_sizeJ; x++ )
+		{
+			pRow[ x ].m_Z = GetFloat( GetBits( pRow[ x ].m_Z ) ^ pXor[ x ] );
+		}
+	}
+
+	return true;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+void HeightFieldJournal::Replay( size_t k )
+{
+	Entry	entry	= m_entries[ k ];
+
+	entry.m_sequence = GetNextSequence();
+
+	bool const	ok	= ApplyDelta( entry, m_hf.GetView() );
+
+	assert( ok );
+	(void)ok;
+
+	m_hf.UpdateApron();
+
+	m_entries.push_back( entry );
+}
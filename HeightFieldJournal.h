@@ -0,0 +1,117 @@
+/** @file *//********************************************************************************************************
+
+                                                  HeightFieldJournal.h
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/HeightFieldJournal.h#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#pragma once
+
+#include <iosfwd>
+#include <vector>
+
+class HeightField;
+class HeightFieldMutableView;
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! A journal of the changes made to a HeightField, for undo and redo, saving, and replication.
+//!
+//! An edit is bracketed by Begin() and Commit(). Begin() saves the heights in the rectangle to be edited, and
+//! Commit() records the XOR of the old and new bits of each height as an entry with the next sequence number. Small
+//! changes leave the high bits alone, so the XORs are bit-packed in blocks of 32 using the width of the largest one
+//! in the block, and unchanged heights cost nearly nothing. The size of an entry depends on the size of the edit,
+//! not the size of the heightfield.
+//!
+//! Since XOR is its own inverse, the same entry undoes and redoes an edit. Undo() and Redo() append their changes
+//! as new entries, so the journal is always the linear history of the changes to the heightfield, and replaying it
+//! from the start reproduces the current heights.
+//!
+//! Entries can be written to a stream a few at a time (for example, appended to a file or sent to another process
+//! after each edit) and applied to another copy of the heightfield with Apply().
+//!
+//! @note	The heightfield must not be changed outside of Begin() and Commit(), and its size must not change.
+
+class HeightFieldJournal
+{
+public:
+
+	//! Constructor
+	explicit HeightFieldJournal( HeightField & hf );
+
+	//! Saves the heights in a rectangle that is about to be edited.
+	void Begin( int j, int i, int sj, int si );
+
+	//! Records the changes to the rectangle since Begin() as an entry.
+	void Commit();
+
+	//! Restores the rectangle to its state at Begin(), without recording anything.
+	void Rollback();
+
+	//! Returns true if there is an edit to undo.
+	bool CanUndo() const							{ return !m_undo.empty(); }
+
+	//! Returns true if there is an edit to redo.
+	bool CanRedo() const							{ return !m_redo.empty(); }
+
+	//! Undoes the last edit. Returns false if there is nothing to undo.
+	bool Undo();
+
+	//! Redoes the last undone edit. Returns false if there is nothing to redo.
+	bool Redo();
+
+	//! Returns the sequence number of the next entry.
+	unsigned long long GetNextSequence() const		{ return m_firstSequence + m_entries.size(); }
+
+	//! Returns the sequence number of the oldest entry in the journal.
+	unsigned long long GetFirstSequence() const		{ return m_firstSequence; }
+
+	//! Writes the entries starting at a sequence number.
+	void Write( std::ostream & stream, unsigned long long first ) const;
+
+	//! Discards all of the entries and the undo history.
+	void Clear();
+
+	//! Applies the entries in a stream to a heightfield.
+	static bool Apply( std::istream & stream, HeightField & hf, unsigned long long & next );
+
+private:
+
+	// A recorded change to a rectangle
+	struct Entry
+	{
+		unsigned long long				m_sequence;		// Sequence number
+		int								m_j;			// Location of the rectangle along the J axis
+		int								m_i;			// Location of the rectangle along the I axis
+		int								m_sizeJ;		// Size of the rectangle along the J axis
+		int								m_sizeI;		// Size of the rectangle along the I axis
+		std::vector< unsigned char >	m_delta;		// Bit-packed XOR of the old and new heights
+	};
+
+	// Applies an entry's changes to a view. Returns false if the delta is malformed.
+	static bool ApplyDelta( Entry const & entry, HeightFieldMutableView const & view );
+
+	// Appends an entry with the same changes as an existing one, and applies it
+	void Replay( size_t k );
+
+	HeightField &					m_hf;				//!< Heightfield being edited
+	std::vector< Entry >			m_entries;			//!< Entries, in order
+	unsigned long long				m_firstSequence;	//!< Sequence number of the first entry
+	std::vector< size_t >			m_undo;				//!< Entries that can be undone, last one last
+	std::vector< size_t >			m_redo;				//!< Entries that can be redone, last one last
+	bool							m_editing;			//!< True between Begin() and Commit() or Rollback()
+	int								m_j;				//!< Location of the edited rectangle along the J axis
+	int								m_i;				//!< Location of the edited rectangle along the I axis
+	int								m_sizeJ;			//!< Size of the edited rectangle along the J axis
+	int								m_sizeI;			//!< Size of the edited rectangle along the I axis
+	std::vector< float >			m_before;			//!< Heights in the edited rectangle at Begin()
+};
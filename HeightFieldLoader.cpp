@@ -16,33 +16,698 @@
 #include "HeightFieldLoader.h"
 
 #include "HeightField.h"
+#include "HeightFieldView.h"
+#include "Parallel.h"
+#include "Simd.h"
 
 #include "Misc/Types.h"
 #include "TgaFile/TgaFile.h"
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <string>
 
 using namespace std;
 
 
+namespace
+{
+
+// Approximate number of bytes of text formatted or parsed together. The work within a batch is done in parallel.
+size_t const	BATCH_SIZE			= 1 << 24;
+
+// Approximate number of bytes of text formatted by a single task
+size_t const	BLOCK_SIZE			= 1 << 18;
+
+// Maximum number of characters written for a height, including the separator
+int const		MAX_HEIGHT_CHARS	= 16;
+
+// A line of text to be parsed
+struct Line
+{
+	size_t	m_Offset;	// Offset of the line in the batch
+	size_t	m_Length;	// Length of the line
+	size_t	m_First;	// Index of the first height in the line
+};
+
+// Returns true if the character separates heights
+inline bool IsSpace( char c )
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+// Returns the number of heights in a line
+size_t CountTokens( char const * p, char const * pEnd )
+{
+	size_t	n		= 0;
+	bool	inToken	= false;
+
+	for ( ; p < pEnd; ++p )
+	{
+		bool const	space	= IsSpace( *p );
+		n += ( !space && !inToken );
+		inToken = !space;
+	}
+
+	return n;
+}
+
+// Formats rows [ first, last ) of a view. Returns the end of the text.
+char * FormatRows( HeightFieldView const & view, int first, int last, char * p )
+{
+	int const	sizeJ	= view.GetSizeJ();
+
+	for ( int i = first; i < last; i++ )
+	{
+		HeightField::Vertex const * const	pRow	= view.GetData( 0, i );
+
+		for ( int j = 0; j < sizeJ; j++ )
+		{
+			p = to_chars( p, p + MAX_HEIGHT_CHARS - 1, pRow[j].m_Z ).ptr;
+			*p++ = ' ';
+		}
+		*p++ = '\n';
+	}
+
+	return p;
+}
+
+// Parses the heights in a line into a view, starting with the height at index @a k. Heights after the last one in
+// the view are ignored. Returns false if a height is malformed.
+bool ParseLine( char const * p, char const * pEnd, size_t k, HeightFieldMutableView const & view )
+{
+	size_t const	sizeJ	= size_t( view.GetSizeJ() );
+	size_t const	n		= sizeJ * size_t( view.GetSizeI() );
+	int				i		= int( k / sizeJ );
+	int				j		= int( k % sizeJ );
+	HeightField::Vertex *	pRow	= ( k < n ) ? view.GetData( 0, i ) : 0;
+
+	while ( k < n )
+	{
+		while ( p < pEnd && IsSpace( *p ) )
+		{
+			++p;
+		}
+
+		if ( p == pEnd )
+		{
+			break;
+		}
+
+		char const *	pToken	= p;
+
+		while ( p < pEnd && !IsSpace( *p ) )
+		{
+			++p;
+		}
+
+		if ( *pToken == '+' )	// Accepted by istream but not by from_chars
+		{
+			++pToken;
+		}
+
+		from_chars_result const	result	= from_chars( pToken, p, pRow[j].m_Z );
+		if ( result.ec != errc() || result.ptr != p )
+		{
+			return false;
+		}
+
+		++k;
+		if ( ++j == int( sizeJ ) && k < n )
+		{
+			j = 0;
+			pRow = view.GetData( 0, ++i );
+		}
+	}
+
+	return true;
+}
+
+// Inserts the heights of a view, row by row
+void WriteHeights( ostream & stream, HeightFieldView const & view )
+{
+	int const		sizeI		= view.GetSizeI();
+	size_t const	rowSize		= size_t( view.GetSizeJ() ) * MAX_HEIGHT_CHARS + 1;
+	int const		blockRows	= int( max( BLOCK_SIZE / rowSize, size_t( 1 ) ) );
+	int const		batchBlocks	= int( max( BATCH_SIZE / ( rowSize * blockRows ), size_t( Parallel::GetThreadCount() ) ) );
+
+	vector< vector<char> >	blocks( min( batchBlocks, ( sizeI + blockRows - 1 ) / blockRows ) );
+	vector<size_t>			lengths( blocks.size() );
+
+	for ( int batch0 = 0; batch0 < sizeI && stream; batch0 += batchBlocks * blockRows )
+	{
+		int const	batch1	= min( batch0 + batchBlocks * blockRows, sizeI );
+		int const	nBlocks	= ( batch1 - batch0 + blockRows - 1 ) / blockRows;
+
+		// Format the blocks in parallel and then write them in order
+
+		Parallel::For( 0, nBlocks, 1, [ & ]( int first, int last )
+		{
+			for ( int b = first; b < last; b++ )
+			{
+				int const	i0	= batch0 + b * blockRows;
+				int const	i1	= min( i0 + blockRows, batch1 );
+
+				blocks[b].resize( rowSize * ( i1 - i0 ) );
+				lengths[b] = FormatRows( view, i0, i1, &blocks[b][0] ) - &blocks[b][0];
+			}
+		} );
+
+		for ( int b = 0; b < nBlocks; b++ )
+		{
+			stream.write( &blocks[b][0], lengths[b] );
+		}
+	}
+}
+
+// Extracts the heights of a view. The text is read a line at a time so that nothing following the last line
+// containing a height is consumed.
+void ReadHeights( istream & stream, HeightFieldMutableView const & view )
+{
+	size_t const	n	= size_t( view.GetSizeI() ) * view.GetSizeJ();
+
+	string			line;
+	string			text;
+	vector<Line>	lines;
+	size_t			count	= 0;
+
+	while ( count < n )
+	{
+		// Gather lines until the batch is full or all of the heights are present
+
+		text.clear();
+		lines.clear();
+
+		while ( count < n && text.size() < BATCH_SIZE && getline( stream, line ) )
+		{
+			size_t const	tokens	= CountTokens( line.data(), line.data() + line.size() );
+
+			if ( tokens > 0 )
+			{
+				Line const	l	= { text.size(), line.size(), count };
+				lines.push_back( l );
+				text += line;
+				count += tokens;
+			}
+		}
+
+		if ( lines.empty() )
+		{
+			stream.setstate( ios::failbit );
+			return;
+		}
+
+		// Parse the lines in parallel
+
+		atomic<bool>	malformed( false );
+
+		Parallel::For( 0, int( lines.size() ), 1, [ & ]( int first, int last )
+		{
+			for ( int k = first; k < last; k++ )
+			{
+				char const * const	p	= text.data() + lines[k].m_Offset;
+
+				if ( !ParseLine( p, p + lines[k].m_Length, lines[k].m_First, view ) )
+				{
+					malformed = true;
+				}
+			}
+		} );
+
+		if ( malformed )
+		{
+			stream.setstate( ios::failbit );
+			return;
+		}
+	}
+}
+
+// Returns the number of bytes in a sample
+int GetSampleSize( HeightFieldLoader::RawFormat::Type type )
+{
+	switch ( type )
+	{
+	case HeightFieldLoader::RawFormat::TYPE_UINT8:		return 1;
+	case HeightFieldLoader::RawFormat::TYPE_UINT16:		return 2;
+	case HeightFieldLoader::RawFormat::TYPE_INT16:		return 2;
+	default:											return 4;
+	}
+}
+
+// Converts n samples to heights (sample * scale + offset). The vector kernels compute exactly the same values as
+// the scalar code.
+void DecodeSamples( unsigned char const *				pSrc,
+					int									n,
+					HeightFieldLoader::RawFormat const &	format,
+					float *								pDst )
+{
+	HeightFieldLoader::RawFormat::Type const	type	= format.m_Type;
+	bool const									swap	= format.m_BigEndian;
+	float const									scale	= format.m_Scale;
+	float const									offset	= format.m_Offset;
+	int											k		= 0;
+
+#if defined( HEIGHTFIELD_USE_AVX2 )
+
+	__m256 const	vScale	= _mm256_set1_ps( scale );
+	__m256 const	vOffset	= _mm256_set1_ps( offset );
+	__m128i const	swap16	= _mm_setr_epi8( 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14 );
+	__m256i const	swap32	= _mm256_setr_epi8( 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+												3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 );
+
+	for ( ; k + 8 <= n; k += 8 )
+	{
+		__m256	z;
+
+		if ( type == HeightFieldLoader::RawFormat::TYPE_FLOAT32 )
+		{
+			__m256i	x	= _mm256_loadu_si256( reinterpret_cast< __m256i const * >( pSrc + k * 4 ) );
+
+			if ( swap )
+			{
+				x = _mm256_shuffle_epi8( x, swap32 );
+			}
+			z = _mm256_castsi256_ps( x );
+		}
+		else if ( type == HeightFieldLoader::RawFormat::TYPE_UINT8 )
+		{
+			z = _mm256_cvtepi32_ps( _mm256_cvtepu8_epi32( _mm_loadl_epi64( reinterpret_cast< __m128i const * >( pSrc + k ) ) ) );
+		}
+		else
+		{
+			__m128i	x	= _mm_loadu_si128( reinterpret_cast< __m128i const * >( pSrc + k * 2 ) );
+
+			if ( swap )
+			{
+				x = _mm_shuffle_epi8( x, swap16 );
+			}
+			z = _mm256_cvtepi32_ps( ( type == HeightFieldLoader::RawFormat::TYPE_INT16 ) ? _mm256_cvtepi16_epi32( x )
+																						 : _mm256_cvtepu16_epi32( x ) );
+		}
+
+		_mm256_storeu_ps( pDst + k, _mm256_add_ps( _mm256_mul_ps( z, vScale ), vOffset ) );
+	}
+
+#elif defined( HEIGHTFIELD_USE_SSE )
+
+	__m128 const	vScale	= _mm_set1_ps( scale );
+	__m128 const	vOffset	= _mm_set1_ps( offset );
+	__m128i const	zero	= _mm_setzero_si128();
+
+	for ( ; k + 8 <= n; k += 8 )
+	{
+		__m128	z0;
+		__m128	z1;
+
+		if ( type == HeightFieldLoader::RawFormat::TYPE_FLOAT32 )
+		{
+			__m128i	x0	= _mm_loadu_si128( reinterpret_cast< __m128i const * >( pSrc + k * 4 ) );
+			__m128i	x1	= _mm_loadu_si128( reinterpret_cast< __m128i const * >( pSrc + k * 4 + 16 ) );
+
+			if ( swap )
+			{
+				// Swap the 16-bit halves of each 32-bit value, and then the bytes of each half
+
+				x0 = _mm_shufflehi_epi16( _mm_shufflelo_epi16( x0, 0xb1 ), 0xb1 );
+				x1 = _mm_shufflehi_epi16( _mm_shufflelo_epi16( x1, 0xb1 ), 0xb1 );
+				x0 = _mm_or_si128( _mm_slli_epi16( x0, 8 ), _mm_srli_epi16( x0, 8 ) );
+				x1 = _mm_or_si128( _mm_slli_epi16( x1, 8 ), _mm_srli_epi16( x1, 8 ) );
+			}
+			z0 = _mm_castsi128_ps( x0 );
+			z1 = _mm_castsi128_ps( x1 );
+		}
+		else
+		{
+			__m128i	x;
+
+			if ( type == HeightFieldLoader::RawFormat::TYPE_UINT8 )
+			{
+				x = _mm_unpacklo_epi8( _mm_loadl_epi64( reinterpret_cast< __m128i const * >( pSrc + k ) ), zero );
+			}
+			else
+			{
+				x = _mm_loadu_si128( reinterpret_cast< __m128i const * >( pSrc + k * 2 ) );
+
+				if ( swap )
+				{
+					x = _mm_or_si128( _mm_slli_epi16( x, 8 ), _mm_srli_epi16( x, 8 ) );
+				}
+			}
+
+			if ( type == HeightFieldLoader::RawFormat::TYPE_INT16 )
+			{
+				z0 = _mm_cvtepi32_ps( _mm_srai_epi32( _mm_unpacklo_epi16( x, x ), 16 ) );
+				z1 = _mm_cvtepi32_ps( _mm_srai_epi32( _mm_unpackhi_epi16( x, x ), 16 ) );
+			}
+			else
+			{
+				z0 = _mm_cvtepi32_ps( _mm_unpacklo_epi16( x, zero ) );
+				z1 = _mm_cvtepi32_ps( _mm_unpackhi_epi16( x, zero ) );
+			}
+		}
+
+		_mm_storeu_ps( pDst + k, _mm_add_ps( _mm_mul_ps( z0, vScale ), vOffset ) );
+		_mm_storeu_ps( pDst + k + 4, _mm_add_ps( _mm_mul_ps( z1, vScale ), vOffset ) );
+	}
+
+#endif
+
+	for ( ; k < n; k++ )
+	{
+		float	z;
+
+		if ( type == HeightFieldLoader::RawFormat::TYPE_UINT8 )
+		{
+			z = float( pSrc[ k ] );
+		}
+		else if ( type == HeightFieldLoader::RawFormat::TYPE_FLOAT32 )
+		{
+			unsigned char const * const	p		= pSrc + k * 4;
+			unsigned const				bits	= swap ? ( unsigned( p[ 0 ] ) << 24 | unsigned( p[ 1 ] ) << 16 | unsigned( p[ 2 ] ) << 8 | p[ 3 ] )
+													   : ( unsigned( p[ 3 ] ) << 24 | unsigned( p[ 2 ] ) << 16 | unsigned( p[ 1 ] ) << 8 | p[ 0 ] );
+
+			memcpy( &z, &bits, sizeof( z ) );
+		}
+		else
+		{
+			unsigned char const * const	p	= pSrc + k * 2;
+			unsigned const				x	= swap ? ( unsigned( p[ 0 ] ) << 8 | p[ 1 ] ) : ( unsigned( p[ 1 ] ) << 8 | p[ 0 ] );
+
+			z = ( type == HeightFieldLoader::RawFormat::TYPE_INT16 ) ? float( short( x ) ) : float( x );
+		}
+
+		pDst[ k ] = z * scale + offset;
+	}
+}
+
+// Reads the samples of a heightfield in batches of rows with read( p, n ), which returns false if it fails, and
+// decodes each batch in parallel straight into the heightfield and then updates its apron. The heightfield must
+// already have the right size.
+template< typename Read >
+bool DecodeRows( Read & read, HeightFieldLoader::RawFormat const & format, HeightField & hf )
+{
+	int const		sizeI		= format.m_SizeI;
+	size_t const	rowSize		= size_t( format.m_SizeJ ) * GetSampleSize( format.m_Type );
+	int const		batchRows	= int( max( BATCH_SIZE / max( rowSize, size_t( 1 ) ), size_t( 1 ) ) );
+
+	vector< unsigned char >			buffer( rowSize * min( batchRows, sizeI ) );
+	HeightFieldMutableView const	view	= hf.GetView();
+
+	for ( int batch0 = 0; batch0 < sizeI; batch0 += batchRows )
+	{
+		int const	batch1	= min( batch0 + batchRows, sizeI );
+
+		if ( !read( reinterpret_cast< char * >( &buffer[ 0 ] ), rowSize * ( batch1 - batch0 ) ) )
+		{
+			return false;
+		}
+
+		Parallel::For( batch0, batch1, 1, [ & ]( int first, int last )
+		{
+			for ( int r = first; r < last; r++ )
+			{
+				int const	i	= format.m_TopDown ? sizeI - 1 - r : r;
+
+				DecodeSamples( &buffer[ rowSize * ( r - batch0 ) ], format.m_SizeJ, format, &view.GetData( 0, i )->m_Z );
+			}
+		} );
+	}
+
+	hf.UpdateApron();
+
+	return true;
+}
+
+// Returns true if the rest of a file holds at least the given number of bytes
+bool HasBytes( istream & stream, unsigned long long n )
+{
+	istream::pos_type const	position	= stream.tellg();
+
+	stream.seekg( 0, ios::end );
+
+	istream::pos_type const	end	= stream.tellg();
+
+	stream.seekg( position );
+
+	return stream && position != istream::pos_type( -1 ) && (unsigned long long)( end - position ) >= n;
+}
+
+// Loads samples in a stream described by a format into a heightfield
+bool LoadSamples( istream & stream, HeightFieldLoader::RawFormat const & format, HeightField & hf )
+{
+	unsigned long long const	size	= (unsigned long long)format.m_SizeI * format.m_SizeJ * GetSampleSize( format.m_Type );
+
+	if ( format.m_SizeI <= 0 || format.m_SizeJ <= 0 || !HasBytes( stream, size ) )
+	{
+		return false;
+	}
+
+	try
+	{
+		hf.Resize( format.m_SizeI, format.m_SizeJ );
+
+		auto	read	= [ & ]( char * p, size_t n ) -> bool
+		{
+			return bool( stream.read( p, n ) );
+		};
+
+		return DecodeRows( read, format, hf );
+	}
+	catch ( ... )
+	{
+		return false;
+	}
+}
+
+// Reads the run-length encoded pixels of a TGA file
+class TgaRleReader
+{
+public:
+
+	TgaRleReader( istream & stream, int pixelSize )
+		: m_stream( stream ),
+		m_pixelSize( pixelSize ),
+		m_count( 0 ),
+		m_repeat( false )
+	{
+	}
+
+	// Reads the next n bytes of pixels
+	bool operator ()( char * p, size_t n )
+	{
+		char * const	pEnd	= p + n;
+
+		while ( p < pEnd )
+		{
+			if ( m_count == 0 )
+			{
+				int const	header	= m_stream.get();
+
+				if ( header == istream::traits_type::eof() )
+				{
+					return false;
+				}
+
+				m_count		= ( header & 0x7f ) + 1;
+				m_repeat	= ( header & 0x80 ) != 0;
+
+				if ( m_repeat && !m_stream.read( m_pixel, m_pixelSize ) )
+				{
+					return false;
+				}
+			}
+
+			if ( pEnd - p < m_pixelSize )
+			{
+				return false;	// A pixel is split between batches, which never happens since rows are whole
+			}
+
+			if ( m_repeat )
+			{
+				memcpy( p, m_pixel, m_pixelSize );
+			}
+			else if ( !m_stream.read( p, m_pixelSize ) )
+			{
+				return false;
+			}
+
+			p += m_pixelSize;
+			--m_count;
+		}
+
+		return true;
+	}
+
+private:
+
+	TgaRleReader & operator =( TgaRleReader const & );
+
+	istream &	m_stream;		// Stream containing the pixels
+	int			m_pixelSize;	// Number of bytes in a pixel
+	int			m_count;		// Number of pixels left in the current packet
+	bool		m_repeat;		// True if the current packet repeats a single pixel
+	char		m_pixel[ 4 ];	// The repeated pixel
+};
+
+// Skips whitespace and comments in the header of a PGM file
+void SkipPgmSpace( istream & stream )
+{
+	while ( stream )
+	{
+		int const	c	= stream.peek();
+
+		if ( c == '#' )
+		{
+			string	comment;
+			getline( stream, comment );
+		}
+		else if ( c != istream::traits_type::eof() && IsSpace( char( c ) ) )
+		{
+			stream.get();
+		}
+		else
+		{
+			break;
+		}
+	}
+}
+
+// Returns a copy of a string in upper case
+string ToUpper( string s )
+{
+	for ( size_t k = 0; k < s.size(); k++ )
+	{
+		s[ k ] = char( toupper( (unsigned char)s[ k ] ) );
+	}
+
+	return s;
+}
+
+} // anonymous namespace
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! This function creates a HeightField using height data loaded from a TGA file. The size of the height field is
+//! determined by the size of the image. The format of the image must be one byte per pixel (@c IMAGE_COLORMAPPED 
+//! or @c IMAGE_GREYSCALE). The origin of the heightfield is the origin of the image (as specified by the pixel
+//! order). The values in the image are multiplied by @a zScale / 255 to get the actual heights.
+//!
+//! @param	sFileName	The name of the TGA file containing the height data.
+//! @param	zScale		Scale factor for height data
+//!
+//! @return		The heightfield or 0 if the file could not be loaded
+//!
+//! @note	As a result of scaling, the heights will be in the range of 0 - @a zScale, inclusive.
+
+unique_ptr<HeightField> HeightFieldLoader::LoadTga( char const * sFileName, float zScale )
+{
+	unique_ptr<HeightField>	pHF;
+
+	try
+	{
+		pHF.reset( new HeightField );
+
+		if ( !LoadTga( sFileName, zScale, *pHF ) )
+		{
+			pHF.reset();
+		}
+	}
+	catch( ... )
+	{
+		pHF.reset();
+	}
+
+	return pHF;
+}
+
+
 /********************************************************************************************************************/
 /*																													*/
 /********************************************************************************************************************/
 
-//! This function creates a HeightField using height data loaded from a TGA file. The size of the height field is
-//! determined by the size of the image. The format of the image must be one byte per pixel (@c IMAGE_COLORMAPPED 
-//! or @c IMAGE_GREYSCALE). The origin of the heightfield is the origin of the image (as specified by the pixel
-//! order). The values in the image are multiplied by @a zScale / 255 to get the actual heights.
+//! This function loads height data from a TGA file into an existing HeightField, replacing its contents. The
+//! heightfield's storage is reused. The image is read into a temporary buffer.
 //!
 //! @param	sFileName	The name of the TGA file containing the height data.
 //! @param	zScale		Scale factor for height data
+//! @param	hf			Receives the heights. It is unchanged if the file could not be loaded.
 //!
-//! @return		The address of the heightfield or 0 if the file could not be loaded
+//! @return		true if the file was loaded
 //!
-//! @note	As a result of scaling, the heights will be in the range of 0 - @a zScale, inclusive.
+//! @see	LoadTga( char const *, float )
 
-auto_ptr<HeightField> HeightFieldLoader::LoadTga( char const * sFileName, float zScale )
+bool HeightFieldLoader::LoadTga( char const * sFileName, float zScale, HeightField & hf )
 {
-	HeightField *	pHF	= 0;
+	vector<uint8>	image;
+
+	return LoadTga( sFileName, zScale, hf, image );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! This function loads height data from a TGA file into an existing HeightField, replacing its contents. The
+//! heightfield's storage and the caller's image buffer are reused, so loading files of the same size repeatedly
+//! does not allocate. The buffer is never released here, so the caller decides how long to keep it.
+//!
+//! The sizes along I and J are the height and width of the image, so each row of the heightfield is a row of the
+//! image.
+//!
+//! @param	sFileName	The name of the TGA file containing the height data.
+//! @param	zScale		Scale factor for height data
+//! @param	hf			Receives the heights. It is unchanged if the file could not be loaded.
+//! @param	image		Buffer for the image. Its capacity is reused.
+//!
+//! @return		true if the file was loaded
+
+bool HeightFieldLoader::LoadTga( char const * sFileName, float zScale, HeightField & hf, vector<uint8> & image )
+{
+	int	width;
+	int	height;
+
+	if ( !ReadTgaImage( sFileName, width, height, image ) )
+	{
+		return false;
+	}
+
+	try
+	{
+		hf.Assign( height, width, zScale, &image[0] );
+	}
+	catch( ... )
+	{
+		return false;
+	}
+
+	return true;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
 
+//! This function reads the image in a TGA file. The format of the image must be one byte per pixel
+//! (@c IMAGE_COLORMAPPED or @c IMAGE_GREYSCALE). The image is returned in the order expected by the HeightField
+//! constructor. It is separate from LoadTga() so that reading the file and converting the image can be done at
+//! different times or on different threads.
+//!
+//! @param	sFileName	The name of the TGA file
+//! @param	width		Receives the width of the image
+//! @param	height		Receives the height of the image
+//! @param	image		Receives the pixels. Its capacity is reused.
+//!
+//! @return		true if the image was read
+
+bool HeightFieldLoader::ReadTgaImage( char const * sFileName, int & width, int & height, vector<uint8> & image )
+{
 	try
 	{
 		TgaFile		file( sFileName );
@@ -55,24 +720,25 @@ auto_ptr<HeightField> HeightFieldLoader::LoadTga( char const * sFileName, float
 
 			// Load the image data.
 
-			vector<uint8>	image( imageSize );
+			image.resize( imageSize );
 
 			if ( file.Read( &image[0], TgaFile::ORDER_BOTTOMLEFT ) )
 			{
-				// Create the height field
-
-				pHF = new HeightField( file.m_Width, file.m_Height, zScale, &image[0] );
+				width	= file.m_Width;
+				height	= file.m_Height;
+				return true;
 			}
 		}
 	}
 	catch( ... )
 	{
-		// nothing to do. pHF is already 0.
+		// nothing to do.
 	}
 
-	return auto_ptr<HeightField>( pHF );
+	return false;
 }
 
+
 /********************************************************************************************************************/
 /*																													*/
 /********************************************************************************************************************/
@@ -98,20 +764,373 @@ bool HeightFieldLoader::WriteTga( char const * sFileName, HeightField const & hf
 /*																													*/
 /********************************************************************************************************************/
 
-ostream & operator <<( ostream & stream, HeightField const & hf )
+//! The heights are in the same format as for a HeightField, but there is no size. This allows a stream that is too
+//! large to load to be processed a band of rows at a time, after the size has been extracted with
+//! <tt>stream >> sizeI >> sizeJ</tt>. Each band must end at the end of a line. If the view is of a HeightField with
+//! an apron, HeightField::UpdateApron() must be called after the last band.
+//!
+//! @param	stream	Stream to extract from
+//! @param	view	Receives the heights
+//!
+//! @return		true if the heights were extracted
+
+bool HeightFieldLoader::ReadRows( istream & stream, HeightFieldMutableView const & view )
+{
+	if ( stream && view.GetSizeI() > 0 && view.GetSizeJ() > 0 )
+	{
+		ReadHeights( stream, view );
+	}
+
+	return !stream.fail();
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+HeightFieldLoader::RawFormat::RawFormat()
+	: m_SizeI( 0 ),
+	m_SizeJ( 0 ),
+	m_Type( TYPE_UINT16 ),
+	m_BigEndian( false ),
+	m_TopDown( false ),
+	m_SkipBytes( 0 ),
+	m_Scale( 1.0f ),
+	m_Offset( 0.0f )
+{
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! The image must be 16-bit greyscale (@c IMAGE_GREYSCALE or its run-length encoded form). As with LoadTga(), the
+//! first row of the heightfield is the bottom row of the image, and the values in the image are multiplied by
+//! @a zScale / 65535 to get the heights. The sizes along I and J are the height and width of the image.
+//!
+//! The pixels are read in large batches of rows, and each batch is decoded in parallel straight into the
+//! heightfield.
+//!
+//! @param	sFileName	The name of the TGA file containing the height data.
+//! @param	zScale		Scale factor for height data
+//! @param	hf			Receives the heights. If the header is valid but the image is not, it may be resized.
+//!
+//! @return		true if the file was loaded
+
+bool HeightFieldLoader::LoadTga16( char const * sFileName, float zScale, HeightField & hf )
+{
+	ifstream		file( sFileName, ios::binary );
+	unsigned char	header[ 18 ];
+
+	if ( !file.read( reinterpret_cast< char * >( header ), sizeof( header ) ) )
+	{
+		return false;
+	}
+
+	int const	idLength		= header[ 0 ];
+	int const	colorMapType	= header[ 1 ];
+	int const	imageType		= header[ 2 ];
+	int const	colorMapLength	= header[ 5 ] | header[ 6 ] << 8;
+	int const	colorMapDepth	= header[ 7 ];
+	int const	width			= header[ 12 ] | header[ 13 ] << 8;
+	int const	height			= header[ 14 ] | header[ 15 ] << 8;
+	int const	pixelDepth		= header[ 16 ];
+	int const	descriptor		= header[ 17 ];
+
+	// Only greyscale images (uncompressed or run-length encoded) that go from left to right are supported
+
+	if ( ( imageType != 3 && imageType != 11 ) || pixelDepth != 16 || ( descriptor & 0x10 ) != 0 )
+	{
+		return false;
+	}
+
+	file.seekg( idLength + ( ( colorMapType == 1 ) ? colorMapLength * ( ( colorMapDepth + 7 ) / 8 ) : 0 ), ios::cur );
+
+	RawFormat	format;
+
+	format.m_SizeI		= height;
+	format.m_SizeJ		= width;
+	format.m_Type		= RawFormat::TYPE_UINT16;
+	format.m_TopDown	= ( descriptor & 0x20 ) != 0;
+	format.m_Scale		= zScale / 65535.0f;
+
+	if ( imageType == 3 )
+	{
+		return LoadSamples( file, format, hf );
+	}
+
+	if ( width <= 0 || height <= 0 )
+	{
+		return false;
+	}
+
+	try
+	{
+		TgaRleReader	reader( file, 2 );
+
+		hf.Resize( height, width );
+		return DecodeRows( reader, format, hf );
+	}
+	catch ( ... )
+	{
+		return false;
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! The file must be a binary (P5) PGM file. Its samples are 8-bit if its maximum value is less than 256, and 16-bit
+//! big-endian otherwise. As with LoadTga(), the first row of the heightfield is the bottom row of the image. The
+//! values in the image are multiplied by @a zScale / (the maximum value) to get the heights.
+//!
+//! @param	sFileName	The name of the PGM file containing the height data.
+//! @param	zScale		Scale factor for height data
+//! @param	hf			Receives the heights. If the header is valid but the image is not, it may be resized.
+//!
+//! @return		true if the file was loaded
+
+bool HeightFieldLoader::LoadPgm( char const * sFileName, float zScale, HeightField & hf )
+{
+	ifstream	file( sFileName, ios::binary );
+	char		magic[ 2 ];
+	int			width		= 0;
+	int			height		= 0;
+	int			maxValue	= 0;
+
+	if ( !file.read( magic, 2 ) || magic[ 0 ] != 'P' || magic[ 1 ] != '5' )
+	{
+		return false;
+	}
+
+	SkipPgmSpace( file );
+	file >> width;
+	SkipPgmSpace( file );
+	file >> height;
+	SkipPgmSpace( file );
+	file >> maxValue;
+
+	// A single whitespace character separates the header from the samples
+
+	if ( !file || maxValue <= 0 || maxValue > 65535 || !IsSpace( char( file.get() ) ) )
+	{
+		return false;
+	}
+
+	RawFormat	format;
+
+	format.m_SizeI		= height;
+	format.m_SizeJ		= width;
+	format.m_Type		= ( maxValue < 256 ) ? RawFormat::TYPE_UINT8 : RawFormat::TYPE_UINT16;
+	format.m_BigEndian	= true;
+	format.m_TopDown	= true;
+	format.m_Scale		= zScale / float( maxValue );
+
+	return LoadSamples( file, format, hf );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! The samples are read in large batches of rows, and each batch is byte-swapped (if necessary), scaled and
+//! converted in parallel straight into the heightfield.
+//!
+//! @param	sFileName	The name of the raw file
+//! @param	format		Layout of the file
+//! @param	hf			Receives the heights. If the file is too short, it is unchanged.
+//!
+//! @return		true if the file was loaded
+
+bool HeightFieldLoader::LoadRaw( char const * sFileName, RawFormat const & format, HeightField & hf )
+{
+	ifstream	file( sFileName, ios::binary );
+
+	if ( !file.seekg( format.m_SkipBytes ) )
+	{
+		return false;
+	}
+
+	return LoadSamples( file, format, hf );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! The header file has the same name as the raw file, with the extension replaced by @c .hdr.
+//!
+//! @param	sFileName	The name of the raw file
+//! @param	hf			Receives the heights. If the file is too short, it is unchanged.
+//!
+//! @return		true if the file was loaded
+//!
+//! @see	ReadRawHeader()
+
+bool HeightFieldLoader::LoadRaw( char const * sFileName, HeightField & hf )
+{
+	string				name( sFileName );
+	size_t const		slash	= name.find_last_of( "/\\" );
+	size_t const		dot		= name.find_last_of( '.' );
+	RawFormat			format;
+
+	if ( dot != string::npos && ( slash == string::npos || dot > slash ) )
+	{
+		name.erase( dot );
+	}
+
+	return ReadRawHeader( ( name + ".hdr" ).c_str(), format ) && LoadRaw( sFileName, format, hf );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! The header is a list of keywords and values, one per line, as written for ESRI BIL files (and by GDAL). The
+//! keywords used are @c NROWS, @c NCOLS, @c NBANDS (which must be 1), @c NBITS (8, 16 or 32), @c PIXELTYPE
+//! (@c UNSIGNEDINT, @c SIGNEDINT or @c FLOAT), @c BYTEORDER (@c I for little-endian or @c M for big-endian) and
+//! @c SKIPBYTES. Other keywords are ignored. The first row in the file is the top row, so the format is top-down.
+//! The scale is 1 and the offset is 0.
+//!
+//! @param	sFileName	The name of the header file
+//! @param	format		Receives the format
+//!
+//! @return		true if the header was read and describes a supported format
+
+bool HeightFieldLoader::ReadRawHeader( char const * sFileName, RawFormat & format )
+{
+	ifstream	file( sFileName );
+	string		line;
+	int			nBits		= 8;
+	int			nBands		= 1;
+	string		pixelType	= "UNSIGNEDINT";
+	RawFormat	result;
+
+	result.m_TopDown = true;
+
+	while ( getline( file, line ) )
+	{
+		char const *	p		= line.data();
+		char const *	pEnd	= p + line.size();
+
+		while ( p < pEnd && IsSpace( *p ) )	++p;
+		char const * const	pKey	= p;
+		while ( p < pEnd && !IsSpace( *p ) )	++p;
+		string const		key		= ToUpper( string( pKey, p ) );
+		while ( p < pEnd && IsSpace( *p ) )	++p;
+		char const * const	pValue	= p;
+		while ( p < pEnd && !IsSpace( *p ) )	++p;
+		string const		value	= ToUpper( string( pValue, p ) );
+
+		if ( key == "NROWS" )			result.m_SizeI		= atoi( value.c_str() );
+		else if ( key == "NCOLS" )		result.m_SizeJ		= atoi( value.c_str() );
+		else if ( key == "NBANDS" )		nBands				= atoi( value.c_str() );
+		else if ( key == "NBITS" )		nBits				= atoi( value.c_str() );
+		else if ( key == "SKIPBYTES" )	result.m_SkipBytes	= atoll( value.c_str() );
+		else if ( key == "BYTEORDER" )	result.m_BigEndian	= ( value == "M" );
+		else if ( key == "PIXELTYPE" )	pixelType			= value;
+	}
+
+	if ( pixelType == "FLOAT" && nBits == 32 )					result.m_Type = RawFormat::TYPE_FLOAT32;
+	else if ( pixelType == "SIGNEDINT" && nBits == 16 )			result.m_Type = RawFormat::TYPE_INT16;
+	else if ( pixelType == "UNSIGNEDINT" && nBits == 16 )		result.m_Type = RawFormat::TYPE_UINT16;
+	else if ( pixelType == "UNSIGNEDINT" && nBits == 8 )		result.m_Type = RawFormat::TYPE_UINT8;
+	else														return false;
+
+	if ( !file.eof() || nBands != 1 || result.m_SizeI <= 0 || result.m_SizeJ <= 0 )
+	{
+		return false;
+	}
+
+	format = result;
+	return true;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! The header keywords @c NCOLS and @c NROWS give the size, and the other keywords (such as @c CELLSIZE and
+//! @c NODATA_VALUE) are ignored. Cells with no data keep the no-data value. The first row in the file is the top
+//! row, so, as with LoadTga(), it becomes the last row of the heightfield. The text is parsed in parallel, in
+//! batches of lines, as with the extraction operator.
+//!
+//! @param	sFileName	The name of the grid file
+//! @param	hf			Receives the heights. If the header is valid but the heights are not, it may be resized.
+//!
+//! @return		true if the file was loaded
+
+bool HeightFieldLoader::LoadAsciiGrid( char const * sFileName, HeightField & hf )
 {
-	stream << hf.GetSizeI() << " " << hf.GetSizeJ() << endl;
+	ifstream	file( sFileName );
+	int			sizeI	= 0;
+	int			sizeJ	= 0;
+
+	// Read the header, which ends where the numbers start
+
+	while ( file >> ws && isalpha( file.peek() ) )
+	{
+		string	key;
+		string	value;
+
+		file >> key >> value;
+		key = ToUpper( key );
+
+		if ( key == "NROWS" )		sizeI = atoi( value.c_str() );
+		else if ( key == "NCOLS" )	sizeJ = atoi( value.c_str() );
+	}
+
+	if ( !file || sizeI <= 0 || sizeJ <= 0 )
+	{
+		return false;
+	}
 
-	for ( int i = 0; i < hf.GetSizeI(); i++ )
+	try
 	{
-		for ( int j = 0; j < hf.GetSizeJ(); j++ )
+		hf.Resize( sizeI, sizeJ );
+		ReadHeights( file, hf.GetView() );
+
+		if ( file.fail() )
 		{
-			stream << hf.GetData( j, i )->m_Z << " ";
+			return false;
 		}
-		stream << endl;
+
+		HeightFieldMutableView const	view	= hf.GetView();
+
+		Parallel::For( 0, sizeI / 2, 1, [ & ]( int first, int last )
+		{
+			for ( int i = first; i < last; i++ )
+			{
+				swap_ranges( view.GetData( 0, i ), view.GetData( 0, i ) + sizeJ, view.GetData( 0, sizeI - 1 - i ) );
+			}
+		} );
+
+		hf.UpdateApron();
+	}
+	catch ( ... )
+	{
+		return false;
 	}
 
-	return stream;
+	return true;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+ostream & operator <<( ostream & stream, HeightField const & hf )
+{
+	return stream << hf.GetView();
 }
 
 
@@ -119,20 +1138,75 @@ ostream & operator <<( ostream & stream, HeightField const & hf )
 /*																													*/
 /********************************************************************************************************************/
 
+//! The format is the size of the height field (I and then J) followed by the heights, row by row. The heights can
+//! be separated by any whitespace. Extraction stops at the end of the line containing the last height.
 //!
 //! @exception	bad_alloc	Unable to allocate a HeightField to contain the value
 
 istream & operator >>( istream & stream, HeightField & hf )
 {
-	stream >> hf.m_sizeI >> hf.m_sizeJ;
+	int	sizeI;
+	int	sizeJ;
 
-	int const	n	= hf.m_sizeI * hf.m_sizeJ;
+	stream >> sizeI >> sizeJ;
 
-	hf.m_data.resize( n );
+	if ( stream && ( sizeI < 0 || sizeJ < 0 ) )
+	{
+		stream.setstate( ios::failbit );
+	}
+
+	if ( stream )
+	{
+		hf.Resize( sizeI, sizeJ );
+		ReadHeights( stream, hf.GetView() );
+		hf.UpdateApron();
+	}
+
+	return stream;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! The format is the same as for a HeightField, so a view can be extracted as a HeightField. Each height is
+//! written with the fewest digits that read back as the same value. The rows are formatted in parallel in large
+//! blocks, and the stream is not flushed.
+
+ostream & operator <<( ostream & stream, HeightFieldView const & view )
+{
+	stream << view.GetSizeI() << " " << view.GetSizeJ() << "\n";
+
+	WriteHeights( stream, view );
+
+	return stream;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! The view is not resized. If the size in the stream does not match the size of the view, nothing is extracted
+//! and the stream's @c failbit is set. If the view is of a HeightField with an apron, HeightField::UpdateApron()
+//! must be called afterwards.
+
+istream & operator >>( istream & stream, HeightFieldMutableView const & view )
+{
+	int	sizeI;
+	int	sizeJ;
+
+	stream >> sizeI >> sizeJ;
+
+	if ( stream && ( sizeI != view.GetSizeI() || sizeJ != view.GetSizeJ() ) )
+	{
+		stream.setstate( ios::failbit );
+	}
 
-	for ( int k = 0; k < n; k++ )
+	if ( stream )
 	{
-		stream >> hf.m_data[k].m_Z;
+		ReadHeights( stream, view );
 	}
 
 	return stream;
@@ -15,8 +15,11 @@
 
 #include <memory>
 #include <iosfwd>
+#include <vector>
 
 class HeightField;
+class HeightFieldView;
+class HeightFieldMutableView;
 
 
 /********************************************************************************************************************/
@@ -29,11 +32,66 @@ class HeightFieldLoader
 {
 public:
 
+	//! The layout of a raw file of heights
+	struct RawFormat
+	{
+		//! Type of the samples
+		enum Type
+		{
+			TYPE_UINT8,		//!< 8-bit unsigned integer
+			TYPE_UINT16,	//!< 16-bit unsigned integer
+			TYPE_INT16,		//!< 16-bit signed integer
+			TYPE_FLOAT32	//!< 32-bit IEEE float
+		};
+
+		//! Constructor
+		RawFormat();
+
+		int			m_SizeI;		//!< Number of rows
+		int			m_SizeJ;		//!< Number of samples in a row
+		Type		m_Type;			//!< Type of the samples
+		bool		m_BigEndian;	//!< True if the samples are big-endian
+		bool		m_TopDown;		//!< True if the first row in the file is the last row of the heightfield
+		long long	m_SkipBytes;	//!< Number of bytes before the first sample
+		float		m_Scale;		//!< Each height is the sample times this value plus m_Offset
+		float		m_Offset;		//!< Added to each scaled sample
+	};
+
 	//! Creates a HeightField from a TGA file
-	static std::auto_ptr< HeightField > LoadTga( char const * sFileName, float zScale );
+	static std::unique_ptr< HeightField > LoadTga( char const * sFileName, float zScale );
+
+	//! Loads a TGA file into an existing HeightField
+	static bool LoadTga( char const * sFileName, float zScale, HeightField & hf );
+
+	//! Loads a TGA file into an existing HeightField, reading the image into a buffer provided by the caller
+	static bool LoadTga( char const * sFileName, float zScale, HeightField & hf, std::vector< unsigned __int8 > & image );
+
+	//! Reads the 8-bit image in a TGA file without converting it
+	static bool ReadTgaImage( char const * sFileName, int & width, int & height, std::vector< unsigned __int8 > & image );
 
 	//! Writes a HeightField to a TGA file
 	static bool WriteTga( char const * sFileName, HeightField const & hf, float zScale );
+
+	//! Extracts the next rows of heights in a stream into a view
+	static bool ReadRows( std::istream & stream, HeightFieldMutableView const & view );
+
+	//! Loads a 16-bit greyscale TGA file into an existing HeightField
+	static bool LoadTga16( char const * sFileName, float zScale, HeightField & hf );
+
+	//! Loads a binary (8-bit or 16-bit) PGM file into an existing HeightField
+	static bool LoadPgm( char const * sFileName, float zScale, HeightField & hf );
+
+	//! Loads a raw file of heights into an existing HeightField
+	static bool LoadRaw( char const * sFileName, RawFormat const & format, HeightField & hf );
+
+	//! Loads a raw file of heights described by an ESRI-style .hdr file into an existing HeightField
+	static bool LoadRaw( char const * sFileName, HeightField & hf );
+
+	//! Reads the format of a raw file from an ESRI-style .hdr file
+	static bool ReadRawHeader( char const * sFileName, RawFormat & format );
+
+	//! Loads an ESRI ASCII grid file into an existing HeightField
+	static bool LoadAsciiGrid( char const * sFileName, HeightField & hf );
 };
 
 
@@ -46,3 +104,9 @@ std::ostream & operator <<( std::ostream & stream, HeightField const & hf );
 
 //! Extracts a HeightField from a stream
 std::istream & operator >>( std::istream & stream, HeightField & hf );
+
+//! Inserts a HeightFieldView into a stream
+std::ostream & operator <<( std::ostream & stream, HeightFieldView const & view );
+
+//! Extracts the heights of a HeightFieldMutableView from a stream
+std::istream & operator >>( std::istream & stream, HeightFieldMutableView const & view );
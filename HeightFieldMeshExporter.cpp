@@ -0,0 +1,442 @@
+/** @file *//********************************************************************************************************
+
+                                              HeightFieldMeshExporter.cpp
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/HeightFieldMeshExporter.cpp#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#include "PrecompiledHeaders.h"
+
+#include "HeightFieldMeshExporter.h"
+
+#include "HeightFieldView.h"
+#include "Parallel.h"
+
+#include <charconv>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+using namespace std;
+
+
+namespace
+{
+
+// Approximate number of bytes formatted together. The blocks within a batch are formatted in parallel.
+size_t const	BATCH_SIZE			= 1 << 24;
+
+// Approximate number of bytes formatted by a single task
+size_t const	BLOCK_SIZE			= 1 << 18;
+
+// Maximum number of characters written for a float or an index in an OBJ file
+int const		MAX_NUMBER_CHARS	= 24;
+
+// The vertexes and cells of the exported mesh
+class Grid
+{
+public:
+
+	Grid( HeightFieldView const & view, float spacing, int step )
+		: m_view( view ),
+		m_spacing( spacing ),
+		m_step( step ),
+		m_nJ( ( view.GetSizeJ() > 0 ) ? ( view.GetSizeJ() - 1 + step - 1 ) / step + 1 : 0 ),
+		m_nI( ( view.GetSizeI() > 0 ) ? ( view.GetSizeI() - 1 + step - 1 ) / step + 1 : 0 )
+	{
+		assert( step >= 1 );
+	}
+
+	// Returns the number of vertexes along the J axis
+	int GetVerticesJ() const					{ return m_nJ; }
+
+	// Returns the number of vertexes along the I axis
+	int GetVerticesI() const					{ return m_nI; }
+
+	// Returns the number of vertexes
+	unsigned long long GetVertexCount() const	{ return (unsigned long long)m_nJ * m_nI; }
+
+	// Returns the number of triangles
+	unsigned long long GetTriangleCount() const
+	{
+		return ( m_nJ > 1 && m_nI > 1 ) ? 2ull * ( m_nJ - 1 ) * ( m_nI - 1 ) : 0;
+	}
+
+	// Returns the position of a vertex in the view
+	int GetJ( int x ) const						{ return min( x * m_step, m_view.GetSizeJ() - 1 ); }
+	int GetI( int y ) const						{ return min( y * m_step, m_view.GetSizeI() - 1 ); }
+
+	// Returns the coordinates of a vertex
+	float GetX( int x ) const					{ return float( GetJ( x ) ) * m_spacing; }
+	float GetY( int y ) const					{ return float( GetI( y ) ) * m_spacing; }
+	float GetZ( int x, int y ) const			{ return m_view.GetZ( GetJ( x ), GetI( y ) ); }
+
+	// Returns the indexes of the two triangles of cell ( x, y ), counter-clockwise from above
+	void GetTriangles( int x, int y, unsigned long long triangles[ 6 ] ) const
+	{
+		unsigned long long const	a	= (unsigned long long)y * m_nJ + x;
+		unsigned long long const	b	= a + 1;
+		unsigned long long const	c	= a + m_nJ;
+		unsigned long long const	d	= c + 1;
+
+		triangles[ 0 ] = a;	triangles[ 1 ] = b;	triangles[ 2 ] = d;
+		triangles[ 3 ] = a;	triangles[ 4 ] = d;	triangles[ 5 ] = c;
+	}
+
+private:
+
+	HeightFieldView	m_view;		// Heightfield
+	float			m_spacing;	// Horizontal distance between adjacent vertexes of the heightfield
+	int				m_step;		// Number of vertexes of the heightfield between vertexes of the mesh
+	int				m_nJ;		// Number of vertexes along the J axis
+	int				m_nI;		// Number of vertexes along the I axis
+};
+
+// Appends a 32-bit integer in little-endian order
+inline char * PutInteger( char * p, unsigned x )
+{
+	p[ 0 ] = char( x );
+	p[ 1 ] = char( x >> 8 );
+	p[ 2 ] = char( x >> 16 );
+	p[ 3 ] = char( x >> 24 );
+	return p + 4;
+}
+
+// Appends a float in little-endian order
+inline char * PutFloat( char * p, float z )
+{
+	unsigned	bits;
+
+	memcpy( &bits, &z, sizeof( bits ) );
+	return PutInteger( p, bits );
+}
+
+// Writes items [ 0, nItems ). The items are formatted in blocks in parallel by format( first, last, p ), which
+// returns the end of the text, and the blocks are written in order. itemSize is the most bytes an item can take.
+template< typename Format >
+void WriteBlocks( ostream & stream, int nItems, size_t itemSize, Format const & format )
+{
+	if ( nItems <= 0 )
+	{
+		return;
+	}
+
+	int const	blockItems	= int( max( BLOCK_SIZE / itemSize, size_t( 1 ) ) );
+	int const	batchBlocks	= int( max( BATCH_SIZE / ( itemSize * blockItems ), size_t( Parallel::GetThreadCount() ) ) );
+
+	vector< vector< char > >	blocks( min( batchBlocks, ( nItems + blockItems - 1 ) / blockItems ) );
+	vector< size_t >			lengths( blocks.size() );
+
+	for ( int batch0 = 0; batch0 < nItems && stream; batch0 += batchBlocks * blockItems )
+	{
+		int const	batch1	= min( batch0 + batchBlocks * blockItems, nItems );
+		int const	nBlocks	= ( batch1 - batch0 + blockItems - 1 ) / blockItems;
+
+		Parallel::For( 0, nBlocks, 1, [ & ]( int first, int last )
+		{
+			for ( int b = first; b < last; b++ )
+			{
+				int const	k0	= batch0 + b * blockItems;
+				int const	k1	= min( k0 + blockItems, batch1 );
+
+				blocks[ b ].resize( itemSize * ( k1 - k0 ) );
+				lengths[ b ] = format( k0, k1, &blocks[ b ][ 0 ] ) - &blocks[ b ][ 0 ];
+			}
+		} );
+
+		for ( int b = 0; b < nBlocks; b++ )
+		{
+			stream.write( &blocks[ b ][ 0 ], lengths[ b ] );
+		}
+	}
+}
+
+// Writes the vertexes as binary floats, one row of vertexes per item. If yUp is true, the coordinates are
+// ( x, z, -y ) instead of ( x, y, z ).
+void WriteBinaryVertexes( ostream & stream, Grid const & grid, bool yUp )
+{
+	WriteBlocks( stream, grid.GetVerticesI(), size_t( grid.GetVerticesJ() ) * 12, [ & ]( int first, int last, char * p )
+	{
+		for ( int y = first; y < last; y++ )
+		{
+			float const	v	= grid.GetY( y );
+
+			for ( int x = 0; x < grid.GetVerticesJ(); x++ )
+			{
+				float const	z	= grid.GetZ( x, y );
+
+				p = PutFloat( p, grid.GetX( x ) );
+				p = PutFloat( p, yUp ? z : v );
+				p = PutFloat( p, yUp ? -v : z );
+			}
+		}
+		return p;
+	} );
+}
+
+// Writes the triangles as binary 32-bit indexes, one row of cells per item. If count is true, each triangle is
+// preceded by a byte containing 3, as in a PLY list.
+void WriteBinaryTriangles( ostream & stream, Grid const & grid, bool count )
+{
+	int const		cellsJ			= grid.GetVerticesJ() - 1;
+	size_t const	triangleSize	= count ? 13 : 12;
+
+	if ( grid.GetTriangleCount() == 0 )
+	{
+		return;
+	}
+
+	WriteBlocks( stream, grid.GetVerticesI() - 1, size_t( cellsJ ) * 2 * triangleSize, [ & ]( int first, int last, char * p )
+	{
+		unsigned long long	triangles[ 6 ];
+
+		for ( int y = first; y < last; y++ )
+		{
+			for ( int x = 0; x < cellsJ; x++ )
+			{
+				grid.GetTriangles( x, y, triangles );
+
+				for ( int k = 0; k < 6; k++ )
+				{
+					if ( count && k % 3 == 0 )
+					{
+						*p++ = 3;
+					}
+					p = PutInteger( p, unsigned( triangles[ k ] ) );
+				}
+			}
+		}
+		return p;
+	} );
+}
+
+} // anonymous namespace
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! The file has a @c vertex element with float properties @c x, @c y and @c z, and a @c face element with a list
+//! property @c vertex_indices (a uchar count and uint indexes).
+//!
+//! @param	stream	Stream to write to. It should be opened in binary mode.
+//! @param	view	Heightfield
+//! @param	spacing	Horizontal distance between adjacent vertexes of the heightfield
+//! @param	step	Number of vertexes of the heightfield between vertexes of the mesh
+//!
+//! @return		false, if the mesh has more than 2^32 vertexes or the stream fails
+//!
+//! @exception	bad_alloc	Unable to allocate the buffers.
+
+bool HeightFieldMeshExporter::WritePly( ostream & stream, HeightFieldView const & view, float spacing /*= 1.0f*/, int step /*= 1*/ )
+{
+	Grid const	grid( view, spacing, step );
+
+	if ( grid.GetVertexCount() > 0x100000000ull )
+	{
+		return false;
+	}
+
+	stream << "ply\n"
+			  "format binary_little_endian 1.0\n"
+			  "element vertex " << grid.GetVertexCount() << "\n"
+			  "property float x\n"
+			  "property float y\n"
+			  "property float z\n"
+			  "element face " << grid.GetTriangleCount() << "\n"
+			  "property list uchar uint vertex_indices\n"
+			  "end_header\n";
+
+	WriteBinaryVertexes( stream, grid, false );
+	WriteBinaryTriangles( stream, grid, true );
+
+	return bool( stream );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! The file contains a single node with a single mesh, whose primitive has a @c POSITION attribute and uint
+//! indexes. The binary chunk holds the positions followed by the indexes.
+//!
+//! @param	stream	Stream to write to. It should be opened in binary mode.
+//! @param	view	Heightfield
+//! @param	spacing	Horizontal distance between adjacent vertexes of the heightfield
+//! @param	step	Number of vertexes of the heightfield between vertexes of the mesh
+//!
+//! @return		false, if the file would be larger than 4 GB (the limit of the format) or the stream fails
+//!
+//! @exception	bad_alloc	Unable to allocate the buffers.
+
+bool HeightFieldMeshExporter::WriteGlb( ostream & stream, HeightFieldView const & view, float spacing /*= 1.0f*/, int step /*= 1*/ )
+{
+	Grid const	grid( view, spacing, step );
+
+	unsigned long long const	positionsSize	= grid.GetVertexCount() * 12;
+	unsigned long long const	indexesSize		= grid.GetTriangleCount() * 12;
+
+	// The accessor of the positions must have their bounds. Only the bounds of the heights must be computed.
+
+	vector< float >	minZ( max( grid.GetVerticesI(), 1 ), numeric_limits< float >::max() );
+	vector< float >	maxZ( max( grid.GetVerticesI(), 1 ), -numeric_limits< float >::max() );
+
+	Parallel::For( 0, grid.GetVerticesI(), 1, [ & ]( int first, int last )
+	{
+		for ( int y = first; y < last; y++ )
+		{
+			for ( int x = 0; x < grid.GetVerticesJ(); x++ )
+			{
+				minZ[ y ] = min( minZ[ y ], grid.GetZ( x, y ) );
+				maxZ[ y ] = max( maxZ[ y ], grid.GetZ( x, y ) );
+			}
+		}
+	} );
+
+	float const	z0	= ( grid.GetVertexCount() > 0 ) ? *min_element( minZ.begin(), minZ.end() ) : 0.0f;
+	float const	z1	= ( grid.GetVertexCount() > 0 ) ? *max_element( maxZ.begin(), maxZ.end() ) : 0.0f;
+	float const	x1	= grid.GetX( max( grid.GetVerticesJ() - 1, 0 ) );
+	float const	y1	= grid.GetY( max( grid.GetVerticesI() - 1, 0 ) );
+
+	// Build the JSON chunk, padded with spaces to a multiple of 4 bytes
+
+	char	number[ MAX_NUMBER_CHARS ];
+
+	auto const	toString	= [ & ]( float x ) -> string
+	{
+		return string( number, to_chars( number, number + MAX_NUMBER_CHARS, x ).ptr );
+	};
+
+	string	json;
+
+	json += "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"mesh\":0}],";
+	json += "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0}";
+	json += ( grid.GetTriangleCount() > 0 ) ? ",\"indices\":1}]}]," : "}]}],";
+	json += "\"buffers\":[{\"byteLength\":" + to_string( positionsSize + indexesSize ) + "}],";
+	json += "\"bufferViews\":[{\"buffer\":0,\"byteOffset\":0,\"byteLength\":" + to_string( positionsSize ) + ",\"target\":34962}";
+	if ( grid.GetTriangleCount() > 0 )
+	{
+		json += ",{\"buffer\":0,\"byteOffset\":" + to_string( positionsSize ) + ",\"byteLength\":" + to_string( indexesSize ) + ",\"target\":34963}";
+	}
+	json += "],\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":" + to_string( grid.GetVertexCount() ) +
+			",\"type\":\"VEC3\",\"min\":[0," + toString( z0 ) + "," + toString( -y1 ) + "],\"max\":[" +
+			toString( x1 ) + "," + toString( z1 ) + ",0]}";
+	if ( grid.GetTriangleCount() > 0 )
+	{
+		json += ",{\"bufferView\":1,\"componentType\":5125,\"count\":" + to_string( grid.GetTriangleCount() * 3 ) + ",\"type\":\"SCALAR\"}";
+	}
+	json += "]}";
+	json.append( ( 4 - json.size() % 4 ) % 4, ' ' );
+
+	unsigned long long const	length	= 12 + 8 + json.size() + 8 + positionsSize + indexesSize;
+
+	if ( length > 0xffffffffull || grid.GetVertexCount() > 0x100000000ull )
+	{
+		return false;
+	}
+
+	char	header[ 20 ];
+	char *	p	= header;
+
+	p = PutInteger( p, 0x46546c67 );		// "glTF"
+	p = PutInteger( p, 2 );
+	p = PutInteger( p, unsigned( length ) );
+	p = PutInteger( p, unsigned( json.size() ) );
+	p = PutInteger( p, 0x4e4f534a );		// "JSON"
+	stream.write( header, p - header );
+	stream.write( json.data(), json.size() );
+
+	p = header;
+	p = PutInteger( p, unsigned( positionsSize + indexesSize ) );
+	p = PutInteger( p, 0x004e4942 );		// "BIN"
+	stream.write( header, p - header );
+
+	WriteBinaryVertexes( stream, grid, true );
+	WriteBinaryTriangles( stream, grid, false );
+
+	return bool( stream );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! Each coordinate is written with the fewest digits that read back as the same value.
+//!
+//! @param	stream	Stream to write to
+//! @param	view	Heightfield
+//! @param	spacing	Horizontal distance between adjacent vertexes of the heightfield
+//! @param	step	Number of vertexes of the heightfield between vertexes of the mesh
+//!
+//! @return		false, if the stream fails
+//!
+//! @exception	bad_alloc	Unable to allocate the buffers.
+
+bool HeightFieldMeshExporter::WriteObj( ostream & stream, HeightFieldView const & view, float spacing /*= 1.0f*/, int step /*= 1*/ )
+{
+	Grid const	grid( view, spacing, step );
+	int const	cellsJ	= grid.GetVerticesJ() - 1;
+
+	WriteBlocks( stream, grid.GetVerticesI(), size_t( grid.GetVerticesJ() ) * ( 3 + 3 * MAX_NUMBER_CHARS ), [ & ]( int first, int last, char * p )
+	{
+		for ( int y = first; y < last; y++ )
+		{
+			float const	v	= grid.GetY( y );
+
+			for ( int x = 0; x < grid.GetVerticesJ(); x++ )
+			{
+				*p++ = 'v';
+				*p++ = ' ';
+				p = to_chars( p, p + MAX_NUMBER_CHARS - 1, grid.GetX( x ) ).ptr;
+				*p++ = ' ';
+				p = to_chars( p, p + MAX_NUMBER_CHARS - 1, v ).ptr;
+				*p++ = ' ';
+				p = to_chars( p, p + MAX_NUMBER_CHARS - 1, grid.GetZ( x, y ) ).ptr;
+				*p++ = '\n';
+			}
+		}
+		return p;
+	} );
+
+	if ( grid.GetTriangleCount() > 0 )
+	{
+		WriteBlocks( stream, grid.GetVerticesI() - 1, size_t( cellsJ ) * 2 * ( 3 + 3 * MAX_NUMBER_CHARS ), [ & ]( int first, int last, char * p )
+		{
+			unsigned long long	triangles[ 6 ];
+
+			for ( int y = first; y < last; y++ )
+			{
+				for ( int x = 0; x < cellsJ; x++ )
+				{
+					grid.GetTriangles( x, y, triangles );
+
+					for ( int k = 0; k < 6; k++ )
+					{
+						if ( k % 3 == 0 )
+						{
+							*p++ = 'f';
+						}
+						*p++ = ' ';
+						p = to_chars( p, p + MAX_NUMBER_CHARS - 1, triangles[ k ] + 1 ).ptr;	// OBJ indexes start at 1
+						if ( k % 3 == 2 )
+						{
+							*p++ = '\n';
+						}
+					}
+				}
+			}
+			return p;
+		} );
+	}
+
+	return bool( stream );
+}
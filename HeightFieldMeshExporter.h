@@ -0,0 +1,50 @@
+/** @file *//********************************************************************************************************
+
+                                               HeightFieldMeshExporter.h
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/HeightFieldMeshExporter.h#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#pragma once
+
+#include <iosfwd>
+
+class HeightFieldView;
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! Writes the triangle mesh of a heightfield in common 3D formats.
+//!
+//! The mesh has a vertex at every @a step vertexes of the view along each axis, plus the last row and column, so
+//! it always covers the whole view. A sub-rectangle is exported by passing a sub-view. Each cell is split into two
+//! triangles by the diagonal from ( j, i ) to ( j + step, i + step ), as in HeightFieldView::GetInterpolatedZ(),
+//! and the triangles are counter-clockwise when viewed from above.
+//!
+//! The mesh is never built in memory. The vertexes and then the triangles are formatted in blocks of rows, in
+//! parallel, and written in order, so the memory used does not depend on the size of the mesh.
+//!
+//! In PLY and OBJ files, X is along J, Y is along I, and Z is the height. glTF is Y-up, so in glTF files X is along
+//! J, Y is the height, and -Z is along I.
+
+class HeightFieldMeshExporter
+{
+public:
+
+	//! Writes a binary (little-endian) PLY file.
+	static bool WritePly( std::ostream & stream, HeightFieldView const & view, float spacing = 1.0f, int step = 1 );
+
+	//! Writes a binary glTF (.glb) file.
+	static bool WriteGlb( std::ostream & stream, HeightFieldView const & view, float spacing = 1.0f, int step = 1 );
+
+	//! Writes a Wavefront OBJ file.
+	static bool WriteObj( std::ostream & stream, HeightFieldView const & view, float spacing = 1.0f, int step = 1 );
+};
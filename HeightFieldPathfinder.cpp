@@ -0,0 +1,812 @@
+/** @file *//********************************************************************************************************
+
+                                                HeightFieldPathfinder.cpp
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/HeightFieldPathfinder.cpp#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#include "PrecompiledHeaders.h"
+
+#include "HeightFieldPathfinder.h"
+
+#include "HeightField.h"
+#include "Parallel.h"
+
+#include <functional>
+#include <queue>
+
+using namespace std;
+
+
+namespace
+{
+
+float const	SQRT2		= 1.41421356f;
+float const	INFINITE	= numeric_limits< float >::max();
+
+// Runs of crossable vertexes at least this long get an entrance at each end instead of one in the middle
+int const	LONG_ENTRANCE	= 6;
+
+// Offsets of the 8 neighbors of a vertex
+int const	NEIGHBOR_J[ 8 ]	= { 1, 1, 0, -1, -1, -1, 0, 1 };
+int const	NEIGHBOR_I[ 8 ]	= { 0, 1, 1, 1, 0, -1, -1, -1 };
+
+// An entry in the open list of a search
+typedef pair< float, int >	OpenEntry;
+typedef priority_queue< OpenEntry, vector< OpenEntry >, greater< OpenEntry > >	OpenList;
+
+// Returns a lower bound of the cost between two vertexes (the octile distance)
+float EstimateCost( int dj, int di, float spacing )
+{
+	dj = abs( dj );
+	di = abs( di );
+	return spacing * ( float( max( dj, di ) - min( dj, di ) ) + SQRT2 * float( min( dj, di ) ) );
+}
+
+} // anonymous namespace
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	spacing			Horizontal distance between adjacent vertexes
+//! @param	maxSlope		Steepest slope (rise / run) that can be traversed
+//! @param	maxStep			Largest change in height between adjacent vertexes that can be traversed
+//! @param	slopePenalty	Additional cost per unit of slope
+
+HeightFieldPathfinder::Traversability::Traversability( float spacing /*= 1.0f*/,
+													   float maxSlope /*= 1.0f*/,
+													   float maxStep /*= 1.0e30f*/,
+													   float slopePenalty /*= 1.0f*/ )
+	: m_Spacing( spacing ),
+	m_MaxSlope( maxSlope ),
+	m_MaxStep( maxStep ),
+	m_SlopePenalty( slopePenalty )
+{
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	hf				Terrain. It must outlive the pathfinder.
+//! @param	traversability	Movement rules
+//! @param	clusterSize		Size of a cluster along each axis. Larger clusters make queries faster and updates
+//!							slower.
+//!
+//! @exception	bad_alloc	Unable to allocate the graph.
+
+HeightFieldPathfinder::HeightFieldPathfinder( HeightField const &		hf,
+											  Traversability const &	traversability,
+											  int						clusterSize /*= 32*/ )
+	: m_hf( hf ),
+	m_traversability( traversability ),
+	m_clusterSize( clusterSize ),
+	m_clustersJ( ( hf.GetSizeJ() + clusterSize - 1 ) / clusterSize ),
+	m_clustersI( ( hf.GetSizeI() + clusterSize - 1 ) / clusterSize )
+{
+	assert( clusterSize >= 2 );
+	assert( traversability.m_Spacing > 0.0f );
+
+	int const	nClusters	= m_clustersJ * m_clustersI;
+
+	m_clusters.resize( nClusters );
+	m_borderNodes.resize( nClusters * 2 );
+
+	vector< int >	borders( nClusters * 2 );
+	vector< char >	changed( nClusters, 0 );
+
+	for ( int b = 0; b < nClusters * 2; b++ )
+	{
+		borders[ b ] = b;
+	}
+
+	RebuildBorders( borders, changed );
+
+	Parallel::For( 0, nClusters, 1, [ this ]( int first, int last )
+	{
+		for ( int c = first; c < last; c++ )
+		{
+			ComputeClusterCosts( c );
+		}
+	} );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	a	A vertex
+//! @param	b	A vertex adjacent to @a a (including diagonally)
+//!
+//! @return		The cost of the step, or -1 if it is impassable. The cost is the same in both directions.
+
+float HeightFieldPathfinder::GetStepCost( Point const & a, Point const & b ) const
+{
+	int const	dj	= abs( b.m_J - a.m_J );
+	int const	di	= abs( b.m_I - a.m_I );
+
+	assert( dj <= 1 && di <= 1 && dj + di > 0 );
+
+	float const	run		= ( dj + di == 2 ) ? m_traversability.m_Spacing * SQRT2 : m_traversability.m_Spacing;
+	float const	rise	= fabsf( m_hf.GetZ( b.m_J, b.m_I ) - m_hf.GetZ( a.m_J, a.m_I ) );
+
+	if ( rise > m_traversability.m_MaxStep || rise > m_traversability.m_MaxSlope * run )
+	{
+		return -1.0f;
+	}
+
+	return run + m_traversability.m_SlopePenalty * rise;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! The abstract path is found with A* over the entrances. The start and the goal are connected to the entrances
+//! of their clusters by searching those clusters. The detailed path is then found one cluster at a time. If the
+//! start and the goal are in the same or adjacent clusters, a direct path within those clusters is used if it is
+//! cheaper.
+//!
+//! @param	start	Starting vertex
+//! @param	goal	Destination vertex
+//! @param	path	Receives the vertexes along the path, including @a start and @a goal
+//! @param	pCost	If not 0, receives the cost of the path
+//!
+//! @return		false if there is no path
+
+bool HeightFieldPathfinder::FindPath( Point const & start, Point const & goal, vector< Point > & path, float * pCost /*= 0*/ ) const
+{
+	path.clear();
+
+	if ( start.m_J == goal.m_J && start.m_I == goal.m_I )
+	{
+		path.push_back( start );
+		if ( pCost != 0 )
+		{
+			*pCost = 0.0f;
+		}
+		return true;
+	}
+
+	int const	startCluster	= GetClusterIndex( start );
+	int const	goalCluster		= GetClusterIndex( goal );
+	Rect const	startRect		= GetClusterRect( startCluster );
+	Rect const	goalRect		= GetClusterRect( goalCluster );
+
+	// Connect the start and the goal to the entrances of their clusters. Costs are symmetric, so the costs from
+	// the goal are the costs to it.
+
+	vector< float >	fromStart;
+	vector< float >	toGoal;
+
+	Dijkstra( startRect, start, fromStart );
+	Dijkstra( goalRect, goal, toGoal );
+
+	auto const	costInRect	= [ this ]( vector< float > const & costs, Rect const & rect, Point const & p )
+	{
+		return costs[ ( p.m_I - rect.m_I0 ) * ( rect.m_J1 - rect.m_J0 ) + ( p.m_J - rect.m_J0 ) ];
+	};
+
+	// A* over the entrances. The start and goal are given the indexes following the entrances.
+
+	int const	nNodes		= int( m_nodes.size() );
+	int const	START		= nNodes;
+	int const	GOAL		= nNodes + 1;
+	float const	spacing		= m_traversability.m_Spacing;
+
+	vector< float >	g( nNodes + 2, INFINITE );
+	vector< int >	parent( nNodes + 2, -1 );
+	vector< char >	closed( nNodes + 2, 0 );
+	OpenList		open;
+
+	auto const	pointOf	= [ & ]( int n ) { return ( n == START ) ? start : ( ( n == GOAL ) ? goal : m_nodes[ n ].m_Point ); };
+
+	auto const	relax	= [ & ]( int from, int to, float cost )
+	{
+		float const	newG	= g[ from ] + cost;
+
+		if ( newG < g[ to ] )
+		{
+			Point const	p	= pointOf( to );
+
+			g[ to ]			= newG;
+			parent[ to ]	= from;
+			open.push( OpenEntry( newG + EstimateCost( goal.m_J - p.m_J, goal.m_I - p.m_I, spacing ), to ) );
+		}
+	};
+
+	g[ START ] = 0.0f;
+	open.push( OpenEntry( 0.0f, START ) );
+
+	while ( !open.empty() )
+	{
+		int const	u	= open.top().second;
+
+		open.pop();
+
+		if ( closed[ u ] )
+		{
+			continue;
+		}
+
+		closed[ u ] = 1;
+
+		if ( u == GOAL )
+		{
+			break;
+		}
+
+		if ( u == START )
+		{
+			Cluster const &	cluster	= m_clusters[ startCluster ];
+
+			for ( size_t k = 0; k < cluster.m_Nodes.size(); k++ )
+			{
+				float const	cost	= costInRect( fromStart, startRect, m_nodes[ cluster.m_Nodes[ k ] ].m_Point );
+
+				if ( cost < INFINITE )
+				{
+					relax( START, cluster.m_Nodes[ k ], cost );
+				}
+			}
+
+			if ( startCluster == goalCluster && costInRect( fromStart, startRect, goal ) < INFINITE )
+			{
+				relax( START, GOAL, costInRect( fromStart, startRect, goal ) );
+			}
+
+			continue;
+		}
+
+		Node const &	node	= m_nodes[ u ];
+		Cluster const &	cluster	= m_clusters[ node.m_Cluster ];
+		int const		n		= int( cluster.m_Nodes.size() );
+		int const		slot	= int( find( cluster.m_Nodes.begin(), cluster.m_Nodes.end(), u ) - cluster.m_Nodes.begin() );
+
+		for ( int k = 0; k < n; k++ )
+		{
+			float const	cost	= cluster.m_Costs[ slot * n + k ];
+
+			if ( k != slot && cost >= 0.0f )
+			{
+				relax( u, cluster.m_Nodes[ k ], cost );
+			}
+		}
+
+		relax( u, node.m_Partner, node.m_CrossCost );
+
+		if ( node.m_Cluster == goalCluster )
+		{
+			float const	cost	= costInRect( toGoal, goalRect, node.m_Point );
+
+			if ( cost < INFINITE )
+			{
+				relax( u, GOAL, cost );
+			}
+		}
+	}
+
+	// If the start and the goal are close, the path through the entrances may be much longer than the direct
+	// path, so the clusters containing them are also searched directly.
+
+	int const	dcj	= abs( goalCluster % m_clustersJ - startCluster % m_clustersJ );
+	int const	dci	= abs( goalCluster / m_clustersJ - startCluster / m_clustersJ );
+
+	if ( dcj <= 1 && dci <= 1 )
+	{
+		Rect const	rect	= { min( startRect.m_J0, goalRect.m_J0 ), min( startRect.m_I0, goalRect.m_I0 ),
+								max( startRect.m_J1, goalRect.m_J1 ), max( startRect.m_I1, goalRect.m_I1 ) };
+		float		cost;
+
+		if ( FindLocalPath( rect, start, goal, path, &cost ) && cost <= g[ GOAL ] )
+		{
+			if ( pCost != 0 )
+			{
+				*pCost = cost;
+			}
+			return true;
+		}
+
+		path.clear();
+	}
+
+	if ( g[ GOAL ] == INFINITE )
+	{
+		return false;
+	}
+
+	// Refine the abstract path. Each step is either a crossing between partners or a path within a cluster.
+
+	vector< int >	abstractPath;
+
+	for ( int n = GOAL; n != -1; n = parent[ n ] )
+	{
+		abstractPath.push_back( n );
+	}
+
+	reverse( abstractPath.begin(), abstractPath.end() );
+
+	vector< Point >	segment;
+
+	path.push_back( start );
+
+	for ( size_t k = 1; k < abstractPath.size(); k++ )
+	{
+		int const	a	= abstractPath[ k - 1 ];
+		int const	b	= abstractPath[ k ];
+
+		if ( a < nNodes && m_nodes[ a ].m_Partner == b )
+		{
+			path.push_back( m_nodes[ b ].m_Point );
+			continue;
+		}
+
+		int const	cluster	= ( a == START ) ? startCluster : m_nodes[ a ].m_Cluster;
+
+		FindLocalPath( GetClusterRect( cluster ), pointOf( a ), pointOf( b ), segment );
+		path.insert( path.end(), segment.begin() + 1, segment.end() );
+	}
+
+	if ( pCost != 0 )
+	{
+		*pCost = g[ GOAL ];
+	}
+
+	return true;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! Every step to or from a vertex in the rectangle may have changed, so the clusters containing the rectangle and
+//! the vertexes around it have their entrances and costs rebuilt.
+//!
+//! @param	j	J index of the first vertex that changed
+//! @param	i	I index of the first vertex that changed
+//! @param	sj	Width of the rectangle along the J axis
+//! @param	si	Width of the rectangle along the I axis
+//!
+//! @exception	bad_alloc	Unable to allocate the new entrances.
+
+void HeightFieldPathfinder::Update( int j, int i, int sj, int si )
+{
+	if ( sj <= 0 || si <= 0 )
+	{
+		return;
+	}
+
+	int const	cj0	= max( j - 1, 0 ) / m_clusterSize;
+	int const	ci0	= max( i - 1, 0 ) / m_clusterSize;
+	int const	cj1	= min( j + sj, m_hf.GetSizeJ() - 1 ) / m_clusterSize;
+	int const	ci1	= min( i + si, m_hf.GetSizeI() - 1 ) / m_clusterSize;
+
+	// The borders of the affected clusters, including those owned by the clusters before them
+
+	vector< int >	borders;
+	vector< char >	changed( m_clusters.size(), 0 );
+
+	for ( int ci = ci0; ci <= ci1; ci++ )
+	{
+		for ( int cj = cj0; cj <= cj1; cj++ )
+		{
+			int const	c	= ci * m_clustersJ + cj;
+
+			changed[ c ] = 1;
+			borders.push_back( c * 2 );
+			borders.push_back( c * 2 + 1 );
+
+			if ( cj == cj0 && cj > 0 )
+			{
+				borders.push_back( ( c - 1 ) * 2 );
+			}
+
+			if ( ci == ci0 && ci > 0 )
+			{
+				borders.push_back( ( c - m_clustersJ ) * 2 + 1 );
+			}
+		}
+	}
+
+	RebuildBorders( borders, changed );
+
+	vector< int >	rebuild;
+
+	for ( size_t c = 0; c < changed.size(); c++ )
+	{
+		if ( changed[ c ] )
+		{
+			rebuild.push_back( int( c ) );
+		}
+	}
+
+	Parallel::For( 0, int( rebuild.size() ), 1, [ & ]( int first, int last )
+	{
+		for ( int k = first; k < last; k++ )
+		{
+			ComputeClusterCosts( rebuild[ k ] );
+		}
+	} );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+int HeightFieldPathfinder::GetClusterIndex( Point const & p ) const
+{
+	assert_limits( 0, p.m_J, m_hf.GetSizeJ() - 1 );
+	assert_limits( 0, p.m_I, m_hf.GetSizeI() - 1 );
+
+	return ( p.m_I / m_clusterSize ) * m_clustersJ + ( p.m_J / m_clusterSize );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+HeightFieldPathfinder::Rect HeightFieldPathfinder::GetClusterRect( int cluster ) const
+{
+	int const	j0	= ( cluster % m_clustersJ ) * m_clusterSize;
+	int const	i0	= ( cluster / m_clustersJ ) * m_clusterSize;
+
+	Rect const	rect	= { j0, i0, min( j0 + m_clusterSize, m_hf.GetSizeJ() ), min( i0 + m_clusterSize, m_hf.GetSizeI() ) };
+
+	return rect;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+void HeightFieldPathfinder::FindEntrances( int border, vector< Node > & nodes ) const
+{
+	nodes.clear();
+
+	int const	cluster	= border / 2;
+	bool const	alongI	= ( border & 1 ) != 0;
+	Rect const	rect	= GetClusterRect( cluster );
+
+	// Find the neighboring cluster and the line of vertexes along the border
+
+	int		neighbor;
+	int		length;
+
+	if ( alongI )
+	{
+		if ( rect.m_I1 >= m_hf.GetSizeI() )
+		{
+			return;
+		}
+		neighbor	= cluster + m_clustersJ;
+		length		= rect.m_J1 - rect.m_J0;
+	}
+	else
+	{
+		if ( rect.m_J1 >= m_hf.GetSizeJ() )
+		{
+			return;
+		}
+		neighbor	= cluster + 1;
+		length		= rect.m_I1 - rect.m_I0;
+	}
+
+	// Returns the vertexes on each side of the border at position k along it
+	auto const	inside	= [ & ]( int k ) -> Point
+	{
+		Point const	p	= { alongI ? rect.m_J0 + k : rect.m_J1 - 1, alongI ? rect.m_I1 - 1 : rect.m_I0 + k };
+		return p;
+	};
+
+	auto const	outside	= [ & ]( int k ) -> Point
+	{
+		Point const	p	= { alongI ? rect.m_J0 + k : rect.m_J1, alongI ? rect.m_I1 : rect.m_I0 + k };
+		return p;
+	};
+
+	auto const	addEntrance	= [ & ]( int k )
+	{
+		Node const	a	= { inside( k ), cluster, -1, GetStepCost( inside( k ), outside( k ) ) };
+		Node const	b	= { outside( k ), neighbor, -1, a.m_CrossCost };
+
+		nodes.push_back( a );
+		nodes.push_back( b );
+	};
+
+	// Each run of vertexes where the border can be crossed gets one or two entrances
+
+	int	runStart	= -1;
+
+	for ( int k = 0; k <= length; k++ )
+	{
+		bool const	open	= ( k < length ) && GetStepCost( inside( k ), outside( k ) ) >= 0.0f;
+
+		if ( open && runStart < 0 )
+		{
+			runStart = k;
+		}
+		else if ( !open && runStart >= 0 )
+		{
+			int const	runLength	= k - runStart;
+
+			if ( runLength >= LONG_ENTRANCE )
+			{
+				addEntrance( runStart );
+				addEntrance( k - 1 );
+			}
+			else
+			{
+				addEntrance( runStart + runLength / 2 );
+			}
+
+			runStart = -1;
+		}
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+void HeightFieldPathfinder::RebuildBorders( vector< int > const & borders, vector< char > & changed )
+{
+	// Find the new entrances in parallel
+
+	vector< vector< Node > >	entrances( borders.size() );
+
+	Parallel::For( 0, int( borders.size() ), 1, [ & ]( int first, int last )
+	{
+		for ( int k = first; k < last; k++ )
+		{
+			FindEntrances( borders[ k ], entrances[ k ] );
+		}
+	} );
+
+	for ( size_t k = 0; k < borders.size(); k++ )
+	{
+		vector< int > &	borderNodes	= m_borderNodes[ borders[ k ] ];
+
+		// Remove the old entrances
+
+		for ( size_t n = 0; n < borderNodes.size(); n++ )
+		{
+			Node &				node	= m_nodes[ borderNodes[ n ] ];
+			vector< int > &		nodes	= m_clusters[ node.m_Cluster ].m_Nodes;
+
+			nodes.erase( find( nodes.begin(), nodes.end(), borderNodes[ n ] ) );
+			changed[ node.m_Cluster ] = 1;
+			node.m_Partner = -1;
+			m_freeNodes.push_back( borderNodes[ n ] );
+		}
+
+		borderNodes.clear();
+
+		// Add the new ones. They come in pairs of partners.
+
+		vector< Node > const &	newNodes	= entrances[ k ];
+
+		for ( size_t n = 0; n < newNodes.size(); n += 2 )
+		{
+			int	index[ 2 ];
+
+			for ( int side = 0; side < 2; side++ )
+			{
+				if ( !m_freeNodes.empty() )
+				{
+					index[ side ] = m_freeNodes.back();
+					m_freeNodes.pop_back();
+					m_nodes[ index[ side ] ] = newNodes[ n + side ];
+				}
+				else
+				{
+					index[ side ] = int( m_nodes.size() );
+					m_nodes.push_back( newNodes[ n + side ] );
+				}
+			}
+
+			for ( int side = 0; side < 2; side++ )
+			{
+				Node &	node	= m_nodes[ index[ side ] ];
+
+				node.m_Partner = index[ 1 - side ];
+				m_clusters[ node.m_Cluster ].m_Nodes.push_back( index[ side ] );
+				changed[ node.m_Cluster ] = 1;
+				borderNodes.push_back( index[ side ] );
+			}
+		}
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+void HeightFieldPathfinder::ComputeClusterCosts( int c )
+{
+	Cluster &		cluster	= m_clusters[ c ];
+	Rect const		rect	= GetClusterRect( c );
+	int const		n		= int( cluster.m_Nodes.size() );
+	int const		width	= rect.m_J1 - rect.m_J0;
+	vector< float >	costs;
+
+	cluster.m_Costs.assign( size_t( n ) * n, -1.0f );
+
+	for ( int a = 0; a < n; a++ )
+	{
+		Dijkstra( rect, m_nodes[ cluster.m_Nodes[ a ] ].m_Point, costs );
+
+		for ( int b = 0; b < n; b++ )
+		{
+			Point const &	p		= m_nodes[ cluster.m_Nodes[ b ] ].m_Point;
+			float const		cost	= costs[ ( p.m_I - rect.m_I0 ) * width + ( p.m_J - rect.m_J0 ) ];
+
+			if ( cost < INFINITE )
+			{
+				cluster.m_Costs[ a * n + b ] = cost;
+			}
+		}
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+void HeightFieldPathfinder::Dijkstra( Rect const & rect, Point const & from, vector< float > & costs ) const
+{
+	int const	width	= rect.m_J1 - rect.m_J0;
+	int const	height	= rect.m_I1 - rect.m_I0;
+
+	costs.assign( size_t( width ) * height, INFINITE );
+
+	OpenList	open;
+	int const	start	= ( from.m_I - rect.m_I0 ) * width + ( from.m_J - rect.m_J0 );
+
+	costs[ start ] = 0.0f;
+	open.push( OpenEntry( 0.0f, start ) );
+
+	while ( !open.empty() )
+	{
+		OpenEntry const	entry	= open.top();
+
+		open.pop();
+
+		if ( entry.first > costs[ entry.second ] )
+		{
+			continue;
+		}
+
+		Point const	p	= { rect.m_J0 + entry.second % width, rect.m_I0 + entry.second / width };
+
+		for ( int d = 0; d < 8; d++ )
+		{
+			Point const	q	= { p.m_J + NEIGHBOR_J[ d ], p.m_I + NEIGHBOR_I[ d ] };
+
+			if ( q.m_J < rect.m_J0 || q.m_J >= rect.m_J1 || q.m_I < rect.m_I0 || q.m_I >= rect.m_I1 )
+			{
+				continue;
+			}
+
+			float const	step	= GetStepCost( p, q );
+
+			if ( step >= 0.0f )
+			{
+				int const	k		= ( q.m_I - rect.m_I0 ) * width + ( q.m_J - rect.m_J0 );
+				float const	cost	= entry.first + step;
+
+				if ( cost < costs[ k ] )
+				{
+					costs[ k ] = cost;
+					open.push( OpenEntry( cost, k ) );
+				}
+			}
+		}
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+bool HeightFieldPathfinder::FindLocalPath( Rect const & rect, Point const & from, Point const & to, vector< Point > & path, float * pCost /*= 0*/ ) const
+{
+	path.clear();
+
+	int const	width	= rect.m_J1 - rect.m_J0;
+	int const	height	= rect.m_I1 - rect.m_I0;
+	float const	spacing	= m_traversability.m_Spacing;
+
+	vector< float >	g( size_t( width ) * height, INFINITE );
+	vector< int >	parent( g.size(), -1 );
+	OpenList		open;
+
+	int const	start	= ( from.m_I - rect.m_I0 ) * width + ( from.m_J - rect.m_J0 );
+	int const	goal	= ( to.m_I - rect.m_I0 ) * width + ( to.m_J - rect.m_J0 );
+
+	g[ start ] = 0.0f;
+	open.push( OpenEntry( EstimateCost( to.m_J - from.m_J, to.m_I - from.m_I, spacing ), start ) );
+
+	while ( !open.empty() )
+	{
+		int const	u	= open.top().second;
+		float const	f	= open.top().first;
+
+		open.pop();
+
+		if ( u == goal )
+		{
+			break;
+		}
+
+		Point const	p	= { rect.m_J0 + u % width, rect.m_I0 + u / width };
+
+		if ( f > g[ u ] + EstimateCost( to.m_J - p.m_J, to.m_I - p.m_I, spacing ) )
+		{
+			continue;
+		}
+
+		for ( int d = 0; d < 8; d++ )
+		{
+			Point const	q	= { p.m_J + NEIGHBOR_J[ d ], p.m_I + NEIGHBOR_I[ d ] };
+
+			if ( q.m_J < rect.m_J0 || q.m_J >= rect.m_J1 || q.m_I < rect.m_I0 || q.m_I >= rect.m_I1 )
+			{
+				continue;
+			}
+
+			float const	step	= GetStepCost( p, q );
+
+			if ( step >= 0.0f )
+			{
+				int const	k		= ( q.m_I - rect.m_I0 ) * width + ( q.m_J - rect.m_J0 );
+				float const	cost	= g[ u ] + step;
+
+				if ( cost < g[ k ] )
+				{
+					g[ k ]		= cost;
+					parent[ k ]	= u;
+					open.push( OpenEntry( cost + EstimateCost( to.m_J - q.m_J, to.m_I - q.m_I, spacing ), k ) );
+				}
+			}
+		}
+	}
+
+	if ( g[ goal ] == INFINITE )
+	{
+		return false;
+	}
+
+	for ( int k = goal; k != -1; k = parent[ k ] )
+	{
+		Point const	p	= { rect.m_J0 + k % width, rect.m_I0 + k / width };
+		path.push_back( p );
+	}
+
+	reverse( path.begin(), path.end() );
+
+	if ( pCost != 0 )
+	{
+		*pCost = g[ goal ];
+	}
+
+	return true;
+}
@@ -0,0 +1,136 @@
+/** @file *//********************************************************************************************************
+
+                                                 HeightFieldPathfinder.h
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/HeightFieldPathfinder.h#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#pragma once
+
+#include <vector>
+
+class HeightField;
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! Finds paths across a HeightField using hierarchical pathfinding (HPA*).
+//!
+//! Paths move between the 8 neighbors of a vertex. The cost of a step is its horizontal length, increased in
+//! proportion to its slope. Steps that are too steep or too high are impassable.
+//!
+//! The heightfield is divided into square clusters. Where two adjacent clusters can be crossed, entrances are
+//! placed on their border, and the costs of the paths between the entrances of each cluster are precomputed. The
+//! clusters are processed in parallel. A query searches the small graph of entrances and then computes the
+//! detailed path only within the clusters the abstract path goes through. When heights change, only the clusters
+//! around the change are rebuilt.
+//!
+//! Paths are near-optimal: the path between two entrances is optimal, but a path is forced to cross borders at
+//! entrances. When the start and goal are in the same or adjacent clusters, a direct search of those clusters is
+//! also done, since forcing a short path through entrances can make it much longer.
+//!
+//! @note	The heightfield must outlive the pathfinder. FindPath() may be called by several threads at the same
+//!			time, but not while Update() is running.
+
+class HeightFieldPathfinder
+{
+public:
+
+	//! A vertex of the heightfield
+	struct Point
+	{
+		int	m_J;	//!< Position along the J axis
+		int	m_I;	//!< Position along the I axis
+	};
+
+	//! Determines which steps can be taken and what they cost
+	struct Traversability
+	{
+		//! Constructor
+		Traversability( float spacing = 1.0f, float maxSlope = 1.0f, float maxStep = 1.0e30f, float slopePenalty = 1.0f );
+
+		float	m_Spacing;		//!< Horizontal distance between adjacent vertexes
+		float	m_MaxSlope;		//!< Steepest slope (rise / run) that can be traversed
+		float	m_MaxStep;		//!< Largest change in height between adjacent vertexes that can be traversed
+		float	m_SlopePenalty;	//!< The cost of a step is its length * ( 1 + m_SlopePenalty * slope ).
+	};
+
+	//! Constructor
+	HeightFieldPathfinder( HeightField const & hf, Traversability const & traversability, int clusterSize = 32 );
+
+	//! Finds a path between two vertexes.
+	bool FindPath( Point const & start, Point const & goal, std::vector< Point > & path, float * pCost = 0 ) const;
+
+	//! Rebuilds the clusters affected by a change in the heights of a rectangle.
+	void Update( int j, int i, int sj, int si );
+
+	//! Returns the cost of a step between two adjacent vertexes, or a negative value if it is impassable.
+	float GetStepCost( Point const & a, Point const & b ) const;
+
+private:
+
+	// An entrance to a cluster
+	struct Node
+	{
+		Point	m_Point;		// Location
+		int		m_Cluster;		// Index of the cluster
+		int		m_Partner;		// Node on the other side of the border, or -1 if the node has been removed
+		float	m_CrossCost;	// Cost of the step to the partner
+	};
+
+	// A square group of vertexes
+	struct Cluster
+	{
+		std::vector< int >		m_Nodes;	// Entrances to the cluster
+		std::vector< float >	m_Costs;	// Cost of the path between each pair of entrances (negative if none)
+	};
+
+	// A rectangle of vertexes
+	struct Rect
+	{
+		int	m_J0;
+		int	m_I0;
+		int	m_J1;	// One past the last column
+		int	m_I1;	// One past the last row
+	};
+
+	// Returns the index of the cluster containing a vertex
+	int GetClusterIndex( Point const & p ) const;
+
+	// Returns the vertexes in a cluster
+	Rect GetClusterRect( int cluster ) const;
+
+	// Finds the entrances on a border. Border 2c is between cluster c and the next cluster along J, and border
+	// 2c+1 is between cluster c and the next cluster along I. The entrances are returned in pairs of partners.
+	void FindEntrances( int border, std::vector< Node > & nodes ) const;
+
+	// Replaces the entrances on a set of borders and marks the clusters whose entrances changed
+	void RebuildBorders( std::vector< int > const & borders, std::vector< char > & changed );
+
+	// Computes the costs between the entrances of a cluster
+	void ComputeClusterCosts( int cluster );
+
+	// Computes the cost of the cheapest path from a vertex to every vertex of a rectangle
+	void Dijkstra( Rect const & rect, Point const & from, std::vector< float > & costs ) const;
+
+	// Finds the cheapest path between two vertexes within a rectangle. Returns false if there is none.
+	bool FindLocalPath( Rect const & rect, Point const & from, Point const & to, std::vector< Point > & path, float * pCost = 0 ) const;
+
+	HeightField const &					m_hf;				//!< The terrain
+	Traversability						m_traversability;	//!< Movement rules
+	int									m_clusterSize;		//!< Size of a cluster along each axis
+	int									m_clustersJ;		//!< Number of clusters along the J axis
+	int									m_clustersI;		//!< Number of clusters along the I axis
+	std::vector< Node >					m_nodes;			//!< All entrances, including removed ones
+	std::vector< int >					m_freeNodes;		//!< Indexes of removed entrances that can be reused
+	std::vector< Cluster >				m_clusters;			//!< Clusters
+	std::vector< std::vector< int > >	m_borderNodes;		//!< Entrances on each border (see FindEntrances())
+};
@@ -0,0 +1,189 @@
+/** @file *//********************************************************************************************************
+
+                                                 HeightFieldProfile.cpp
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/HeightFieldProfile.cpp#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#include "PrecompiledHeaders.h"
+
+#include "HeightFieldProfile.h"
+
+#include "HeightFieldView.h"
+#include "Parallel.h"
+
+using namespace std;
+
+
+namespace
+{
+
+// Crossings closer than this (as a fraction of the segment) are treated as one, such as at a vertex, where a
+// row, a column and a diagonal all cross.
+double const	COINCIDENT	= 1.0e-9;
+
+// Steps through the crossings of a segment with a family of evenly spaced parallel lines. The segment goes from
+// u0 to u0 + du, where u is the coordinate measured across the lines, which are at multiples of spacing.
+class LineWalker
+{
+public:
+
+	LineWalker( double u0, double du, double spacing )
+	{
+		if ( du > 0.0 )
+		{
+			m_t		= ( ( floor( u0 / spacing ) + 1.0 ) * spacing - u0 ) / du;
+			m_dt	= spacing / du;
+		}
+		else if ( du < 0.0 )
+		{
+			m_t		= ( ( ceil( u0 / spacing ) - 1.0 ) * spacing - u0 ) / du;
+			m_dt	= -spacing / du;
+		}
+		else
+		{
+			m_t		= numeric_limits< double >::max();
+			m_dt	= 0.0;
+		}
+	}
+
+	// Returns the position of the next crossing along the segment
+	double GetNext() const	{ return m_t; }
+
+	// Moves past the crossings before the given position
+	void Advance( double t )
+	{
+		while ( m_t <= t + COINCIDENT )
+		{
+			m_t += m_dt;
+		}
+	}
+
+private:
+
+	double	m_t;	// Position of the next crossing, as a fraction of the segment
+	double	m_dt;	// Distance between crossings, as a fraction of the segment
+};
+
+// Appends a sample of the surface
+void AddSample( HeightFieldView const & view, double j, double i, double distance, int step,
+				HeightFieldProfile::Profile & profile )
+{
+	HeightFieldProfile::Sample	s;
+
+	s.m_J			= min( max( float( j ), 0.0f ), float( view.GetSizeJ() - 1 ) );
+	s.m_I			= min( max( float( i ), 0.0f ), float( view.GetSizeI() - 1 ) );
+	s.m_Z			= view.GetInterpolatedZ( s.m_J, s.m_I, step );
+	s.m_Distance	= float( distance );
+
+	profile.push_back( s );
+}
+
+} // anonymous namespace
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! The profile includes a sample at each point of the polyline and at each point where the polyline crosses a
+//! row, a column or a diagonal of the triangulation, in order. Consecutive samples are never at the same place.
+//!
+//! @param	view		Heightfield
+//! @param	polyline	Points of the polyline, in grid coordinates. They must be within the heightfield.
+//! @param	profile		Receives the samples. Its capacity is reused.
+//! @param	step		Size of a cell, as for HeightFieldView::GetInterpolatedZ()
+//!
+//! @exception	bad_alloc	Unable to allocate the samples.
+
+void HeightFieldProfile::Compute( HeightFieldView const & view, Polyline const & polyline, Profile & profile, int step /*= 1*/ )
+{
+	profile.clear();
+
+	if ( polyline.empty() )
+	{
+		return;
+	}
+
+	double	distance	= 0.0;
+
+	AddSample( view, polyline[ 0 ].m_J, polyline[ 0 ].m_I, distance, step, profile );
+
+	for ( size_t k = 1; k < polyline.size(); k++ )
+	{
+		double const	j0		= polyline[ k - 1 ].m_J;
+		double const	i0		= polyline[ k - 1 ].m_I;
+		double const	dj		= polyline[ k ].m_J - j0;
+		double const	di		= polyline[ k ].m_I - i0;
+		double const	length	= sqrt( dj * dj + di * di );
+
+		if ( length == 0.0 )
+		{
+			continue;
+		}
+
+		// Walk the columns, the rows and the diagonals together, emitting the crossings in order
+
+		LineWalker	columns( j0, dj, step );
+		LineWalker	rows( i0, di, step );
+		LineWalker	diagonals( j0 - i0, dj - di, step );
+
+		columns.Advance( 0.0 );
+		rows.Advance( 0.0 );
+		diagonals.Advance( 0.0 );
+
+		while ( true )
+		{
+			double const	t	= min( min( columns.GetNext(), rows.GetNext() ), diagonals.GetNext() );
+
+			if ( t >= 1.0 - COINCIDENT )
+			{
+				break;
+			}
+
+			AddSample( view, j0 + t * dj, i0 + t * di, distance + t * length, step, profile );
+
+			columns.Advance( t );
+			rows.Advance( t );
+			diagonals.Advance( t );
+		}
+
+		distance += length;
+
+		AddSample( view, polyline[ k ].m_J, polyline[ k ].m_I, distance, step, profile );
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	view		Heightfield
+//! @param	polylines	Polylines, in grid coordinates. They must be within the heightfield.
+//! @param	profiles	Receives the profile of each polyline
+//! @param	step		Size of a cell, as for HeightFieldView::GetInterpolatedZ()
+//!
+//! @exception	bad_alloc	Unable to allocate the samples.
+
+void HeightFieldProfile::Compute( HeightFieldView const &	view,
+								  vector< Polyline > const &	polylines,
+								  vector< Profile > &		profiles,
+								  int						step /*= 1*/ )
+{
+	profiles.resize( polylines.size() );
+
+	Parallel::For( 0, int( polylines.size() ), 1, [ & ]( int first, int last )
+	{
+		for ( int k = first; k < last; k++ )
+		{
+			Compute( view, polylines[ k ], profiles[ k ], step );
+		}
+	} );
+}
@@ -0,0 +1,71 @@
+/** @file *//********************************************************************************************************
+
+                                                  HeightFieldProfile.h
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/HeightFieldProfile.h#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#pragma once
+
+#include <vector>
+
+class HeightFieldView;
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! Computes the exact height profile along polylines across a heightfield.
+//!
+//! The surface used by HeightFieldView::GetInterpolatedZ() is made of two triangles per cell, divided by the
+//! diagonal from ( j, i ) to ( j + step, i + step ), and it is linear within each triangle. So the profile along a
+//! straight segment is linear between the points where the segment crosses the edges of the cells and the
+//! diagonals. Each segment is walked through the grid (as in a DDA) and a sample is emitted at each of those
+//! points, so linear interpolation between the samples is the exact profile.
+//!
+//! If @a step is greater than 1 and the size of the view is not a multiple of @a step plus 1, the cells along the
+//! last row and column extend beyond the edges, and GetInterpolatedZ() takes the heights of their far corners from
+//! the view's edge mode. Those cells are still linear within each triangle, so the profile is exact there too.
+
+class HeightFieldProfile
+{
+public:
+
+	//! A point on a polyline, in grid coordinates
+	struct Point
+	{
+		float	m_J;		//!< Position along the J axis
+		float	m_I;		//!< Position along the I axis
+	};
+
+	//! A sample of a profile
+	struct Sample
+	{
+		float	m_J;		//!< Position along the J axis
+		float	m_I;		//!< Position along the I axis
+		float	m_Z;		//!< Height of the surface
+		float	m_Distance;	//!< Horizontal distance from the start of the polyline, in grid units
+	};
+
+	//! A polyline
+	typedef std::vector< Point >	Polyline;
+
+	//! A profile
+	typedef std::vector< Sample >	Profile;
+
+	//! Computes the profile along a polyline.
+	static void Compute( HeightFieldView const & view, Polyline const & polyline, Profile & profile, int step = 1 );
+
+	//! Computes the profiles along many polylines in parallel.
+	static void Compute( HeightFieldView const &		view,
+						 std::vector< Polyline > const &	polylines,
+						 std::vector< Profile > &		profiles,
+						 int							step	= 1 );
+};
@@ -0,0 +1,337 @@
+/** @file *//********************************************************************************************************
+
+                                                HeightFieldResampler.cpp
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/HeightFieldResampler.cpp#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#include "PrecompiledHeaders.h"
+
+#include "HeightFieldResampler.h"
+
+#include "HeightField.h"
+#include "Parallel.h"
+#include "Simd.h"
+
+using namespace std;
+
+
+namespace
+{
+
+// Number of output rows filtered together. Only the source rows needed by a band are kept in memory.
+int const	BAND_SIZE	= 32;
+
+float const	PI	= 3.14159265f;
+
+// Source vertexes contributing to a single output vertex
+struct Contribution
+{
+	int				m_First;	// Index of the first source vertex
+	vector<float>	m_Weights;	// Normalized weights of the source vertexes starting at m_First
+};
+
+// Returns the radius of a filter's kernel
+float GetRadius( HeightFieldResampler::Filter filter )
+{
+	switch ( filter )
+	{
+	case HeightFieldResampler::FILTER_TRIANGLE:	return 1.0f;
+	case HeightFieldResampler::FILTER_LANCZOS3:	return 3.0f;
+	default:									return 0.5f;
+	}
+}
+
+// Returns the value of a filter's kernel at t
+float Kernel( HeightFieldResampler::Filter filter, float t )
+{
+	t = fabsf( t );
+
+	switch ( filter )
+	{
+	case HeightFieldResampler::FILTER_TRIANGLE:
+		return max( 1.0f - t, 0.0f );
+
+	case HeightFieldResampler::FILTER_LANCZOS3:
+	{
+		if ( t < 1.0e-6f )
+		{
+			return 1.0f;
+		}
+		if ( t >= 3.0f )
+		{
+			return 0.0f;
+		}
+		float const	x	= PI * t;
+		return 3.0f * sinf( x ) * sinf( x / 3.0f ) / ( x * x );
+	}
+
+	default:	// Box, min and max
+		return ( t < 0.5f ) ? 1.0f : ( ( t == 0.5f ) ? 0.5f : 0.0f );
+	}
+}
+
+// Computes the contributions of the source vertexes to each output vertex along one axis
+vector<Contribution> ComputeContributions( int srcSize, int dstSize, HeightFieldResampler::Filter filter )
+{
+	vector<Contribution>	contributions( dstSize );
+
+	float const	scale	= ( dstSize > 1 ) ? float( srcSize - 1 ) / float( dstSize - 1 ) : float( srcSize );
+	float const	width	= max( scale, 1.0f );
+	float const	support	= GetRadius( filter ) * width;
+
+	for ( int k = 0; k < dstSize; k++ )
+	{
+		float const	x		= ( dstSize > 1 ) ? float( k ) * scale : float( srcSize - 1 ) * 0.5f;
+		int const	lo		= int( ceilf( x - support ) );
+		int const	hi		= int( floorf( x + support ) );
+		int const	first	= min( max( lo, 0 ), srcSize - 1 );
+		int const	last	= min( max( hi, 0 ), srcSize - 1 );
+
+		Contribution &	c	= contributions[ k ];
+
+		c.m_First = first;
+		c.m_Weights.assign( last - first + 1, 0.0f );
+
+		// Taps beyond the edges are folded into the edge vertexes
+
+		float	sum	= 0.0f;
+
+		for ( int n = lo; n <= hi; n++ )
+		{
+			float const	w	= Kernel( filter, ( float( n ) - x ) / width );
+
+			c.m_Weights[ min( max( n, 0 ), srcSize - 1 ) - first ] += w;
+			sum += w;
+		}
+
+		for ( size_t n = 0; n < c.m_Weights.size(); n++ )
+		{
+			c.m_Weights[ n ] /= sum;
+		}
+
+		// Min and max only use the vertexes that are covered
+
+		if ( filter == HeightFieldResampler::FILTER_MIN || filter == HeightFieldResampler::FILTER_MAX )
+		{
+			while ( c.m_Weights.size() > 1 && c.m_Weights.back() <= 0.0f )
+			{
+				c.m_Weights.pop_back();
+			}
+			while ( c.m_Weights.size() > 1 && c.m_Weights.front() <= 0.0f )
+			{
+				c.m_Weights.erase( c.m_Weights.begin() );
+				++c.m_First;
+			}
+		}
+	}
+
+	return contributions;
+}
+
+// Filters a source row along the J axis
+void FilterRow( HeightField::Vertex const *		pSrc,
+				vector<Contribution> const &	contributions,
+				HeightFieldResampler::Filter	filter,
+				float *							pDst )
+{
+	int const	n	= int( contributions.size() );
+
+	for ( int j = 0; j < n; j++ )
+	{
+		Contribution const &				c		= contributions[ j ];
+		HeightField::Vertex const * const	pV		= pSrc + c.m_First;
+		int const							nTaps	= int( c.m_Weights.size() );
+		float								z;
+
+		if ( filter == HeightFieldResampler::FILTER_MIN )
+		{
+			z = pV[ 0 ].m_Z;
+			for ( int k = 1; k < nTaps; k++ )
+			{
+				z = min( z, pV[ k ].m_Z );
+			}
+		}
+		else if ( filter == HeightFieldResampler::FILTER_MAX )
+		{
+			z = pV[ 0 ].m_Z;
+			for ( int k = 1; k < nTaps; k++ )
+			{
+				z = max( z, pV[ k ].m_Z );
+			}
+		}
+		else
+		{
+			z = 0.0f;
+			for ( int k = 0; k < nTaps; k++ )
+			{
+				z += pV[ k ].m_Z * c.m_Weights[ k ];
+			}
+		}
+
+		pDst[ j ] = z;
+	}
+}
+
+// Combines filtered rows along the I axis
+void FilterColumns( float const *					pRows,
+					int								stride,
+					Contribution const &			c,
+					HeightFieldResampler::Filter	filter,
+					int								n,
+					float *							pDst )
+{
+	int const	nTaps	= int( c.m_Weights.size() );
+	int			j		= 0;
+
+#if defined( HEIGHTFIELD_USE_SSE )
+
+	for ( ; j + 4 <= n; j += 4 )
+	{
+		__m128	z	= _mm_loadu_ps( pRows + j );
+
+		if ( filter == HeightFieldResampler::FILTER_MIN )
+		{
+			for ( int k = 1; k < nTaps; k++ )
+			{
+				z = _mm_min_ps( z, _mm_loadu_ps( pRows + k * stride + j ) );
+			}
+		}
+		else if ( filter == HeightFieldResampler::FILTER_MAX )
+		{
+			for ( int k = 1; k < nTaps; k++ )
+			{
+				z = _mm_max_ps( z, _mm_loadu_ps( pRows + k * stride + j ) );
+			}
+		}
+		else
+		{
+			z = _mm_mul_ps( z, _mm_set1_ps( c.m_Weights[ 0 ] ) );
+			for ( int k = 1; k < nTaps; k++ )
+			{
+				z = _mm_add_ps( z, _mm_mul_ps( _mm_loadu_ps( pRows + k * stride + j ), _mm_set1_ps( c.m_Weights[ k ] ) ) );
+			}
+		}
+
+		_mm_storeu_ps( pDst + j, z );
+	}
+
+#endif // defined( HEIGHTFIELD_USE_SSE )
+
+	for ( ; j < n; j++ )
+	{
+		float	z	= pRows[ j ];
+
+		if ( filter == HeightFieldResampler::FILTER_MIN )
+		{
+			for ( int k = 1; k < nTaps; k++ )
+			{
+				z = min( z, pRows[ k * stride + j ] );
+			}
+		}
+		else if ( filter == HeightFieldResampler::FILTER_MAX )
+		{
+			for ( int k = 1; k < nTaps; k++ )
+			{
+				z = max( z, pRows[ k * stride + j ] );
+			}
+		}
+		else
+		{
+			z *= c.m_Weights[ 0 ];
+			for ( int k = 1; k < nTaps; k++ )
+			{
+				z += pRows[ k * stride + j ] * c.m_Weights[ k ];
+			}
+		}
+
+		pDst[ j ] = z;
+	}
+}
+
+} // anonymous namespace
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	hf		Height field to resample
+//! @param	sizeI	Size of the new height field along the I axis
+//! @param	sizeJ	Size of the new height field along the J axis
+//! @param	filter	Resampling filter
+//!
+//! @return		The resampled height field
+//!
+//! @exception	bad_alloc	Unable to allocate the new height field.
+//!
+//! The filter is applied separably. The output is produced in bands of rows in parallel. Each band filters only
+//! the source rows it needs along the J axis and then combines them along the I axis, so the only memory needed
+//! besides the two height fields is a few rows per thread.
+
+HeightField HeightFieldResampler::Resize( HeightField const & hf, int sizeI, int sizeJ, Filter filter /*= FILTER_TRIANGLE*/ )
+{
+	assert( sizeI > 0 && sizeJ > 0 );
+	assert( hf.GetSizeI() > 0 && hf.GetSizeJ() > 0 );
+
+	vector<Contribution> const	contributionsI	= ComputeContributions( hf.GetSizeI(), sizeI, filter );
+	vector<Contribution> const	contributionsJ	= ComputeContributions( hf.GetSizeJ(), sizeJ, filter );
+
+	// The new vertex array is first touched by the threads that fill it
+
+	HeightField::Storage	data( size_t( sizeI ) * sizeJ, HeightField::Allocator( hf.GetAllocatorPolicy() ) );
+
+	Parallel::For( 0, sizeI, BAND_SIZE, [ & ]( int first, int last )
+	{
+		vector<float>	band;
+		vector<float>	row( sizeJ );
+
+		for ( int band0 = first; band0 < last; band0 += BAND_SIZE )
+		{
+			int const	band1	= min( band0 + BAND_SIZE, last );
+
+			// Filter the source rows needed by this band along J
+
+			int	srcFirst	= contributionsI[ band0 ].m_First;
+			int	srcLast		= srcFirst;
+
+			for ( int i = band0; i < band1; i++ )
+			{
+				Contribution const &	c	= contributionsI[ i ];
+				srcFirst	= min( srcFirst, c.m_First );
+				srcLast		= max( srcLast, c.m_First + int( c.m_Weights.size() ) );
+			}
+
+			band.resize( size_t( srcLast - srcFirst ) * sizeJ );
+
+			for ( int s = srcFirst; s < srcLast; s++ )
+			{
+				FilterRow( hf.GetData( 0, s ), contributionsJ, filter, &band[ size_t( s - srcFirst ) * sizeJ ] );
+			}
+
+			// Combine the filtered rows along I
+
+			for ( int i = band0; i < band1; i++ )
+			{
+				Contribution const &	c	= contributionsI[ i ];
+
+				FilterColumns( &band[ size_t( c.m_First - srcFirst ) * sizeJ ], sizeJ, c, filter, sizeJ, &row[ 0 ] );
+
+				HeightField::Vertex * const	pDst	= &data[ size_t( i ) * sizeJ ];
+
+				for ( int j = 0; j < sizeJ; j++ )
+				{
+					pDst[ j ].m_Z = row[ j ];
+				}
+			}
+		}
+	} );
+
+	return HeightField( sizeI, sizeJ, std::move( data ) );
+}
@@ -0,0 +1,45 @@
+/** @file *//********************************************************************************************************
+
+                                                 HeightFieldResampler.h
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/HeightFieldResampler.h#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#pragma once
+
+class HeightField;
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! Resamples a HeightField to a different size.
+//!
+//! The corners of the new height field coincide with the corners of the original, so a vertex at ( j, i ) in the
+//! new height field corresponds to ( j * ( sizeJ - 1 ) / ( newSizeJ - 1 ), i * ( sizeI - 1 ) / ( newSizeI - 1 ) )
+//! in the original. When reducing, the filters are widened by the reduction factor to prevent aliasing.
+
+class HeightFieldResampler
+{
+public:
+
+	//! Resampling filters
+	enum Filter
+	{
+		FILTER_BOX,			//!< Average of the vertexes covered by the new vertex
+		FILTER_TRIANGLE,	//!< Bilinear (tent) filter
+		FILTER_LANCZOS3,	//!< Lanczos filter with 3 lobes. Sharpest, but may overshoot near cliffs.
+		FILTER_MIN,			//!< Lowest of the vertexes covered by the new vertex
+		FILTER_MAX			//!< Highest of the vertexes covered by the new vertex
+	};
+
+	//! Returns a resampled copy of a height field
+	static HeightField Resize( HeightField const & hf, int sizeI, int sizeJ, Filter filter = FILTER_TRIANGLE );
+};
@@ -0,0 +1,425 @@
+/** @file *//********************************************************************************************************
+
+                                                HeightFieldStatistics.cpp
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/HeightFieldStatistics.cpp#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#include "PrecompiledHeaders.h"
+
+#include "HeightFieldStatistics.h"
+
+#include "HeightFieldView.h"
+#include "Parallel.h"
+#include "Simd.h"
+
+using namespace std;
+
+
+namespace
+{
+
+// Size of the tiles processed by a single task. A tile of floats fits in the L2 cache.
+int const	TILE_SIZE	= 256;
+
+// Number of bins in the histogram of a tile
+int const	TILE_BINS	= 1024;
+
+// Statistics of a tile
+struct TileStatistics
+{
+	size_t				m_count;
+	float				m_minZ;
+	float				m_maxZ;
+	double				m_mean;
+	double				m_deviation;	// Sum of the squares of the deviations from the mean
+	vector< unsigned >	m_histogram;	// Histogram over [ m_minZ, m_maxZ ]
+};
+
+// Computes the range of a row and the sums of the differences between its heights and a reference height, and of
+// their squares. The reference keeps the values small, so that they can be summed in single precision.
+void ScanRow( float const * pZ, int n, float reference, float & minZ, float & maxZ, double & sum, double & sumOfSquares )
+{
+	int		j		= 0;
+	float	rowSum	= 0.0f;
+	float	rowSum2	= 0.0f;
+
+#if defined( HEIGHTFIELD_USE_AVX2 )
+
+	if ( n >= 8 )
+	{
+		__m256 const	vReference	= _mm256_set1_ps( reference );
+		__m256			vMin		= _mm256_loadu_ps( pZ );
+		__m256			vMax		= vMin;
+		__m256			vSum		= _mm256_setzero_ps();
+		__m256			vSum2		= _mm256_setzero_ps();
+
+		for ( ; j + 8 <= n; j += 8 )
+		{
+			__m256 const	z	= _mm256_loadu_ps( pZ + j );
+			__m256 const	d	= _mm256_sub_ps( z, vReference );
+
+			vMin	= _mm256_min_ps( vMin, z );
+			vMax	= _mm256_max_ps( vMax, z );
+			vSum	= _mm256_add_ps( vSum, d );
+			vSum2	= _mm256_add_ps( vSum2, _mm256_mul_ps( d, d ) );
+		}
+
+		float	lanes[ 4 ][ 8 ];
+
+		_mm256_storeu_ps( lanes[ 0 ], vMin );
+		_mm256_storeu_ps( lanes[ 1 ], vMax );
+		_mm256_storeu_ps( lanes[ 2 ], vSum );
+		_mm256_storeu_ps( lanes[ 3 ], vSum2 );
+
+		for ( int k = 0; k < 8; k++ )
+		{
+			minZ	= min( minZ, lanes[ 0 ][ k ] );
+			maxZ	= max( maxZ, lanes[ 1 ][ k ] );
+			rowSum	+= lanes[ 2 ][ k ];
+			rowSum2	+= lanes[ 3 ][ k ];
+		}
+	}
+
+#elif defined( HEIGHTFIELD_USE_SSE )
+
+	if ( n >= 4 )
+	{
+		__m128 const	vReference	= _mm_set1_ps( reference );
+		__m128			vMin		= _mm_loadu_ps( pZ );
+		__m128			vMax		= vMin;
+		__m128			vSum		= _mm_setzero_ps();
+		__m128			vSum2		= _mm_setzero_ps();
+
+		for ( ; j + 4 <= n; j += 4 )
+		{
+			__m128 const	z	= _mm_loadu_ps( pZ + j );
+			__m128 const	d	= _mm_sub_ps( z, vReference );
+
+			vMin	= _mm_min_ps( vMin, z );
+			vMax	= _mm_max_ps( vMax, z );
+			vSum	= _mm_add_ps( vSum, d );
+			vSum2	= _mm_add_ps( vSum2, _mm_mul_ps( d, d ) );
+		}
+
+		float	lanes[ 4 ][ 4 ];
+
+		_mm_storeu_ps( lanes[ 0 ], vMin );
+		_mm_storeu_ps( lanes[ 1 ], vMax );
+		_mm_storeu_ps( lanes[ 2 ], vSum );
+		_mm_storeu_ps( lanes[ 3 ], vSum2 );
+
+		for ( int k = 0; k < 4; k++ )
+		{
+			minZ	= min( minZ, lanes[ 0 ][ k ] );
+			maxZ	= max( maxZ, lanes[ 1 ][ k ] );
+			rowSum	+= lanes[ 2 ][ k ];
+			rowSum2	+= lanes[ 3 ][ k ];
+		}
+	}
+
+#endif
+
+	for ( ; j < n; j++ )
+	{
+		float const	z	= pZ[ j ];
+		float const	d	= z - reference;
+
+		minZ	= min( minZ, z );
+		maxZ	= max( maxZ, z );
+		rowSum	+= d;
+		rowSum2	+= d * d;
+	}
+
+	// A row is short enough to be summed in single precision. The rows are summed in double precision.
+
+	sum				+= rowSum;
+	sumOfSquares	+= rowSum2;
+}
+
+// Adds the heights in a row to a histogram over [ minZ, minZ + nBins / scale )
+void BinRow( float const * pZ, int n, float minZ, float scale, int nBins, unsigned * pHistogram )
+{
+	int	j	= 0;
+
+#if defined( HEIGHTFIELD_USE_AVX2 )
+
+	__m256 const	vMin		= _mm256_set1_ps( minZ );
+	__m256 const	vScale		= _mm256_set1_ps( scale );
+	__m256i const	vLastBin	= _mm256_set1_epi32( nBins - 1 );
+
+	for ( ; j + 8 <= n; j += 8 )
+	{
+		__m256 const	t	= _mm256_mul_ps( _mm256_sub_ps( _mm256_loadu_ps( pZ + j ), vMin ), vScale );
+		__m256i const	bin	= _mm256_min_epi32( _mm256_max_epi32( _mm256_cvttps_epi32( t ), _mm256_setzero_si256() ), vLastBin );
+
+		int	bins[ 8 ];
+
+		_mm256_storeu_si256( reinterpret_cast< __m256i * >( bins ), bin );
+
+		for ( int k = 0; k < 8; k++ )
+		{
+			++pHistogram[ bins[ k ] ];
+		}
+	}
+
+#endif
+
+	for ( ; j < n; j++ )
+	{
+		int const	bin	= int( ( pZ[ j ] - minZ ) * scale );
+
+		++pHistogram[ min( max( bin, 0 ), nBins - 1 ) ];
+	}
+}
+
+// Computes the statistics of a tile of a view
+void ScanTile( HeightFieldView const & view, int j0, int i0, int j1, int i1, TileStatistics & tile )
+{
+	int const	n				= j1 - j0;
+	float const	reference		= view.GetZ( j0, i0 );
+	double		sum				= 0.0;
+	double		sumOfSquares	= 0.0;
+
+	tile.m_count	= size_t( n ) * ( i1 - i0 );
+	tile.m_minZ		= numeric_limits< float >::max();
+	tile.m_maxZ		= -numeric_limits< float >::max();
+	tile.m_histogram.assign( TILE_BINS, 0 );
+
+	for ( int i = i0; i < i1; i++ )
+	{
+		float const * const	pZ	= &view.GetData( j0, i )->m_Z;
+
+		ScanRow( pZ, n, reference, tile.m_minZ, tile.m_maxZ, sum, sumOfSquares );
+	}
+
+	tile.m_mean			= reference + sum / double( tile.m_count );
+	tile.m_deviation	= max( sumOfSquares - sum * sum / double( tile.m_count ), 0.0 );
+
+	// The tile is still in the cache, so the second sweep does not read memory again.
+
+	float const	range	= tile.m_maxZ - tile.m_minZ;
+	float const	scale	= ( range > 0.0f ) ? TILE_BINS / range : 0.0f;
+
+	for ( int i = i0; i < i1; i++ )
+	{
+		float const * const	pZ	= &view.GetData( j0, i )->m_Z;
+
+		BinRow( pZ, n, tile.m_minZ, scale, TILE_BINS, &tile.m_histogram[ 0 ] );
+	}
+}
+
+} // anonymous namespace
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+HeightFieldStatistics::HeightFieldStatistics()
+	: m_count( 0 ),
+	m_minZ( numeric_limits< float >::max() ),
+	m_maxZ( -numeric_limits< float >::max() ),
+	m_sum( 0.0 ),
+	m_deviation( 0.0 ),
+	m_binWidth( 0.0f ),
+	m_histogram( HISTOGRAM_SIZE, 0 )
+{
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	view	Heights to compute the statistics of
+//!
+//! @exception	bad_alloc	Unable to allocate the tile histograms.
+
+HeightFieldStatistics::HeightFieldStatistics( HeightFieldView const & view )
+	: m_count( 0 ),
+	m_minZ( numeric_limits< float >::max() ),
+	m_maxZ( -numeric_limits< float >::max() ),
+	m_sum( 0.0 ),
+	m_deviation( 0.0 ),
+	m_binWidth( 0.0f ),
+	m_histogram( HISTOGRAM_SIZE, 0 )
+{
+	int const	sizeI	= view.GetSizeI();
+	int const	sizeJ	= view.GetSizeJ();
+
+	if ( sizeI <= 0 || sizeJ <= 0 )
+	{
+		return;
+	}
+
+	int const	tilesJ	= ( sizeJ + TILE_SIZE - 1 ) / TILE_SIZE;
+	int const	tilesI	= ( sizeI + TILE_SIZE - 1 ) / TILE_SIZE;
+
+	vector< TileStatistics >	tiles( size_t( tilesJ ) * tilesI );
+
+	Parallel::ForTiles( sizeJ, sizeI, TILE_SIZE, TILE_SIZE, [ & ]( int j0, int i0, int j1, int i1 )
+	{
+		ScanTile( view, j0, i0, j1, i1, tiles[ size_t( i0 / TILE_SIZE ) * tilesJ + j0 / TILE_SIZE ] );
+	} );
+
+	// Combine the tiles in order. The means and deviations are combined with the pairwise formula of Chan et al.,
+	// which does not lose precision when the mean is large compared to the deviation.
+
+	double	mean	= 0.0;
+
+	for ( size_t k = 0; k < tiles.size(); k++ )
+	{
+		TileStatistics const &	tile	= tiles[ k ];
+
+		double const	n		= double( m_count );
+		double const	total	= n + double( tile.m_count );
+		double const	delta	= tile.m_mean - mean;
+
+		mean		+= delta * double( tile.m_count ) / total;
+		m_deviation	+= tile.m_deviation + delta * delta * n * double( tile.m_count ) / total;
+		m_count		+= tile.m_count;
+		m_minZ		= min( m_minZ, tile.m_minZ );
+		m_maxZ		= max( m_maxZ, tile.m_maxZ );
+	}
+
+	m_sum = mean * double( m_count );
+
+	// Each bin of a tile's histogram is added to the bin of the whole histogram that contains its center
+
+	float const	range	= m_maxZ - m_minZ;
+	float const	scale	= ( range > 0.0f ) ? HISTOGRAM_SIZE / range : 0.0f;
+
+	m_binWidth = range / HISTOGRAM_SIZE;
+
+	for ( size_t k = 0; k < tiles.size(); k++ )
+	{
+		TileStatistics const &	tile		= tiles[ k ];
+		float const				tileWidth	= ( tile.m_maxZ - tile.m_minZ ) / TILE_BINS;
+
+		for ( int b = 0; b < TILE_BINS; b++ )
+		{
+			unsigned const	count	= tile.m_histogram[ b ];
+
+			if ( count > 0 )
+			{
+				float const	center	= tile.m_minZ + ( b + 0.5f ) * tileWidth;
+				int const	bin		= int( ( center - m_minZ ) * scale );
+
+				m_histogram[ min( max( bin, 0 ), HISTOGRAM_SIZE - 1 ) ] += count;
+			}
+		}
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//!
+//! @return		The mean, or 0 if there are no heights
+
+double HeightFieldStatistics::GetMean() const
+{
+	return ( m_count > 0 ) ? m_sum / double( m_count ) : 0.0;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//!
+//! @return		The population variance, or 0 if there are no heights
+
+double HeightFieldStatistics::GetVariance() const
+{
+	if ( m_count == 0 )
+	{
+		return 0.0;
+	}
+
+	return m_deviation / double( m_count );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//!
+//! @return		The population standard deviation, or 0 if there are no heights
+
+double HeightFieldStatistics::GetStandardDeviation() const
+{
+	return sqrt( GetVariance() );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	percent		Percentage of the heights, in the range [0, 100]
+//!
+//! @return		The height, interpolated within the bin of the histogram that contains it. 0% is the lowest height
+//!				and 100% is the highest.
+
+float HeightFieldStatistics::GetPercentile( float percent ) const
+{
+	assert( percent >= 0.0f && percent <= 100.0f );
+
+	if ( m_count == 0 )
+	{
+		return 0.0f;
+	}
+
+	if ( percent <= 0.0f )
+	{
+		return m_minZ;
+	}
+
+	if ( percent >= 100.0f )
+	{
+		return m_maxZ;
+	}
+
+	double const	target	= double( percent ) / 100.0 * double( m_count );
+	double			below	= 0.0;
+
+	for ( int b = 0; b < HISTOGRAM_SIZE; b++ )
+	{
+		unsigned const	count	= m_histogram[ b ];
+
+		if ( count > 0 && below + count >= target )
+		{
+			float const	t	= float( ( target - below ) / count );
+
+			return min( m_minZ + ( b + t ) * m_binWidth, m_maxZ );
+		}
+
+		below += count;
+	}
+
+	return m_maxZ;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//!
+//! @return		The sum of the squares of the heights
+
+double HeightFieldStatistics::GetSumOfSquares() const
+{
+	return ( m_count > 0 ) ? m_deviation + m_sum * m_sum / double( m_count ) : 0.0;
+}
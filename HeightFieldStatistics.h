@@ -0,0 +1,91 @@
+/** @file *//********************************************************************************************************
+
+                                                 HeightFieldStatistics.h
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/HeightFieldStatistics.h#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+class HeightFieldView;
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! Statistics of the heights in a HeightField or a view.
+//!
+//! All of the statistics are computed by a single parallel, vectorized pass over the data. The data is processed
+//! in square tiles. Each tile is read from memory once: a first sweep computes its range, sums and squares, and a
+//! second sweep, while the tile is still in the cache, computes a fine histogram over the tile's range. The tile
+//! histograms are then merged into a histogram over the whole range. The tiles are combined in a fixed order, so
+//! the results do not depend on the number of threads.
+//!
+//! @note	The histogram and percentiles are accurate to about two bins (the range / 512).
+
+class HeightFieldStatistics
+{
+public:
+
+	//! Number of bins in the histogram
+	static int const	HISTOGRAM_SIZE	= 1024;
+
+	//! Constructor. The statistics are those of an empty set.
+	HeightFieldStatistics();
+
+	//! Constructor
+	explicit HeightFieldStatistics( HeightFieldView const & view );
+
+	//! Returns the number of heights.
+	size_t GetCount() const							{ return m_count; }
+
+	//! Returns the lowest height.
+	float GetMinZ() const							{ return m_minZ; }
+
+	//! Returns the highest height.
+	float GetMaxZ() const							{ return m_maxZ; }
+
+	//! Returns the sum of the heights.
+	double GetSum() const							{ return m_sum; }
+
+	//! Returns the sum of the squares of the heights.
+	double GetSumOfSquares() const;
+
+	//! Returns the mean height.
+	double GetMean() const;
+
+	//! Returns the variance of the heights.
+	double GetVariance() const;
+
+	//! Returns the standard deviation of the heights.
+	double GetStandardDeviation() const;
+
+	//! Returns the histogram. Bin @a k counts the heights in [ min + k * width, min + ( k + 1 ) * width ).
+	std::vector< unsigned > const & GetHistogram() const	{ return m_histogram; }
+
+	//! Returns the width of a bin of the histogram.
+	float GetBinWidth() const						{ return m_binWidth; }
+
+	//! Returns the height below which the given percentage of the heights lie.
+	float GetPercentile( float percent ) const;
+
+private:
+
+	size_t					m_count;		//!< Number of heights
+	float					m_minZ;			//!< Lowest height
+	float					m_maxZ;			//!< Highest height
+	double					m_sum;			//!< Sum of the heights
+	double					m_deviation;	//!< Sum of the squares of the differences between the heights and the mean
+	float					m_binWidth;		//!< Width of a histogram bin
+	std::vector< unsigned >	m_histogram;	//!< Histogram over [ m_minZ, m_maxZ ]
+};
@@ -0,0 +1,358 @@
+/** @file *//********************************************************************************************************
+
+                                                  HeightFieldView.cpp
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/HeightFieldView.cpp#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#include "PrecompiledHeaders.h"
+
+#include "HeightFieldView.h"
+
+#include "Parallel.h"
+
+using namespace std;
+
+
+namespace
+{
+
+// Size of the tiles scanned in parallel by GetMinZ() and GetMaxZ(). Smaller areas are scanned directly.
+int const	SCAN_TILE_SIZE	= 256;
+
+} // anonymous namespace
+
+
+static_assert( sizeof( HeightField::Vertex ) == sizeof( float ), "A Vertex must be layout-compatible with a float" );
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! This constructor creates an empty view.
+
+HeightFieldView::HeightFieldView()
+	: m_sizeI( 0 ), m_sizeJ( 0 ), m_stride( 0 ), m_pData( 0 ), m_edgeMode( HeightField::EDGE_CLAMP ), m_apron( 0 )
+{
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	sizeI	Size of the view along the I axis.
+//! @param	sizeJ	Size of the view along the J axis.
+//! @param	pData	Address of the vertex at ( 0, 0 ). The data should be in this order: <tt>pData[i][j]</tt>.
+//! @param	stride		Number of vertexes between the starts of consecutive rows. If 0 or omitted, the rows are
+//!						assumed to be contiguous (the stride is @a sizeJ).
+//! @param	edgeMode	How the vertexes beyond the edges are addressed
+//! @param	apron		Number of rows and columns beyond each edge that can be read directly
+
+HeightFieldView::HeightFieldView( int sizeI, int sizeJ, Vertex const * pData, int stride /*= 0*/,
+								  HeightField::EdgeMode edgeMode /*= HeightField::EDGE_CLAMP*/, int apron /*= 0*/ )
+	: m_sizeI( sizeI ), m_sizeJ( sizeJ ), m_stride( ( stride > 0 ) ? stride : sizeJ ), m_pData( pData ),
+	m_edgeMode( edgeMode ), m_apron( apron )
+{
+	assert( sizeI >= 0 && sizeJ >= 0 );
+	assert( apron >= 0 );
+	assert( m_stride >= sizeJ + 2 * apron );
+	assert( pData != 0 || sizeI * sizeJ == 0 );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	sizeI	Size of the view along the I axis.
+//! @param	sizeJ	Size of the view along the J axis.
+//! @param	pData	Address of the height at ( 0, 0 ). The data should be in this order: <tt>pData[i][j]</tt>.
+//! @param	stride		Number of heights between the starts of consecutive rows. If 0 or omitted, the rows are
+//!						assumed to be contiguous (the stride is @a sizeJ).
+//! @param	edgeMode	How the vertexes beyond the edges are addressed
+//! @param	apron		Number of rows and columns beyond each edge that can be read directly
+
+HeightFieldView::HeightFieldView( int sizeI, int sizeJ, float const * pData, int stride /*= 0*/,
+								  HeightField::EdgeMode edgeMode /*= HeightField::EDGE_CLAMP*/, int apron /*= 0*/ )
+	: m_sizeI( sizeI ), m_sizeJ( sizeJ ), m_stride( ( stride > 0 ) ? stride : sizeJ ),
+	m_pData( reinterpret_cast< Vertex const * >( pData ) ), m_edgeMode( edgeMode ), m_apron( apron )
+{
+	assert( sizeI >= 0 && sizeJ >= 0 );
+	assert( apron >= 0 );
+	assert( m_stride >= sizeJ + 2 * apron );
+	assert( pData != 0 || sizeI * sizeJ == 0 );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	j	J index
+//! @param	i	I index
+//! @param	sj	width of the area along the J axis
+//! @param	si	width of the area along the I axis
+//!
+//! @return		Lowest Z value
+
+float HeightFieldView::GetMinZ( int j, int i, int sj, int si ) const
+{
+	float const	identity	= numeric_limits< float >::max();
+
+	// A large area is split into tiles that are scanned in parallel
+
+	auto const	scanTile	= [ & ]( int j0, int i0, int j1, int i1 )
+	{
+		float	minZ	= identity;
+
+		for ( int y = i + i0; y < i + i1; y++ )
+		{
+			Vertex const * const	pRow	= GetData( j + j0, y );
+
+			for ( int x = 0; x < j1 - j0; x++ )
+			{
+				float const		z	= pRow[ x ].m_Z;
+				if ( z < minZ )
+				{
+					minZ = z;
+				}
+			}
+		}
+
+		return minZ;
+	};
+
+	if ( sj <= 0 || si <= 0 )
+	{
+		return identity;
+	}
+
+	// A small area is scanned directly, without dispatching any tasks
+
+	if ( sj <= SCAN_TILE_SIZE && si <= SCAN_TILE_SIZE )
+	{
+		return scanTile( 0, 0, sj, si );
+	}
+
+	return Parallel::ReduceTiles( sj, si, SCAN_TILE_SIZE, SCAN_TILE_SIZE, identity, scanTile,
+								  []( float a, float b ) { return min( a, b ); } );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	j	J index
+//! @param	i	I index
+//! @param	sj	width of the area along the J axis
+//! @param	si	width of the area along the I axis
+//!
+//! @return		Highest Z value
+
+float HeightFieldView::GetMaxZ( int j, int i, int sj, int si ) const
+{
+	float const	identity	= -numeric_limits< float >::max();
+
+	// A large area is split into tiles that are scanned in parallel
+
+	auto const	scanTile	= [ & ]( int j0, int i0, int j1, int i1 )
+	{
+		float	maxZ	= identity;
+
+		for ( int y = i + i0; y < i + i1; y++ )
+		{
+			Vertex const * const	pRow	= GetData( j + j0, y );
+
+			for ( int x = 0; x < j1 - j0; x++ )
+			{
+				float const		z	= pRow[ x ].m_Z;
+				if ( z > maxZ )
+				{
+					maxZ = z;
+				}
+			}
+		}
+
+		return maxZ;
+	};
+
+	if ( sj <= 0 || si <= 0 )
+	{
+		return identity;
+	}
+
+	// A small area is scanned directly, without dispatching any tasks
+
+	if ( sj <= SCAN_TILE_SIZE && si <= SCAN_TILE_SIZE )
+	{
+		return scanTile( 0, 0, sj, si );
+	}
+
+	return Parallel::ReduceTiles( sj, si, SCAN_TILE_SIZE, SCAN_TILE_SIZE, identity, scanTile,
+								  []( float a, float b ) { return max( a, b ); } );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	j		j index (can be a non-integer, but must be less than the width of the view unless the edge
+//!					mode is EDGE_WRAP)
+//! @param	i		i index (can be a non-integer, but must be less than the height of the view unless the edge
+//!					mode is EDGE_WRAP)
+//! @param	step	width and height of the quad to interpolate
+//!
+//! The corners of the quad beyond the edges are addressed according to the edge mode, and the triangle is selected
+//! without branching, so the result is computed the same way everywhere.
+//!
+//! @see	HeightField::GetInterpolatedZ()
+
+float HeightFieldView::GetInterpolatedZ( float j, float i, int step/* = 1*/ ) const
+{
+	assert( m_edgeMode == HeightField::EDGE_WRAP || ( i >= 0.0f && i <= m_sizeI-1 ) );
+	assert( m_edgeMode == HeightField::EDGE_WRAP || ( j >= 0.0f && j <= m_sizeJ-1 ) );
+
+	float const	fj0	= floorf( j / step );
+	float const	fi0	= floorf( i / step );
+	float const	dj0	= j / step - fj0;
+	float const	di0	= i / step - fi0;
+
+	int const	j0	= HeightField::GetEdgeIndex( m_edgeMode, int( fj0 ) * step, m_sizeJ );
+	int const	i0	= HeightField::GetEdgeIndex( m_edgeMode, int( fi0 ) * step, m_sizeI );
+	int const	j1	= HeightField::GetEdgeIndex( m_edgeMode, int( fj0 ) * step + step, m_sizeJ );
+	int const	i1	= HeightField::GetEdgeIndex( m_edgeMode, int( fi0 ) * step + step, m_sizeI );
+
+	float const	z00	= GetZ( j0, i0 );
+	float const	z10	= GetZ( j1, i0 );
+	float const	z01	= GetZ( j0, i1 );
+	float const	z11	= GetZ( j1, i1 );
+
+	// The middle corner of the triangle is ( j1, i0 ) if dj0 > di0, and ( j0, i1 ) otherwise
+
+	float const	zm	= ( dj0 > di0 ) ? z10 : z01;
+
+	return z00 + ( zm - z00 ) * max( dj0, di0 ) + ( z11 - zm ) * min( dj0, di0 );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	j	J index of the first vertex in the rectangle
+//! @param	i	I index of the first vertex in the rectangle
+//! @param	sj	width of the rectangle along the J axis
+//! @param	si	width of the rectangle along the I axis
+//!
+//! @return		A view of the rectangle. Its ( 0, 0 ) is ( @a j, @a i ) in this view.
+//!
+//! The view has the same edge mode, which applies to the edges of the rectangle. Its apron is made of the
+//! vertexes around the rectangle in this view and its apron, as wide as they are on the narrowest side.
+
+HeightFieldView HeightFieldView::GetSubView( int j, int i, int sj, int si ) const
+{
+	assert( sj > 0 && si > 0 );
+	assert( j >= 0 && i >= 0 );
+	assert( j + sj <= m_sizeJ && i + si <= m_sizeI );
+
+	return HeightFieldView( si, sj, GetData( j, i ), m_stride, m_edgeMode, GetSubViewApron( j, i, sj, si ) );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	j	J index of the first vertex in the rectangle
+//! @param	i	I index of the first vertex in the rectangle
+//! @param	sj	width of the rectangle along the J axis
+//! @param	si	width of the rectangle along the I axis
+//!
+//! @return		Number of rows and columns around the rectangle that can be read directly
+
+int HeightFieldView::GetSubViewApron( int j, int i, int sj, int si ) const
+{
+	return min( min( j, i ), min( m_sizeJ - j - sj, m_sizeI - i - si ) ) + m_apron;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! This constructor creates an empty view.
+
+HeightFieldMutableView::HeightFieldMutableView()
+{
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	sizeI	Size of the view along the I axis.
+//! @param	sizeJ	Size of the view along the J axis.
+//! @param	pData	Address of the vertex at ( 0, 0 ). The data should be in this order: <tt>pData[i][j]</tt>.
+//! @param	stride		Number of vertexes between the starts of consecutive rows. If 0 or omitted, the rows are
+//!						assumed to be contiguous.
+//! @param	edgeMode	How the vertexes beyond the edges are addressed
+//! @param	apron		Number of rows and columns beyond each edge that can be read directly
+
+HeightFieldMutableView::HeightFieldMutableView( int sizeI, int sizeJ, Vertex * pData, int stride /*= 0*/,
+												HeightField::EdgeMode edgeMode /*= HeightField::EDGE_CLAMP*/,
+												int apron /*= 0*/ )
+	: HeightFieldView( sizeI, sizeJ, pData, stride, edgeMode, apron )
+{
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	sizeI	Size of the view along the I axis.
+//! @param	sizeJ	Size of the view along the J axis.
+//! @param	pData	Address of the height at ( 0, 0 ). The data should be in this order: <tt>pData[i][j]</tt>.
+//! @param	stride		Number of heights between the starts of consecutive rows. If 0 or omitted, the rows are
+//!						assumed to be contiguous.
+//! @param	edgeMode	How the vertexes beyond the edges are addressed
+//! @param	apron		Number of rows and columns beyond each edge that can be read directly
+
+HeightFieldMutableView::HeightFieldMutableView( int sizeI, int sizeJ, float * pData, int stride /*= 0*/,
+												HeightField::EdgeMode edgeMode /*= HeightField::EDGE_CLAMP*/,
+												int apron /*= 0*/ )
+	: HeightFieldView( sizeI, sizeJ, pData, stride, edgeMode, apron )
+{
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	j	J index of the first vertex in the rectangle
+//! @param	i	I index of the first vertex in the rectangle
+//! @param	sj	width of the rectangle along the J axis
+//! @param	si	width of the rectangle along the I axis
+//!
+//! @return		A modifiable view of the rectangle
+
+HeightFieldMutableView HeightFieldMutableView::GetSubView( int j, int i, int sj, int si ) const
+{
+	assert( sj > 0 && si > 0 );
+	assert( j >= 0 && i >= 0 );
+	assert( j + sj <= m_sizeJ && i + si <= m_sizeI );
+
+	return HeightFieldMutableView( si, sj, GetData( j, i ), m_stride, m_edgeMode, GetSubViewApron( j, i, sj, si ) );
+}
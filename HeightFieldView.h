@@ -0,0 +1,201 @@
+/** @file *//********************************************************************************************************
+
+                                                   HeightFieldView.h
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/HeightFieldView.h#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#pragma once
+
+#include "HeightField.h"
+
+#include <Misc/Assert.h>
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! A read-only view of height data that is owned by something else.
+//!
+//! A view consists of a pointer to the first vertex, the size of the area, and the distance between rows (the
+//! stride). It can refer to a whole HeightField, a rectangle within one, or an external buffer. Views are cheap
+//! to copy and never allocate. The data must outlive the view.
+//!
+//! A view also has an edge mode, which addresses the vertexes beyond its edges, and an apron, which is the number
+//! of rows and columns beyond each edge that can be read directly. The apron of a HeightField's view is the
+//! HeightField's apron, and the apron of a view of a rectangle includes the vertexes around the rectangle.
+
+class HeightFieldView
+{
+public:
+
+	typedef HeightField::Vertex	Vertex;
+
+	//! Constructor
+	HeightFieldView();
+
+	//! Constructor
+	HeightFieldView( int sizeI, int sizeJ, Vertex const * pData, int stride = 0,
+					 HeightField::EdgeMode edgeMode = HeightField::EDGE_CLAMP, int apron = 0 );
+
+	//! Constructor
+	HeightFieldView( int sizeI, int sizeJ, float const * pData, int stride = 0,
+					 HeightField::EdgeMode edgeMode = HeightField::EDGE_CLAMP, int apron = 0 );
+
+	//! Returns the size of the view along the I axis.
+	int GetSizeI() const	{ return m_sizeI; }
+
+	//! Returns the size of the view along the J axis.
+	int GetSizeJ() const	{ return m_sizeJ; }
+
+	//! Returns the number of vertexes between the starts of consecutive rows.
+	int GetStride() const	{ return m_stride; }
+
+	//! Returns the edge mode.
+	HeightField::EdgeMode GetEdgeMode() const	{ return m_edgeMode; }
+
+	//! Returns the number of rows and columns beyond each edge that can be read directly.
+	int GetApron() const	{ return m_apron; }
+
+	//! Returns a pointer to a particular element
+	Vertex const * GetData( int j = 0, int i = 0 ) const;
+
+	//! Returns an element
+	float GetZ( int j, int i ) const;
+
+	//! Returns an element, applying the edge mode to locations beyond the edges
+	float GetEdgeZ( int j, int i ) const;
+
+	//! Returns the lowest Z in the specified range
+	float GetMinZ( int j, int i, int sj, int si ) const;
+
+	//! Returns the lowest Z in the view
+	float GetMinZ() const	{ return GetMinZ( 0, 0, m_sizeJ, m_sizeI ); }
+
+	//! Returns the highest Z in the specified range
+	float GetMaxZ( int j, int i, int sj, int si ) const;
+
+	//! Returns the highest Z in the view
+	float GetMaxZ() const	{ return GetMaxZ( 0, 0, m_sizeJ, m_sizeI ); }
+
+	//! Returns the interpolated Z at [ @a j, @a i ]
+	float GetInterpolatedZ( float j, float i, int step = 1 ) const;
+
+	//! Returns a view of a rectangle within this view
+	HeightFieldView GetSubView( int j, int i, int sj, int si ) const;
+
+protected:
+
+	// Returns the apron of a view of a rectangle within this view
+	int GetSubViewApron( int j, int i, int sj, int si ) const;
+
+	int				m_sizeI;	//!< Size of the view in the I direction
+	int				m_sizeJ;	//!< Size of the view in the J direction
+	int				m_stride;	//!< Number of vertexes between the starts of consecutive rows
+	Vertex const *	m_pData;	//!< First vertex
+
+	HeightField::EdgeMode	m_edgeMode;	//!< Addressing of the vertexes beyond the edges
+	int						m_apron;	//!< Number of rows and columns beyond each edge that can be read directly
+};
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! A view of height data that allows the data to be modified.
+
+class HeightFieldMutableView : public HeightFieldView
+{
+public:
+
+	//! Constructor
+	HeightFieldMutableView();
+
+	//! Constructor
+	HeightFieldMutableView( int sizeI, int sizeJ, Vertex * pData, int stride = 0,
+							HeightField::EdgeMode edgeMode = HeightField::EDGE_CLAMP, int apron = 0 );
+
+	//! Constructor
+	HeightFieldMutableView( int sizeI, int sizeJ, float * pData, int stride = 0,
+							HeightField::EdgeMode edgeMode = HeightField::EDGE_CLAMP, int apron = 0 );
+
+	using HeightFieldView::GetData;
+
+	//! Returns a pointer to an element
+	Vertex * GetData( int j = 0, int i = 0 ) const;
+
+	//! Returns a modifiable view of a rectangle within this view
+	HeightFieldMutableView GetSubView( int j, int i, int sj, int si ) const;
+};
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	j	J index
+//! @param	i	I index
+//!
+//! @return		Pointer to const element at ( @a j, @a i )
+//!
+//! The location may be in the apron.
+
+inline HeightFieldView::Vertex const * HeightFieldView::GetData( int j/*= 0*/, int i/*= 0*/ ) const
+{
+	assert_limits( -m_apron, j, m_sizeJ-1+m_apron );
+	assert_limits( -m_apron, i, m_sizeI-1+m_apron );
+	return &m_pData[ ptrdiff_t( i ) * m_stride + j ];
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	j	J index
+//! @param	i	I index
+//!
+//! @return		Z value at ( @a j, @a i )
+
+inline float HeightFieldView::GetZ( int j, int i ) const
+{
+	return GetData( j, i )->m_Z;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	j	J index. It can be any value.
+//! @param	i	I index. It can be any value.
+//!
+//! @return		Z value of the vertex addressed by ( @a j, @a i ) according to the edge mode
+
+inline float HeightFieldView::GetEdgeZ( int j, int i ) const
+{
+	return GetZ( HeightField::GetEdgeIndex( m_edgeMode, j, m_sizeJ ), HeightField::GetEdgeIndex( m_edgeMode, i, m_sizeI ) );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	j	J index
+//! @param	i	I index
+//!
+//! @return		Pointer to element at ( @a j, @a i )
+
+inline HeightFieldView::Vertex * HeightFieldMutableView::GetData( int j/*= 0*/, int i/*= 0*/ ) const
+{
+	return const_cast< Vertex * >( HeightFieldView::GetData( j, i ) );
+}
@@ -0,0 +1,327 @@
+/** @file *//********************************************************************************************************
+
+                                                     HorizonMap.cpp
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/HorizonMap.cpp#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#include "PrecompiledHeaders.h"
+
+#include "HorizonMap.h"
+
+#include "HeightField.h"
+#include "Parallel.h"
+
+using namespace std;
+
+
+namespace
+{
+
+float const	TWO_PI			= 6.2831853f;
+float const	HALF_PI			= 1.5707963f;
+float const	ANGLE_TO_CODE	= 255.0f / HALF_PI;
+
+// A point on the upper convex hull of a line of heights
+struct HullPoint
+{
+	float	m_U;	// Distance along the line
+	float	m_Z;	// Height
+};
+
+// Finds the two stored azimuths on either side of an azimuth and the weight of the second one
+void GetDirections( float azimuth, int nDirections, int & d0, int & d1, float & w )
+{
+	float	f	= azimuth / TWO_PI * nDirections;
+
+	f -= floorf( f / nDirections ) * nDirections;
+
+	d0	= int( f );
+	w	= f - float( d0 );
+	d0	= d0 % nDirections;
+	d1	= ( d0 + 1 ) % nDirections;
+}
+
+} // anonymous namespace
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	hf				Height field
+//! @param	spacing			Distance between adjacent vertexes, in the same units as Z
+//! @param	nDirections		Number of azimuths to compute, evenly spaced starting at the J axis
+//!
+//! @exception	bad_alloc	Unable to allocate the map.
+
+HorizonMap::HorizonMap( HeightField const & hf, float spacing, int nDirections /*= 16*/ )
+	: m_sizeI( hf.GetSizeI() ),
+	m_sizeJ( hf.GetSizeJ() ),
+	m_nDirections( nDirections )
+{
+	assert( spacing > 0.0f );
+	assert( nDirections > 0 );
+
+	m_horizons.resize( size_t( m_nDirections ) * m_sizeI * m_sizeJ );
+
+	if ( m_sizeI > 0 && m_sizeJ > 0 )
+	{
+		for ( int d = 0; d < m_nDirections; d++ )
+		{
+			Sweep( hf, spacing, d );
+		}
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	j			J index
+//! @param	i			I index
+//! @param	azimuth		Azimuth in radians
+//!
+//! @return		Horizon angle in radians, interpolated between the two nearest stored azimuths
+
+float HorizonMap::GetHorizonAngleAt( int j, int i, float azimuth ) const
+{
+	int		d0;
+	int		d1;
+	float	w;
+
+	GetDirections( azimuth, m_nDirections, d0, d1, w );
+
+	return GetHorizonAngle( j, i, d0 ) * ( 1.0f - w ) + GetHorizonAngle( j, i, d1 ) * w;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	j			J index
+//! @param	i			I index
+//! @param	azimuth		Azimuth of the light in radians
+//! @param	elevation	Elevation angle of the light in radians
+//!
+//! @return		True if the light is hidden by the terrain
+
+bool HorizonMap::IsShadowed( int j, int i, float azimuth, float elevation ) const
+{
+	return elevation < GetHorizonAngleAt( j, i, azimuth );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	j	J index
+//! @param	i	I index
+//!
+//! @return		Visible fraction of the cosine-weighted sky, in the range [0, 1]
+//!
+//! For a horizontal surface, the visible fraction of the sky in a slice with horizon angle h is cos^2( h ). The
+//! result is the average over the stored azimuths.
+
+float HorizonMap::GetAmbientVisibility( int j, int i ) const
+{
+	float	sum	= 0.0f;
+
+	for ( int d = 0; d < m_nDirections; d++ )
+	{
+		float const	c	= cosf( GetHorizonAngle( j, i, d ) );
+		sum += c * c;
+	}
+
+	return sum / float( m_nDirections );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	azimuth		Azimuth of the light in radians
+//! @param	elevation	Elevation angle of the light in radians
+//! @param	mask		Receives 1 for each vertex in shadow and 0 for each lit vertex, in this order: <tt>[i][j]</tt>
+
+void HorizonMap::ComputeShadowMask( float azimuth, float elevation, vector<unsigned char> & mask ) const
+{
+	mask.resize( size_t( m_sizeI ) * m_sizeJ );
+
+	int		d0;
+	int		d1;
+	float	w;
+
+	GetDirections( azimuth, m_nDirections, d0, d1, w );
+
+	// Compare in quantized units: elevation < h0 * ( 1 - w ) + h1 * w
+
+	float const	threshold	= elevation * ANGLE_TO_CODE;
+
+	Parallel::For( 0, m_sizeI, 64, [ & ]( int first, int last )
+	{
+		for ( int i = first; i < last; i++ )
+		{
+			size_t const				offset	= size_t( i ) * m_sizeJ;
+			unsigned char const * const	pH0		= &m_horizons[ size_t( d0 ) * m_sizeI * m_sizeJ + offset ];
+			unsigned char const * const	pH1		= &m_horizons[ size_t( d1 ) * m_sizeI * m_sizeJ + offset ];
+			unsigned char * const		pMask	= &mask[ offset ];
+
+			for ( int j = 0; j < m_sizeJ; j++ )
+			{
+				pMask[ j ] = ( threshold < float( pH0[ j ] ) * ( 1.0f - w ) + float( pH1[ j ] ) * w ) ? 1 : 0;
+			}
+		}
+	} );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	visibility	Receives the ambient visibility of each vertex, in this order: <tt>[i][j]</tt>
+//!
+//! @see	GetAmbientVisibility()
+
+void HorizonMap::ComputeAmbientVisibility( vector<float> & visibility ) const
+{
+	visibility.resize( size_t( m_sizeI ) * m_sizeJ );
+
+	// cos^2 of every quantized angle
+
+	float	table[ 256 ];
+
+	for ( int k = 0; k < 256; k++ )
+	{
+		float const	c	= cosf( float( k ) / ANGLE_TO_CODE );
+		table[ k ] = c * c / float( m_nDirections );
+	}
+
+	Parallel::For( 0, m_sizeI, 64, [ & ]( int first, int last )
+	{
+		for ( int i = first; i < last; i++ )
+		{
+			size_t const	offset	= size_t( i ) * m_sizeJ;
+			float * const	pV		= &visibility[ offset ];
+
+			fill( pV, pV + m_sizeJ, 0.0f );
+
+			for ( int d = 0; d < m_nDirections; d++ )
+			{
+				unsigned char const * const	pH	= &m_horizons[ size_t( d ) * m_sizeI * m_sizeJ + offset ];
+
+				for ( int j = 0; j < m_sizeJ; j++ )
+				{
+					pV[ j ] += table[ pH[ j ] ];
+				}
+			}
+		}
+	} );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! The height field is divided into parallel lines in the direction of the azimuth, one vertex apart along the
+//! axis closest to that direction, so that every vertex is on exactly one line. Each line is swept from its far end
+//! towards the light's opposite direction while maintaining the upper convex hull of the heights already visited.
+//! The horizon of each point is its tangent to the hull, and hull points that fall below a tangent can never be
+//! the horizon of a later point, so each line takes linear time. The lines are swept in parallel.
+//!
+//! @note	Heights along a line are interpolated between the two nearest vertexes across the line, and each vertex
+//!			takes the horizon of the closest point on its line.
+
+void HorizonMap::Sweep( HeightField const & hf, float spacing, int direction )
+{
+	float const	azimuth		= TWO_PI * float( direction ) / float( m_nDirections );
+	float const	dj			= cosf( azimuth );
+	float const	di			= sinf( azimuth );
+	bool const	alongJ		= fabsf( dj ) >= fabsf( di );
+	int const	nMajor		= alongJ ? m_sizeJ : m_sizeI;
+	int const	nMinor		= alongJ ? m_sizeI : m_sizeJ;
+	float const	major		= alongJ ? dj : di;
+	float const	rate		= ( alongJ ? di : dj ) / major;	// Change along the minor axis per step along the major axis
+	float const	stepLength	= spacing * sqrtf( 1.0f + rate * rate );
+	int const	extent		= int( ceilf( fabsf( rate ) * float( nMajor - 1 ) ) );
+
+	unsigned char * const	pHorizons	= &m_horizons[ size_t( direction ) * m_sizeI * m_sizeJ ];
+
+	auto GetZ = [ & ]( int m, int n ) -> float
+	{
+		return alongJ ? hf.GetZ( m, n ) : hf.GetZ( n, m );
+	};
+
+	Parallel::For( -extent - 1, nMinor + extent + 1, 16, [ & ]( int first, int last )
+	{
+		vector<HullPoint>	hull;
+
+		hull.reserve( nMajor );
+
+		for ( int k = first; k < last; k++ )
+		{
+			hull.clear();
+
+			for ( int t = 0; t < nMajor; t++ )
+			{
+				int const	m	= ( major > 0.0f ) ? nMajor - 1 - t : t;
+				float const	f	= float( k ) + rate * float( m );
+				int const	n	= int( floorf( f + 0.5f ) );
+
+				if ( n < 0 || n >= nMinor )
+				{
+					continue;
+				}
+
+				float const	fc	= min( max( f, 0.0f ), float( nMinor - 1 ) );
+				int const	n0	= int( fc );
+				int const	n1	= min( n0 + 1, nMinor - 1 );
+				float const	w	= fc - float( n0 );
+
+				HullPoint	p;
+				p.m_U = float( t ) * stepLength;
+				p.m_Z = GetZ( m, n0 ) * ( 1.0f - w ) + GetZ( m, n1 ) * w;
+
+				// Remove the points that are below the tangent from p
+
+				while ( hull.size() >= 2 )
+				{
+					HullPoint const &	top		= hull[ hull.size() - 1 ];
+					HullPoint const &	second	= hull[ hull.size() - 2 ];
+
+					if ( ( top.m_Z - p.m_Z ) * ( p.m_U - second.m_U ) > ( second.m_Z - p.m_Z ) * ( p.m_U - top.m_U ) )
+					{
+						break;
+					}
+
+					hull.pop_back();
+				}
+
+				float	angle	= 0.0f;
+
+				if ( !hull.empty() )
+				{
+					HullPoint const &	top	= hull.back();
+					angle = max( atan2f( top.m_Z - p.m_Z, p.m_U - top.m_U ), 0.0f );
+				}
+
+				hull.push_back( p );
+
+				size_t const	index	= alongJ ? size_t( n ) * m_sizeJ + m : size_t( m ) * m_sizeJ + n;
+				pHorizons[ index ] = (unsigned char)( angle * ANGLE_TO_CODE + 0.5f );
+			}
+		}
+	} );
+}
@@ -0,0 +1,95 @@
+/** @file *//********************************************************************************************************
+
+                                                      HorizonMap.h
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/HorizonMap.h#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#pragma once
+
+#include <Misc/Assert.h>
+#include <vector>
+
+class HeightField;
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! Precomputed horizon angles of a HeightField, for terrain self-shadowing and ambient occlusion.
+//!
+//! For each of a fixed number of azimuths, the map stores the elevation angle of the horizon as seen from each
+//! vertex. An azimuth is measured in radians from the J axis towards the I axis. Horizon angles are in the range
+//! [0, pi/2] and are stored with 8 bits of precision.
+
+class HorizonMap
+{
+public:
+
+	//! Constructor
+	HorizonMap( HeightField const & hf, float spacing, int nDirections = 16 );
+
+	//! Returns the size of the map along the I axis.
+	int GetSizeI() const							{ return m_sizeI; }
+
+	//! Returns the size of the map along the J axis.
+	int GetSizeJ() const							{ return m_sizeJ; }
+
+	//! Returns the number of azimuths in the map.
+	int GetDirectionCount() const					{ return m_nDirections; }
+
+	//! Returns the horizon angle at ( @a j, @a i ) for one of the stored azimuths.
+	float GetHorizonAngle( int j, int i, int direction ) const;
+
+	//! Returns the horizon angle at ( @a j, @a i ) for any azimuth.
+	float GetHorizonAngleAt( int j, int i, float azimuth ) const;
+
+	//! Returns true if a light at the given azimuth and elevation is below the horizon at ( @a j, @a i ).
+	bool IsShadowed( int j, int i, float azimuth, float elevation ) const;
+
+	//! Returns the fraction of the sky that is visible from ( @a j, @a i ).
+	float GetAmbientVisibility( int j, int i ) const;
+
+	//! Computes the shadow mask for a directional light.
+	void ComputeShadowMask( float azimuth, float elevation, std::vector<unsigned char> & mask ) const;
+
+	//! Computes the ambient visibility of every vertex.
+	void ComputeAmbientVisibility( std::vector<float> & visibility ) const;
+
+private:
+
+	// Computes the horizons for one azimuth
+	void Sweep( HeightField const & hf, float spacing, int direction );
+
+	int							m_sizeI;		//!< Size of the map in the I direction
+	int							m_sizeJ;		//!< Size of the map in the J direction
+	int							m_nDirections;	//!< Number of azimuths
+	std::vector<unsigned char>	m_horizons;		//!< Quantized horizon angles in this order: <tt>[direction][i][j]</tt>
+};
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	j			J index
+//! @param	i			I index
+//! @param	direction	Index of the azimuth. The azimuth is <tt>2 pi * direction / GetDirectionCount()</tt>.
+//!
+//! @return		Horizon angle in radians
+
+inline float HorizonMap::GetHorizonAngle( int j, int i, int direction ) const
+{
+	assert_limits( 0, j, m_sizeJ-1 );
+	assert_limits( 0, i, m_sizeI-1 );
+	assert_limits( 0, direction, m_nDirections-1 );
+
+	return m_horizons[ ( size_t( direction ) * m_sizeI + i ) * m_sizeJ + j ] * ( 1.5707963f / 255.0f );
+}
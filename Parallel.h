@@ -0,0 +1,274 @@
+/** @file *//********************************************************************************************************
+
+                                                      Parallel.h
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/Parallel.h#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <vector>
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! Helpers for splitting bulk HeightField operations across threads.
+//!
+//! The work is run by an Executor. By default, it is the library's TaskScheduler, but an application can supply
+//! its own (for example, to share its job system) with SetExecutor(). The way the work is divided does not
+//! depend on the executor, so the results of reductions are the same regardless of how many threads run them.
+
+namespace Parallel
+{
+
+//! Runs batches of tasks.
+class Executor
+{
+public:
+
+	virtual ~Executor() {}
+
+	//! Returns the number of tasks that can run at the same time.
+	virtual int GetConcurrency() const = 0;
+
+	//! Calls @a task( k ) for each k in [ 0, @a n ), possibly in parallel, and returns when they have all finished.
+	//!
+	//! @note	The task does not throw. Run() may be called from within a task.
+	virtual void Run( int n, std::function< void ( int ) > const & task ) = 0;
+};
+
+//! Replaces the executor used by parallel operations. If @a pExecutor is 0, the default is restored.
+void SetExecutor( Executor * pExecutor );
+
+//! Returns the executor used by parallel operations.
+Executor & GetExecutor();
+
+//! Returns the number of threads used by parallel operations.
+int GetThreadCount();
+
+//! Calls @a f( first, last ) on contiguous sub-ranges of [ @a begin, @a end ) in parallel.
+template< typename Function >
+void For( int begin, int end, int grain, Function const & f );
+
+//! Calls @a f( j0, i0, j1, i1 ) for each tile of a 2D range in parallel.
+template< typename Function >
+void ForTiles( int sizeJ, int sizeI, int tileJ, int tileI, Function const & f );
+
+//! Computes a value for each tile of a 2D range in parallel and combines them in order.
+template< typename T, typename Function, typename Combine >
+T ReduceTiles( int sizeJ, int sizeI, int tileJ, int tileI, T const & identity, Function const & f, Combine const & combine );
+
+//! Number of pieces per thread that For() divides a range into, so that idle threads have something to steal
+int const	PIECES_PER_THREAD	= 4;
+
+} // namespace Parallel
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//!
+//! @return		The executor's concurrency
+
+inline int Parallel::GetThreadCount()
+{
+	return GetExecutor().GetConcurrency();
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	begin	First index in the range
+//! @param	end		One past the last index in the range
+//! @param	grain	Minimum number of indexes given to a single call of @a f
+//! @param	f		Function called as <tt>f( first, last )</tt> for each sub-range
+//!
+//! The range is divided into at most PIECES_PER_THREAD pieces per thread. If @a f throws, the exception thrown by
+//! the lowest piece is rethrown after all pieces have finished.
+
+template< typename Function >
+void Parallel::For( int begin, int end, int grain, Function const & f )
+{
+	int const	n	= end - begin;
+
+	if ( n <= 0 )
+	{
+		return;
+	}
+
+	Executor &	executor	= GetExecutor();
+
+	int const	maxPieces	= ( n + std::max( grain, 1 ) - 1 ) / std::max( grain, 1 );
+	int const	nPieces		= std::min( executor.GetConcurrency() * PIECES_PER_THREAD, maxPieces );
+
+	if ( nPieces <= 1 || executor.GetConcurrency() <= 1 )
+	{
+		f( begin, end );
+		return;
+	}
+
+	std::vector< std::exception_ptr >	errors( nPieces );
+
+	executor.Run( nPieces, [ & ]( int k )
+	{
+		int const	first	= begin + int( (long long)n * k / nPieces );
+		int const	last	= begin + int( (long long)n * ( k + 1 ) / nPieces );
+
+		try
+		{
+			f( first, last );
+		}
+		catch ( ... )
+		{
+			errors[k] = std::current_exception();
+		}
+	} );
+
+	for ( int k = 0; k < nPieces; k++ )
+	{
+		if ( errors[k] )
+		{
+			std::rethrow_exception( errors[k] );
+		}
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	sizeJ	Size of the range along the J axis
+//! @param	sizeI	Size of the range along the I axis
+//! @param	tileJ	Size of a tile along the J axis
+//! @param	tileI	Size of a tile along the I axis
+//! @param	f		Function called as <tt>f( j0, i0, j1, i1 )</tt> for each tile, where [ j0, j1 ) and [ i0, i1 ) are
+//!					the ranges covered by the tile
+//!
+//! The tiles are the same no matter how many threads there are. If the range is a single tile, @a f is called
+//! directly. If @a f throws, the exception thrown by the lowest tile is rethrown after all tiles have finished.
+
+template< typename Function >
+void Parallel::ForTiles( int sizeJ, int sizeI, int tileJ, int tileI, Function const & f )
+{
+	if ( sizeJ <= 0 || sizeI <= 0 )
+	{
+		return;
+	}
+
+	tileJ = std::max( tileJ, 1 );
+	tileI = std::max( tileI, 1 );
+
+	int const	tilesJ	= ( sizeJ + tileJ - 1 ) / tileJ;
+	int const	tilesI	= ( sizeI + tileI - 1 ) / tileI;
+	int const	nTiles	= tilesJ * tilesI;
+
+	auto const	runTile	= [ & ]( int k )
+	{
+		int const	j0	= ( k % tilesJ ) * tileJ;
+		int const	i0	= ( k / tilesJ ) * tileI;
+
+		f( j0, i0, std::min( j0 + tileJ, sizeJ ), std::min( i0 + tileI, sizeI ) );
+	};
+
+	Executor &	executor	= GetExecutor();
+
+	if ( nTiles == 1 || executor.GetConcurrency() <= 1 )
+	{
+		for ( int k = 0; k < nTiles; k++ )
+		{
+			runTile( k );
+		}
+		return;
+	}
+
+	std::vector< std::exception_ptr >	errors( nTiles );
+
+	executor.Run( nTiles, [ & ]( int k )
+	{
+		try
+		{
+			runTile( k );
+		}
+		catch ( ... )
+		{
+			errors[k] = std::current_exception();
+		}
+	} );
+
+	for ( int k = 0; k < nTiles; k++ )
+	{
+		if ( errors[k] )
+		{
+			std::rethrow_exception( errors[k] );
+		}
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	sizeJ		Size of the range along the J axis
+//! @param	sizeI		Size of the range along the I axis
+//! @param	tileJ		Size of a tile along the J axis
+//! @param	tileI		Size of a tile along the I axis
+//! @param	identity	Initial value of the result
+//! @param	f			Function called as <tt>f( j0, i0, j1, i1 )</tt> that returns the value of a tile
+//! @param	combine		Function called as <tt>combine( a, b )</tt> that combines two values
+//!
+//! @return		The values of the tiles combined in row-major order of the tiles, starting with @a identity
+//!
+//! Because the tiles and the order in which they are combined are fixed, the result is deterministic even if
+//! @a combine is not associative (e.g. floating point addition).
+
+template< typename T, typename Function, typename Combine >
+T Parallel::ReduceTiles( int			sizeJ,
+						 int			sizeI,
+						 int			tileJ,
+						 int			tileI,
+						 T const &		identity,
+						 Function const &	f,
+						 Combine const &	combine )
+{
+	if ( sizeJ <= 0 || sizeI <= 0 )
+	{
+		return identity;
+	}
+
+	tileJ = std::max( tileJ, 1 );
+	tileI = std::max( tileI, 1 );
+
+	int const	tilesJ	= ( sizeJ + tileJ - 1 ) / tileJ;
+
+	std::vector< T >	values( size_t( tilesJ ) * ( ( sizeI + tileI - 1 ) / tileI ), identity );
+
+	ForTiles( sizeJ, sizeI, tileJ, tileI, [ & ]( int j0, int i0, int j1, int i1 )
+	{
+		values[ size_t( i0 / tileI ) * tilesJ + j0 / tileJ ] = f( j0, i0, j1, i1 );
+	} );
+
+	T	result	= identity;
+
+	for ( size_t k = 0; k < values.size(); k++ )
+	{
+		result = combine( result, values[ k ] );
+	}
+
+	return result;
+}
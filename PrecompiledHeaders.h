@@ -11,7 +11,9 @@
 
  ********************************************************************************************************************/
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <istream>
 #include <memory>
 #include <limits>
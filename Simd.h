@@ -0,0 +1,32 @@
+/** @file *//********************************************************************************************************
+
+                                                        Simd.h
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/Simd.h#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#pragma once
+
+//! @def	HEIGHTFIELD_USE_SSE
+//! Defined if the SSE/SSE2 kernels are compiled in. Define @c HEIGHTFIELD_NO_SIMD to use only the scalar kernels.
+
+#if !defined( HEIGHTFIELD_NO_SIMD ) && \
+	( defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 ) || defined( __SSE2__ ) )
+#define HEIGHTFIELD_USE_SSE
+#include <emmintrin.h>
+#endif
+
+//! @def	HEIGHTFIELD_USE_AVX2
+//! Defined if the AVX2 kernels are compiled in (the compiler is targeting AVX2, e.g. with @c -mavx2 or
+//! @c /arch:AVX2). The AVX2 kernels are used instead of the SSE kernels where both exist.
+
+#if defined( HEIGHTFIELD_USE_SSE ) && defined( __AVX2__ )
+#define HEIGHTFIELD_USE_AVX2
+#include <immintrin.h>
+#endif
@@ -0,0 +1,305 @@
+/** @file *//********************************************************************************************************
+
+                                                   TaskScheduler.cpp
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/TaskScheduler.cpp#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#include "PrecompiledHeaders.h"
+
+#include "TaskScheduler.h"
+
+using namespace std;
+
+
+namespace
+{
+
+// Identifies the scheduler and queue of a worker thread
+struct WorkerId
+{
+	TaskScheduler const *	m_pScheduler;
+	int						m_index;
+};
+
+thread_local WorkerId	s_worker	= { 0, -1 };
+
+} // anonymous namespace
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	nThreads	Number of threads that run tasks, including the thread calling Run(). If 0, the number of
+//!						hardware threads is used.
+
+TaskScheduler::TaskScheduler( int nThreads /*= 0*/ )
+	: m_pending( 0 ),
+	m_stopping( false )
+{
+	if ( nThreads <= 0 )
+	{
+		unsigned const	n	= thread::hardware_concurrency();
+		nThreads = ( n > 0 ) ? int( n ) : 1;
+	}
+
+	m_concurrency = nThreads;
+
+	int const	nWorkers	= nThreads - 1;
+
+	for ( int k = 0; k <= nWorkers; k++ )
+	{
+		m_queues.push_back( unique_ptr< Queue >( new Queue ) );
+	}
+
+	m_threads.reserve( nWorkers );
+
+	for ( int k = 0; k < nWorkers; k++ )
+	{
+		m_threads.push_back( thread( &TaskScheduler::WorkerThread, this, k ) );
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+TaskScheduler::~TaskScheduler()
+{
+	{
+		lock_guard< mutex >	lock( m_sleepMutex );
+		m_stopping = true;
+	}
+
+	m_wake.notify_all();
+
+	for ( size_t k = 0; k < m_threads.size(); k++ )
+	{
+		m_threads[ k ].join();
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	n		Number of tasks
+//! @param	task	Function called as <tt>task( k )</tt> for each task. It must not throw.
+//!
+//! The tasks are put in the calling thread's queue if it is a worker, or in the shared queue otherwise. The
+//! calling thread then runs tasks until all of the tasks in the batch have finished.
+
+void TaskScheduler::Run( int n, function< void ( int ) > const & task )
+{
+	if ( n <= 0 )
+	{
+		return;
+	}
+
+	if ( m_threads.empty() || n == 1 )
+	{
+		for ( int k = 0; k < n; k++ )
+		{
+			task( k );
+		}
+		return;
+	}
+
+	int const	self	= ( s_worker.m_pScheduler == this ) ? s_worker.m_index : -1;
+	Queue &		queue	= ( self >= 0 ) ? *m_queues[ self ] : *m_queues.back();
+
+	Batch	batch;
+
+	batch.m_pTask = &task;
+	batch.m_remaining.store( n );
+
+	// The tasks are pushed in reverse so that the owner, which takes from the back, runs them in order while
+	// thieves take the last ones.
+
+	{
+		lock_guard< mutex >	lock( queue.m_mutex );
+
+		for ( int k = n - 1; k >= 0; k-- )
+		{
+			Task const	t	= { &batch, k };
+			queue.m_tasks.push_back( t );
+		}
+	}
+
+	m_pending += n;
+
+	{
+		lock_guard< mutex >	lock( m_sleepMutex );
+	}
+	m_wake.notify_all();
+
+	// Help until the batch is finished
+
+	while ( batch.m_remaining.load() > 0 )
+	{
+		if ( !RunOne( self ) )
+		{
+			unique_lock< mutex >	lock( m_sleepMutex );
+			m_wake.wait( lock, [ & ]() { return batch.m_remaining.load() == 0 || m_pending.load() > 0; } );
+		}
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! The scheduler is created the first time it is needed. It uses all hardware threads.
+
+TaskScheduler & TaskScheduler::GetDefault()
+{
+	static TaskScheduler	scheduler;
+
+	return scheduler;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	self	Index of the calling worker's queue, or -1 if the caller is not a worker
+//!
+//! @return		true if a task was run
+
+bool TaskScheduler::RunOne( int self )
+{
+	Task	task	= { 0, 0 };
+	int const	nQueues	= int( m_queues.size() );
+
+	// The worker's own queue is used as a stack, and the others are stolen from the front.
+
+	if ( self >= 0 )
+	{
+		Queue &				queue	= *m_queues[ self ];
+		lock_guard< mutex >	lock( queue.m_mutex );
+
+		if ( !queue.m_tasks.empty() )
+		{
+			task = queue.m_tasks.back();
+			queue.m_tasks.pop_back();
+		}
+	}
+
+	for ( int k = 0; task.m_pBatch == 0 && k < nQueues; k++ )
+	{
+		int const	victim	= ( self + 1 + k ) % nQueues;
+
+		if ( victim == self )
+		{
+			continue;
+		}
+
+		Queue &				queue	= *m_queues[ victim ];
+		lock_guard< mutex >	lock( queue.m_mutex );
+
+		if ( !queue.m_tasks.empty() )
+		{
+			task = queue.m_tasks.front();
+			queue.m_tasks.pop_front();
+		}
+	}
+
+	if ( task.m_pBatch == 0 )
+	{
+		return false;
+	}
+
+	--m_pending;
+
+	( *task.m_pBatch->m_pTask )( task.m_index );
+
+	// The batch may be destroyed as soon as the last task finishes, so it must not be touched after this.
+
+	if ( --task.m_pBatch->m_remaining == 0 )
+	{
+		{
+			lock_guard< mutex >	lock( m_sleepMutex );
+		}
+		m_wake.notify_all();
+	}
+
+	return true;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+void TaskScheduler::WorkerThread( int index )
+{
+	s_worker.m_pScheduler	= this;
+	s_worker.m_index		= index;
+
+	while ( true )
+	{
+		if ( RunOne( index ) )
+		{
+			continue;
+		}
+
+		unique_lock< mutex >	lock( m_sleepMutex );
+
+		m_wake.wait( lock, [ this ]() { return m_stopping || m_pending.load() > 0; } );
+
+		if ( m_stopping )
+		{
+			return;
+		}
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+namespace
+{
+
+atomic< Parallel::Executor * >	s_pExecutor( 0 );	// Executor supplied by the application, or 0
+
+} // anonymous namespace
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	pExecutor	The new executor, or 0 to use TaskScheduler::GetDefault(). It must outlive its use.
+
+void Parallel::SetExecutor( Executor * pExecutor )
+{
+	s_pExecutor.store( pExecutor );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//!
+//! @return		The executor set by SetExecutor(), or TaskScheduler::GetDefault() if there is none
+
+Parallel::Executor & Parallel::GetExecutor()
+{
+	Executor * const	pExecutor	= s_pExecutor.load();
+
+	return ( pExecutor != 0 ) ? *pExecutor : TaskScheduler::GetDefault();
+}
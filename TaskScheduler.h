@@ -0,0 +1,96 @@
+/** @file *//********************************************************************************************************
+
+                                                    TaskScheduler.h
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/TaskScheduler.h#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#pragma once
+
+#include "Parallel.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! A work-stealing thread pool. It is the default executor for parallel HeightField operations.
+//!
+//! Each worker thread has its own queue of tasks. A worker takes tasks from the back of its own queue and, when it
+//! is empty, steals them from the front of the other queues. Threads that are not workers submit their tasks to a
+//! shared queue. A thread waiting in Run() runs pending tasks (its own or others') until its batch is finished, so
+//! nested calls to Run() do not deadlock and the calling thread is never idle.
+
+class TaskScheduler : public Parallel::Executor
+{
+public:
+
+	//! Constructor
+	explicit TaskScheduler( int nThreads = 0 );
+
+	//! Destructor. Waits for the worker threads to exit.
+	virtual ~TaskScheduler();
+
+	//! Returns the number of tasks that can run at the same time.
+	virtual int GetConcurrency() const	{ return m_concurrency; }
+
+	//! Calls @a task( k ) for each k in [ 0, @a n ) and returns when they have all finished.
+	virtual void Run( int n, std::function< void ( int ) > const & task );
+
+	//! Returns the scheduler used by default.
+	static TaskScheduler & GetDefault();
+
+private:
+
+	// A set of tasks submitted by a single call to Run()
+	struct Batch
+	{
+		std::function< void ( int ) > const *	m_pTask;		// Function to call
+		std::atomic< int >						m_remaining;	// Number of tasks that have not finished
+	};
+
+	// A single call of a batch's function
+	struct Task
+	{
+		Batch *	m_pBatch;	// Batch the task belongs to
+		int		m_index;	// Argument of the call
+	};
+
+	// A queue of pending tasks
+	struct Queue
+	{
+		std::mutex			m_mutex;	// Protects the queue
+		std::deque< Task >	m_tasks;	// Pending tasks
+	};
+
+	// Runs one pending task. Returns false if there are none.
+	bool RunOne( int self );
+
+	// Body of a worker thread
+	void WorkerThread( int index );
+
+	TaskScheduler( TaskScheduler const & );
+	TaskScheduler & operator =( TaskScheduler const & );
+
+	int										m_concurrency;	//!< Number of workers plus the calling thread
+	std::vector< std::unique_ptr< Queue > >	m_queues;		//!< One queue per worker, followed by the shared queue
+	std::atomic< int >						m_pending;		//!< Number of tasks in the queues
+	std::mutex								m_sleepMutex;	//!< Used with m_wake
+	std::condition_variable					m_wake;			//!< Signalled when tasks are submitted or batches finish
+	bool									m_stopping;		//!< True when the workers should exit
+	std::vector< std::thread >				m_threads;		//!< Worker threads
+};
@@ -0,0 +1,493 @@
+/** @file *//********************************************************************************************************
+
+                                                    TilePyramid.cpp
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/TilePyramid.cpp#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#include "PrecompiledHeaders.h"
+
+#include "TilePyramid.h"
+
+#include "HeightField.h"
+#include "HeightFieldLoader.h"
+#include "HeightFieldView.h"
+#include "Parallel.h"
+
+#include <atomic>
+
+using namespace std;
+
+
+namespace
+{
+
+// Returns the size of the next level of a pyramid
+int GetNextLevelSize( int size )
+{
+	return ( size > 1 ) ? size / 2 + 1 : size;
+}
+
+// Returns the number of tiles needed to cover a level
+int GetTileCount( int size, int tileSize )
+{
+	return max( ( size - 1 + tileSize - 1 ) / tileSize, 1 );
+}
+
+// Reads the rows of a HeightField
+class HeightFieldSource : public TilePyramid::Source
+{
+public:
+
+	explicit HeightFieldSource( HeightField const & hf )
+		: m_hf( hf ),
+		m_nextRow( 0 )
+	{
+	}
+
+	virtual int GetSizeI() const	{ return m_hf.GetSizeI(); }
+	virtual int GetSizeJ() const	{ return m_hf.GetSizeJ(); }
+
+	virtual bool Read( HeightFieldMutableView const & rows )
+	{
+		for ( int i = 0; i < rows.GetSizeI(); i++ )
+		{
+			copy( m_hf.GetData( 0, m_nextRow + i ), m_hf.GetData( 0, m_nextRow + i ) + rows.GetSizeJ(), rows.GetData( 0, i ) );
+		}
+
+		m_nextRow += rows.GetSizeI();
+		return true;
+	}
+
+private:
+
+	HeightField const &	m_hf;
+	int					m_nextRow;
+};
+
+// Reads the rows of a HeightField from a stream in the format used by operator >>
+class StreamSource : public TilePyramid::Source
+{
+public:
+
+	StreamSource( istream & stream, int sizeI, int sizeJ )
+		: m_stream( stream ),
+		m_sizeI( sizeI ),
+		m_sizeJ( sizeJ )
+	{
+	}
+
+	virtual int GetSizeI() const	{ return m_sizeI; }
+	virtual int GetSizeJ() const	{ return m_sizeJ; }
+
+	virtual bool Read( HeightFieldMutableView const & rows )
+	{
+		return HeightFieldLoader::ReadRows( m_stream, rows );
+	}
+
+private:
+
+	istream &	m_stream;
+	int			m_sizeI;
+	int			m_sizeJ;
+};
+
+} // anonymous namespace
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+// A level of a pyramid being built. It holds the rows that are still needed by its tiles and by the next level.
+
+class TilePyramid::Level
+{
+public:
+
+	// Constructor
+	Level( TilePyramid const & pyramid, int sizeI, int sizeJ, int zoom, Level * pNext, Writer & writer );
+
+	// Adds the next rows, writes the tiles that are complete, and passes the rows of the next level that are
+	// complete to it. Returns false if a tile could not be written.
+	bool Add( float const * pRows, int count );
+
+private:
+
+	// Returns a row, repeating the edge rows beyond the edges
+	float const * GetRow( int i ) const;
+
+	// Writes the tiles in a range of rows of tiles
+	bool WriteTiles( int firstRow, int lastRow ) const;
+
+	// Computes a row of the next level
+	void Reduce( int i, float * pRow ) const;
+
+	TilePyramid const &	m_pyramid;
+	int					m_sizeI;			// Size of the level along the I axis
+	int					m_sizeJ;			// Size of the level along the J axis
+	int					m_zoom;				// Zoom level of the tiles
+	int					m_tilesI;			// Number of tiles along the I axis
+	int					m_tilesJ;			// Number of tiles along the J axis
+	Level *				m_pNext;			// Next level, or 0 if this is the last one
+	Writer &			m_writer;			// Receives the tiles
+	vector< float >		m_rows;				// Rows that are still needed
+	int					m_firstRow;			// Index of the first row in m_rows
+	int					m_rowCount;			// Number of rows added so far
+	int					m_nextTileRow;		// Next row of tiles to write
+	int					m_nextReducedRow;	// Next row of the next level to compute
+};
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+TilePyramid::Level::Level( TilePyramid const & pyramid, int sizeI, int sizeJ, int zoom, Level * pNext, Writer & writer )
+	: m_pyramid( pyramid ),
+	m_sizeI( sizeI ),
+	m_sizeJ( sizeJ ),
+	m_zoom( zoom ),
+	m_tilesI( GetTileCount( sizeI, pyramid.m_tileSize ) ),
+	m_tilesJ( GetTileCount( sizeJ, pyramid.m_tileSize ) ),
+	m_pNext( pNext ),
+	m_writer( writer ),
+	m_firstRow( 0 ),
+	m_rowCount( 0 ),
+	m_nextTileRow( 0 ),
+	m_nextReducedRow( 0 )
+{
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+bool TilePyramid::Level::Add( float const * pRows, int count )
+{
+	int const	tileSize	= m_pyramid.m_tileSize;
+	int const	border		= m_pyramid.m_border;
+
+	m_rows.insert( m_rows.end(), pRows, pRows + size_t( count ) * m_sizeJ );
+	m_rowCount += count;
+
+	// Returns true if row i (or the edge row repeated there) has been added
+	auto const	isAvailable	= [ this ]( int i ) { return min( i, m_sizeI - 1 ) < m_rowCount; };
+
+	// Write the tiles whose rows have all been added
+
+	int	lastTileRow	= m_nextTileRow;
+
+	while ( lastTileRow < m_tilesI && isAvailable( ( lastTileRow + 1 ) * tileSize + border ) )
+	{
+		++lastTileRow;
+	}
+
+	if ( !WriteTiles( m_nextTileRow, lastTileRow ) )
+	{
+		return false;
+	}
+
+	m_nextTileRow = lastTileRow;
+
+	// Compute the rows of the next level whose rows in this level have all been added, and pass them on
+
+	if ( m_pNext != 0 )
+	{
+		int const	nextSizeJ		= m_pNext->m_sizeJ;
+		int			lastReducedRow	= m_nextReducedRow;
+
+		while ( lastReducedRow < m_pNext->m_sizeI && isAvailable( 2 * lastReducedRow + 1 ) )
+		{
+			++lastReducedRow;
+		}
+
+		int const	n	= lastReducedRow - m_nextReducedRow;
+
+		if ( n > 0 )
+		{
+			vector< float >	reduced( size_t( n ) * nextSizeJ );
+
+			Parallel::For( 0, n, 1, [ & ]( int first, int last )
+			{
+				for ( int k = first; k < last; k++ )
+				{
+					Reduce( m_nextReducedRow + k, &reduced[ size_t( k ) * nextSizeJ ] );
+				}
+			} );
+
+			m_nextReducedRow = lastReducedRow;
+
+			if ( !m_pNext->Add( &reduced[ 0 ], n ) )
+			{
+				return false;
+			}
+		}
+	}
+
+	// Discard the rows that are no longer needed
+
+	int	firstNeeded	= m_nextTileRow * tileSize - border;
+
+	if ( m_pNext != 0 )
+	{
+		firstNeeded = min( firstNeeded, 2 * m_nextReducedRow - 1 );
+	}
+
+	firstNeeded = min( max( firstNeeded, 0 ), m_sizeI - 1 );
+
+	if ( firstNeeded > m_firstRow )
+	{
+		m_rows.erase( m_rows.begin(), m_rows.begin() + size_t( firstNeeded - m_firstRow ) * m_sizeJ );
+		m_firstRow = firstNeeded;
+	}
+
+	return true;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+float const * TilePyramid::Level::GetRow( int i ) const
+{
+	i = min( max( i, 0 ), m_sizeI - 1 );
+
+	assert( i >= m_firstRow && i < m_rowCount );
+
+	return &m_rows[ size_t( i - m_firstRow ) * m_sizeJ ];
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+bool TilePyramid::Level::WriteTiles( int firstRow, int lastRow ) const
+{
+	int const	tileSize	= m_pyramid.m_tileSize;
+	int const	border		= m_pyramid.m_border;
+	int const	n			= m_pyramid.GetTileVertexCount();
+
+	atomic< bool >	failed( false );
+
+	Parallel::For( 0, ( lastRow - firstRow ) * m_tilesJ, 1, [ & ]( int first, int last )
+	{
+		HeightField	tile;
+
+		tile.Resize( n, n );
+
+		HeightFieldMutableView const	view	= tile.GetView();
+
+		for ( int k = first; k < last && !failed; k++ )
+		{
+			int const	x	= k % m_tilesJ;
+			int const	y	= firstRow + k / m_tilesJ;
+			int const	j0	= x * tileSize - border;
+			int const	i0	= y * tileSize - border;
+
+			for ( int i = 0; i < n; i++ )
+			{
+				float const * const			pSrc	= GetRow( i0 + i );
+				HeightField::Vertex * const	pDst	= view.GetData( 0, i );
+
+				for ( int j = 0; j < n; j++ )
+				{
+					pDst[ j ].m_Z = pSrc[ min( max( j0 + j, 0 ), m_sizeJ - 1 ) ];
+				}
+			}
+
+			if ( !m_writer.Write( m_zoom, x, y, tile ) )
+			{
+				failed = true;
+			}
+		}
+	} );
+
+	return !failed;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+void TilePyramid::Level::Reduce( int i, float * pRow ) const
+{
+	float const * const	p0	= GetRow( 2 * i - 1 );
+	float const * const	p1	= GetRow( 2 * i );
+	float const * const	p2	= GetRow( 2 * i + 1 );
+
+	for ( int j = 0; j < m_pNext->m_sizeJ; j++ )
+	{
+		int const	j0	= min( max( 2 * j - 1, 0 ), m_sizeJ - 1 );
+		int const	j1	= min( 2 * j, m_sizeJ - 1 );
+		int const	j2	= min( 2 * j + 1, m_sizeJ - 1 );
+
+		float const	z0	= p0[ j0 ] + 2.0f * p1[ j0 ] + p2[ j0 ];
+		float const	z1	= p0[ j1 ] + 2.0f * p1[ j1 ] + p2[ j1 ];
+		float const	z2	= p0[ j2 ] + 2.0f * p1[ j2 ] + p2[ j2 ];
+
+		pRow[ j ] = ( z0 + 2.0f * z1 + z2 ) * ( 1.0f / 16.0f );
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	tileSize	Number of cells covered by a tile along each axis
+//! @param	border		Number of vertexes added to each side of a tile from its neighbors
+
+TilePyramid::TilePyramid( int tileSize /*= 256*/, int border /*= 1*/ )
+	: m_tileSize( tileSize ),
+	m_border( border )
+{
+	assert( tileSize > 0 );
+	assert( border >= 0 );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	sizeI	Size of the heightfield along the I axis
+//! @param	sizeJ	Size of the heightfield along the J axis
+//!
+//! @return		Number of zoom levels. The last level is the heightfield itself.
+
+int TilePyramid::GetZoomCount( int sizeI, int sizeJ ) const
+{
+	int	n	= 1;
+
+	while ( sizeI - 1 > m_tileSize || sizeJ - 1 > m_tileSize )
+	{
+		sizeI = GetNextLevelSize( sizeI );
+		sizeJ = GetNextLevelSize( sizeJ );
+		++n;
+	}
+
+	return n;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	hf		Heightfield
+//! @param	writer	Receives the tiles
+//!
+//! @return		false if a tile could not be written
+
+bool TilePyramid::Build( HeightField const & hf, Writer & writer ) const
+{
+	HeightFieldSource	source( hf );
+
+	return Build( source, writer );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! The stream is in the format used by <tt>operator >>( std::istream &, HeightField & )</tt>, with each row of
+//! heights on its own line. It is read a band at a time, so it can be much larger than the available memory.
+//!
+//! @param	stream	Stream containing the heightfield
+//! @param	writer	Receives the tiles
+//!
+//! @return		false if the heightfield could not be read or a tile could not be written
+
+bool TilePyramid::Build( istream & stream, Writer & writer ) const
+{
+	int	sizeI;
+	int	sizeJ;
+
+	stream >> sizeI >> sizeJ;
+
+	if ( !stream || sizeI < 0 || sizeJ < 0 )
+	{
+		stream.setstate( ios::failbit );
+		return false;
+	}
+
+	StreamSource	source( stream, sizeI, sizeJ );
+
+	return Build( source, writer );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! The source is read a band of @a tileSize rows at a time. Each band is added to level 0, which writes the tiles
+//! that are complete and passes the rows of level 1 that are complete to it, and so on.
+//!
+//! @param	source	Supplies the heights
+//! @param	writer	Receives the tiles
+//!
+//! @return		false if the source could not be read or a tile could not be written
+//!
+//! @exception	bad_alloc	Unable to allocate the levels.
+
+bool TilePyramid::Build( Source & source, Writer & writer ) const
+{
+	int const	sizeI	= source.GetSizeI();
+	int const	sizeJ	= source.GetSizeJ();
+
+	if ( sizeI <= 0 || sizeJ <= 0 )
+	{
+		return true;
+	}
+
+	// Create the levels, from the first one to the last one
+
+	int const	nZooms	= GetZoomCount( sizeI, sizeJ );
+
+	vector< int >	sizesI( 1, sizeI );
+	vector< int >	sizesJ( 1, sizeJ );
+
+	for ( int level = 1; level < nZooms; level++ )
+	{
+		sizesI.push_back( GetNextLevelSize( sizesI.back() ) );
+		sizesJ.push_back( GetNextLevelSize( sizesJ.back() ) );
+	}
+
+	vector< unique_ptr< Level > >	levels( nZooms );
+
+	for ( int level = nZooms - 1; level >= 0; level-- )
+	{
+		Level * const	pNext	= ( level + 1 < nZooms ) ? levels[ level + 1 ].get() : 0;
+
+		levels[ level ].reset( new Level( *this, sizesI[ level ], sizesJ[ level ], nZooms - 1 - level, pNext, writer ) );
+	}
+
+	// Feed the source to the first level a band at a time
+
+	vector< float >	band( size_t( m_tileSize ) * sizeJ );
+
+	for ( int i = 0; i < sizeI; i += m_tileSize )
+	{
+		int const	count	= min( m_tileSize, sizeI - i );
+
+		if ( !source.Read( HeightFieldMutableView( count, sizeJ, &band[ 0 ] ) ) || !levels[ 0 ]->Add( &band[ 0 ], count ) )
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,112 @@
+/** @file *//********************************************************************************************************
+
+                                                     TilePyramid.h
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/TilePyramid.h#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#pragma once
+
+#include <iosfwd>
+
+class HeightField;
+class HeightFieldMutableView;
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! Builds a quadtree of fixed-size tiles at every level of detail from a HeightField.
+//!
+//! Level 0 is the source. Each following level is half the resolution of the previous one: vertex ( j, i ) of a
+//! level is vertex ( 2j, 2i ) of the previous level, smoothed with a 3x3 triangle filter. A tile covers
+//! @a tileSize cells of its level along each axis, so its last row and column are the first row and column of the
+//! next tile. Each tile also includes a border of @a border vertexes from its neighbors on each side, so a tile
+//! has <tt>tileSize + 1 + 2 * border</tt> vertexes along each axis. Vertexes beyond the edges of a level repeat the
+//! nearest edge vertex. Tiles are identified by a zoom level, where zoom 0 is the single tile covering the whole
+//! heightfield, and the position ( x, y ) of the tile along the J and I axes.
+//!
+//! The source is read a band of rows at a time and all levels are built together as the rows arrive, so only a
+//! few bands of each level are in memory at once. The tiles in a band are built and written in parallel.
+
+class TilePyramid
+{
+public:
+
+	class Source;
+	class Writer;
+
+	//! Constructor
+	explicit TilePyramid( int tileSize = 256, int border = 1 );
+
+	//! Returns the number of vertexes in a tile along each axis, including the borders.
+	int GetTileVertexCount() const			{ return m_tileSize + 1 + 2 * m_border; }
+
+	//! Returns the number of zoom levels in the pyramid of a heightfield of the given size.
+	int GetZoomCount( int sizeI, int sizeJ ) const;
+
+	//! Builds the pyramid of a HeightField.
+	bool Build( HeightField const & hf, Writer & writer ) const;
+
+	//! Builds the pyramid of heights read from a stream.
+	bool Build( std::istream & stream, Writer & writer ) const;
+
+	//! Builds the pyramid of heights read from a source.
+	bool Build( Source & source, Writer & writer ) const;
+
+private:
+
+	class Level;
+
+	int	m_tileSize;		//!< Number of cells covered by a tile along each axis
+	int	m_border;		//!< Number of vertexes added to each side of a tile
+};
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! Supplies the heights of a pyramid's level 0 in order, a band of rows at a time.
+
+class TilePyramid::Source
+{
+public:
+
+	virtual ~Source() {}
+
+	//! Returns the size of the heightfield along the I axis.
+	virtual int GetSizeI() const = 0;
+
+	//! Returns the size of the heightfield along the J axis.
+	virtual int GetSizeJ() const = 0;
+
+	//! Reads the next rows into a view. Returns false if they could not be read.
+	virtual bool Read( HeightFieldMutableView const & rows ) = 0;
+};
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! Receives the tiles of a pyramid.
+//!
+//! @note	Write() is called by several threads at the same time.
+
+class TilePyramid::Writer
+{
+public:
+
+	virtual ~Writer() {}
+
+	//! Writes a tile. Returns false if it could not be written, which stops the build.
+	virtual bool Write( int zoom, int x, int y, HeightField const & tile ) = 0;
+};
@@ -0,0 +1,470 @@
+/** @file *//********************************************************************************************************
+
+                                                VersionedHeightField.cpp
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/VersionedHeightField.cpp#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#include "PrecompiledHeaders.h"
+
+#include "VersionedHeightField.h"
+#include "HeightFieldView.h"
+#include "Parallel.h"
+
+#include <stdexcept>
+
+using namespace std;
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	hf	Initial contents
+//!
+//! @exception	bad_alloc	Unable to allocate the tiles.
+
+VersionedHeightField::VersionedHeightField( HeightField const & hf )
+	: m_sizeI( hf.GetSizeI() ),
+	m_sizeJ( hf.GetSizeJ() ),
+	m_tilesJ( ( hf.GetSizeJ() + TILE_SIZE - 1 ) >> TILE_SHIFT ),
+	m_current( 0 ),
+	m_epoch( 1 )
+{
+	for ( int k = 0; k < MAX_READERS; k++ )
+	{
+		m_readers[ k ].store( 0 );
+		m_readerUsed[ k ].store( false );
+	}
+
+	int const	tilesI	= ( m_sizeI + TILE_SIZE - 1 ) >> TILE_SHIFT;
+
+	Version * const	pVersion	= new Version;
+
+	pVersion->m_number = 0;
+	pVersion->m_tiles.resize( size_t( tilesI ) * m_tilesJ );
+
+	for ( int ti = 0; ti < tilesI; ti++ )
+	{
+		for ( int tj = 0; tj < m_tilesJ; tj++ )
+		{
+			Tile * const	pTile	= new Tile();
+
+			int const	i0	= ti << TILE_SHIFT;
+			int const	j0	= tj << TILE_SHIFT;
+			int const	si	= min( int( TILE_SIZE ), m_sizeI - i0 );
+			int const	sj	= min( int( TILE_SIZE ), m_sizeJ - j0 );
+
+			for ( int i = 0; i < si; i++ )
+			{
+				HeightField::Vertex const * const	pRow	= hf.GetData( j0, i0 + i );
+
+				copy( pRow, pRow + sj, &pTile->m_data[ i * TILE_SIZE ] );
+			}
+
+			pVersion->m_tiles[ ti * m_tilesJ + tj ] = pTile;
+		}
+	}
+
+	m_current.store( pVersion );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @warning	There must not be any Readers, Snapshots or Editors remaining.
+
+VersionedHeightField::~VersionedHeightField()
+{
+	for ( size_t k = 0; k < m_retired.size(); k++ )
+	{
+		delete m_retired[ k ].m_pVersion;
+		delete m_retired[ k ].m_pTile;
+	}
+
+	Version const * const	pVersion	= m_current.load();
+
+	for ( size_t k = 0; k < pVersion->m_tiles.size(); k++ )
+	{
+		delete pVersion->m_tiles[ k ];
+	}
+
+	delete pVersion;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//!
+//! @return		An Editor holding exclusive edit access
+
+VersionedHeightField::Editor VersionedHeightField::Edit()
+{
+	return Editor( *this );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	pVersion	New version
+//! @param	replaced	Tiles in the current version that are not in the new version
+//!
+//! A reader that pins the current epoch after the epoch is advanced is guaranteed to see the new version, so
+//! the old version and its replaced tiles are retired with the epoch before the advance.
+//!
+//! @note	The edit mutex must be held.
+
+void VersionedHeightField::Publish( Version * pVersion, vector<Tile const *> const & replaced )
+{
+	Version const * const		pOld	= m_current.exchange( pVersion );
+	unsigned long long const	epoch	= m_epoch.load();
+
+	Retired	r;
+
+	r.m_epoch		= epoch;
+	r.m_pVersion	= pOld;
+	r.m_pTile		= 0;
+	m_retired.push_back( r );
+
+	r.m_pVersion	= 0;
+	for ( size_t k = 0; k < replaced.size(); k++ )
+	{
+		r.m_pTile = replaced[ k ];
+		m_retired.push_back( r );
+	}
+
+	m_epoch.store( epoch + 1 );
+
+	Reclaim();
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! An object retired in epoch e can be freed if every reader is either idle or pinned in an epoch after e.
+//!
+//! @note	The edit mutex must be held.
+
+void VersionedHeightField::Reclaim()
+{
+	unsigned long long	oldest	= m_epoch.load();
+
+	for ( int k = 0; k < MAX_READERS; k++ )
+	{
+		unsigned long long const	e	= m_readers[ k ].load();
+
+		if ( e != 0 && e < oldest )
+		{
+			oldest = e;
+		}
+	}
+
+	size_t	n	= 0;
+
+	for ( size_t k = 0; k < m_retired.size(); k++ )
+	{
+		if ( m_retired[ k ].m_epoch < oldest )
+		{
+			delete m_retired[ k ].m_pVersion;
+			delete m_retired[ k ].m_pTile;
+		}
+		else
+		{
+			m_retired[ n++ ] = m_retired[ k ];
+		}
+	}
+
+	m_retired.resize( n );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	vhf		Height field to read
+//!
+//! @exception	runtime_error	All reader slots are in use.
+
+VersionedHeightField::Reader::Reader( VersionedHeightField & vhf )
+	: m_vhf( vhf ),
+	m_slot( -1 ),
+	m_pins( 0 )
+{
+	for ( int k = 0; k < MAX_READERS && m_slot < 0; k++ )
+	{
+		bool	expected	= false;
+
+		if ( m_vhf.m_readerUsed[ k ].compare_exchange_strong( expected, true ) )
+		{
+			m_slot = k;
+		}
+	}
+
+	if ( m_slot < 0 )
+	{
+		throw runtime_error( "VersionedHeightField: too many readers" );
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+VersionedHeightField::Reader::~Reader()
+{
+	assert( m_pins == 0 );
+
+	m_vhf.m_readers[ m_slot ].store( 0 );
+	m_vhf.m_readerUsed[ m_slot ].store( false );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//!
+//! @return		A snapshot of the current version. The version remains valid until the snapshot is destroyed.
+//!
+//! Pinning never blocks. Snapshots from the same reader may be nested, in which case the outermost one determines
+//! how long old versions are kept.
+
+VersionedHeightField::Snapshot VersionedHeightField::Reader::Pin()
+{
+	if ( m_pins++ == 0 )
+	{
+		m_vhf.m_readers[ m_slot ].store( m_vhf.m_epoch.load() );
+	}
+
+	return Snapshot( this, m_vhf.m_current.load() );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+VersionedHeightField::Snapshot::Snapshot( Reader * pReader, Version const * pVersion )
+	: m_pReader( pReader ),
+	m_pVersion( pVersion )
+{
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+VersionedHeightField::Snapshot::Snapshot( Snapshot && other )
+	: m_pReader( other.m_pReader ),
+	m_pVersion( other.m_pVersion )
+{
+	other.m_pReader		= 0;
+	other.m_pVersion	= 0;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+VersionedHeightField::Snapshot::~Snapshot()
+{
+	if ( m_pReader && --m_pReader->m_pins == 0 )
+	{
+		m_pReader->m_vhf.m_readers[ m_pReader->m_slot ].store( 0 );
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	hf	Receives the heights of this version. Its storage is reused if it is large enough.
+
+void VersionedHeightField::Snapshot::CopyTo( HeightField & hf ) const
+{
+	int const	sizeI	= GetSizeI();
+	int const	sizeJ	= GetSizeJ();
+
+	hf.Resize( sizeI, sizeJ );
+
+	HeightFieldMutableView const	view	= hf.GetView();
+
+	// The rows are copied in parallel, at least a row of tiles at a time.
+
+	Parallel::For( 0, sizeI, TILE_SIZE, [ & ]( int first, int last )
+	{
+		for ( int i = first; i < last; i++ )
+		{
+			for ( int j0 = 0; j0 < sizeJ; j0 += TILE_SIZE )
+			{
+				Tile const * const	pTile	= m_pVersion->m_tiles[ m_pReader->m_vhf.GetTileIndex( j0, i ) ];
+				int const			sj		= min( int( TILE_SIZE ), sizeJ - j0 );
+
+				HeightField::Vertex const * const	pRow	= &pTile->m_data[ ( i & TILE_MASK ) * TILE_SIZE ];
+
+				copy( pRow, pRow + sj, view.GetData( j0, i ) );
+			}
+		}
+	} );
+
+	hf.UpdateApron();
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+VersionedHeightField::Editor::Editor( VersionedHeightField & vhf )
+	: m_pVhf( &vhf ),
+	m_lock( vhf.m_editMutex )
+{
+	m_tiles = m_pVhf->m_current.load()->m_tiles;
+	m_copied.assign( m_tiles.size(), false );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+VersionedHeightField::Editor::Editor( Editor && other )
+	: m_pVhf( other.m_pVhf ),
+	m_lock( std::move( other.m_lock ) ),
+	m_tiles( std::move( other.m_tiles ) ),
+	m_replaced( std::move( other.m_replaced ) ),
+	m_copied( std::move( other.m_copied ) )
+{
+	other.m_pVhf = 0;
+	other.m_tiles.clear();
+	other.m_copied.clear();
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+VersionedHeightField::Editor::~Editor()
+{
+	for ( size_t k = 0; k < m_copied.size(); k++ )
+	{
+		if ( m_copied[ k ] )
+		{
+			delete m_tiles[ k ];
+		}
+	}
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	j	J index
+//! @param	i	I index
+//!
+//! @return		Z value at ( @a j, @a i ), including uncommitted changes
+
+float VersionedHeightField::Editor::GetZ( int j, int i ) const
+{
+	assert( m_pVhf );
+
+	Tile const * const	pTile	= m_tiles[ m_pVhf->GetTileIndex( j, i ) ];
+	return pTile->m_data[ ( i & TILE_MASK ) * TILE_SIZE + ( j & TILE_MASK ) ].m_Z;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	j	J index
+//! @param	i	I index
+//! @param	z	New value
+//!
+//! The first change to a tile copies it.
+//!
+//! @exception	bad_alloc	Unable to copy the tile.
+
+void VersionedHeightField::Editor::SetZ( int j, int i, float z )
+{
+	assert( m_pVhf );
+
+	int const	t	= m_pVhf->GetTileIndex( j, i );
+
+	if ( !m_copied[ t ] )
+	{
+		m_replaced.reserve( m_replaced.size() + 1 );
+		m_tiles[ t ] = new Tile( *m_tiles[ t ] );
+		m_replaced.push_back( m_pVhf->m_current.load()->m_tiles[ t ] );
+		m_copied[ t ] = true;
+	}
+
+	Tile * const	pTile	= const_cast< Tile * >( m_tiles[ t ] );
+	pTile->m_data[ ( i & TILE_MASK ) * TILE_SIZE + ( j & TILE_MASK ) ].m_Z = z;
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//!
+//! @return		The number of the new version
+//!
+//! @exception	bad_alloc	Unable to allocate the new version. The edit is not affected.
+
+unsigned long long VersionedHeightField::Editor::Commit()
+{
+	assert( m_pVhf );
+
+	VersionedHeightField * const	pVhf	= m_pVhf;
+	Version * const					pNew	= new Version;
+
+	pNew->m_number	= pVhf->m_current.load()->m_number + 1;
+	pNew->m_tiles.swap( m_tiles );
+
+	try
+	{
+		pVhf->m_retired.reserve( pVhf->m_retired.size() + m_replaced.size() + 1 );
+	}
+	catch ( ... )
+	{
+		m_tiles.swap( pNew->m_tiles );
+		delete pNew;
+		throw;
+	}
+
+	unsigned long long const	number	= pNew->m_number;
+
+	pVhf->Publish( pNew, m_replaced );
+
+	// The edit is over
+
+	m_pVhf = 0;
+	m_copied.clear();
+	m_replaced.clear();
+	m_lock.unlock();
+
+	return number;
+}
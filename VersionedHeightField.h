@@ -0,0 +1,265 @@
+/** @file *//********************************************************************************************************
+
+                                                 VersionedHeightField.h
+
+						                    Copyright 2003, John J. Bolton
+	--------------------------------------------------------------------------------------------------------------
+
+	$Header: //depot/Libraries/HeightField/VersionedHeightField.h#1 $
+
+	$NoKeywords: $
+
+ ********************************************************************************************************************/
+
+#pragma once
+
+#include "HeightField.h"
+
+#include <Misc/Assert.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! A height field that can be read by many threads while it is being edited.
+//!
+//! The heights are stored in square tiles. A version is an immutable array of tiles. Readers pin the current
+//! version in a Snapshot and read it without locking. An Editor copies only the tiles it modifies and publishes
+//! a new version atomically when it commits. Replaced tiles and versions are freed using epoch-based reclamation
+//! once no reader can still be using them. Editors are serialized, but readers never wait for them.
+//!
+//! @note	Each thread that reads must use its own Reader.
+
+class VersionedHeightField
+{
+public:
+
+	class Reader;
+	class Snapshot;
+	class Editor;
+
+	//! Maximum number of Readers that can exist at the same time
+	static int const	MAX_READERS	= 64;
+
+	//! Constructor
+	explicit VersionedHeightField( HeightField const & hf );
+
+	//! Destructor
+	~VersionedHeightField();
+
+	//! Returns the size of the heightfield along the I axis.
+	int GetSizeI() const		{ return m_sizeI; }
+
+	//! Returns the size of the heightfield along the J axis.
+	int GetSizeJ() const		{ return m_sizeJ; }
+
+	//! Starts an edit. Blocks until any other edit is done.
+	Editor Edit();
+
+private:
+
+	friend class Reader;
+	friend class Snapshot;
+	friend class Editor;
+
+	enum
+	{
+		TILE_SHIFT	= 6,
+		TILE_SIZE	= 1 << TILE_SHIFT,
+		TILE_MASK	= TILE_SIZE - 1
+	};
+
+	// A square block of heights. Tiles are never modified after they are published.
+	struct Tile
+	{
+		HeightField::Vertex	m_data[ TILE_SIZE * TILE_SIZE ];
+	};
+
+	// An immutable set of tiles
+	struct Version
+	{
+		unsigned long long			m_number;
+		std::vector<Tile const *>	m_tiles;
+	};
+
+	// An object waiting to be freed
+	struct Retired
+	{
+		unsigned long long	m_epoch;	// Epoch when it was retired
+		Version const *		m_pVersion;
+		Tile const *		m_pTile;
+	};
+
+	// Returns the index of the tile containing ( j, i )
+	int GetTileIndex( int j, int i ) const;
+
+	// Publishes a new version and retires the old one
+	void Publish( Version * pVersion, std::vector<Tile const *> const & replaced );
+
+	// Frees everything that no reader can be using
+	void Reclaim();
+
+	VersionedHeightField( VersionedHeightField const & );
+	VersionedHeightField & operator =( VersionedHeightField const & );
+
+	int									m_sizeI;					//!< Size in the I direction
+	int									m_sizeJ;					//!< Size in the J direction
+	int									m_tilesJ;					//!< Number of tiles in the J direction
+	std::atomic<Version const *>		m_current;					//!< Current version
+	std::atomic<unsigned long long>		m_epoch;					//!< Global epoch
+	std::atomic<unsigned long long>		m_readers[ MAX_READERS ];	//!< Epoch pinned by each reader, or 0
+	std::atomic<bool>					m_readerUsed[ MAX_READERS ];	//!< True if the slot belongs to a Reader
+	std::mutex							m_editMutex;				//!< Serializes editors
+	std::vector<Retired>				m_retired;					//!< Objects waiting to be freed
+};
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! A thread's registration for reading a VersionedHeightField.
+
+class VersionedHeightField::Reader
+{
+public:
+
+	//! Constructor
+	explicit Reader( VersionedHeightField & vhf );
+
+	//! Destructor
+	~Reader();
+
+	//! Pins the current version.
+	Snapshot Pin();
+
+private:
+
+	friend class Snapshot;
+
+	Reader( Reader const & );
+	Reader & operator =( Reader const & );
+
+	VersionedHeightField &	m_vhf;		//!< The height field being read
+	int						m_slot;		//!< Index of the reader's epoch slot
+	int						m_pins;		//!< Number of snapshots currently pinned
+};
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! An immutable view of one version of a VersionedHeightField.
+
+class VersionedHeightField::Snapshot
+{
+public:
+
+	//! Move constructor
+	Snapshot( Snapshot && other );
+
+	//! Destructor. Releases the version.
+	~Snapshot();
+
+	//! Returns the version number.
+	unsigned long long GetVersion() const	{ return m_pVersion->m_number; }
+
+	//! Returns the size of the heightfield along the I axis.
+	int GetSizeI() const					{ return m_pReader->m_vhf.m_sizeI; }
+
+	//! Returns the size of the heightfield along the J axis.
+	int GetSizeJ() const					{ return m_pReader->m_vhf.m_sizeJ; }
+
+	//! Returns an element
+	float GetZ( int j, int i ) const;
+
+	//! Copies the version into a HeightField.
+	void CopyTo( HeightField & hf ) const;
+
+private:
+
+	friend class Reader;
+
+	Snapshot( Reader * pReader, Version const * pVersion );
+
+	Snapshot( Snapshot const & );
+	Snapshot & operator =( Snapshot const & );
+
+	Reader *			m_pReader;		//!< Reader that pinned the version
+	Version const *		m_pVersion;		//!< Pinned version
+};
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! An edit of a VersionedHeightField. Changes are not visible to readers until they are committed.
+
+class VersionedHeightField::Editor
+{
+public:
+
+	//! Move constructor
+	Editor( Editor && other );
+
+	//! Destructor. Discards any uncommitted changes.
+	~Editor();
+
+	//! Returns an element
+	float GetZ( int j, int i ) const;
+
+	//! Sets an element
+	void SetZ( int j, int i, float z );
+
+	//! Publishes the changes as a new version and ends the edit.
+	unsigned long long Commit();
+
+private:
+
+	friend class VersionedHeightField;
+
+	explicit Editor( VersionedHeightField & vhf );
+
+	Editor( Editor const & );
+	Editor & operator =( Editor const & );
+
+	VersionedHeightField *				m_pVhf;		//!< The height field being edited
+	std::unique_lock<std::mutex>		m_lock;		//!< Holds the edit mutex
+	std::vector<Tile const *>			m_tiles;	//!< Tiles of the version being built
+	std::vector<Tile const *>			m_replaced;	//!< Tiles that have been copied
+	std::vector<bool>					m_copied;	//!< True for each tile that has been copied
+};
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+inline int VersionedHeightField::GetTileIndex( int j, int i ) const
+{
+	assert_limits( 0, j, m_sizeJ-1 );
+	assert_limits( 0, i, m_sizeI-1 );
+	return ( i >> TILE_SHIFT ) * m_tilesJ + ( j >> TILE_SHIFT );
+}
+
+
+/********************************************************************************************************************/
+/*																													*/
+/********************************************************************************************************************/
+
+//! @param	j	J index
+//! @param	i	I index
+//!
+//! @return		Z value at ( @a j, @a i ) in this version
+
+inline float VersionedHeightField::Snapshot::GetZ( int j, int i ) const
+{
+	Tile const * const	pTile	= m_pVersion->m_tiles[ m_pReader->m_vhf.GetTileIndex( j, i ) ];
+	return pTile->m_data[ ( i & TILE_MASK ) * TILE_SIZE + ( j & TILE_MASK ) ].m_Z;
+}